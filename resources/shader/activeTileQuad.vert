@@ -0,0 +1,36 @@
+#version 430 core
+
+// Draws one quad per tile of the state (instanced); quads of sleeping tiles are degenerate, so their cells are not
+// computed (see ActiveTiles.h).
+
+// has to match ACTIVE_TILE_SIZE in ActiveTiles.h
+#define ACTIVE_TILE_SIZE 16
+
+uniform usampler2D active_tiles;
+// the size of the state texture
+uniform ivec2 state_size;
+
+out vec2 texCoord;
+
+const vec2 corners[4] = vec2[]
+(
+    vec2(0.0, 0.0),
+    vec2(0.0, 1.0),
+    vec2(1.0, 0.0),
+    vec2(1.0, 1.0)
+);
+
+void main()
+{
+    const ivec2 num_tiles = textureSize(active_tiles, 0);
+    const ivec2 tile = ivec2(gl_InstanceID % num_tiles.x, gl_InstanceID / num_tiles.x);
+    if (texelFetch(active_tiles, tile, 0).r == 0u) {
+        texCoord = vec2(0.0);
+        gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+
+    const vec2 cell = vec2(min((tile + corners[gl_VertexID]) * ACTIVE_TILE_SIZE, state_size));
+    texCoord = cell / vec2(state_size);
+    gl_Position = vec4(2.0 * texCoord - 1.0, 0.0, 1.0);
+}
@@ -7,10 +7,12 @@ in vec2 texCoord;
 uniform vec2 quadSize;
 uniform float distance;
 uniform sampler2D heightTexture;
+// maps the texture coordinates of the whole grid to the height texture (scale xy, offset zw)
+uniform vec4 stateTexCoordTransform = vec4(1.0, 1.0, 0.0, 0.0);
 
 layout(location = 0) out vec4 color;
 
 void main()
 {
-    color = vec4(texture(heightTexture, texCoord).rrr, 1.0);
+    color = vec4(texture(heightTexture, texCoord * stateTexCoordTransform.xy + stateTexCoordTransform.zw).rrr, 1.0);
 }
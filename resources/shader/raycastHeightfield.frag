@@ -13,9 +13,49 @@ uniform vec3 sigma_a;
 uniform sampler2D environment;
 uniform sampler2D backgroundTexture;
 uniform sampler2D heightTexture;
+// height gradient in texture coordinates (precomputed central differences, see deriveOutputs.comp)
+uniform sampler2D normalTexture;
+// min (x) and max (y) height of the bilinear cells between the texel centers of the height texture and their mip levels
+uniform sampler2D minMaxPyramid;
 layout(rg32f) uniform image2D backPositionTexture;
+// maps the texture coordinates of the whole grid to the height and normal textures (scale xy, offset zw)
+uniform vec4 stateTexCoordTransform = vec4(1.0, 1.0, 0.0, 0.0);
+// maps the fragment coordinates to the back position texture (scale xy, offset zw, reduced resolution passes)
+uniform vec4 backPositionTransform = vec4(1.0, 1.0, 0.0, 0.0);
+
+#ifdef UPSAMPLE
+// the color and hit (xyz position in texture space, w the packed normal, 0 for no hit) raycast at the reduced resolution
+uniform sampler2D reducedColor;
+uniform sampler2D reducedHit;
+// the size of the reduced resolution and the mapping of fragment coordinates to it (scale xy, offset zw)
+uniform ivec2 reducedSize;
+uniform vec4 reducedTransform;
+// the mean (rgb) and weight (a) of the accumulated samples and the fraction of the weight kept (0 discards them)
+uniform sampler2D history;
+uniform float historyDecay = 0.0;
+#endif
 
 layout(location = 0) out vec4 color;
+#ifdef REDUCED_RESOLUTION
+layout(location = 1) out vec4 hit;
+#endif
+#ifdef UPSAMPLE
+layout(location = 1) out vec4 accumulated;
+#endif
+
+// upper bounds of the traversal (a ray usually hits the height field after a few steps).
+#define MAX_TRAVERSAL_STEPS 256
+#define MAX_REFINEMENT_STEPS 8
+// the refinement stops if the ray height is this close to the height field (in units of the ray parameter).
+#define REFINEMENT_THRESHOLD 1e-5
+// the distance of a reduced resolution hit to the ray (in hit distances of neighbouring reduced pixels) weighted by 1/e
+#define UPSAMPLE_DISTANCE_SIGMA 1.5
+// the exponent of the cosine between the normal of the ray and of a reduced resolution hit
+#define UPSAMPLE_NORMAL_POWER 16.0
+// pixels whose reduced resolution neighbours are weighted less than this use the closest neighbour only
+#define UPSAMPLE_MIN_WEIGHT 0.05
+// the weight of the interpolated color against the accumulated samples close to the pixel center
+#define UPSAMPLE_PRIOR_WEIGHT 1.0
 
 vec3 worldToTex(vec3 x) {
     vec3 offset = vec3(quadSize, distance + 1.0f);
@@ -37,7 +77,7 @@ float heightFieldSphere(vec2 texCoords, vec2 c, float r) {
 }
 
 float heightField(vec2 texCoords) {
-    return simulationHeight * texture(heightTexture, texCoords).r;
+    return simulationHeight * texture(heightTexture, texCoords * stateTexCoordTransform.xy + stateTexCoordTransform.zw).r;
     //return (4.0 * heightFieldSphere(texCoords, vec2(0.5), 0.25))
     //    + (5.0 * heightFieldSphere(texCoords, vec2(0.12, 0.12), 0.09))
     //    + (5.0 * heightFieldSphere(texCoords, vec2(0.12, 0.88), 0.09))
@@ -45,22 +85,106 @@ float heightField(vec2 texCoords) {
     //    + (5.0 * heightFieldSphere(texCoords, vec2(0.88, 0.88), 0.09));
 }
 
-vec3 heightfieldNormal(vec3 p) {
-    const vec2 delta = 1.0f / vec2(textureSize(heightTexture, 0));
-    const vec2 deltaX = vec2(delta.x, 0.0);
-    const vec2 deltaY = vec2(0.0, delta.y);
+// the height of the ray above the height field, the ray parameter lambda goes from the front (0) to the back (1).
+float rayAboveHeightfield(vec2 front, vec2 back, float lambda) {
+    return (1.0 - lambda) - heightField(mix(front, back, lambda));
+}
+
+// searches the intersection of the ray with the height field between a and b (inside a single cell) by regula falsi.
+bool refineCell(vec2 front, vec2 back, float a, float b, out float hit) {
+    hit = a;
+    float fa = rayAboveHeightfield(front, back, a);
+    if (fa <= 0.0) return true;
+    float fb = rayAboveHeightfield(front, back, b);
+    if (fb > 0.0) {
+        // the bilinear height along the ray is quadratic, so the ray may pass through a bump and leave the cell above
+        // the height field again: the minimum of the parabola through a, the midpoint and b is tested.
+        const float fm = rayAboveHeightfield(front, back, 0.5 * (a + b));
+        const float curvature = 2.0 * (fa + fb) - 4.0 * fm;
+        if (curvature <= 0.0) return false;
+        const float tMin = (4.0 * fm - 3.0 * fa - fb) / (-2.0 * curvature);
+        if (tMin <= 0.0 || tMin >= 1.0) return false;
+        const float lambdaMin = mix(a, b, tMin);
+        const float fMin = rayAboveHeightfield(front, back, lambdaMin);
+        if (fMin > 0.0) return false;
+        b = lambdaMin;
+        fb = fMin;
+    }
+
+    hit = b;
+    int side = 0;
+    for (int i = 0; i < MAX_REFINEMENT_STEPS; ++i) {
+        hit = b - fb * (b - a) / (fb - fa);
+        const float fHit = rayAboveHeightfield(front, back, hit);
+        if (abs(fHit) < REFINEMENT_THRESHOLD || b - a < REFINEMENT_THRESHOLD) break;
+        // Illinois variant: halving the value of an end point kept twice keeps the convergence superlinear.
+        if (fHit > 0.0) {
+            a = hit;
+            fa = fHit;
+            if (side == 1) fb *= 0.5;
+            side = 1;
+        } else {
+            b = hit;
+            fb = fHit;
+            if (side == -1) fa *= 0.5;
+            side = -1;
+        }
+    }
+    return true;
+}
+
+// returns the ray parameter of the first intersection with the height field. The ray walks through the cells of the
+// min/max pyramid: cells whose maximum is below the ray are skipped at once and the ray goes up a level, otherwise it
+// descends to the cells between the texel centers, where the bilinear height is intersected by refineCell.
+float traceHeightfield(vec2 front, vec2 back) {
+    const vec2 heightSize = vec2(textureSize(heightTexture, 0));
+    const vec2 cellFront = (front * stateTexCoordTransform.xy + stateTexCoordTransform.zw) * heightSize - 0.5;
+    const vec2 cellBack = (back * stateTexCoordTransform.xy + stateTexCoordTransform.zw) * heightSize - 0.5;
+    const vec2 direction = cellBack - cellFront;
+    // moves positions on a cell border into the cell the ray enters.
+    const vec2 nudge = sign(direction) * 1e-2;
+    const int topLevel = textureQueryLevels(minMaxPyramid) - 1;
+    const ivec2 pyramidSize = textureSize(minMaxPyramid, 0);
+
+    float lambda = max(0.0, 1.0 - simulationHeight * texelFetch(minMaxPyramid, ivec2(0), topLevel).y);
+    int level = topLevel;
+    for (int i = 0; i < MAX_TRAVERSAL_STEPS && lambda < 1.0; ++i) {
+        // the level sizes of glTexStorage2D (textureSize with a lod that differs between invocations is not reliable everywhere).
+        const ivec2 levelSize = max(pyramidSize >> level, ivec2(1));
+        const float cellSize = float(1 << level);
+        const ivec2 cell = clamp(ivec2(floor((cellFront + lambda * direction + nudge) / cellSize)), ivec2(0), levelSize - 1);
+
+        // the cells at the borders extend to infinity (clamp to edge), the last one also covers the rest of odd sizes.
+        const vec2 cellMin = mix(vec2(cell) * cellSize, vec2(-1e30), equal(cell, ivec2(0)));
+        const vec2 cellMax = mix(vec2(cell + 1) * cellSize, vec2(1e30), equal(cell, levelSize - 1));
+        const vec2 exitLambdas = mix((mix(cellMin, cellMax, greaterThan(direction, vec2(0.0))) - cellFront) / direction, vec2(1.0), equal(direction, vec2(0.0)));
+        const float exitLambda = min(min(exitLambdas.x, exitLambdas.y), 1.0);
 
-    vec3 dx0 = vec3(p.xy - deltaX, heightField(p.xy - deltaX));
-    vec3 dx1 = vec3(p.xy + deltaX, heightField(p.xy + deltaX));
-    vec3 tDX = dx1 - dx0;
+        // the ray is below the maximum of the cell from surfaceLambda on.
+        const float surfaceLambda = 1.0 - simulationHeight * texelFetch(minMaxPyramid, cell, level).y;
+        if (surfaceLambda >= exitLambda) {
+            lambda = max(lambda, exitLambda);
+            level = min(level + 1, topLevel);
+            continue;
+        }
+        lambda = max(lambda, surfaceLambda);
+        if (level > 0) {
+            --level;
+            continue;
+        }
 
-    vec3 dy0 = vec3(p.xy - deltaY, heightField(p.xy - deltaY));
-    vec3 dy1 = vec3(p.xy + deltaY, heightField(p.xy + deltaY));
-    vec3 tDY = dy1 - dy0;
+        float hit;
+        if (refineCell(front, back, lambda, exitLambda, hit)) return hit;
+        lambda = max(lambda, exitLambda);
+        level = min(level + 1, topLevel);
+    }
+    return min(lambda, 1.0);
+}
 
-    // vec3 tDX = dFdx(p);
-    // vec3 tDY = dFdy(p);
-    return normalize(cross(tDX, tDY));
+vec3 heightfieldNormal(vec3 p) {
+    // same as normalize(cross(tDX, tDY)) of the central differences of heightField.
+    const vec2 gradient = simulationHeight * texture(normalTexture, p.xy * stateTexCoordTransform.xy + stateTexCoordTransform.zw).rg;
+    return normalize(vec3(-gradient, 1.0));
 }
 
 float reflectivity(vec3 n, vec3 v) {
@@ -71,22 +195,12 @@ float reflectivity(vec3 n, vec3 v) {
     return R0 + (1.0 - R0) * cosTerm2 * cosTerm2 * cosTerm;
 }
 
-void main()
-{
-    // vec3 lightPos = worldToTex(vec3(5, 2, -3));
-    vec3 lightPos = worldToTex(vec3(0.0, 0.0, -10.0));
+// raycasts the height field between the front (t1) and back (t0) positions in texture space.
+vec4 shadeHeightfield(vec3 t1, vec3 t0, out vec3 t) {
     vec3 camPos = worldToTex(cameraPosition);
-
-    vec3 t1 = vec3(texCoord, 1.0f);
-    vec3 t0  = vec3(imageLoad(backPositionTexture, ivec2(gl_FragCoord.xy)).xy, 0.0f);
-    if (t0 == vec3(0.0f)) discard;
     vec3 t1m0 = t1 - t0;
 
-    vec3 t = t0;
-    for (int i = 0; i < 40; ++i) {
-        float h = heightField(t.xy);
-        t = t0 + (h * t1m0);
-    }
+    t = t1 - traceHeightfield(t1.xy, t0.xy) * t1m0;
 
     vec3 normal = heightfieldNormal(t);
 
@@ -104,7 +218,109 @@ void main()
     float R = reflectivity(normal, -v);
     vec3 T = (1.0 - R) * exp(-sigma_a * bgHitLen);
 
-    color = vec4(sqrt(R * cReflection + T * cRefraction), 1.0);
+    return vec4(sqrt(R * cReflection + T * cRefraction), 1.0);
+}
+
+// packs the x and y components of a normal into an integer valued float > 0 (exact in 32 bit).
+float packNormal(vec3 n) {
+    const vec2 q = round((n.xy * 0.5 + 0.5) * 1023.0);
+    return 1.0 + q.x * 1024.0 + q.y;
+}
+
+vec3 unpackNormal(float code) {
+    const float qx = floor((code - 1.0) / 1024.0);
+    const vec2 n = vec2(qx, code - 1.0 - qx * 1024.0) / 1023.0 * 2.0 - 1.0;
+    return vec3(n, sqrt(max(1.0 - dot(n, n), 0.0)));
+}
+
+#ifdef UPSAMPLE
+// joint bilateral upsampling: a reduced resolution hit is used if it lies close to the ray of this pixel (at the
+// height of the hit, relative to the distance between the hits of neighbouring pixels) and has a similar normal.
+// Samples close to the pixel center are also accumulated over jittered frames, so a static view converges to the
+// full resolution.
+void upsample(vec3 t1, vec3 t0, vec2 pixelFootprint) {
+    const vec2 reducedPos = gl_FragCoord.xy * reducedTransform.xy + reducedTransform.zw - 0.5;
+    const ivec2 base = ivec2(floor(reducedPos));
+    const vec2 f = reducedPos - vec2(base);
+    const float sigma = UPSAMPLE_DISTANCE_SIGMA * max(length(pixelFootprint), 1e-6);
+
+    vec4 hits[4];
+    float meanHeight = 0.0;
+    float numHits = 0.0;
+    for (int i = 0; i < 4; ++i) {
+        hits[i] = texelFetch(reducedHit, clamp(base + ivec2(i & 1, i >> 1), ivec2(0), reducedSize - 1), 0);
+        if (hits[i].w == 0.0) continue;
+        meanHeight += hits[i].z;
+        numHits += 1.0;
+    }
+    // the border of the quad may not be covered at the reduced resolution (cleared like the background).
+    if (numHits == 0.0) {
+        color = vec4(0.0);
+        accumulated = vec4(0.0);
+        return;
+    }
+    const vec3 normal = heightfieldNormal(mix(t0, t1, meanHeight / numHits));
+
+    vec3 interpolated = vec3(0.0);
+    float interpolatedWeight = 0.0;
+    vec3 sharp = vec3(0.0);
+    float sharpWeight = 0.0;
+    vec3 nearest = vec3(0.0);
+    float nearestGeometry = -1.0;
+    for (int i = 0; i < 4; ++i) {
+        if (hits[i].w == 0.0) continue;
+        const ivec2 offset = ivec2(i & 1, i >> 1);
+        const vec3 c = texelFetch(reducedColor, clamp(base + offset, ivec2(0), reducedSize - 1), 0).rgb;
+
+        const float d = length(mix(t0.xy, t1.xy, hits[i].z) - hits[i].xy) / sigma;
+        const float geometry = exp(-d * d) * pow(max(dot(normal, unpackNormal(hits[i].w)), 0.0), UPSAMPLE_NORMAL_POWER);
+        if (geometry > nearestGeometry) {
+            nearest = c;
+            nearestGeometry = geometry;
+        }
+        const vec2 bilinear = mix(vec2(1.0) - f, f, vec2(offset));
+        // the distance of the sample to the pixel center in window pixels (a Gaussian with a standard deviation of 0.5).
+        const vec2 toCenter = (vec2(offset) - f) / reducedTransform.xy;
+        const float weight = bilinear.x * bilinear.y * geometry;
+        interpolated += weight * c;
+        interpolatedWeight += weight;
+        sharp += geometry * exp(-2.0 * dot(toCenter, toCenter)) * c;
+        sharpWeight += geometry * exp(-2.0 * dot(toCenter, toCenter));
+    }
+
+    // discontinuities without a matching neighbour use the closest hit (nearest depth upsampling).
+    interpolated = interpolatedWeight >= UPSAMPLE_MIN_WEIGHT ? interpolated / interpolatedWeight : nearest;
+
+    accumulated = historyDecay > 0.0 ? texelFetch(history, ivec2(gl_FragCoord.xy), 0) : vec4(0.0);
+    accumulated.a *= historyDecay;
+    accumulated.rgb = (accumulated.rgb * accumulated.a + sharp) / max(accumulated.a + sharpWeight, 1e-6);
+    accumulated.a += sharpWeight;
+    color = vec4(mix(interpolated, accumulated.rgb, accumulated.a / (accumulated.a + UPSAMPLE_PRIOR_WEIGHT)), 1.0);
+}
+#endif
+
+void main()
+{
+    // vec3 lightPos = worldToTex(vec3(5, 2, -3));
+    vec3 lightPos = worldToTex(vec3(0.0, 0.0, -10.0));
+#ifdef UPSAMPLE
+    // the distance in texture space between the rays of neighbouring reduced pixels (before discarding fragments).
+    const vec2 pixelFootprint = max(abs(dFdx(texCoord)), abs(dFdy(texCoord))) / reducedTransform.xy;
+#endif
+
+    vec3 t1 = vec3(texCoord, 1.0f);
+    vec3 t0  = vec3(imageLoad(backPositionTexture, ivec2(gl_FragCoord.xy * backPositionTransform.xy + backPositionTransform.zw)).xy, 0.0f);
+    if (t0 == vec3(0.0f)) discard;
+
+#ifdef UPSAMPLE
+    upsample(t1, t0, pixelFootprint);
+#else
+    vec3 t;
+    color = shadeHeightfield(t1, t0, t);
+#ifdef REDUCED_RESOLUTION
+    hit = vec4(t, packNormal(heightfieldNormal(t)));
+#endif
+#endif
     
     // color = vec4(t0.xy, 0.0, 1.0);
     // vec3 l = lightPos;// vec3(0.5, 0.5, 5.0);
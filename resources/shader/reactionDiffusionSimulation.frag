@@ -1,51 +1,99 @@
 #version 430 core
 
+// State formats (selected by defines):
+//   default:       RG32F state
+//   STATE_FLOAT16: RG16F state, same arithmetic as the default
+//   STATE_FIXED16: RG16UI state with 15 fractional bits, evaluated in integer arithmetic with explicit rounding so
+//                  all drivers compute bit-identical results (see simulation/FixedPoint.h)
+
 // input attributes
 in vec2 texCoord;
 
 // output attributes
+#ifdef STATE_FIXED16
+layout(location = 0) out uvec4 AB_next;
+#else
 layout(location = 0) out vec4 AB_next;
-layout(location = 1) out vec4 result;
+#endif
 
 // uniforms
+#ifdef STATE_FIXED16
+uniform usampler2D texture_0;
+#else
 uniform sampler2D texture_0;
+#endif
 
 //uniform vec2 inv_tex_dim;
 
-uniform float diffusion_rate_A = 1.0;
-uniform float diffusion_rate_B = 0.5;
-uniform float feed_rate = 0.055;
-uniform float kill_rate = 0.062;
-uniform float dt = 1.0;
+// has to match SimulationParameterUniforms in SimulationParameterBlock.h
+layout(std140, binding = 0) uniform SimulationParameters
+{
+    float diffusion_rate_A;
+    float diffusion_rate_B;
+    float feed_rate;
+    float kill_rate;
+    float dt;
+    float seed_point_radius;
+    int use_manhattan_distance;
+    // fixed point coefficients with 16 fractional bits
+    int fixed_diffusion_A;
+    int fixed_diffusion_B;
+    int fixed_dt;
+    int fixed_feed;
+    int fixed_kill_feed;
+};
+
+// seed points are applied to the state before the iteration by seedSplat.frag.
+
+#ifdef STATE_FIXED16
+const int FIXED_ONE = 1 << 15;
+
+// round(a * b / 2^s) with a 64 bit intermediate (round half up).
+int mulShift(int a, int b, int s)
+{
+    int msb, lsb;
+    imulExtended(a, b, msb, lsb);
+    uint carry;
+    const uint sum = uaddCarry(uint(lsb), 1u << (s - 1), carry);
+    msb += int(carry);
+    return (msb << (32 - s)) | int(sum >> s);
+}
+
+ivec2 fetchAB(ivec2 p, ivec2 offset, ivec2 tex_size)
+{
+    return ivec2(texelFetch(texture_0, clamp(p + offset, ivec2(0), tex_size - 1), 0).rg);
+}
+
+void main()
+{
+    const ivec2 tex_size = textureSize(texture_0, 0);
+    const ivec2 p = ivec2(gl_FragCoord.xy);
+    const ivec2 AB = fetchAB(p, ivec2(0, 0), tex_size);
+    const int A = AB.r;
+    const int B = AB.g;
+
+    // 20 * Laplacian: weights 1 (corners), 4 (edges), -20 (center)
+    const ivec2 laplace_AB_20 = fetchAB(p, ivec2(-1,  1), tex_size) + fetchAB(p, ivec2( 1,  1), tex_size)
+                              + fetchAB(p, ivec2(-1, -1), tex_size) + fetchAB(p, ivec2( 1, -1), tex_size)
+                              + 4 * (fetchAB(p, ivec2( 0,  1), tex_size) + fetchAB(p, ivec2( 0, -1), tex_size)
+                                   + fetchAB(p, ivec2(-1,  0), tex_size) + fetchAB(p, ivec2( 1,  0), tex_size))
+                              - 20 * AB;
 
-uniform float seed_point_radius = 0.001;
-uniform uint num_seed_points = 0;
-const uint max_seed_points = 10;
-uniform vec2 seed_points[max_seed_points];
-uniform bool use_manhattan_distance = false;
+    const int ABB = mulShift(mulShift(A, B, 15), B, 15);
+    const int A_next = A + mulShift(fixed_diffusion_A, laplace_AB_20.r, 16)
+                         + mulShift(fixed_dt, mulShift(fixed_feed, FIXED_ONE - A, 16) - ABB, 16);
+    const int B_next = B + mulShift(fixed_diffusion_B, laplace_AB_20.g, 16)
+                         + mulShift(fixed_dt, ABB - mulShift(fixed_kill_feed, B, 16), 16);
 
+    AB_next = uvec4(clamp(A_next, 0, FIXED_ONE), clamp(B_next, 0, FIXED_ONE), 0, 0);
+}
+#else
 vec2 laplaceAB() // vec2 laplaceAB(vec2 inv_tex_dim)
 {
     // 0.0500    0.2000    0.0500
     // 0.2000   -1.0000    0.2000
     // 0.0500    0.2000    0.0500
 
-    /*
-    const vec2 tex_dim = textureSize(texture_0, 0).xy;
-    const vec2 inv_tex_dim = 1.0 / tex_dim;
-    const float inv_tex_dim_x = inv_tex_dim.x;
-    const float inv_tex_dim_y = inv_tex_dim.y;
-    return 0.05 * texture(texture_0, texCoord + vec2(-inv_tex_dim_x, inv_tex_dim_y)).rg // upper line
-         + 0.20 * texture(texture_0, texCoord + vec2(0.0, inv_tex_dim_y)).rg
-         + 0.05 * texture(texture_0, texCoord + vec2(inv_tex_dim_x, inv_tex_dim_y)).rg
-         + 0.20 * texture(texture_0, texCoord + vec2(-inv_tex_dim_x, 0.0)).rg // middle line
-         -        texture(texture_0, texCoord).rg
-         + 0.20 * texture(texture_0, texCoord + vec2(inv_tex_dim_x, 0.0)).rg
-         + 0.05 * texture(texture_0, texCoord + vec2(-inv_tex_dim_x, -inv_tex_dim_y)).rg // lower line
-         + 0.20 * texture(texture_0, texCoord + vec2(0.0, -inv_tex_dim_y)).rg
-         + 0.05 * texture(texture_0, texCoord + vec2(inv_tex_dim_x, -inv_tex_dim_y)).rg;
-    */
-
     return 0.05 * textureOffset(texture_0, texCoord, ivec2(-1,  1)).rg // upper line
          + 0.20 * textureOffset(texture_0, texCoord, ivec2( 0,  1)).rg
          + 0.05 * textureOffset(texture_0, texCoord, ivec2( 1,  1)).rg
@@ -59,28 +107,9 @@ vec2 laplaceAB() // vec2 laplaceAB(vec2 inv_tex_dim)
 
 void main()
 {
-    const vec2 tex_dim = textureSize(texture_0, 0).xy;
-    //const vec2 inv_tex_dim = 1.0 / tex_dim;
     const vec2 AB = texture(texture_0, texCoord).rg;
     const float A = AB.r;
-    float B = AB.g; // TODO: add const here when brush shader is available
-
-    for (int i = 0; i < num_seed_points; ++i) {
-        vec2 seed_point = abs(texCoord - seed_points[i]);
-        seed_point.x *= tex_dim.x / tex_dim.y; // fix aspect ratio
-        if (use_manhattan_distance) {
-            const float d = seed_point.x + seed_point.y;
-            if (d < seed_point_radius) {
-                B = 1.0;
-            }
-        } else {
-            const float d = dot(seed_point, seed_point);
-            const float r = seed_point_radius * seed_point_radius;
-            if (d < r) {// && d > 0.9 * r) {
-                B = 1.0;
-            }
-        }
-    }
+    const float B = AB.g;
 
     const vec2 laplace_AB = laplaceAB();
     const float laplace_A = laplace_AB.r;
@@ -90,8 +119,6 @@ void main()
     const float A_next = A + (diffusion_rate_A * laplace_A - ABB + feed_rate * (1 - A)) * dt;
     const float B_next = B + (diffusion_rate_B * laplace_B + ABB - (kill_rate + feed_rate) * B) * dt;
 
-    const float result_value = 1.0 - clamp(A_next - B_next, 0.0, 1.0);
-    //const float result_value = clamp(A_next - B_next, 0.0, 1.0);
-    result = vec4(result_value, result_value, result_value, 1.0);
     AB_next = vec4(clamp(A_next, 0.0, 1.0), clamp(B_next, 0.0, 1.0), 1.0, 1.0);
 }
+#endif
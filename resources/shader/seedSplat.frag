@@ -0,0 +1,51 @@
+#version 430 core
+
+// Sets B = 1 inside a seed point stamp. Only the B channel is written (color mask), A stays unchanged.
+// STATE_FIXED16 selects the fixed point state as in reactionDiffusionSimulation.frag.
+
+in vec2 texCoord;
+flat in vec2 seedPoint;
+
+#ifdef STATE_FIXED16
+layout(location = 0) out uvec4 AB;
+#else
+layout(location = 0) out vec4 AB;
+#endif
+
+// has to match SimulationParameterUniforms in SimulationParameterBlock.h
+layout(std140, binding = 0) uniform SimulationParameters
+{
+    float diffusion_rate_A;
+    float diffusion_rate_B;
+    float feed_rate;
+    float kill_rate;
+    float dt;
+    float seed_point_radius;
+    int use_manhattan_distance;
+    // fixed point coefficients with 16 fractional bits
+    int fixed_diffusion_A;
+    int fixed_diffusion_B;
+    int fixed_dt;
+    int fixed_feed;
+    int fixed_kill_feed;
+};
+
+// the size of the whole grid, texCoord and seedPoint are grid coordinates
+uniform vec2 grid_dim;
+
+void main()
+{
+    vec2 seed_point = abs(texCoord - seedPoint);
+    seed_point.x *= grid_dim.x / grid_dim.y; // fix aspect ratio
+    if (use_manhattan_distance != 0) {
+        if (seed_point.x + seed_point.y >= seed_point_radius) discard;
+    } else {
+        if (dot(seed_point, seed_point) >= seed_point_radius * seed_point_radius) discard;
+    }
+
+#ifdef STATE_FIXED16
+    AB = uvec4(0, 1 << 15, 0, 0);
+#else
+    AB = vec4(0.0, 1.0, 0.0, 0.0);
+#endif
+}
@@ -0,0 +1,51 @@
+#version 430 core
+
+// Draws one quad per seed point covering the bounding box of its stamp (instanced, positions from a buffer).
+
+layout(std430, binding = 0) readonly buffer SeedPoints
+{
+    vec2 seed_points[];
+};
+
+// has to match SimulationParameterUniforms in SimulationParameterBlock.h
+layout(std140, binding = 0) uniform SimulationParameters
+{
+    float diffusion_rate_A;
+    float diffusion_rate_B;
+    float feed_rate;
+    float kill_rate;
+    float dt;
+    float seed_point_radius;
+    int use_manhattan_distance;
+    // fixed point coefficients with 16 fractional bits
+    int fixed_diffusion_A;
+    int fixed_diffusion_B;
+    int fixed_dt;
+    int fixed_feed;
+    int fixed_kill_feed;
+};
+
+// the size of the state texture, the whole grid and the grid cell at its origin (see SimulationDomain.h)
+uniform vec2 tex_dim;
+uniform vec2 grid_dim;
+uniform vec2 domain_origin;
+
+out vec2 texCoord;
+flat out vec2 seedPoint;
+
+const vec2 corners[4] = vec2[]
+(
+    vec2(-1.0, -1.0),
+    vec2(-1.0,  1.0),
+    vec2( 1.0, -1.0),
+    vec2( 1.0,  1.0)
+);
+
+void main()
+{
+    seedPoint = seed_points[gl_InstanceID];
+    // x distances are scaled by the aspect ratio in seedSplat.frag; one texel of padding covers rasterization rounding.
+    const vec2 extent = seed_point_radius * vec2(grid_dim.y / grid_dim.x, 1.0) + 1.0 / grid_dim;
+    texCoord = seedPoint + corners[gl_VertexID] * extent;
+    gl_Position = vec4(2.0 * (texCoord * grid_dim - domain_origin) / tex_dim - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,142 @@
+/**
+ * @file   ActiveTiles.cpp
+ *
+ * @brief  Implementation of the activity mask letting quiescent tiles of the simulation grid sleep.
+ */
+
+#include "core/open_gl.h"
+#include "ActiveTiles.h"
+#include "core/app/ApplicationNodeBase.h"
+
+namespace viscom {
+
+    /** Has to match the local size of activeTilesDilate.comp. */
+    constexpr GLuint DILATE_LOCAL_SIZE = 8;
+
+    namespace {
+        GLuint CreateTileTexture(const glm::uvec2& size)
+        {
+            GLuint texture = 0;
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8UI, static_cast<GLsizei>(size.x), static_cast<GLsizei>(size.y));
+            // integer textures are incomplete with linear filtering.
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            return texture;
+        }
+    }
+
+    ActiveTiles::ActiveTiles(ApplicationNodeBase* appNode, const glm::uvec2& size) :
+        numTiles_{ (size + glm::uvec2(ACTIVE_TILE_SIZE - 1)) / ACTIVE_TILE_SIZE }
+    {
+        changeProgram_ = appNode->GetGPUProgramManager().GetResource("activeTilesChange", std::vector<std::string>{ "activeTilesChange.comp" });
+        changeStateLoc_ = changeProgram_->getUniformLocation("state");
+        changePreviousStateLoc_ = changeProgram_->getUniformLocation("previous_state");
+        changeThresholdLoc_ = changeProgram_->getUniformLocation("threshold");
+        changeFixedProgram_ = appNode->GetGPUProgramManager().GetResource("activeTilesChangeFixed16",
+            std::vector<std::string>{ "activeTilesChange.comp" }, std::vector<std::string>{ "STATE_FIXED16" });
+        changeFixedStateLoc_ = changeFixedProgram_->getUniformLocation("state");
+        changeFixedPreviousStateLoc_ = changeFixedProgram_->getUniformLocation("previous_state");
+        changeFixedThresholdLoc_ = changeFixedProgram_->getUniformLocation("threshold");
+        dilateProgram_ = appNode->GetGPUProgramManager().GetResource("activeTilesDilate", std::vector<std::string>{ "activeTilesDilate.comp" });
+
+        changedTexture_ = CreateTileTexture(numTiles_);
+        maskTexture_ = CreateTileTexture(numTiles_);
+        for (auto& pendingCount : pendingCounts_) {
+            glGenBuffers(1, &pendingCount.buffer_);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, pendingCount.buffer_);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        WakeAll();
+    }
+
+    ActiveTiles::~ActiveTiles()
+    {
+        for (auto& pendingCount : pendingCounts_) {
+            if (pendingCount.fence_ != nullptr) glDeleteSync(pendingCount.fence_);
+            glDeleteBuffers(1, &pendingCount.buffer_);
+        }
+        const std::array<GLuint, 2> textures{ { changedTexture_, maskTexture_ } };
+        glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+    }
+
+    void ActiveTiles::WakeAll()
+    {
+        WakeCells(GridRect{ glm::ivec2(0), glm::ivec2(numTiles_ * ACTIVE_TILE_SIZE) });
+        activeFraction_ = 1.0f;
+    }
+
+    void ActiveTiles::WakeCells(const GridRect& cells)
+    {
+        const auto tileSize = static_cast<int>(ACTIVE_TILE_SIZE);
+        const GridRect tiles{ cells.min_ / tileSize - 1, (cells.max_ + tileSize - 1) / tileSize + 1 };
+        const auto wakeTiles = tiles.Intersect(GridRect{ glm::ivec2(0), glm::ivec2(numTiles_) });
+        if (wakeTiles.IsEmpty()) return;
+
+        const auto size = wakeTiles.GetSize();
+        wakeData_.resize(static_cast<std::size_t>(size.x) * size.y, 1);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, maskTexture_);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, wakeTiles.min_.x, wakeTiles.min_.y, size.x, size.y, GL_RED_INTEGER, GL_UNSIGNED_BYTE, wakeData_.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    void ActiveTiles::Update(GLuint state, GLuint previousState, StateFormat format, float threshold, std::uint64_t steps)
+    {
+        const auto fixedPoint = format == StateFormat::Fixed16;
+        glUseProgram((fixedPoint ? changeFixedProgram_ : changeProgram_)->getProgramId());
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, state);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, previousState);
+        glUniform1i(fixedPoint ? changeFixedStateLoc_ : changeStateLoc_, 0);
+        glUniform1i(fixedPoint ? changeFixedPreviousStateLoc_ : changePreviousStateLoc_, 1);
+        // the textures are steps iterations apart.
+        glUniform1f(fixedPoint ? changeFixedThresholdLoc_ : changeThresholdLoc_, threshold * static_cast<float>(steps));
+        glBindImageTexture(0, changedTexture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8UI);
+        glDispatchCompute(numTiles_.x, numTiles_.y, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // a count still in flight is dropped.
+        auto& pendingCount = pendingCounts_[nextCount_];
+        nextCount_ = (nextCount_ + 1) % pendingCounts_.size();
+        if (pendingCount.fence_ != nullptr) glDeleteSync(pendingCount.fence_);
+        const GLuint zero = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, pendingCount.buffer_);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &zero);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, pendingCount.buffer_);
+
+        glUseProgram(dilateProgram_->getProgramId());
+        glBindImageTexture(0, changedTexture_, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R8UI);
+        glBindImageTexture(1, maskTexture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8UI);
+        glDispatchCompute((numTiles_.x + DILATE_LOCAL_SIZE - 1) / DILATE_LOCAL_SIZE, (numTiles_.y + DILATE_LOCAL_SIZE - 1) / DILATE_LOCAL_SIZE, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        pendingCount.fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    void ActiveTiles::Poll()
+    {
+        for (auto& pendingCount : pendingCounts_) {
+            if (pendingCount.fence_ == nullptr) continue;
+            const auto status = glClientWaitSync(pendingCount.fence_, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) continue;
+            glDeleteSync(pendingCount.fence_);
+            pendingCount.fence_ = nullptr;
+
+            GLuint activeTiles = 0;
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, pendingCount.buffer_);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &activeTiles);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            activeFraction_ = static_cast<float>(activeTiles) / static_cast<float>(numTiles_.x * numTiles_.y);
+        }
+    }
+}
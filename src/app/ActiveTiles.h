@@ -0,0 +1,87 @@
+/**
+ * @file   ActiveTiles.h
+ *
+ * @brief  Declaration of the activity mask letting quiescent tiles of the simulation grid sleep.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "app/SimulationData.h"
+#include "app/SimulationDomain.h"
+#include <array>
+#include <vector>
+
+namespace viscom {
+
+    class ApplicationNodeBase;
+    class GPUProgram;
+
+    /** The size of the tiles in cells (has to match ACTIVE_TILE_SIZE in the shaders). */
+    constexpr unsigned int ACTIVE_TILE_SIZE = 16;
+    /** The iterations between updates of the mask (at most ACTIVE_TILE_SIZE, so a change cannot cross a sleeping tile). */
+    constexpr std::uint64_t ACTIVE_TILE_UPDATE_INTERVAL = 8;
+
+    /**
+     *  Splits the state into tiles of ACTIVE_TILE_SIZE^2 cells with a mask (R8UI, one texel per tile) of the tiles
+     *  the simulation passes compute. Every ACTIVE_TILE_UPDATE_INTERVAL iterations the two state textures are
+     *  compared: tiles in which no cell changed by more than the threshold go to sleep, unless a neighbouring tile
+     *  changed. Sleeping tiles keep the values in both state textures, which differ by less than the threshold.
+     *  Seed points and writes of the whole state wake the tiles again.
+     */
+    class ActiveTiles
+    {
+    public:
+        ActiveTiles(ApplicationNodeBase* appNode, const glm::uvec2& size);
+        ActiveTiles(const ActiveTiles&) = delete;
+        ActiveTiles& operator=(const ActiveTiles&) = delete;
+        ~ActiveTiles();
+
+        /** Wakes all tiles (after the state was replaced). */
+        void WakeAll();
+        /** Wakes the tiles overlapping the given cells of the state and their neighbours. */
+        void WakeCells(const GridRect& cells);
+        /** Updates the mask from the change between the two state textures (written steps iterations apart). */
+        void Update(GLuint state, GLuint previousState, StateFormat format, float threshold, std::uint64_t steps);
+        /** Reads back the number of active tiles of finished updates (does not wait for the GPU). */
+        void Poll();
+
+        GLuint GetMaskTexture() const { return maskTexture_; }
+        const glm::uvec2& GetNumTiles() const { return numTiles_; }
+        /** Returns the fraction of active tiles after the last update read back. */
+        float GetActiveFraction() const { return activeFraction_; }
+
+    private:
+        /** A count of active tiles computed on the GPU but not read back yet. */
+        struct PendingCount {
+            GLuint buffer_ = 0;
+            GLsync fence_ = nullptr;
+        };
+
+        /** The number of tiles in x and y. */
+        glm::uvec2 numTiles_;
+        /** The tiles that changed in the last update and the mask (both R8UI). */
+        GLuint changedTexture_ = 0;
+        GLuint maskTexture_ = 0;
+        /** Ones for waking tiles (reused to avoid allocations). */
+        std::vector<std::uint8_t> wakeData_;
+
+        /** Programs finding the changed tiles of floating point and fixed point states and their uniform locations. */
+        std::shared_ptr<GPUProgram> changeProgram_;
+        std::shared_ptr<GPUProgram> changeFixedProgram_;
+        GLint changeStateLoc_ = -1;
+        GLint changePreviousStateLoc_ = -1;
+        GLint changeThresholdLoc_ = -1;
+        GLint changeFixedStateLoc_ = -1;
+        GLint changeFixedPreviousStateLoc_ = -1;
+        GLint changeFixedThresholdLoc_ = -1;
+        /** Program computing the mask from the changed tiles. */
+        std::shared_ptr<GPUProgram> dilateProgram_;
+
+        /** The counts in flight (used alternately). */
+        std::array<PendingCount, 2> pendingCounts_;
+        std::size_t nextCount_ = 0;
+        /** The fraction of active tiles after the last update read back. */
+        float activeFraction_ = 1.0f;
+    };
+}
@@ -11,7 +11,6 @@
 #include "Vertices.h"
 #include <imgui.h>
 #include "core/gfx/mesh/MeshRenderable.h"
-#include "core/gfx/FullscreenQuad.h"
 #include <iostream>
 #include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -19,91 +18,348 @@
 #include <glm/gtc/type_ptr.hpp>
 #include "app/renderers/HeightfieldRaycaster.h"
 #include "app/renderers/SimpleGreyScaleRenderer.h"
+#include "app/simulation/CPUSimulator.h"
+#include "app/simulation/FixedPoint.h"
+#include "app/DerivedOutputs.h"
+#include "app/IterationScheduler.h"
+#include "app/SimulationParameterBlock.h"
+#include "app/Checkpoint.h"
+#include "app/FrameRecorder.h"
+#include "app/FrameProfiler.h"
+#include "app/StateSync.h"
+#include "app/SimulationDomain.h"
+#include "app/ActiveTiles.h"
+#include "app/ConvergenceMonitor.h"
+#include "app/StepErrorEstimator.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <spdlog/spdlog.h>
 
 
 #include <iostream>
 
 namespace viscom {
 
+    namespace {
+        /** Texture format and program name suffix / defines of a state format. */
+        struct StateFormatDescriptor {
+            GLenum stateFormat_;
+            const char* programSuffix_;
+            const char* define_;
+        };
+
+        /** Has to match the order of StateFormat. */
+        const std::array<StateFormatDescriptor, STATE_FORMAT_NAMES.size()> STATE_FORMAT_DESCRIPTORS{ {
+            { GL_RG32F, "", nullptr },
+            { GL_RG16F, "FP16", "STATE_FLOAT16" },
+            { GL_RG16UI, "Fixed16", "STATE_FIXED16" }
+        } };
+
+        const StateFormatDescriptor& GetStateFormatDescriptor(StateFormat format)
+        {
+            return STATE_FORMAT_DESCRIPTORS[static_cast<std::size_t>(format)];
+        }
+    }
+
     ApplicationNodeImplementation::ApplicationNodeImplementation(ApplicationNodeInternal* appNode) :
         ApplicationNodeBase{ appNode }
     {
-        FrameBufferDescriptor reactDiffuseFBDesc;
-        reactDiffuseFBDesc.texDesc_.emplace_back(GL_RG32F, GL_TEXTURE_2D);
-        reactDiffuseFBDesc.texDesc_.emplace_back(GL_RG32F, GL_TEXTURE_2D);
-        reactDiffuseFBDesc.texDesc_.emplace_back(GL_R32F, GL_TEXTURE_2D);
-        reactDiffuseFBO_ = std::make_unique<FrameBuffer>(SIMULATION_SIZE_X, SIMULATION_SIZE_Y, reactDiffuseFBDesc);
+#ifdef RD_PROFILING
+        frameProfiler_ = std::make_unique<FrameProfiler>();
+#endif
+        LoadSimulationConfig();
+        const auto gridSize = simData_.gridSize_ * (USE_DOMAIN_DECOMPOSITION ? DOMAIN_GRID_SCALE : 1u);
+        const auto tile = USE_DOMAIN_DECOMPOSITION ? GetViewportTile(gridSize) : GridRect{ glm::ivec2(0), glm::ivec2(gridSize) };
+        domain_ = std::make_unique<SimulationDomain>(gridSize, GetClusterNodeIndex(), tile);
+        simulationSize_ = domain_->GetStateSize();
+        if (domain_->IsDecomposed()) {
+            spdlog::info("Simulating cells [{}, {}) x [{}, {}) of the {}x{} grid.", domain_->GetStateRect().min_.x, domain_->GetStateRect().max_.x,
+                domain_->GetStateRect().min_.y, domain_->GetStateRect().max_.y, gridSize.x, gridSize.y);
+        }
+
+        CreateSimulationBuffers(activeStateFormat_);
+        derivedOutputs_ = std::make_unique<DerivedOutputs>(this, simulationSize_);
+        derivedOutputs_->SetGridPlacement(gridSize, domain_->GetStateRect().min_);
+        activeTiles_ = std::make_unique<ActiveTiles>(this, simulationSize_);
+        iterationScheduler_ = std::make_unique<IterationScheduler>();
+        simParameters_ = std::make_unique<SimulationParameterBlock>();
+        UpdateParameterGridScale();
+        stateHasher_ = std::make_unique<StateHasher>(this);
+        convergenceMonitor_ = std::make_unique<ConvergenceMonitor>(this);
+        stepErrorEstimator_ = std::make_unique<StepErrorEstimator>(this);
 
         renderers_.push_back(std::make_unique<renderers::HeightfieldRaycaster>(this));
         renderers_.push_back(std::make_unique<renderers::SimpleGreyScaleRenderer>(this));
 
-        reactionDiffusionFullScreenQuad_ = CreateFullscreenQuad("reactionDiffusionSimulation.frag");
-        const auto rdGpuProgram = reactionDiffusionFullScreenQuad_->GetGPUProgram();
-        rdPrevIterationTextureLoc_ = rdGpuProgram->getUniformLocation("texture_0");
-        rdDiffusionRateALoc_ = rdGpuProgram->getUniformLocation("diffusion_rate_A");
-        rdDiffusionRateBLoc_ = rdGpuProgram->getUniformLocation("diffusion_rate_B");
-        rdFeedRateLoc_ = rdGpuProgram->getUniformLocation("feed_rate");
-        rdKillRateLoc_ = rdGpuProgram->getUniformLocation("kill_rate");
-        rdDtLoc_ = rdGpuProgram->getUniformLocation("dt");
-        rdSeedPointRadiusLoc_ = rdGpuProgram->getUniformLocation("seed_point_radius");
-        rdNumSeedPointsLoc_ = rdGpuProgram->getUniformLocation("num_seed_points");
-        rdSeedPointsLoc_ = rdGpuProgram->getUniformLocation("seed_points");
-        rdUseManhattanDistanceLoc_ = rdGpuProgram->getUniformLocation("use_manhattan_distance");
-
-        seed_points_.clear();
+        glGenVertexArrays(1, &simulationQuadVAO_);
+        glGenBuffers(1, &seedPointBuffer_);
+        CreateSimulationPrograms(activeStateFormat_);
+
+        seedEvents_.Clear();
         ResetSimulation();
     }
 
-    ApplicationNodeImplementation::~ApplicationNodeImplementation() = default;
+    ApplicationNodeImplementation::~ApplicationNodeImplementation()
+    {
+        if (simulationQuadVAO_ != 0) glDeleteVertexArrays(1, &simulationQuadVAO_);
+        simulationQuadVAO_ = 0;
+        if (seedPointBuffer_ != 0) glDeleteBuffers(1, &seedPointBuffer_);
+        seedPointBuffer_ = 0;
+        if (haloReadFBO_ != 0) glDeleteFramebuffers(1, &haloReadFBO_);
+        haloReadFBO_ = 0;
+    }
+
+    void ApplicationNodeImplementation::LoadSimulationConfig()
+    {
+        const auto configFile = GetConfig().resourceSearchPaths_.back() + "/simulation.txt";
+        if (!utils::file_exists(configFile)) return;
+
+        std::ifstream ifs(configFile);
+        std::string str;
+        while (ifs >> str && ifs.good()) {
+            if (str == "gridSize.x=") ifs >> simData_.gridSize_.x;
+            else if (str == "gridSize.y=") ifs >> simData_.gridSize_.y;
+            else if (str == "scaleParametersToGrid=") ifs >> simData_.scaleParametersToGrid_;
+            else if (str == "dynamicResolution=") ifs >> simData_.dynamicResolution_;
+        }
+        simData_.gridSize_ = glm::max(simData_.gridSize_, glm::uvec2(1));
+    }
+
+    void ApplicationNodeImplementation::ResizeSimulation(const glm::uvec2& gridSize)
+    {
+        // the CPU state is resampled on the GPU like the others.
+        if (activeBackend_ == SimulationBackend::CPU) UploadCPUState();
+        const std::unique_ptr<FrameBuffer> previousFBO = std::move(reactDiffuseFBO_);
+        const auto previousState = previousFBO->GetTextures()[iterationToggle_ ? 1 : 0];
+
+        domain_ = std::make_unique<SimulationDomain>(gridSize, domain_->GetNode(), GridRect{ glm::ivec2(0), glm::ivec2(gridSize) });
+        simulationSize_ = domain_->GetStateSize();
+        CreateSimulationBuffers(activeStateFormat_);
+
+        // has to match LOCAL_SIZE in resampleState.comp.
+        constexpr GLuint LOCAL_SIZE = 16;
+        glUseProgram(resampleStateProgram_->getProgramId());
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, previousState);
+        glUniform1i(rsStateLoc_, 0);
+        glBindImageTexture(0, GetCurrentStateTexture(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GetStateFormatDescriptor(activeStateFormat_).stateFormat_);
+        glDispatchCompute((simulationSize_.x + LOCAL_SIZE - 1) / LOCAL_SIZE, (simulationSize_.y + LOCAL_SIZE - 1) / LOCAL_SIZE, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+        glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GetStateFormatDescriptor(activeStateFormat_).stateFormat_);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        derivedOutputs_ = std::make_unique<DerivedOutputs>(this, simulationSize_);
+        derivedOutputs_->SetGridPlacement(gridSize, domain_->GetStateRect().min_);
+        derivedOutputsDirty_ = true;
+        activeTiles_ = std::make_unique<ActiveTiles>(this, simulationSize_);
+        if (cpuSimulator_) {
+            cpuSimulator_ = std::make_unique<simulation::CPUSimulator>(simulationSize_);
+            cpuSimulator_->SetGridPlacement(gridSize, domain_->GetStateRect().min_);
+            if (activeBackend_ == SimulationBackend::CPU) {
+                ReadSimulationState(cpuStateBuffer_);
+                cpuSimulator_->SetState(cpuStateBuffer_);
+            }
+        }
+        UpdateParameterGridScale();
+        spdlog::info("Resampled the simulation to a {}x{} grid.", gridSize.x, gridSize.y);
+    }
+
+    bool ApplicationNodeImplementation::IsGridResizeIteration(std::uint64_t iteration) const
+    {
+        // the tiles of decomposed nodes are fixed to the initial grid.
+        return !domain_->IsDecomposed() && iteration >= simData_.gridSizeIteration_ && simData_.gridSize_ != domain_->GetGridSize();
+    }
+
+    void ApplicationNodeImplementation::UpdateParameterGridScale()
+    {
+        const auto gridHeight = domain_->GetGridSize().y;
+        const auto scaleParameters = simData_.scaleParametersToGrid_ && !domain_->IsDecomposed();
+        simParameters_->SetGridScale(scaleParameters ? static_cast<float>(gridHeight) / static_cast<float>(SIMULATION_SIZE_Y) : 1.0f, gridHeight);
+    }
+
+    GridRect ApplicationNodeImplementation::GetViewportTile(const glm::uvec2& gridSize) const
+    {
+        // the simulation plane spans the virtual screen, so the viewport shows the same fraction of the grid.
+        const auto& viewport = GetViewportScreen(0);
+        const auto screenSize = glm::vec2(GetConfig().virtualScreenSize_);
+        const auto cellScale = glm::vec2(gridSize) / screenSize;
+        const auto tileMin = glm::floor(glm::vec2(viewport.position_) * cellScale);
+        const auto tileMax = glm::ceil(glm::vec2(viewport.position_ + viewport.size_) * cellScale);
+        return GridRect{ glm::ivec2(tileMin), glm::ivec2(tileMax) }.Intersect(GridRect{ glm::ivec2(0), glm::ivec2(gridSize) });
+    }
+
+    void ApplicationNodeImplementation::CreateSimulationBuffers(StateFormat format)
+    {
+        const auto& formatDesc = GetStateFormatDescriptor(format);
+        FrameBufferDescriptor reactDiffuseFBDesc;
+        reactDiffuseFBDesc.texDesc_.emplace_back(formatDesc.stateFormat_, GL_TEXTURE_2D);
+        reactDiffuseFBDesc.texDesc_.emplace_back(formatDesc.stateFormat_, GL_TEXTURE_2D);
+        reactDiffuseFBO_ = std::make_unique<FrameBuffer>(simulationSize_.x, simulationSize_.y, reactDiffuseFBDesc);
+
+        if (format == StateFormat::Fixed16) {
+            // integer textures are incomplete with linear filtering.
+            for (std::size_t i = 0; i < 2; ++i) {
+                glBindTexture(GL_TEXTURE_2D, reactDiffuseFBO_->GetTextures()[i]);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            }
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+        activeStateFormat_ = format;
+    }
+
+    void ApplicationNodeImplementation::CreateSimulationPrograms(StateFormat format)
+    {
+        const auto& formatDesc = GetStateFormatDescriptor(format);
+        std::vector<std::string> defines;
+        if (formatDesc.define_ != nullptr) defines.emplace_back(formatDesc.define_);
+
+        reactionDiffusionProgram_ = GetGPUProgramManager().GetResource(std::string("reactionDiffusion") + formatDesc.programSuffix_,
+            std::vector<std::string>{ "simulationQuad.vert", "reactionDiffusionSimulation.frag" }, defines);
+        rdPrevIterationTextureLoc_ = reactionDiffusionProgram_->getUniformLocation("texture_0");
+
+        reactionDiffusionTilesProgram_ = GetGPUProgramManager().GetResource(std::string("reactionDiffusionTiles") + formatDesc.programSuffix_,
+            std::vector<std::string>{ "activeTileQuad.vert", "reactionDiffusionSimulation.frag" }, defines);
+        rdtPrevIterationTextureLoc_ = reactionDiffusionTilesProgram_->getUniformLocation("texture_0");
+        rdtActiveTilesLoc_ = reactionDiffusionTilesProgram_->getUniformLocation("active_tiles");
+        rdtStateSizeLoc_ = reactionDiffusionTilesProgram_->getUniformLocation("state_size");
+
+        reactionDiffusionComputeProgram_ = GetGPUProgramManager().GetResource(std::string("reactionDiffusionCompute") + formatDesc.programSuffix_,
+            std::vector<std::string>{ "reactionDiffusionSimulation.comp" }, defines);
+        rdcNumStepsLoc_ = reactionDiffusionComputeProgram_->getUniformLocation("num_steps");
+        rdcActiveTilesLoc_ = reactionDiffusionComputeProgram_->getUniformLocation("active_tiles");
+        rdcSkipSleepingTilesLoc_ = reactionDiffusionComputeProgram_->getUniformLocation("skip_sleeping_tiles");
+
+        seedSplatProgram_ = GetGPUProgramManager().GetResource(std::string("seedSplat") + formatDesc.programSuffix_,
+            std::vector<std::string>{ "seedSplat.vert", "seedSplat.frag" }, defines);
+        ssTexDimLoc_ = seedSplatProgram_->getUniformLocation("tex_dim");
+        ssGridDimLoc_ = seedSplatProgram_->getUniformLocation("grid_dim");
+        ssDomainOriginLoc_ = seedSplatProgram_->getUniformLocation("domain_origin");
+
+        resampleStateProgram_ = GetGPUProgramManager().GetResource(std::string("resampleState") + formatDesc.programSuffix_,
+            std::vector<std::string>{ "resampleState.comp" }, defines);
+        rsStateLoc_ = resampleStateProgram_->getUniformLocation("state");
+    }
 
     void ApplicationNodeImplementation::UpdateFrame(double currentTime, double elapsedTime)
     {
-        static const std::vector<std::size_t> drawBuffers0{{0, 2}};
-        static const std::vector<std::size_t> drawBuffers1{{1, 2}};
+        RD_PROFILE_BEGIN_FRAME(*frameProfiler_);
+#ifdef RD_PROFILING
+        if (simData_.traceExportId_ != exportedTraceId_) {
+            exportedTraceId_ = simData_.traceExportId_;
+            const auto traceFile = GetTraceFile(exportedTraceId_);
+            std::error_code error;
+            std::filesystem::create_directories(std::filesystem::path(traceFile).parent_path(), error);
+            if (!frameProfiler_->WriteTrace(traceFile, GetClusterNodeIndex())) spdlog::warn("Could not write the trace {}.", traceFile);
+        }
+#endif
+        if (simData_.checkpointRestoreRequest_ != handledCheckpointRestoreRequest_) {
+            handledCheckpointRestoreRequest_ = simData_.checkpointRestoreRequest_;
+            RestoreCheckpoint(simData_.checkpointRestoreIteration_);
+        }
+        if (checkpointWriter_) checkpointWriter_->Poll();
+        stateHasher_->Poll();
+        if (simData_.recordingId_ != activeRecordingId_) {
+            activeRecordingId_ = simData_.recordingId_;
+            frameRecorder_.reset();
+            if (activeRecordingId_ != 0) frameRecorder_ = std::make_unique<FrameRecorder>(GetRecordingDirectory(activeRecordingId_), simData_.recordingFrameRate_);
+        }
+        if (frameRecorder_) frameRecorder_->Poll();
+        drawnWindows_ = 0;
 
+        if (simData_.simulationBackend_ != activeBackend_) SwitchSimulationBackend(simData_.simulationBackend_);
+        if (simData_.stateFormat_ != activeStateFormat_) SwitchStateFormat(simData_.stateFormat_);
+        if (IsGridResizeIteration(currentLocalIterationCount_)) ResizeSimulation(simData_.gridSize_);
+        UpdateParameterGridScale();
+        // the mask is stale after iterations that computed all tiles.
+        if (simData_.activeTiles_ && !activeTilesEnabled_) activeTiles_->WakeAll();
+        activeTilesEnabled_ = simData_.activeTiles_;
+        activeTiles_->Poll();
+        if (simData_.idleThrottling_ && !idleThrottlingEnabled_) convergenceMonitor_->Clear();
+        idleThrottlingEnabled_ = simData_.idleThrottling_;
+        convergenceMonitor_->Poll();
+        stepErrorEstimator_->Poll();
+
+        iterationScheduler_->CollectGPUMeasurements();
         if (currentLocalIterationCount_ < simData_.currentGlobalIterationCount_) {
-            const auto iterations = glm::min(simData_.currentGlobalIterationCount_ - currentLocalIterationCount_, MAX_FRAME_ITERATIONS);
+            // a node that fell behind catches up as fast as its budget allows, decomposed nodes have to stay in lockstep.
+            const auto maxIterations = simData_.adaptiveIterations_ ? iterationScheduler_->GetAffordableIterations(simData_) : simData_.maxFrameIterations_;
+            const auto pendingIterations = simData_.currentGlobalIterationCount_ - currentLocalIterationCount_;
+            const auto iterations = domain_->IsDecomposed() ? pendingIterations : glm::min(pendingIterations, maxIterations);
+
+            if (activeBackend_ == SimulationBackend::CPU) iterationScheduler_->BeginCPUMeasurement();
+            else iterationScheduler_->BeginGPUMeasurement();
+            // uploads the parameters only if they changed, all passes of the frame use the bound block.
+            simParameters_->SetTimestep(simData_.timestepSchedule_.GetTimestep(currentLocalIterationCount_));
+            if (activeBackend_ != SimulationBackend::CPU) simParameters_->Bind();
 
-            for (std::uint64_t i = 0; i < iterations; ++i) {
-                if (currentLocalIterationCount_ + i == simData_.resetFrameIdx_) {
+            RD_PROFILE_GPU_SCOPE(*frameProfiler_, Iterations);
+            for (std::uint64_t i = 0; i < iterations;) {
+                const auto iteration = currentLocalIterationCount_ + i;
+                if (iteration == simData_.resetFrameIdx_) {
                     ResetSimulation();
                 }
+                // all nodes resample and change the time step at the same iteration, so their states stay comparable.
+                const auto resize = IsGridResizeIteration(iteration);
+                if (resize) ResizeSimulation(simData_.gridSize_);
+                const auto timestepChange = simData_.timestepSchedule_.IsChangeIteration(iteration);
+                if (timestepChange) simParameters_->SetTimestep(simData_.timestepSchedule_.GetTimestep(iteration));
+                if ((resize || timestepChange) && activeBackend_ != SimulationBackend::CPU) simParameters_->Bind();
 
-                const std::vector<std::size_t>* currentDrawBuffers{nullptr};
-                glActiveTexture(GL_TEXTURE0);
-                if (iterationToggle_) {
-                    currentDrawBuffers = &drawBuffers0;
-                    glBindTexture(GL_TEXTURE_2D, reactDiffuseFBO_->GetTextures()[1]);
-                } else {
-                    currentDrawBuffers = &drawBuffers1;
-                    glBindTexture(GL_TEXTURE_2D, reactDiffuseFBO_->GetTextures()[0]);
+                seedEvents_.GetSeedPoints(iteration, iterationSeedPoints_);
+                std::uint64_t steps = 1;
+                if (activeBackend_ == SimulationBackend::CPU) cpuSimulator_->Step(simParameters_->GetEffective(), iterationSeedPoints_);
+                else {
+                    if (!iterationSeedPoints_.empty()) SplatSeedPoints(iterationSeedPoints_);
+                    if (activeBackend_ == SimulationBackend::ComputeShader) {
+                        // a batch stops before the next reset, seeded iteration or time step change, so seeds are always
+                        // splatted in between, and after a hashed iteration, halo exchange or mask update.
+                        while (steps < glm::min(iterations - i, COMPUTE_STEPS_PER_DISPATCH) && !IsStateHashIteration(iteration + steps)
+                            && !IsHaloExchangeIteration(iteration + steps) && !IsActiveTileUpdateIteration(iteration + steps)
+                            && iteration + steps != simData_.resetFrameIdx_
+                            && !IsGridResizeIteration(iteration + steps)
+                            && !simData_.timestepSchedule_.IsChangeIteration(iteration + steps)
+                            && !seedEvents_.HasSeedPoints(iteration + steps)) ++steps;
+                        SimulateComputeShader(steps);
+                    }
+                    else SimulateFragmentShader();
                 }
-                iterationToggle_ = !iterationToggle_;
+                i += steps;
 
-                std::vector<glm::vec2> actual_seed_points;
-                for (const auto& seed_point : seed_points_) {
-                    if (currentLocalIterationCount_ + i == seed_point.first) actual_seed_points.push_back(seed_point.second);
+                const auto exchangeHalos = IsHaloExchangeIteration(iteration + steps);
+                const auto hashState = IsStateHashIteration(iteration + steps);
+                if ((exchangeHalos || hashState) && activeBackend_ == SimulationBackend::CPU) UploadCPUState();
+                if (exchangeHalos) ExchangeHalos(iteration + steps);
+                if (hashState) stateHasher_->Hash(GetCurrentStateTexture(), activeStateFormat_, simulationSize_, iteration + steps);
+                if (IsActiveTileUpdateIteration(iteration + steps)) {
+                    activeTiles_->Update(GetCurrentStateTexture(), reactDiffuseFBO_->GetTextures()[iterationToggle_ ? 0 : 1],
+                        activeStateFormat_, simData_.activityThreshold_, steps);
                 }
-
-                const auto rdGpuProgram = reactionDiffusionFullScreenQuad_->GetGPUProgram();
-                glUseProgram(rdGpuProgram->getProgramId());
-                glUniform1i(rdPrevIterationTextureLoc_, 0);
-                glUniform1f(rdDiffusionRateALoc_, simData_.diffusion_rate_a_);
-                glUniform1f(rdDiffusionRateBLoc_, simData_.diffusion_rate_b_);
-                glUniform1f(rdFeedRateLoc_, simData_.feed_rate_);
-                glUniform1f(rdKillRateLoc_, simData_.kill_rate_);
-                glUniform1f(rdDtLoc_, simData_.dt_);
-                glUniform1f(rdSeedPointRadiusLoc_, simData_.seed_point_radius_);
-                glUniform1ui(rdNumSeedPointsLoc_, static_cast<GLuint>(actual_seed_points.size()));
-                glUniform2fv(rdSeedPointsLoc_, static_cast<GLsizei>(actual_seed_points.size()), reinterpret_cast<const GLfloat*>(actual_seed_points.data()));
-                glUniform1i(rdUseManhattanDistanceLoc_, simData_.use_manhattan_distance_);
-
-                // simulate
-                reactDiffuseFBO_->DrawToFBO(*currentDrawBuffers, [this]() {
-                    reactionDiffusionFullScreenQuad_->Draw();
-                });
             }
             currentLocalIterationCount_ += iterations;
+
+            if (activeBackend_ == SimulationBackend::CPU) iterationScheduler_->EndCPUMeasurement(iterations);
+            else iterationScheduler_->EndGPUMeasurement(iterations);
+
+            if (activeBackend_ == SimulationBackend::CPU) UploadCPUState();
+            derivedOutputsDirty_ = true;
+            if (frameRecorder_ && simData_.recordState_) frameRecorder_->RecordState(GetCurrentStateTexture(), activeStateFormat_, simulationSize_, currentLocalIterationCount_);
+            if (simData_.idleThrottling_) convergenceMonitor_->Measure(GetCurrentStateTexture(), activeStateFormat_, simulationSize_, currentLocalIterationCount_);
+            const auto timestep = simData_.timestepSchedule_.GetTimestep(currentLocalIterationCount_);
+            if (simData_.adaptiveTimestep_ && timestep > 0.0f) {
+                // the error of the time step the next iteration uses.
+                simParameters_->SetTimestep(timestep);
+                simParameters_->Bind();
+                stepErrorEstimator_->Estimate(GetCurrentStateTexture(), activeStateFormat_, simulationSize_, currentLocalIterationCount_,
+                    timestep, simParameters_->GetEffective().dt_);
+            }
+        }
+
+        const auto requiredOutputs = renderers_[simData_.currentRenderer_]->GetRequiredDerivedOutputs();
+        if (derivedOutputsDirty_ || !HasDerivedOutput(derivedOutputs_->GetValidOutputs(), requiredOutputs)) {
+            derivedOutputs_->Update(GetCurrentStateTexture(), activeStateFormat_, requiredOutputs);
+            derivedOutputsDirty_ = false;
         }
 
         float userDistance = (GetCamera()->GetPosition() + GetCamera()->GetUserPosition()).z;
@@ -117,19 +373,548 @@ namespace viscom {
         renderers_[simData_.currentRenderer_]->UpdateFrame(currentTime, elapsedTime, simData_, GetConfig().nearPlaneSize_);
     }
 
+    void ApplicationNodeImplementation::SplatSeedPoints(const std::vector<glm::vec2>& seedPoints)
+    {
+        RD_PROFILE_GPU_SCOPE(*frameProfiler_, Seeding);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, seedPointBuffer_);
+        if (seedPoints.size() > seedPointBufferCapacity_) {
+            seedPointBufferCapacity_ = glm::max(seedPoints.size(), 2 * seedPointBufferCapacity_);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, seedPointBufferCapacity_ * sizeof(glm::vec2), nullptr, GL_DYNAMIC_DRAW);
+        }
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, seedPoints.size() * sizeof(glm::vec2), seedPoints.data());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, seedPointBuffer_);
+
+        glUseProgram(seedSplatProgram_->getProgramId());
+        glUniform2f(ssTexDimLoc_, static_cast<float>(simulationSize_.x), static_cast<float>(simulationSize_.y));
+        const auto gridSize = glm::vec2(domain_->GetGridSize());
+        glUniform2f(ssGridDimLoc_, gridSize.x, gridSize.y);
+        const auto domainOrigin = glm::vec2(domain_->GetStateRect().min_);
+        glUniform2f(ssDomainOriginLoc_, domainOrigin.x, domainOrigin.y);
+
+        // the same bounding boxes as in seedSplat.vert.
+        const auto seedRadius = simParameters_->GetEffective().seed_point_radius_;
+        const auto extent = seedRadius * glm::vec2(gridSize.y / gridSize.x, 1.0f) * gridSize + 1.0f;
+        for (const auto& seedPoint : seedPoints) {
+            const auto center = seedPoint * gridSize - domainOrigin;
+            activeTiles_->WakeCells(GridRect{ glm::ivec2(glm::floor(center - extent)), glm::ivec2(glm::ceil(center + extent)) });
+        }
+
+        // one instanced quad per stamp, so only the texels around the seed points are touched; A is masked out.
+        reactDiffuseFBO_->DrawToFBO(std::vector<std::size_t>{ iterationToggle_ ? 1u : 0u }, [this, &seedPoints]() {
+            glColorMaski(0, GL_FALSE, GL_TRUE, GL_FALSE, GL_FALSE);
+            glBindVertexArray(simulationQuadVAO_);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(seedPoints.size()));
+            glBindVertexArray(0);
+            glColorMaski(0, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        });
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    void ApplicationNodeImplementation::SimulateFragmentShader()
+    {
+        static const std::vector<std::size_t> drawBuffers0{{0}};
+        static const std::vector<std::size_t> drawBuffers1{{1}};
+
+        const std::vector<std::size_t>* currentDrawBuffers{nullptr};
+        glActiveTexture(GL_TEXTURE0);
+        if (iterationToggle_) {
+            currentDrawBuffers = &drawBuffers0;
+            glBindTexture(GL_TEXTURE_2D, reactDiffuseFBO_->GetTextures()[1]);
+        } else {
+            currentDrawBuffers = &drawBuffers1;
+            glBindTexture(GL_TEXTURE_2D, reactDiffuseFBO_->GetTextures()[0]);
+        }
+        iterationToggle_ = !iterationToggle_;
+
+        if (IsSkippingSleepingTiles()) {
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, activeTiles_->GetMaskTexture());
+            glUseProgram(reactionDiffusionTilesProgram_->getProgramId());
+            glUniform1i(rdtPrevIterationTextureLoc_, 0);
+            glUniform1i(rdtActiveTilesLoc_, 1);
+            glUniform2i(rdtStateSizeLoc_, static_cast<GLint>(simulationSize_.x), static_cast<GLint>(simulationSize_.y));
+
+            // one quad per tile, the ones of sleeping tiles are degenerate and keep their texels.
+            const auto& numTiles = activeTiles_->GetNumTiles();
+            reactDiffuseFBO_->DrawToFBO(*currentDrawBuffers, [this, &numTiles]() {
+                glBindVertexArray(simulationQuadVAO_);
+                glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(numTiles.x * numTiles.y));
+                glBindVertexArray(0);
+            });
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glActiveTexture(GL_TEXTURE0);
+            return;
+        }
+
+        glUseProgram(reactionDiffusionProgram_->getProgramId());
+        glUniform1i(rdPrevIterationTextureLoc_, 0);
+
+        // simulate
+        reactDiffuseFBO_->DrawToFBO(*currentDrawBuffers, [this]() {
+            glBindVertexArray(simulationQuadVAO_);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            glBindVertexArray(0);
+        });
+    }
+
+    void ApplicationNodeImplementation::SimulateComputeShader(std::uint64_t steps)
+    {
+        // has to match the defines in reactionDiffusionSimulation.comp.
+        constexpr GLuint TILE_SIZE = 32;
+
+        const auto srcTexture = GetCurrentStateTexture();
+        const auto dstTexture = reactDiffuseFBO_->GetTextures()[iterationToggle_ ? 0 : 1];
+        iterationToggle_ = !iterationToggle_;
+
+        glUseProgram(reactionDiffusionComputeProgram_->getProgramId());
+        glUniform1i(rdcNumStepsLoc_, static_cast<GLint>(steps));
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, activeTiles_->GetMaskTexture());
+        glUniform1i(rdcActiveTilesLoc_, 0);
+        glUniform1i(rdcSkipSleepingTilesLoc_, IsSkippingSleepingTiles() ? GL_TRUE : GL_FALSE);
+
+        const auto& formatDesc = GetStateFormatDescriptor(activeStateFormat_);
+        glBindImageTexture(0, srcTexture, 0, GL_FALSE, 0, GL_READ_ONLY, formatDesc.stateFormat_);
+        glBindImageTexture(1, dstTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, formatDesc.stateFormat_);
+
+        const auto outputSize = TILE_SIZE - 2 * static_cast<GLuint>(steps);
+        glDispatchCompute((simulationSize_.x + outputSize - 1) / outputSize, (simulationSize_.y + outputSize - 1) / outputSize, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
     void ApplicationNodeImplementation::ResetSimulation() const
     {
+        RD_PROFILE_GPU_SCOPE(*frameProfiler_, Reset);
         // clear A and B, {0, 1}
-        reactDiffuseFBO_->DrawToFBO(std::vector<std::size_t>{0, 1}, []() {
-            glClearColor(1.0f, 0.0f, 1.0f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
+        reactDiffuseFBO_->DrawToFBO(std::vector<std::size_t>{0, 1}, [this]() {
+            if (activeStateFormat_ == StateFormat::Fixed16) {
+                const std::array<GLuint, 4> fixedClearValue{ { simulation::FIXED_POINT_ONE, 0, simulation::FIXED_POINT_ONE, 0 } };
+                glClearBufferuiv(GL_COLOR, 0, fixedClearValue.data());
+                glClearBufferuiv(GL_COLOR, 1, fixedClearValue.data());
+            }
+            else {
+                glClearColor(1.0f, 0.0f, 1.0f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT);
+            }
         });
 
-        // clear mixed result, {2}
-        reactDiffuseFBO_->DrawToFBO(std::vector<std::size_t>{2}, []() {
-            glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
-        });
+        if (cpuSimulator_) cpuSimulator_->Reset();
+        activeTiles_->WakeAll();
+    }
+
+    GLuint ApplicationNodeImplementation::GetCurrentStateTexture() const
+    {
+        // the next iteration reads from the texture written last.
+        return reactDiffuseFBO_->GetTextures()[iterationToggle_ ? 1 : 0];
+    }
+
+    void ApplicationNodeImplementation::SwitchSimulationBackend(SimulationBackend backend)
+    {
+        cpuStateBuffer_.resize(static_cast<std::size_t>(simulationSize_.x) * simulationSize_.y);
+
+        if (backend == SimulationBackend::CPU) {
+            if (!cpuSimulator_) {
+                cpuSimulator_ = std::make_unique<simulation::CPUSimulator>(simulationSize_);
+                cpuSimulator_->SetGridPlacement(domain_->GetGridSize(), domain_->GetStateRect().min_);
+            }
+
+            ReadSimulationState(cpuStateBuffer_);
+            cpuSimulator_->SetState(cpuStateBuffer_);
+        }
+        else if (activeBackend_ == SimulationBackend::CPU) {
+            cpuSimulator_->GetState(cpuStateBuffer_);
+            WriteSimulationState(cpuStateBuffer_);
+        }
+
+        activeBackend_ = backend;
+    }
+
+    void ApplicationNodeImplementation::SwitchStateFormat(StateFormat format)
+    {
+        // the CPU backend keeps its 32 bit state and uploads it again.
+        if (activeBackend_ == SimulationBackend::CPU) cpuSimulator_->GetState(cpuStateBuffer_);
+        else ReadSimulationState(cpuStateBuffer_);
+
+        CreateSimulationBuffers(format);
+        CreateSimulationPrograms(format);
+        spdlog::info("Switched simulation state format to {}.", STATE_FORMAT_NAMES[static_cast<std::size_t>(format)]);
+
+        WriteSimulationState(cpuStateBuffer_);
+    }
+
+    void ApplicationNodeImplementation::ReadSimulationState(std::vector<glm::vec2>& state)
+    {
+        const auto numCells = static_cast<std::size_t>(simulationSize_.x) * simulationSize_.y;
+        state.resize(numCells);
+
+        glBindTexture(GL_TEXTURE_2D, GetCurrentStateTexture());
+        if (activeStateFormat_ == StateFormat::Fixed16) {
+            fixedStateBuffer_.resize(numCells);
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RG_INTEGER, GL_UNSIGNED_SHORT, fixedStateBuffer_.data());
+            for (std::size_t i = 0; i < numCells; ++i) {
+                state[i] = glm::vec2(simulation::FromFixedPoint(fixedStateBuffer_[i].x), simulation::FromFixedPoint(fixedStateBuffer_[i].y));
+            }
+        }
+        else glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_FLOAT, state.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void ApplicationNodeImplementation::WriteSimulationState(const std::vector<glm::vec2>& state)
+    {
+        const auto numCells = static_cast<std::size_t>(simulationSize_.x) * simulationSize_.y;
+
+        glBindTexture(GL_TEXTURE_2D, GetCurrentStateTexture());
+        if (activeStateFormat_ == StateFormat::Fixed16) {
+            fixedStateBuffer_.resize(numCells);
+            for (std::size_t i = 0; i < numCells; ++i) {
+                fixedStateBuffer_[i] = glm::u16vec2(simulation::ToFixedPoint(state[i].x), simulation::ToFixedPoint(state[i].y));
+            }
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, simulationSize_.x, simulationSize_.y, GL_RG_INTEGER, GL_UNSIGNED_SHORT, fixedStateBuffer_.data());
+        }
+        else glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, simulationSize_.x, simulationSize_.y, GL_RG, GL_FLOAT, state.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        derivedOutputsDirty_ = true;
+        activeTiles_->WakeAll();
+    }
+
+    std::string ApplicationNodeImplementation::GetCheckpointDirectory() const
+    {
+        return GetConfig().resourceSearchPaths_.back() + "/checkpoints";
+    }
+
+    std::string ApplicationNodeImplementation::GetRecordingDirectory(std::uint64_t recordingId) const
+    {
+        // the nodes of a local cluster share the resource directory.
+        return GetConfig().resourceSearchPaths_.back() + "/recordings/" + std::to_string(recordingId) + "_node" + std::to_string(GetClusterNodeIndex());
+    }
+
+#ifdef RD_PROFILING
+    std::string ApplicationNodeImplementation::GetTraceFile(std::uint64_t traceId) const
+    {
+        return GetConfig().resourceSearchPaths_.back() + "/traces/" + std::to_string(traceId) + "_node" + std::to_string(GetClusterNodeIndex()) + ".json";
+    }
+#endif
+
+    bool ApplicationNodeImplementation::RequestCheckpoint()
+    {
+        // a checkpoint holds the whole grid.
+        if (domain_->IsDecomposed()) return false;
+        if (!checkpointWriter_) checkpointWriter_ = std::make_unique<CheckpointWriter>(GetCheckpointDirectory(), static_cast<std::size_t>(simData_.maxCheckpoints_));
+        checkpointWriter_->SetMaxCheckpoints(static_cast<std::size_t>(simData_.maxCheckpoints_));
+        return checkpointWriter_->Request(GetCurrentStateTexture(), activeStateFormat_, simulationSize_,
+            currentLocalIterationCount_, simData_, simParameters_->Get());
+    }
+
+    bool ApplicationNodeImplementation::RestoreCheckpoint(std::uint64_t iteration)
+    {
+        const auto path = GetCheckpointPath(GetCheckpointDirectory(), iteration);
+        const MappedCheckpoint checkpoint{ path };
+        if (!checkpoint.IsValid()) {
+            spdlog::error("Could not restore checkpoint {}.", path);
+            return false;
+        }
+        const auto& header = checkpoint.GetHeader();
+        const glm::uvec2 checkpointSize{ header.width_, header.height_ };
+        if (checkpointSize != simulationSize_) {
+            if (domain_->IsDecomposed()) {
+                spdlog::error("Checkpoint {} has a different simulation size ({}x{}).", path, header.width_, header.height_);
+                return false;
+            }
+            // the resampled state is overwritten below.
+            ResizeSimulation(checkpointSize);
+        }
+        simData_.gridSize_ = checkpointSize;
+        simData_.gridSizeIteration_ = header.localIterationCount_;
+
+        const auto format = static_cast<StateFormat>(header.stateFormat_);
+        if (format != activeStateFormat_) {
+            CreateSimulationBuffers(format);
+            CreateSimulationPrograms(format);
+        }
+        simData_.stateFormat_ = format;
+        checkpoint.UploadState(GetCurrentStateTexture());
+        if (activeBackend_ == SimulationBackend::CPU) {
+            ReadSimulationState(cpuStateBuffer_);
+            cpuSimulator_->SetState(cpuStateBuffer_);
+        }
+
+        // seed events belong to the timeline before the restore.
+        currentLocalIterationCount_ = header.localIterationCount_;
+        seedEvents_.Clear();
+        stateHasher_->Clear();
+        convergenceMonitor_->Clear();
+        stepErrorEstimator_->Clear();
+        derivedOutputsDirty_ = true;
+        activeTiles_->WakeAll();
+        spdlog::info("Restored checkpoint {}.", path);
+        return true;
+    }
+
+    bool ApplicationNodeImplementation::IsStateHashIteration(std::uint64_t iteration) const
+    {
+        // decomposed nodes have different states.
+        return !domain_->IsDecomposed() && simData_.verifyState_ && simData_.stateHashInterval_ > 0 && iteration % simData_.stateHashInterval_ == 0;
+    }
+
+    bool ApplicationNodeImplementation::IsHaloExchangeIteration(std::uint64_t iteration) const
+    {
+        return domain_->IsDecomposed() && iteration % DOMAIN_HALO_SIZE == 0;
+    }
+
+    bool ApplicationNodeImplementation::IsSkippingSleepingTiles() const
+    {
+        // the CPU backend always computes the whole state.
+        return simData_.activeTiles_ && activeBackend_ != SimulationBackend::CPU;
+    }
+
+    bool ApplicationNodeImplementation::IsActiveTileUpdateIteration(std::uint64_t iteration) const
+    {
+        return IsSkippingSleepingTiles() && iteration % ACTIVE_TILE_UPDATE_INTERVAL == 0;
+    }
+
+    void ApplicationNodeImplementation::ExchangeHalos(std::uint64_t iteration)
+    {
+        const auto& transferFormat = GetStateTransferFormat(activeStateFormat_);
+        const auto& stateOrigin = domain_->GetStateRect().min_;
+
+        // the send regions are read from the state texture attached to a read frame buffer.
+        if (haloReadFBO_ == 0) glGenFramebuffers(1, &haloReadFBO_);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, haloReadFBO_);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, GetCurrentStateTexture(), 0);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        for (const auto& region : domain_->GetSendRegions()) {
+            const auto size = region.rect_.GetSize();
+            const auto offset = region.rect_.min_ - stateOrigin;
+            const auto dataSize = static_cast<std::size_t>(size.x) * size.y * transferFormat.cellSize_;
+
+            DomainHaloHeader header;
+            header.iteration_ = iteration;
+            header.sourceNode_ = domain_->GetNode();
+            header.stateFormat_ = static_cast<std::int32_t>(activeStateFormat_);
+            header.rect_ = region.rect_;
+            haloPackage_.resize(sizeof(DomainHaloHeader) + dataSize);
+            std::memcpy(haloPackage_.data(), &header, sizeof(DomainHaloHeader));
+            glReadPixels(offset.x, offset.y, size.x, size.y, transferFormat.format_, transferFormat.type_, haloPackage_.data() + sizeof(DomainHaloHeader));
+#ifdef VISCOM_USE_SGCT
+            TransferDataToNode(haloPackage_.data(), static_cast<int>(haloPackage_.size()), static_cast<int>(ClusterPackage::DomainHalo), region.node_);
+#endif
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+        if (!domain_->TakeHalos(iteration, receivedHalos_, std::chrono::milliseconds(DOMAIN_HALO_TIMEOUT_MS))) {
+            spdlog::warn("Not all halos of iteration {} arrived in time, the borders of the tile may be inexact.", iteration);
+        }
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, GetCurrentStateTexture());
+        for (const auto& halo : receivedHalos_) {
+            DomainHaloHeader header;
+            std::memcpy(&header, halo.data(), sizeof(DomainHaloHeader));
+            const auto size = header.rect_.GetSize();
+            if (header.stateFormat_ != static_cast<std::int32_t>(activeStateFormat_) || header.rect_.IsEmpty() || !domain_->GetStateRect().Contains(header.rect_)
+                || halo.size() != sizeof(DomainHaloHeader) + static_cast<std::size_t>(size.x) * size.y * transferFormat.cellSize_) {
+                spdlog::error("Received a malformed halo from node {}.", header.sourceNode_);
+                continue;
+            }
+
+            const auto offset = header.rect_.min_ - stateOrigin;
+            glTexSubImage2D(GL_TEXTURE_2D, 0, offset.x, offset.y, size.x, size.y, transferFormat.format_, transferFormat.type_,
+                halo.data() + sizeof(DomainHaloHeader));
+            wokenHalos_.push_back(GridRect{ offset, offset + size });
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        for (const auto& halo : wokenHalos_) activeTiles_->WakeCells(halo);
+        wokenHalos_.clear();
+
+        if (activeBackend_ == SimulationBackend::CPU) {
+            ReadSimulationState(cpuStateBuffer_);
+            cpuSimulator_->SetState(cpuStateBuffer_);
+        }
+    }
+
+    void ApplicationNodeImplementation::CreateStateSnapshot(std::vector<std::uint8_t>& snapshot)
+    {
+        const auto& transferFormat = GetStateTransferFormat(activeStateFormat_);
+        StateSnapshotHeader header;
+        header.iteration_ = currentLocalIterationCount_;
+        header.width_ = simulationSize_.x;
+        header.height_ = simulationSize_.y;
+        header.stateFormat_ = static_cast<std::int32_t>(activeStateFormat_);
+        header.stateSize_ = static_cast<std::uint32_t>(static_cast<std::size_t>(simulationSize_.x) * simulationSize_.y * transferFormat.cellSize_);
+
+        // snapshots are rare (a worker joined or diverged), so the state is read back directly.
+        std::vector<std::uint8_t> state(header.stateSize_);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, GetCurrentStateTexture());
+        glGetTexImage(GL_TEXTURE_2D, 0, transferFormat.format_, transferFormat.type_, state.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+        EncodeStateSnapshot(header, state.data(), snapshot);
+    }
+
+    bool ApplicationNodeImplementation::ApplyStateSnapshot(const std::vector<std::uint8_t>& snapshot)
+    {
+        StateSnapshotHeader header;
+        std::vector<std::uint8_t> state;
+        if (!DecodeStateSnapshot(snapshot, header, state)) {
+            spdlog::error("Received a malformed state snapshot.");
+            return false;
+        }
+        const glm::uvec2 snapshotSize{ header.width_, header.height_ };
+        if (snapshotSize != simulationSize_) {
+            if (domain_->IsDecomposed()) {
+                spdlog::error("State snapshot has a different simulation size ({}x{}).", header.width_, header.height_);
+                return false;
+            }
+            // the coordinator may not have reached a pending resize yet, the snapshot is resampled again at gridSizeIteration_.
+            ResizeSimulation(snapshotSize);
+        }
+
+        const auto format = static_cast<StateFormat>(header.stateFormat_);
+        if (format != activeStateFormat_) {
+            CreateSimulationBuffers(format);
+            CreateSimulationPrograms(format);
+        }
+        const auto& transferFormat = GetStateTransferFormat(format);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, GetCurrentStateTexture());
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, simulationSize_.x, simulationSize_.y, transferFormat.format_, transferFormat.type_, state.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        if (activeBackend_ == SimulationBackend::CPU) {
+            ReadSimulationState(cpuStateBuffer_);
+            cpuSimulator_->SetState(cpuStateBuffer_);
+        }
+
+        // the node continues from the iteration of the snapshot with the seed events it still has.
+        currentLocalIterationCount_ = header.iteration_;
+        seedEvents_.Rewind(currentLocalIterationCount_);
+        stateHasher_->Clear();
+        convergenceMonitor_->Clear();
+        stepErrorEstimator_->Clear();
+        derivedOutputsDirty_ = true;
+        activeTiles_->WakeAll();
+        spdlog::info("Applied state snapshot of iteration {} ({} of {} bytes).", header.iteration_, snapshot.size(), header.stateSize_);
+        return true;
+    }
+
+    std::array<float, SIMULATION_BACKEND_NAMES.size()> ApplicationNodeImplementation::CompareSimulationBackends(std::uint64_t iterations)
+    {
+        const auto numCells = static_cast<std::size_t>(simulationSize_.x) * simulationSize_.y;
+        if (!cpuSimulator_) {
+            cpuSimulator_ = std::make_unique<simulation::CPUSimulator>(simulationSize_);
+            cpuSimulator_->SetGridPlacement(domain_->GetGridSize(), domain_->GetStateRect().min_);
+        }
+
+        std::vector<glm::vec2> initialState(numCells);
+        if (activeBackend_ == SimulationBackend::CPU) cpuSimulator_->GetState(initialState);
+        else ReadSimulationState(initialState);
+        const auto initialToggle = iterationToggle_;
+        simParameters_->Bind();
+
+        const std::vector<glm::vec2> noSeedPoints;
+        std::array<std::vector<glm::vec2>, SIMULATION_BACKEND_NAMES.size()> results;
+        for (std::size_t backend = 0; backend < results.size(); ++backend) {
+            results[backend].resize(numCells);
+            switch (static_cast<SimulationBackend>(backend)) {
+            case SimulationBackend::FragmentShader:
+                WriteSimulationState(initialState);
+                for (std::uint64_t i = 0; i < iterations; ++i) SimulateFragmentShader();
+                break;
+            case SimulationBackend::ComputeShader:
+                WriteSimulationState(initialState);
+                for (std::uint64_t i = 0; i < iterations; i += COMPUTE_STEPS_PER_DISPATCH) {
+                    SimulateComputeShader(glm::min(iterations - i, COMPUTE_STEPS_PER_DISPATCH));
+                }
+                break;
+            case SimulationBackend::CPU:
+                cpuSimulator_->SetState(initialState);
+                for (std::uint64_t i = 0; i < iterations; ++i) cpuSimulator_->Step(simParameters_->GetEffective(), noSeedPoints);
+                cpuSimulator_->GetState(results[backend]);
+                continue;
+            }
+
+            ReadSimulationState(results[backend]);
+            iterationToggle_ = initialToggle;
+        }
+
+        std::array<float, SIMULATION_BACKEND_NAMES.size()> maxDifferences;
+        for (std::size_t backend = 0; backend < results.size(); ++backend) {
+            maxDifferences[backend] = 0.0f;
+            for (std::size_t i = 0; i < numCells; ++i) {
+                const auto difference = glm::abs(results[backend][i] - results[0][i]);
+                maxDifferences[backend] = glm::max(maxDifferences[backend], glm::max(difference.x, difference.y));
+            }
+            spdlog::info("Backend comparison ({} iterations): {} max. difference {}.", iterations, SIMULATION_BACKEND_NAMES[backend], maxDifferences[backend]);
+        }
+
+        WriteSimulationState(initialState);
+        cpuSimulator_->SetState(initialState);
+        return maxDifferences;
+    }
+
+    std::array<ApplicationNodeImplementation::StateFormatError, STATE_FORMAT_NAMES.size()> ApplicationNodeImplementation::CompareStateFormats(std::uint64_t iterations)
+    {
+        const auto numCells = static_cast<std::size_t>(simulationSize_.x) * simulationSize_.y;
+        const auto initialFormat = activeStateFormat_;
+        const auto initialToggle = iterationToggle_;
+
+        std::vector<glm::vec2> initialState(numCells);
+        if (activeBackend_ == SimulationBackend::CPU) cpuSimulator_->GetState(initialState);
+        else ReadSimulationState(initialState);
+
+        simParameters_->Bind();
+        std::array<std::vector<glm::vec2>, STATE_FORMAT_NAMES.size()> results;
+        for (std::size_t format = 0; format < results.size(); ++format) {
+            CreateSimulationBuffers(static_cast<StateFormat>(format));
+            CreateSimulationPrograms(static_cast<StateFormat>(format));
+            WriteSimulationState(initialState);
+
+            if (activeBackend_ == SimulationBackend::ComputeShader) {
+                for (std::uint64_t i = 0; i < iterations; i += COMPUTE_STEPS_PER_DISPATCH) {
+                    SimulateComputeShader(glm::min(iterations - i, COMPUTE_STEPS_PER_DISPATCH));
+                }
+            }
+            else {
+                for (std::uint64_t i = 0; i < iterations; ++i) SimulateFragmentShader();
+            }
+
+            ReadSimulationState(results[format]);
+            iterationToggle_ = initialToggle;
+        }
+
+        const auto& reference = results[static_cast<std::size_t>(StateFormat::Float32)];
+        std::array<StateFormatError, STATE_FORMAT_NAMES.size()> errors;
+        for (std::size_t format = 0; format < results.size(); ++format) {
+            auto maxError = 0.0f;
+            auto squaredErrorSum = 0.0;
+            for (std::size_t i = 0; i < numCells; ++i) {
+                const auto difference = glm::abs(results[format][i] - reference[i]);
+                maxError = glm::max(maxError, glm::max(difference.x, difference.y));
+                squaredErrorSum += static_cast<double>(difference.x) * difference.x + static_cast<double>(difference.y) * difference.y;
+            }
+            errors[format].maxError_ = maxError;
+            errors[format].rmse_ = static_cast<float>(glm::sqrt(squaredErrorSum / static_cast<double>(2 * numCells)));
+            spdlog::info("State format comparison ({} iterations): {} max. error {}, RMSE {}.", iterations,
+                STATE_FORMAT_NAMES[format], errors[format].maxError_, errors[format].rmse_);
+        }
+
+        CreateSimulationBuffers(initialFormat);
+        CreateSimulationPrograms(initialFormat);
+        WriteSimulationState(initialState);
+        return errors;
+    }
+
+    void ApplicationNodeImplementation::UploadCPUState()
+    {
+        cpuSimulator_->GetState(cpuStateBuffer_);
+        WriteSimulationState(cpuStateBuffer_);
     }
 
     void ApplicationNodeImplementation::ClearBuffer(FrameBuffer& fbo)
@@ -140,11 +925,35 @@ namespace viscom {
     void ApplicationNodeImplementation::DrawFrame(FrameBuffer& fbo)
     {
         auto perspectiveMatrix = GetCamera()->GetViewPerspectiveMatrix();
-        renderers_[simData_.currentRenderer_]->RenderRDResults(fbo, simData_, perspectiveMatrix, reactDiffuseFBO_->GetTextures()[2]);
+        renderers_[simData_.currentRenderer_]->RenderRDResults(fbo, simData_, perspectiveMatrix, *derivedOutputs_);
+        // recorded before the GUI is drawn on top.
+        if (frameRecorder_) fbo.DrawToFBO([this]() { frameRecorder_->RecordWindow(drawnWindows_, currentLocalIterationCount_); });
+        ++drawnWindows_;
+    }
+
+    void ApplicationNodeImplementation::Draw2D(FrameBuffer& fbo)
+    {
+        {
+            RD_PROFILE_GPU_SCOPE(*frameProfiler_, Draw2D);
+            ApplicationNodeBase::Draw2D(fbo);
+        }
+        RD_PROFILE_END_FRAME(*frameProfiler_);
     }
 
     void ApplicationNodeImplementation::CleanUp()
     {
         renderers_.clear();
     }
+
+#ifdef VISCOM_USE_SGCT
+    bool ApplicationNodeImplementation::DataTransferCallback(void* receivedData, int receivedLength, std::uint16_t packageID, int clientID)
+    {
+        // halos arrive on the network thread and are applied by the waiting ExchangeHalos.
+        if (packageID == static_cast<std::uint16_t>(ClusterPackage::DomainHalo)) {
+            domain_->AddHalo(receivedData, static_cast<std::size_t>(receivedLength));
+            return true;
+        }
+        return ApplicationNodeBase::DataTransferCallback(receivedData, receivedLength, packageID, clientID);
+    }
+#endif
 }
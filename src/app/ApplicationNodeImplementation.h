@@ -9,41 +9,34 @@
 #pragma once
 
 #include "core/app/ApplicationNodeBase.h"
+#include "app/SimulationData.h"
+#include "app/SeedEventQueue.h"
+#include <glm/gtc/type_precision.hpp>
 
 namespace viscom::renderers {
     class RDRenderer;
 }
 
+namespace viscom::simulation {
+    class CPUSimulator;
+}
+
 namespace viscom {
 
     class MeshRenderable;
-    class FullscreenQuad;
-
-    struct SimulationData {
-        /** The distance the simulation will be drawn at. */
-        float simulationDrawDistance_ = 15.0f;
-        /** The simulation height field height. */
-        float simulationHeight_ = 0.1f;
-        /** The relative index of refraction used for raycasting. */
-        float eta_ = 1.5f;
-        /** The absorption coefficient. */
-        glm::vec3 sigma_a_ = glm::vec3(2.0f);
-        /** The current global iteration count. */
-        std::uint64_t currentGlobalIterationCount_ = 0;
-        /** frame at which the simulation should be reset */
-        size_t resetFrameIdx_ = 0;
-
-        /** reaction diffusion parameters */
-        float diffusion_rate_a_ = 1.0f;
-        float diffusion_rate_b_ = 0.5f;
-        float feed_rate_ = 0.055f;
-        float kill_rate_ = 0.062f;
-        float dt_ = 1.0f;
-        float seed_point_radius_ = 0.1f;
-        bool use_manhattan_distance_ = true;
-
-        int currentRenderer_ = 0;
-    };
+    class GPUProgram;
+    class DerivedOutputs;
+    class IterationScheduler;
+    class SimulationParameterBlock;
+    class CheckpointWriter;
+    class FrameRecorder;
+    class FrameProfiler;
+    class StateHasher;
+    class SimulationDomain;
+    class ActiveTiles;
+    class ConvergenceMonitor;
+    class StepErrorEstimator;
+    struct GridRect;
 
     struct SimulationPlane {
         glm::vec3 position_;
@@ -64,59 +57,232 @@ namespace viscom {
         virtual void UpdateFrame(double currentTime, double elapsedTime) override;
         virtual void ClearBuffer(FrameBuffer& fbo) override;
         virtual void DrawFrame(FrameBuffer& fbo) override;
+        virtual void Draw2D(FrameBuffer& fbo) override;
         virtual void CleanUp() override;
+#ifdef VISCOM_USE_SGCT
+        virtual bool DataTransferCallback(void* receivedData, int receivedLength, std::uint16_t packageID, int clientID) override;
+#endif
 
-        using SeedPoint = std::pair<std::size_t, glm::vec2>;
+        /** The error of a state format compared to the 32 bit floating point state. */
+        struct StateFormatError {
+            /** The maximum absolute error of A and B. */
+            float maxError_ = -1.0f;
+            /** The root mean square error of A and B. */
+            float rmse_ = -1.0f;
+        };
 
         std::uint64_t& GetCurrentLocalIterationCount() { return currentLocalIterationCount_; }
         SimulationData& GetSimulationData() { return simData_; }
-        std::vector<SeedPoint>& GetSeedPoints() { return seed_points_; }
+        SimulationParameterBlock& GetSimulationParameters() { return *simParameters_; }
+        SeedEventQueue& GetSeedEvents() { return seedEvents_; }
         const std::vector<std::unique_ptr<renderers::RDRenderer>>& GetRenderers() const { return renderers_; }
+        const DerivedOutputs& GetDerivedOutputs() const { return *derivedOutputs_; }
+        const IterationScheduler& GetIterationScheduler() const { return *iterationScheduler_; }
+        SimulationDomain& GetSimulationDomain() { return *domain_; }
+        const ActiveTiles& GetActiveTiles() const { return *activeTiles_; }
+        const ConvergenceMonitor& GetConvergenceMonitor() const { return *convergenceMonitor_; }
+        const StepErrorEstimator& GetStepErrorEstimator() const { return *stepErrorEstimator_; }
+#ifdef RD_PROFILING
+        /** Returns the per-phase timers of this node (see FrameProfiler.h). */
+        FrameProfiler& GetFrameProfiler() const { return *frameProfiler_; }
+#endif
         void ResetSimulation() const;
+        /**
+         *  Runs the given number of iterations without seed points from the current state with every backend and
+         *  returns the maximum absolute difference of A and B to the fragment shader backend for each backend.
+         *  The simulation state is restored afterwards.
+         */
+        std::array<float, SIMULATION_BACKEND_NAMES.size()> CompareSimulationBackends(std::uint64_t iterations);
+        /**
+         *  Runs the given number of iterations without seed points from the current state with every state format
+         *  (using the active GPU backend, the fragment shader if the CPU backend is active) and returns the error of
+         *  each format compared to the 32 bit floating point state. The simulation state is restored afterwards.
+         */
+        std::array<StateFormatError, STATE_FORMAT_NAMES.size()> CompareStateFormats(std::uint64_t iterations);
 
         const glm::vec2& GetSimulationOutputSize() const { return simulationOutputSize_; }
+        /** Returns the directory the checkpoints are stored in. */
+        std::string GetCheckpointDirectory() const;
+        /** Returns the directory this node writes the recording with the given id to. */
+        std::string GetRecordingDirectory(std::uint64_t recordingId) const;
+#ifdef RD_PROFILING
+        /** Returns the file this node writes the trace with the given id to. */
+        std::string GetTraceFile(std::uint64_t traceId) const;
+#endif
 
-        /** The maximum iteration count per frame. */
-        static constexpr std::uint64_t MAX_FRAME_ITERATIONS = 15;
-        /** The increase in iteration count per frame. */
-        static constexpr std::uint64_t FRAME_ITERATIONS_INC = 5;
-
-        /** The simulation frame buffer size (x). */
-        static constexpr unsigned int SIMULATION_SIZE_X = 1920 / 4;
-        /** The simulation frame buffer size (y). */
-        static constexpr unsigned int SIMULATION_SIZE_Y = 1080 / 4;
+        /** The number of iterations done by a single compute shader dispatch (at most 8, see the shader). */
+        static constexpr std::uint64_t COMPUTE_STEPS_PER_DISPATCH = 4;
 
     protected:
         const SimulationPlane& GetSimPlane() const { return simPlane_; }
+        /** Starts an asynchronous checkpoint of the current state, returns false if the last one is still written. */
+        bool RequestCheckpoint();
+        /** Returns the checkpoint writer (nullptr if no checkpoint was requested yet). */
+        const CheckpointWriter* GetCheckpointWriter() const { return checkpointWriter_.get(); }
+        /** Returns the recorder (nullptr while not recording). */
+        const FrameRecorder* GetFrameRecorder() const { return frameRecorder_.get(); }
+        /** Returns the hashes of the local state. */
+        const StateHasher& GetStateHasher() const { return *stateHasher_; }
+        /** Reads the current state and encodes it as a snapshot (see StateSync.h). */
+        void CreateStateSnapshot(std::vector<std::uint8_t>& snapshot);
+        /** Replaces the state and the local iteration count with a snapshot, returns false if it does not fit. */
+        bool ApplyStateSnapshot(const std::vector<std::uint8_t>& snapshot);
 
     private:
+        /** Sets B = 1 around the seed points in the current state texture (before the next iteration). */
+        void SplatSeedPoints(const std::vector<glm::vec2>& seedPoints);
+        /** Runs a single iteration with the fragment shader. */
+        void SimulateFragmentShader();
+        /** Runs steps iterations with a single compute shader dispatch. */
+        void SimulateComputeShader(std::uint64_t steps);
+        /** Returns the texture holding the most recent simulation state. */
+        GLuint GetCurrentStateTexture() const;
+        /** Switches the simulation backend and transfers the current state to it. */
+        void SwitchSimulationBackend(SimulationBackend backend);
+        /** Creates the simulation frame buffer with textures in the given state format. */
+        void CreateSimulationBuffers(StateFormat format);
+        /** Loads the simulation programs for the given state format and queries their uniform locations. */
+        void CreateSimulationPrograms(StateFormat format);
+        /** Switches the state format of the GPU simulation and converts the current state to it. */
+        void SwitchStateFormat(StateFormat format);
+        /** Reads the most recent GPU simulation state (converted to floating point). */
+        void ReadSimulationState(std::vector<glm::vec2>& state);
+        /** Writes the GPU simulation state (converted from floating point). */
+        void WriteSimulationState(const std::vector<glm::vec2>& state);
+        /** Uploads the state of the CPU simulation to the current state texture. */
+        void UploadCPUState();
+        /** Replaces the state and the local iteration count with the checkpoint of the given iteration. */
+        bool RestoreCheckpoint(std::uint64_t iteration);
+        /** Returns if the state after the given iteration is hashed. */
+        bool IsStateHashIteration(std::uint64_t iteration) const;
+        /** Reads the grid size from simulation.txt in the resource directory (keeps the default if there is none). */
+        void LoadSimulationConfig();
+        /** Resamples the state to a grid of the given size and recreates everything depending on the size. */
+        void ResizeSimulation(const glm::uvec2& gridSize);
+        /** Returns if the grid is resampled to SimulationData::gridSize_ before the given iteration. */
+        bool IsGridResizeIteration(std::uint64_t iteration) const;
+        /** Passes the scale of the grid relative to the tuned size to the parameters. */
+        void UpdateParameterGridScale();
+        /** Returns the tile of the grid shown in the viewport of this node. */
+        GridRect GetViewportTile(const glm::uvec2& gridSize) const;
+        /** Returns if the halos are exchanged with the neighbouring nodes after the given iteration. */
+        bool IsHaloExchangeIteration(std::uint64_t iteration) const;
+        /** Sends the cells of the tile to the neighbours and replaces the halo with their cells. */
+        void ExchangeHalos(std::uint64_t iteration);
+        /** Returns if the GPU simulation only computes the active tiles. */
+        bool IsSkippingSleepingTiles() const;
+        /** Returns if the activity mask is updated after the given iteration. */
+        bool IsActiveTileUpdateIteration(std::uint64_t iteration) const;
+
         /** The current local iteration count. */
         std::uint64_t currentLocalIterationCount_ = 0;
+        /** The part of the grid this node simulates. */
+        std::unique_ptr<SimulationDomain> domain_;
+        /** The size of the simulation state of this node (the whole grid without domain decomposition). */
+        glm::uvec2 simulationSize_;
+        /** The frame buffer the send regions of the halo exchange are read from. */
+        GLuint haloReadFBO_ = 0;
+        /** The halo package sent and the ones received (reused to avoid allocations). */
+        std::vector<std::uint8_t> haloPackage_;
+        std::vector<std::vector<std::uint8_t>> receivedHalos_;
+        /** The cells of the received halos in the state (their tiles are woken, reused to avoid allocations). */
+        std::vector<GridRect> wokenHalos_;
         /** Holds the simulation data. */
         SimulationData simData_;
+        /** Holds the versioned reaction diffusion parameters and their uniform buffer. */
+        std::unique_ptr<SimulationParameterBlock> simParameters_;
 
         /** Toggle switch for iteration step */
         bool iterationToggle_ = true;
-        /** stores seed points */
-        std::vector<SeedPoint> seed_points_;
+        /** The pending seed events. */
+        SeedEventQueue seedEvents_;
+        /** The seed points of the current iteration (reused to avoid allocations). */
+        std::vector<glm::vec2> iterationSeedPoints_;
 
         /** Uniform Location for texture sampler of previous iteration step */
         GLint rdPrevIterationTextureLoc_ = -1;
-        GLint rdDiffusionRateALoc_ = -1;
-        GLint rdDiffusionRateBLoc_ = -1;
-        GLint rdFeedRateLoc_ = -1;
-        GLint rdKillRateLoc_ = -1;
-        GLint rdDtLoc_ = -1;
-        GLint rdSeedPointRadiusLoc_ = -1;
-        GLint rdNumSeedPointsLoc_ = -1;
-        GLint rdSeedPointsLoc_ = -1;
-        GLint rdUseManhattanDistanceLoc_ = -1;
 
         /** Program to compute reaction diffusion step */
-        std::unique_ptr<FullscreenQuad> reactionDiffusionFullScreenQuad_;
+        std::shared_ptr<GPUProgram> reactionDiffusionProgram_;
+        /** Program to compute a reaction diffusion step in the active tiles only (one instanced quad per tile). */
+        std::shared_ptr<GPUProgram> reactionDiffusionTilesProgram_;
+        /** Uniform locations of the active tiles program. */
+        GLint rdtPrevIterationTextureLoc_ = -1;
+        GLint rdtActiveTilesLoc_ = -1;
+        GLint rdtStateSizeLoc_ = -1;
+        /** Empty vertex array for drawing the simulation quad (the vertices are generated in the shader). */
+        GLuint simulationQuadVAO_ = 0;
+        /** Program to compute several reaction diffusion steps in a single dispatch. */
+        std::shared_ptr<GPUProgram> reactionDiffusionComputeProgram_;
+        /** Uniform locations of the compute program. */
+        GLint rdcNumStepsLoc_ = -1;
+        GLint rdcActiveTilesLoc_ = -1;
+        GLint rdcSkipSleepingTilesLoc_ = -1;
+        /** Program drawing the seed point stamps into the state. */
+        std::shared_ptr<GPUProgram> seedSplatProgram_;
+        /** Uniform locations of the seed splat program. */
+        GLint ssTexDimLoc_ = -1;
+        GLint ssGridDimLoc_ = -1;
+        GLint ssDomainOriginLoc_ = -1;
+        /** Program resampling the state to a new grid size and its uniform location. */
+        std::shared_ptr<GPUProgram> resampleStateProgram_;
+        GLint rsStateLoc_ = -1;
+        /** Shader storage buffer holding the seed points of an iteration. */
+        GLuint seedPointBuffer_ = 0;
+        /** The number of seed points the buffer can hold. */
+        std::size_t seedPointBufferCapacity_ = 0;
         /** The frame buffer object for the simulation. */
         std::unique_ptr<FrameBuffer> reactDiffuseFBO_;
 
+        /** The backend currently advancing the simulation. */
+        SimulationBackend activeBackend_ = SimulationBackend::FragmentShader;
+        /** The state format of the simulation textures. */
+        StateFormat activeStateFormat_ = StateFormat::Float32;
+        /** The CPU simulation (created when the CPU backend is first selected). */
+        std::unique_ptr<simulation::CPUSimulator> cpuSimulator_;
+        /** Staging memory for transferring the state between the CPU and the GPU. */
+        std::vector<glm::vec2> cpuStateBuffer_;
+        /** Staging memory for transferring the fixed point state. */
+        std::vector<glm::u16vec2> fixedStateBuffer_;
+
+        /** The tiles of the state that changed recently (the others are not computed by the GPU backends). */
+        std::unique_ptr<ActiveTiles> activeTiles_;
+        /** The value of SimulationData::activeTiles_ in the last frame (all tiles are woken when it is switched on). */
+        bool activeTilesEnabled_ = false;
+
+        /** Measures the change of the state every frame that iterated (for the idle throttling). */
+        std::unique_ptr<ConvergenceMonitor> convergenceMonitor_;
+        /** The value of SimulationData::idleThrottling_ in the last frame (the measurements restart when it is switched on). */
+        bool idleThrottlingEnabled_ = false;
+        /** Estimates the error of the time step every frame that iterated (for the adaptive time step). */
+        std::unique_ptr<StepErrorEstimator> stepErrorEstimator_;
+
+        /** Measures the iteration time and chooses the iterations per frame. */
+        std::unique_ptr<IterationScheduler> iterationScheduler_;
+        /** The outputs derived from the state for the renderers. */
+        std::unique_ptr<DerivedOutputs> derivedOutputs_;
+        /** Set when the state changed since the derived outputs were last computed. */
+        bool derivedOutputsDirty_ = true;
+
+        /** Writes the checkpoints in the background (created with the first checkpoint). */
+        std::unique_ptr<CheckpointWriter> checkpointWriter_;
+        /** The last checkpoint restore request handled (see SimulationData::checkpointRestoreRequest_). */
+        std::uint64_t handledCheckpointRestoreRequest_ = 0;
+        /** Records the windows and the state while SimulationData::recordingId_ is set. */
+        std::unique_ptr<FrameRecorder> frameRecorder_;
+        /** The recording of the recorder. */
+        std::uint64_t activeRecordingId_ = 0;
+        /** The windows drawn in the current frame (the index of the next window recorded). */
+        std::size_t drawnWindows_ = 0;
+#ifdef RD_PROFILING
+        /** Times the phases of the frames. */
+        std::unique_ptr<FrameProfiler> frameProfiler_;
+        /** The last trace export request handled (see SimulationData::traceExportId_). */
+        std::uint64_t exportedTraceId_ = 0;
+#endif
+        /** Hashes the state every SimulationData::stateHashInterval_ iterations. */
+        std::unique_ptr<StateHasher> stateHasher_;
+
         std::vector<std::unique_ptr<renderers::RDRenderer>> renderers_;
 
         /** Holds the simulation plane. */
@@ -0,0 +1,237 @@
+/**
+ * @file   BatchRun.cpp
+ *
+ * @brief  Implementation of the headless batch runs of the simulation on the CPU.
+ */
+
+#include "BatchRun.h"
+#include "app/ParameterScaling.h"
+#include "app/simulation/CPUSimulator.h"
+#include "app/simulation/SpectralSimulator.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <spdlog/spdlog.h>
+
+namespace viscom {
+
+    namespace {
+        /** Maximum size of a stored (uncompressed) deflate block. */
+        constexpr std::size_t DEFLATE_MAX_STORED_BLOCK = 65535;
+
+        std::uint32_t PNGCrc(const std::uint8_t* data, std::size_t size, std::uint32_t crc = 0xffffffffu)
+        {
+            static const auto table = []() {
+                std::array<std::uint32_t, 256> result;
+                for (std::uint32_t n = 0; n < 256; ++n) {
+                    auto c = n;
+                    for (int k = 0; k < 8; ++k) c = (c & 1u) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                    result[n] = c;
+                }
+                return result;
+            }();
+            for (std::size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xffu] ^ (crc >> 8);
+            return crc;
+        }
+
+        void AppendBigEndian(std::vector<std::uint8_t>& out, std::uint32_t value)
+        {
+            for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<std::uint8_t>(value >> shift));
+        }
+
+        void WritePNGChunk(std::ofstream& ofs, const char* type, const std::vector<std::uint8_t>& data)
+        {
+            std::vector<std::uint8_t> chunk;
+            AppendBigEndian(chunk, static_cast<std::uint32_t>(data.size()));
+            chunk.insert(chunk.end(), type, type + 4);
+            chunk.insert(chunk.end(), data.begin(), data.end());
+            AppendBigEndian(chunk, PNGCrc(chunk.data() + 4, chunk.size() - 4) ^ 0xffffffffu);
+            ofs.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+        }
+
+    }
+
+    bool WritePNG(const std::string& filename, const std::vector<std::uint8_t>& pixels, const glm::uvec2& size, unsigned int channels)
+    {
+        std::ofstream ofs(filename, std::ios::binary | std::ios::trunc);
+        if (!ofs.is_open()) return false;
+        const std::array<std::uint8_t, 8> signature{ { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' } };
+        ofs.write(reinterpret_cast<const char*>(signature.data()), signature.size());
+
+        std::vector<std::uint8_t> header;
+        AppendBigEndian(header, size.x);
+        AppendBigEndian(header, size.y);
+        // color type 0 is grey-scale, 2 RGB.
+        header.insert(header.end(), { 8, static_cast<std::uint8_t>(channels == 3 ? 2 : 0), 0, 0, 0 });
+        WritePNGChunk(ofs, "IHDR", header);
+
+        // every row starts with filter type 0 (none).
+        std::vector<std::uint8_t> raw;
+        const auto rowSize = static_cast<std::size_t>(size.x) * channels;
+        raw.reserve((rowSize + 1) * size.y);
+        for (std::size_t y = 0; y < size.y; ++y) {
+            raw.push_back(0);
+            raw.insert(raw.end(), pixels.begin() + y * rowSize, pixels.begin() + (y + 1) * rowSize);
+        }
+
+        std::vector<std::uint8_t> zlib{ 0x78, 0x01 };
+        for (std::size_t offset = 0; offset < raw.size(); offset += DEFLATE_MAX_STORED_BLOCK) {
+            const auto blockSize = std::min(DEFLATE_MAX_STORED_BLOCK, raw.size() - offset);
+            zlib.push_back(offset + blockSize == raw.size() ? 1 : 0);
+            zlib.push_back(static_cast<std::uint8_t>(blockSize));
+            zlib.push_back(static_cast<std::uint8_t>(blockSize >> 8));
+            zlib.push_back(static_cast<std::uint8_t>(~blockSize));
+            zlib.push_back(static_cast<std::uint8_t>(~blockSize >> 8));
+            zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+        }
+        std::uint32_t adlerA = 1, adlerB = 0;
+        for (auto value : raw) {
+            adlerA = (adlerA + value) % 65521u;
+            adlerB = (adlerB + adlerA) % 65521u;
+        }
+        AppendBigEndian(zlib, (adlerB << 16) | adlerA);
+        WritePNGChunk(ofs, "IDAT", zlib);
+        WritePNGChunk(ofs, "IEND", {});
+        return ofs.good();
+    }
+
+    bool ReadSeedScript(const std::string& seedScriptFile, std::vector<BatchSeed>& seeds)
+    {
+        std::ifstream ifs(seedScriptFile);
+        if (!ifs.is_open()) return false;
+
+        std::string line;
+        for (std::size_t lineNumber = 1; std::getline(ifs, line); ++lineNumber) {
+            const auto first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') continue;
+
+            std::istringstream iss(line);
+            BatchSeed seed;
+            if (!(iss >> seed.iteration_ >> seed.position_.x >> seed.position_.y)) {
+                spdlog::error("Could not parse line {} of the seed script {}.", lineNumber, seedScriptFile);
+                return false;
+            }
+            seeds.push_back(seed);
+        }
+        std::stable_sort(seeds.begin(), seeds.end(), [](const BatchSeed& lhs, const BatchSeed& rhs) { return lhs.iteration_ < rhs.iteration_; });
+        return true;
+    }
+
+    bool PrepareOutputDirectory(const std::string& directory)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error) {
+            spdlog::error("Could not create the output directory {}: {}", directory, error.message());
+            return false;
+        }
+
+        // a file is written and removed again, so a read-only directory fails before the run instead of after it.
+        const auto probeFile = directory + "/.write_test";
+        if (!std::ofstream{ probeFile, std::ios::trunc }.is_open()) {
+            spdlog::error("Could not write to the output directory {}.", directory);
+            return false;
+        }
+        std::filesystem::remove(probeFile, error);
+        return true;
+    }
+
+    BatchRun::BatchRun(const BatchSettings& settings, const SimulationParameters& parameters, std::vector<BatchSeed> seeds) :
+        settings_{ settings },
+        parameters_{ ScaleParametersToGrid(parameters, settings.scaleParametersToGrid_ ? static_cast<float>(settings.gridSize_.y) / static_cast<float>(SIMULATION_SIZE_Y) : 1.0f, settings.gridSize_.y) },
+        seeds_{ std::move(seeds) }
+    {
+        if (settings_.spectral_) simulator_ = std::make_unique<simulation::SpectralSimulator>(settings_.gridSize_, settings_.numThreads_);
+        else simulator_ = std::make_unique<simulation::CPUSimulator>(settings_.gridSize_, settings_.numThreads_);
+        simulator_->SetGridPlacement(settings_.gridSize_, glm::ivec2(0));
+    }
+
+    BatchRun::~BatchRun() = default;
+
+    std::string BatchRun::GetOutputPath(const std::string& prefix, std::uint64_t iteration, const std::string& suffix) const
+    {
+        std::array<char, 32> iterationString;
+        std::snprintf(iterationString.data(), iterationString.size(), "%08llu", static_cast<unsigned long long>(iteration));
+        return settings_.outputDirectory_ + "/" + prefix + iterationString.data() + suffix;
+    }
+
+    bool BatchRun::IsOutputIteration(std::uint64_t iteration, const std::vector<std::uint64_t>& iterations, std::uint64_t interval)
+    {
+        if (interval > 0 && iteration % interval == 0) return true;
+        return std::find(iterations.begin(), iterations.end(), iteration) != iterations.end();
+    }
+
+    bool BatchRun::Run()
+    {
+        using Clock = std::chrono::steady_clock;
+        summary_ = BatchSummary{};
+        if (!PrepareOutputDirectory(settings_.outputDirectory_)) return false;
+        simulator_->Reset();
+        if (!WriteOutputs(0)) return false;
+
+        auto nextSeed = seeds_.begin();
+        std::vector<glm::vec2> seedPoints;
+        auto nextProgress = settings_.iterations_ / 10;
+        auto start = Clock::now();
+        for (std::uint64_t iteration = 0; iteration < settings_.iterations_; ++iteration) {
+            seedPoints.clear();
+            for (; nextSeed != seeds_.end() && nextSeed->iteration_ <= iteration; ++nextSeed) seedPoints.push_back(nextSeed->position_);
+            simulator_->Step(parameters_, seedPoints);
+
+            const auto done = iteration + 1;
+            if (!IsOutputIteration(done, settings_.dumpIterations_, settings_.dumpInterval_)
+                && !IsOutputIteration(done, settings_.renderIterations_, settings_.renderInterval_) && done != nextProgress) continue;
+
+            // writing the outputs does not count as simulation time.
+            const auto outputStart = Clock::now();
+            summary_.simulationTime_ += std::chrono::duration<double>(outputStart - start).count();
+            summary_.iterations_ = done;
+            if (done == nextProgress) {
+                spdlog::info("Iteration {} of {} ({:.1f} it/s).", done, settings_.iterations_, static_cast<double>(done) / summary_.simulationTime_);
+                nextProgress += settings_.iterations_ / 10;
+            }
+            if (!WriteOutputs(done)) return false;
+            start = Clock::now();
+            summary_.outputTime_ += std::chrono::duration<double>(start - outputStart).count();
+        }
+        summary_.simulationTime_ += std::chrono::duration<double>(Clock::now() - start).count();
+        summary_.iterations_ = settings_.iterations_;
+        return true;
+    }
+
+    bool BatchRun::WriteOutputs(std::uint64_t iteration)
+    {
+        const auto& size = settings_.gridSize_;
+        if (IsOutputIteration(iteration, settings_.dumpIterations_, settings_.dumpInterval_)) {
+            const auto filename = GetOutputPath("state_", iteration, "_" + std::to_string(size.x) + "x" + std::to_string(size.y) + ".raw");
+            simulator_->GetState(state_);
+            std::ofstream ofs(filename, std::ios::binary | std::ios::trunc);
+            ofs.write(reinterpret_cast<const char*>(state_.data()), static_cast<std::streamsize>(state_.size() * sizeof(glm::vec2)));
+            if (!ofs.good()) {
+                spdlog::error("Could not write the state dump {}.", filename);
+                return false;
+            }
+        }
+
+        if (IsOutputIteration(iteration, settings_.renderIterations_, settings_.renderInterval_)) {
+            const auto filename = GetOutputPath("result_", iteration, ".png");
+            simulator_->GetResult(result_);
+            // images start with the top row.
+            std::vector<std::uint8_t> pixels(result_.size());
+            for (std::size_t y = 0; y < size.y; ++y) {
+                for (std::size_t x = 0; x < size.x; ++x) {
+                    pixels[(size.y - 1 - y) * size.x + x] = static_cast<std::uint8_t>(glm::clamp(result_[y * size.x + x], 0.0f, 1.0f) * 255.0f + 0.5f);
+                }
+            }
+            if (!WritePNG(filename, pixels, size, 1)) {
+                spdlog::error("Could not write the image {}.", filename);
+                return false;
+            }
+        }
+        return true;
+    }
+}
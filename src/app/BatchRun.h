@@ -0,0 +1,117 @@
+/**
+ * @file   BatchRun.h
+ *
+ * @brief  Declaration of the headless batch runs of the simulation on the CPU.
+ */
+
+#pragma once
+
+#include "app/SimulationData.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace viscom {
+
+    namespace simulation {
+        class Simulator;
+    }
+
+    /** The settings of a batch run (filled from the command line of the batch executable). */
+    struct BatchSettings {
+        /** The seed script (empty for a single seed point in the center at iteration 0). */
+        std::string seedScriptFile_;
+        /** The directory the state dumps and images are written to. */
+        std::string outputDirectory_ = ".";
+        /** The simulation grid size. */
+        glm::uvec2 gridSize_ = glm::uvec2{ SIMULATION_SIZE_X, SIMULATION_SIZE_Y };
+        /** Scale the parameters to the grid size (see ScaleParametersToGrid). */
+        bool scaleParametersToGrid_ = true;
+        /** Use the spectral ETDRK2 solver (periodic domain) instead of the explicit one. */
+        bool spectral_ = false;
+        /** The number of threads (0 for all cores). */
+        std::size_t numThreads_ = 0;
+        /** The number of iterations to run. */
+        std::uint64_t iterations_ = 10000;
+        /** The iterations the state is dumped and the result is rendered at (in addition to the intervals). */
+        std::vector<std::uint64_t> dumpIterations_;
+        std::vector<std::uint64_t> renderIterations_;
+        /** Dump the state and render the result every this many iterations (0 for never). */
+        std::uint64_t dumpInterval_ = 0;
+        std::uint64_t renderInterval_ = 0;
+    };
+
+    /** A seed point of a seed script. */
+    struct BatchSeed {
+        /** The iteration the seed point is applied in. */
+        std::uint64_t iteration_;
+        /** The position in texture coordinates. */
+        glm::vec2 position_;
+    };
+
+    /**
+     *  Reads a seed script: one seed point per line as "iteration x y" with x and y in texture coordinates, lines
+     *  starting with # are comments. The seeds are returned sorted by iteration (false if the file cannot be read).
+     */
+    bool ReadSeedScript(const std::string& seedScriptFile, std::vector<BatchSeed>& seeds);
+
+    /**
+     *  Writes an 8 bit grey-scale (1 channel) or RGB (3 channels) PNG, pixels start with the top row. The image data
+     *  is stored without compression (stored deflate blocks), so no compression library is needed, the files of the
+     *  simulation grid sizes are small enough anyway.
+     */
+    bool WritePNG(const std::string& filename, const std::vector<std::uint8_t>& pixels, const glm::uvec2& size, unsigned int channels);
+    /** Creates the output directory if it does not exist and checks that files can be written to it. */
+    bool PrepareOutputDirectory(const std::string& directory);
+
+    /** The time measurements of a batch run. */
+    struct BatchSummary {
+        /** The iterations done. */
+        std::uint64_t iterations_ = 0;
+        /** The time spent in the iterations in seconds (without writing the outputs). */
+        double simulationTime_ = 0.0;
+        /** The time spent writing the outputs in seconds. */
+        double outputTime_ = 0.0;
+    };
+
+    /**
+     *  Runs the simulation on the CPU without a window or an OpenGL context: the seeds of the script are applied
+     *  at their iterations and the iterations run back to back (no frame or wall clock coupling). At the chosen
+     *  iterations the state is written as raw float (A, B) pairs (bottom row first, like the state texture) to
+     *  state_<iteration>_<width>x<height>.raw and the result as a grey-scale image (like SimpleGreyScaleRenderer)
+     *  to result_<iteration>.png.
+     */
+    class BatchRun
+    {
+    public:
+        BatchRun(const BatchSettings& settings, const SimulationParameters& parameters, std::vector<BatchSeed> seeds);
+        ~BatchRun();
+
+        /** Runs all iterations, returns false if the output directory or an output could not be written. */
+        bool Run();
+        /** Returns the time measurements of the run. */
+        const BatchSummary& GetSummary() const { return summary_; }
+
+    private:
+        /** Writes the outputs chosen for the iteration. */
+        bool WriteOutputs(std::uint64_t iteration);
+        /** Returns the path of an output file of the iteration. */
+        std::string GetOutputPath(const std::string& prefix, std::uint64_t iteration, const std::string& suffix) const;
+        static bool IsOutputIteration(std::uint64_t iteration, const std::vector<std::uint64_t>& iterations, std::uint64_t interval);
+
+        /** The settings of the run. */
+        BatchSettings settings_;
+        /** The parameters (scaled to the grid). */
+        SimulationParameters parameters_;
+        /** The seeds sorted by iteration. */
+        std::vector<BatchSeed> seeds_;
+        /** The simulation. */
+        std::unique_ptr<simulation::Simulator> simulator_;
+        /** The time measurements. */
+        BatchSummary summary_;
+
+        /** Buffers for the outputs. */
+        std::vector<glm::vec2> state_;
+        std::vector<float> result_;
+    };
+}
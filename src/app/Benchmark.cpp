@@ -0,0 +1,131 @@
+/**
+ * @file   Benchmark.cpp
+ *
+ * @brief  Implementation of the benchmark results, their JSON report and the comparison to a baseline.
+ */
+
+#include "Benchmark.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+namespace viscom {
+
+    namespace {
+        std::string EscapeJSON(const std::string& str)
+        {
+            std::string result;
+            for (auto c : str) {
+                if (c == '"' || c == '\\') result.push_back('\\');
+                if (static_cast<unsigned char>(c) < 0x20) result.push_back(' ');
+                else result.push_back(c);
+            }
+            return result;
+        }
+
+        std::string FormatNumber(double value)
+        {
+            char str[32];
+            std::snprintf(str, sizeof(str), "%.6g", std::isfinite(value) ? value : 0.0);
+            return str;
+        }
+
+        /** Returns the position after "key": in the line (npos if it is missing). */
+        std::size_t FindJSONValue(const std::string& line, const std::string& key)
+        {
+            const auto quotedKey = "\"" + key + "\":";
+            const auto pos = line.find(quotedKey);
+            if (pos == std::string::npos) return std::string::npos;
+            return line.find_first_not_of(' ', pos + quotedKey.size());
+        }
+
+        bool ReadJSONString(const std::string& line, const std::string& key, std::string& value)
+        {
+            auto pos = FindJSONValue(line, key);
+            if (pos == std::string::npos || line[pos] != '"') return false;
+            value.clear();
+            for (++pos; pos < line.size() && line[pos] != '"'; ++pos) {
+                if (line[pos] == '\\' && pos + 1 < line.size()) ++pos;
+                value.push_back(line[pos]);
+            }
+            return pos < line.size();
+        }
+
+        bool ReadJSONNumber(const std::string& line, const std::string& key, double& value)
+        {
+            const auto pos = FindJSONValue(line, key);
+            if (pos == std::string::npos) return false;
+            char* end = nullptr;
+            value = std::strtod(line.c_str() + pos, &end);
+            return end != line.c_str() + pos;
+        }
+    }
+
+    void BenchmarkReport::AddInfo(const std::string& key, const std::string& value)
+    {
+        info_.emplace_back(key, value);
+    }
+
+    void BenchmarkReport::AddResult(const BenchmarkResult& result)
+    {
+        results_.push_back(result);
+    }
+
+    bool BenchmarkReport::WriteJSON(const std::string& file) const
+    {
+        std::ofstream ofs(file);
+        if (!ofs) return false;
+
+        ofs << "{\n";
+        for (const auto& info : info_) ofs << "  \"" << EscapeJSON(info.first) << "\": \"" << EscapeJSON(info.second) << "\",\n";
+        ofs << "  \"results\": [\n";
+        for (std::size_t i = 0; i < results_.size(); ++i) {
+            const auto& result = results_[i];
+            ofs << "    { \"name\": \"" << EscapeJSON(result.name_) << "\", \"unit\": \"" << EscapeJSON(result.unit_)
+                << "\", \"value\": " << FormatNumber(result.value_) << ", \"higherIsBetter\": " << (result.higherIsBetter_ ? "true" : "false")
+                << ", \"bytesPerIteration\": " << FormatNumber(result.bytesPerIteration_)
+                << ", \"bandwidthGBs\": " << FormatNumber(result.bandwidth_) << " }" << (i + 1 < results_.size() ? "," : "") << "\n";
+        }
+        ofs << "  ]\n}\n";
+        return static_cast<bool>(ofs);
+    }
+
+    bool ReadBenchmarkResults(const std::string& file, std::vector<BenchmarkResult>& results)
+    {
+        std::ifstream ifs(file);
+        if (!ifs) return false;
+
+        results.clear();
+        std::string line;
+        while (std::getline(ifs, line)) {
+            BenchmarkResult result;
+            if (!ReadJSONString(line, "name", result.name_) || !ReadJSONNumber(line, "value", result.value_)) continue;
+            ReadJSONString(line, "unit", result.unit_);
+            const auto higherIsBetter = FindJSONValue(line, "higherIsBetter");
+            result.higherIsBetter_ = higherIsBetter != std::string::npos && line.compare(higherIsBetter, 4, "true") == 0;
+            ReadJSONNumber(line, "bytesPerIteration", result.bytesPerIteration_);
+            ReadJSONNumber(line, "bandwidthGBs", result.bandwidth_);
+            results.push_back(result);
+        }
+        return true;
+    }
+
+    std::vector<BenchmarkComparison> CompareBenchmarkResults(const std::vector<BenchmarkResult>& results,
+        const std::vector<BenchmarkResult>& baseline, double threshold)
+    {
+        std::vector<BenchmarkComparison> comparisons;
+        for (const auto& result : results) {
+            for (const auto& base : baseline) {
+                if (base.name_ != result.name_ || base.value_ <= 0.0) continue;
+
+                BenchmarkComparison comparison{ result.name_, base.value_, result.value_ };
+                comparison.change_ = (result.higherIsBetter_ ? base.value_ - result.value_ : result.value_ - base.value_) / base.value_;
+                comparison.regression_ = comparison.change_ > threshold;
+                comparisons.push_back(comparison);
+                break;
+            }
+        }
+        return comparisons;
+    }
+}
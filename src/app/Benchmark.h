@@ -0,0 +1,71 @@
+/**
+ * @file   Benchmark.h
+ *
+ * @brief  Declaration of the benchmark results, their JSON report and the comparison to a baseline.
+ */
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace viscom {
+
+    /** A measured value of a benchmark case. */
+    struct BenchmarkResult {
+        /** The name of the case, unique within a report (e.g. simulation/fragment/480x270). */
+        std::string name_;
+        /** The unit of the value. */
+        std::string unit_;
+        double value_ = 0.0;
+        /** Whether larger values are better (iterations per second) or worse (times). */
+        bool higherIsBetter_ = false;
+        /** The estimated state traffic per iteration in bytes and the resulting bandwidth in GB/s (0 if the case does not iterate). */
+        double bytesPerIteration_ = 0.0;
+        double bandwidth_ = 0.0;
+    };
+
+    /** The comparison of a result to the result of the same name in a baseline. */
+    struct BenchmarkComparison {
+        std::string name_;
+        double baseline_ = 0.0;
+        double value_ = 0.0;
+        /** The relative change, positive if the result got worse. */
+        double change_ = 0.0;
+        /** Set if the result got worse by more than the threshold. */
+        bool regression_ = false;
+    };
+
+    /**
+     *  Collects the results of a benchmark run and writes them as JSON: an object with the information about the
+     *  run (strings) and a "results" array with one object per line, so a baseline can be read back without a JSON
+     *  library (see ReadBenchmarkResults).
+     */
+    class BenchmarkReport
+    {
+    public:
+        /** Adds information about the run (renderer, window size, ...). */
+        void AddInfo(const std::string& key, const std::string& value);
+        void AddResult(const BenchmarkResult& result);
+        const std::vector<BenchmarkResult>& GetResults() const { return results_; }
+
+        /** Writes the report, returns false if the file cannot be written. */
+        bool WriteJSON(const std::string& file) const;
+
+    private:
+        /** The information about the run. */
+        std::vector<std::pair<std::string, std::string>> info_;
+        std::vector<BenchmarkResult> results_;
+    };
+
+    /** Reads the results of a report written by BenchmarkReport::WriteJSON (false if the file cannot be read). */
+    bool ReadBenchmarkResults(const std::string& file, std::vector<BenchmarkResult>& results);
+
+    /**
+     *  Compares the results to the baseline results of the same name (results without a baseline are skipped).
+     *  A result is a regression if it got worse by more than threshold relative to the baseline.
+     */
+    std::vector<BenchmarkComparison> CompareBenchmarkResults(const std::vector<BenchmarkResult>& results,
+        const std::vector<BenchmarkResult>& baseline, double threshold);
+}
@@ -0,0 +1,331 @@
+/**
+ * @file   BenchmarkNode.cpp
+ *
+ * @brief  Implementation of the application node running the benchmark suite (rd_bench).
+ */
+
+#include "core/open_gl.h"
+#include "BenchmarkNode.h"
+#include "app/ClusterSync.h"
+#include "app/SimulationDomain.h"
+#include "app/SimulationParameterBlock.h"
+#include "core/gfx/FrameBuffer.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <spdlog/spdlog.h>
+
+namespace viscom {
+
+    namespace {
+        /** The frames each case runs before it is measured (grid resize, backend switch, program warm up). */
+        constexpr std::size_t BENCHMARK_WARMUP_FRAMES = 3;
+        /** The maximum frames a case is measured for (ends cases faster than the timer resolution). */
+        constexpr std::size_t BENCHMARK_MAX_FRAMES = 10000;
+        /** The iterations per frame of the simulation cases. */
+        constexpr std::uint64_t BENCHMARK_FRAME_ITERATIONS = 16;
+        /** The seed points placed at the start of every simulation case, so there is a pattern to compute. */
+        constexpr std::size_t BENCHMARK_INITIAL_SEEDS = 4;
+        /** The frames encoded and decoded by each cluster sync case. */
+        constexpr std::size_t SYNC_BENCHMARK_FRAMES = 2000;
+        /** The renderers measured (in the order ApplicationNodeImplementation creates them). */
+        constexpr int RAYCASTER_RENDERER = 0;
+        constexpr int GREYSCALE_RENDERER = 1;
+
+        using BenchmarkClock = std::chrono::steady_clock;
+
+        double GetSeconds(BenchmarkClock::time_point start)
+        {
+            return std::chrono::duration<double>(BenchmarkClock::now() - start).count();
+        }
+
+        std::string FormatSize(const glm::uvec2& size)
+        {
+            return std::to_string(size.x) + "x" + std::to_string(size.y);
+        }
+
+        std::string FormatFraction(float value)
+        {
+            char str[16];
+            std::snprintf(str, sizeof(str), "%.2f", value);
+            return str;
+        }
+    }
+
+    BenchmarkNode::BenchmarkNode(ApplicationNodeInternal* appNode, const BenchmarkSettings& settings) :
+        ApplicationNodeImplementation{ appNode },
+        settings_{ settings }
+    {
+    }
+
+    BenchmarkNode::~BenchmarkNode() = default;
+
+    void BenchmarkNode::InitOpenGL()
+    {
+        CreateCases();
+        RunSyncBenchmarks();
+    }
+
+    void BenchmarkNode::CreateCases()
+    {
+        const std::vector<glm::uvec2> gridSizes = settings_.quick_ ? std::vector<glm::uvec2>{ { 240, 135 }, { 480, 270 } }
+            : std::vector<glm::uvec2>{ { 240, 135 }, { 480, 270 }, { 960, 540 }, { 1920, 1080 } };
+        const std::vector<std::size_t> seedCounts = settings_.quick_ ? std::vector<std::size_t>{ 0, 1, 16, 256 }
+            : std::vector<std::size_t>{ 0, 1, 16, 256, 4096 };
+        const std::vector<float> resolutions = settings_.quick_ ? std::vector<float>{ 0.5f, 1.0f } : std::vector<float>{ 0.25f, 0.5f, 1.0f };
+        const std::vector<float> heights = settings_.quick_ ? std::vector<float>{ 0.1f } : std::vector<float>{ 0.02f, 0.1f, 0.5f };
+        const std::array<const char*, 3> backendNames{ { "fragment", "compute", "cpu" } };
+
+        for (std::size_t b = 0; b < backendNames.size(); ++b) {
+            const auto backend = static_cast<SimulationBackend>(b);
+            for (const auto& gridSize : gridSizes) {
+                cases_.push_back(BenchmarkCase{ std::string("simulation/") + backendNames[b] + "/" + FormatSize(gridSize), CaseType::Simulation,
+                    [backend, gridSize](SimulationData& simData) { simData.simulationBackend_ = backend; simData.gridSize_ = gridSize; },
+                    BENCHMARK_FRAME_ITERATIONS });
+            }
+        }
+
+        // a single iteration per frame, so the seed points are a large part of the frame.
+        for (auto backend : { SimulationBackend::FragmentShader, SimulationBackend::CPU }) {
+            for (auto seeds : seedCounts) {
+                cases_.push_back(BenchmarkCase{ std::string("seeding/") + backendNames[static_cast<std::size_t>(backend)] + "/" + std::to_string(seeds),
+                    CaseType::Seeding, [backend](SimulationData& simData) { simData.simulationBackend_ = backend; }, 1, seeds });
+            }
+        }
+
+        // the renderers draw the state the prepare case grew, the render cache is off so every frame is drawn.
+        cases_.push_back(BenchmarkCase{ "prepare", CaseType::Prepare, [](SimulationData&) {}, 50, 16, settings_.quick_ ? 20u : 100u });
+        for (auto resolution : resolutions) {
+            for (auto height : heights) {
+                cases_.push_back(BenchmarkCase{ "render/raycast/res" + FormatFraction(resolution) + "/height" + FormatFraction(height), CaseType::Rendering,
+                    [resolution, height](SimulationData& simData) {
+                        simData.currentRenderer_ = RAYCASTER_RENDERER;
+                        simData.renderResolution_ = resolution;
+                        simData.simulationHeight_ = height;
+                    } });
+            }
+        }
+        cases_.push_back(BenchmarkCase{ "render/greyscale", CaseType::Rendering, [](SimulationData& simData) { simData.currentRenderer_ = GREYSCALE_RENDERER; } });
+    }
+
+    void BenchmarkNode::RunSyncBenchmarks()
+    {
+        struct SyncCase {
+            const char* name_;
+            std::size_t seedsPerFrame_;
+            bool keyFrames_;
+        };
+        const std::array<SyncCase, 3> syncCases{ { { "steady", 0, false }, { "seeds16", 16, false }, { "keyframe", 16, true } } };
+        const auto frames = settings_.quick_ ? SYNC_BENCHMARK_FRAMES / 4 : SYNC_BENCHMARK_FRAMES;
+
+        for (const auto& syncCase : syncCases) {
+            // a coordinator and a worker side of their own, so the node's simulation is not touched.
+            SimulationData simData = GetSimulationData();
+            SimulationParameterBlock parameters, decodedParameters;
+            SeedEventQueue seedEvents, decodedSeedEvents;
+            ClusterSyncEncoder encoder;
+            ClusterSyncDecoder decoder;
+            const StateHash stateHash;
+            const std::vector<DomainTile> domainTiles;
+            std::vector<std::uint8_t> payload;
+            std::uniform_real_distribution<float> position{ 0.0f, 1.0f };
+
+            double encodeTime = 0.0, decodeTime = 0.0;
+            std::uint64_t payloadBytes = 0;
+            for (std::size_t frame = 0; frame < frames; ++frame) {
+                for (std::size_t i = 0; i < syncCase.seedsPerFrame_; ++i) {
+                    seedEvents.Push(simData.currentGlobalIterationCount_ + 1, glm::vec2(position(random_), position(random_)));
+                }
+                simData.currentGlobalIterationCount_ += BENCHMARK_FRAME_ITERATIONS;
+                if (syncCase.keyFrames_) encoder.RequestKeyFrame();
+
+                auto start = BenchmarkClock::now();
+                encoder.Encode(simData, parameters, seedEvents, stateHash, domainTiles, payload);
+                encodeTime += GetSeconds(start);
+                start = BenchmarkClock::now();
+                if (!decoder.Decode(payload, decodedParameters, decodedSeedEvents)) spdlog::warn("Sync benchmark payload could not be decoded.");
+                decodeTime += GetSeconds(start);
+                payloadBytes += payload.size();
+
+                seedEvents.Retire(simData.currentGlobalIterationCount_);
+                decodedSeedEvents.Retire(simData.currentGlobalIterationCount_);
+            }
+
+            const auto name = std::string("sync/") + syncCase.name_;
+            const auto numFrames = static_cast<double>(frames);
+            report_.AddResult(BenchmarkResult{ name + "/encode", "us", 1e6 * encodeTime / numFrames });
+            report_.AddResult(BenchmarkResult{ name + "/decode", "us", 1e6 * decodeTime / numFrames });
+            report_.AddResult(BenchmarkResult{ name + "/payload", "bytes", static_cast<double>(payloadBytes) / numFrames });
+        }
+    }
+
+    void BenchmarkNode::PlaceSeedPoints(std::uint64_t iteration, std::size_t count)
+    {
+        std::uniform_real_distribution<float> position{ 0.0f, 1.0f };
+        for (std::size_t i = 0; i < count; ++i) GetSeedEvents().Push(iteration, glm::vec2(position(random_), position(random_)));
+    }
+
+    void BenchmarkNode::StartCase()
+    {
+        const auto& benchmarkCase = cases_[currentCase_];
+        auto& simData = GetSimulationData();
+        // everything that adapts to the measurements or skips work is off, so each run does the same work.
+        simData.adaptiveIterations_ = false;
+        simData.dynamicResolution_ = false;
+        simData.activeTiles_ = false;
+        simData.adaptiveTimestep_ = false;
+        simData.idleThrottling_ = false;
+        simData.verifyState_ = false;
+        simData.periodicCheckpoints_ = false;
+        simData.adaptiveRenderResolution_ = false;
+        simData.temporalAccumulation_ = false;
+        simData.reuseFrames_ = false;
+        simData.currentRenderer_ = GREYSCALE_RENDERER;
+        simData.maxFrameIterations_ = glm::max(benchmarkCase.iterationsPerFrame_, std::uint64_t{ 1 });
+        benchmarkCase.setup_(simData);
+
+        // the rendering cases draw the state of the prepare case.
+        if (benchmarkCase.type_ != CaseType::Rendering) {
+            const auto iteration = GetCurrentLocalIterationCount();
+            simData.gridSizeIteration_ = iteration;
+            simData.resetFrameIdx_ = iteration;
+            PlaceSeedPoints(iteration, BENCHMARK_INITIAL_SEEDS);
+        }
+
+        caseFrame_ = 0;
+        measuredFrames_ = 0;
+        measuredTime_ = 0.0;
+        spdlog::info("Benchmark {}.", benchmarkCase.name_);
+    }
+
+    void BenchmarkNode::FinishCase()
+    {
+        const auto& benchmarkCase = cases_[currentCase_];
+        if (benchmarkCase.type_ == CaseType::Prepare || measuredFrames_ == 0) return;
+
+        const auto frameTime = 1000.0 * measuredTime_ / static_cast<double>(measuredFrames_);
+        if (benchmarkCase.type_ == CaseType::Simulation) {
+            const auto iterationsPerSecond = static_cast<double>(measuredFrames_ * benchmarkCase.iterationsPerFrame_) / measuredTime_;
+            const auto bytesPerIteration = GetBytesPerIteration();
+            report_.AddResult(BenchmarkResult{ benchmarkCase.name_, "it/s", iterationsPerSecond, true, bytesPerIteration,
+                1e-9 * bytesPerIteration * iterationsPerSecond });
+        }
+        else if (benchmarkCase.type_ == CaseType::Seeding) {
+            report_.AddResult(BenchmarkResult{ benchmarkCase.name_, "ms", frameTime, false, GetBytesPerIteration() });
+            // the seed counts of a backend start with 0.
+            if (benchmarkCase.seedsPerFrame_ == 0) unseededFrameTime_ = frameTime;
+            else {
+                report_.AddResult(BenchmarkResult{ benchmarkCase.name_ + "/perSeed", "us",
+                    1000.0 * std::max(frameTime - unseededFrameTime_, 0.0) / static_cast<double>(benchmarkCase.seedsPerFrame_) });
+            }
+        }
+        else report_.AddResult(BenchmarkResult{ benchmarkCase.name_, "ms", frameTime });
+    }
+
+    double BenchmarkNode::GetBytesPerIteration()
+    {
+        // a lower bound: every cell is read and written once per pass, the neighbours come from the caches.
+        const auto stateSize = GetSimulationDomain().GetStateSize();
+        const auto cells = static_cast<double>(stateSize.x) * static_cast<double>(stateSize.y);
+        const auto& simData = GetSimulationData();
+        if (simData.simulationBackend_ == SimulationBackend::CPU) return cells * 2.0 * 2.0 * sizeof(float);
+
+        const auto cellSize = simData.stateFormat_ == StateFormat::Float32 ? 2.0 * sizeof(float) : 2.0 * sizeof(std::uint16_t);
+        const auto passesPerIteration = simData.simulationBackend_ == SimulationBackend::ComputeShader
+            ? 1.0 / static_cast<double>(COMPUTE_STEPS_PER_DISPATCH) : 1.0;
+        return cells * 2.0 * cellSize * passesPerIteration;
+    }
+
+    void BenchmarkNode::UpdateFrame(double currentTime, double elapsedTime)
+    {
+        if (currentCase_ >= cases_.size()) return;
+
+        if (caseFrame_ > 0) {
+            const auto& benchmarkCase = cases_[currentCase_];
+            const auto done = benchmarkCase.type_ == CaseType::Prepare ? caseFrame_ >= benchmarkCase.frames_
+                : (measuredFrames_ >= settings_.minCaseFrames_ && measuredTime_ >= settings_.minCaseTime_) || measuredFrames_ >= BENCHMARK_MAX_FRAMES;
+            if (done) {
+                FinishCase();
+                if (++currentCase_ == cases_.size()) {
+                    Finish();
+                    return;
+                }
+                caseFrame_ = 0;
+            }
+        }
+        if (caseFrame_ == 0) StartCase();
+
+        const auto& benchmarkCase = cases_[currentCase_];
+        auto& simData = GetSimulationData();
+        const auto seeds = benchmarkCase.type_ == CaseType::Prepare ? (caseFrame_ == 0 ? benchmarkCase.seedsPerFrame_ : 0) : benchmarkCase.seedsPerFrame_;
+        PlaceSeedPoints(GetCurrentLocalIterationCount(), seeds);
+        simData.currentGlobalIterationCount_ += benchmarkCase.iterationsPerFrame_;
+
+        const auto measured = benchmarkCase.type_ != CaseType::Prepare && caseFrame_ >= BENCHMARK_WARMUP_FRAMES;
+        glFinish();
+        const auto start = BenchmarkClock::now();
+        ApplicationNodeImplementation::UpdateFrame(currentTime, elapsedTime);
+        glFinish();
+        if (measured && benchmarkCase.type_ != CaseType::Rendering) measuredTime_ += GetSeconds(start);
+        if (measured) ++measuredFrames_;
+        GetSeedEvents().Retire(GetCurrentLocalIterationCount());
+        ++caseFrame_;
+    }
+
+    void BenchmarkNode::DrawFrame(FrameBuffer& fbo)
+    {
+        if (windowSize_.x == 0) windowSize_ = glm::uvec2(fbo.GetWidth(), fbo.GetHeight());
+        // UpdateFrame counted this frame already.
+        const auto measured = currentCase_ < cases_.size() && cases_[currentCase_].type_ == CaseType::Rendering && caseFrame_ > BENCHMARK_WARMUP_FRAMES;
+        if (!measured) {
+            ApplicationNodeImplementation::DrawFrame(fbo);
+            return;
+        }
+
+        glFinish();
+        const auto start = BenchmarkClock::now();
+        ApplicationNodeImplementation::DrawFrame(fbo);
+        glFinish();
+        measuredTime_ += GetSeconds(start);
+    }
+
+    void BenchmarkNode::Finish()
+    {
+        const auto glString = [](GLenum name) {
+            const auto str = glGetString(name);
+            return str != nullptr ? std::string(reinterpret_cast<const char*>(str)) : std::string();
+        };
+        report_.AddInfo("glVendor", glString(GL_VENDOR));
+        report_.AddInfo("glRenderer", glString(GL_RENDERER));
+        report_.AddInfo("glVersion", glString(GL_VERSION));
+        report_.AddInfo("windowSize", FormatSize(windowSize_));
+        report_.AddInfo("quick", settings_.quick_ ? "true" : "false");
+
+        for (const auto& result : report_.GetResults()) std::cout << result.name_ << ": " << result.value_ << " " << result.unit_ << "\n";
+        if (!report_.WriteJSON(settings_.outputFile_)) spdlog::error("Could not write the benchmark report {}.", settings_.outputFile_);
+
+        auto regressions = 0;
+        if (!settings_.baselineFile_.empty()) {
+            std::vector<BenchmarkResult> baseline;
+            if (!ReadBenchmarkResults(settings_.baselineFile_, baseline)) {
+                spdlog::error("Could not read the benchmark baseline {}.", settings_.baselineFile_);
+                ++regressions;
+            }
+            // positive changes are worse (slower or larger), whether the value is a time or a rate.
+            std::cout << "\ncompared to " << settings_.baselineFile_ << " (threshold " << 100.0 * settings_.threshold_ << "%):\n";
+            for (const auto& comparison : CompareBenchmarkResults(report_.GetResults(), baseline, settings_.threshold_)) {
+                std::cout << comparison.name_ << ": " << comparison.baseline_ << " -> " << comparison.value_ << " ("
+                    << (comparison.change_ > 0.0 ? "+" : "") << 100.0 * comparison.change_ << "%)"
+                    << (comparison.regression_ ? " REGRESSION" : "") << "\n";
+                if (comparison.regression_) ++regressions;
+            }
+        }
+        std::cout << std::flush;
+
+        // the framework loop cannot be left from the application, the report is written, so the process ends here.
+        std::exit(regressions > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+}
@@ -0,0 +1,110 @@
+/**
+ * @file   BenchmarkNode.h
+ *
+ * @brief  Declaration of the application node running the benchmark suite (rd_bench).
+ */
+
+#pragma once
+
+#include "app/ApplicationNodeImplementation.h"
+#include "app/Benchmark.h"
+#include <functional>
+#include <random>
+
+namespace viscom {
+
+    /** The settings of a benchmark run (filled from the command line of rd_bench). */
+    struct BenchmarkSettings {
+        /** The file the JSON report is written to. */
+        std::string outputFile_ = "rd_bench.json";
+        /** A report the results are compared to (empty for none). */
+        std::string baselineFile_;
+        /** The relative change a result may get worse by before it counts as a regression. */
+        double threshold_ = 0.1;
+        /** Fewer and smaller cases with shorter measurements (e.g. for llvmpipe). */
+        bool quick_ = false;
+        /** The minimum time and number of frames each case is measured for. */
+        double minCaseTime_ = 1.0;
+        std::size_t minCaseFrames_ = 10;
+    };
+
+    /**
+     *  Runs the benchmark cases one after another through the normal frame loop of the node, so the simulation and
+     *  rendering code is measured as the application runs it: the iterations per second of each backend at several
+     *  grid sizes, the frame cost with a growing number of seed points, the raycaster at several render resolutions
+     *  and heights and the grey-scale renderer (with the render cache off) and the coding of the cluster sync
+     *  payloads. Each case is warmed up first (grid resize, backend switch) and measured with glFinish around the
+     *  measured work, so the times hold for llvmpipe and GPUs alike. At the end the report is written, compared to
+     *  the baseline and the process exits with EXIT_FAILURE if a result regressed.
+     */
+    class BenchmarkNode final : public ApplicationNodeImplementation
+    {
+    public:
+        BenchmarkNode(ApplicationNodeInternal* appNode, const BenchmarkSettings& settings);
+        virtual ~BenchmarkNode() override;
+
+        virtual void InitOpenGL() override;
+        virtual void UpdateFrame(double currentTime, double elapsedTime) override;
+        virtual void DrawFrame(FrameBuffer& fbo) override;
+
+    private:
+        /** What a case measures. */
+        enum class CaseType {
+            /** Runs iterations to grow a pattern for the following cases (not measured). */
+            Prepare,
+            /** The time of UpdateFrame (the iterations of the frame). */
+            Simulation,
+            /** The time of UpdateFrame with seed points in every frame. */
+            Seeding,
+            /** The time of DrawFrame (the renderer). */
+            Rendering
+        };
+
+        /** A benchmark case. */
+        struct BenchmarkCase {
+            std::string name_;
+            CaseType type_ = CaseType::Simulation;
+            /** Applied to the simulation data before the case starts. */
+            std::function<void(SimulationData&)> setup_;
+            /** The iterations and seed points per frame. */
+            std::uint64_t iterationsPerFrame_ = 0;
+            std::size_t seedsPerFrame_ = 0;
+            /** The frames a prepare case runs. */
+            std::size_t frames_ = 0;
+        };
+
+        /** Creates the cases (fewer with BenchmarkSettings::quick_). */
+        void CreateCases();
+        /** Measures the coding of the cluster sync payloads (on the CPU, no frames needed). */
+        void RunSyncBenchmarks();
+        /** Starts the current case. */
+        void StartCase();
+        /** Adds the results of the current case to the report. */
+        void FinishCase();
+        /** Writes the report, compares it to the baseline and ends the process. */
+        void Finish();
+        /** Places count seed points at random positions before the given iteration. */
+        void PlaceSeedPoints(std::uint64_t iteration, std::size_t count);
+        /** Returns the estimated state traffic of an iteration with the current backend and grid size in bytes. */
+        double GetBytesPerIteration();
+
+        /** The settings of the run. */
+        BenchmarkSettings settings_;
+        /** The cases and the current one. */
+        std::vector<BenchmarkCase> cases_;
+        std::size_t currentCase_ = 0;
+        /** The frames of the current case so far (including the warm up frames). */
+        std::size_t caseFrame_ = 0;
+        /** The measured frames and their total time in seconds. */
+        std::size_t measuredFrames_ = 0;
+        double measuredTime_ = 0.0;
+        /** The frame time of the last seeding case without seed points in ms (the base of the seed point costs). */
+        double unseededFrameTime_ = 0.0;
+        /** The size of the first window (for the report). */
+        glm::uvec2 windowSize_ = glm::uvec2{ 0 };
+        /** The seed point positions (fixed seed, so every run places the same points). */
+        std::mt19937 random_{ 42 };
+        /** The results of the run. */
+        BenchmarkReport report_;
+    };
+}
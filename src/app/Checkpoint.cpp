@@ -0,0 +1,301 @@
+/**
+ * @file   Checkpoint.cpp
+ *
+ * @brief  Implementation of the binary checkpoints of the simulation state.
+ */
+
+#include "core/open_gl.h"
+#include "Checkpoint.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace viscom {
+
+    namespace {
+        constexpr std::array<char, 8> CHECKPOINT_MAGIC{ { 'R', 'D', 'C', 'H', 'K', 'P', 'T', '\0' } };
+        const std::string CHECKPOINT_PREFIX = "checkpoint_";
+        const std::string CHECKPOINT_EXTENSION = ".rdc";
+
+        std::size_t GetStateOffset(const CheckpointHeader& header)
+        {
+            return static_cast<std::size_t>(header.headerSize_) + header.simulationDataSize_ + header.parametersSize_;
+        }
+    }
+
+    const StateTransferFormat& GetStateTransferFormat(StateFormat format)
+    {
+        // has to match the order of StateFormat.
+        static const std::array<StateTransferFormat, STATE_FORMAT_NAMES.size()> STATE_TRANSFER_FORMATS{ {
+            { GL_RG, GL_FLOAT, 2 * sizeof(float) },
+            { GL_RG, GL_HALF_FLOAT, 2 * sizeof(std::uint16_t) },
+            { GL_RG_INTEGER, GL_UNSIGNED_SHORT, 2 * sizeof(std::uint16_t) }
+        } };
+        return STATE_TRANSFER_FORMATS[static_cast<std::size_t>(format)];
+    }
+
+    std::vector<CheckpointInfo> ListCheckpoints(const std::string& directory)
+    {
+        std::vector<CheckpointInfo> result;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            const auto filename = entry.path().filename().string();
+            if (filename.size() <= CHECKPOINT_PREFIX.size() + CHECKPOINT_EXTENSION.size()
+                || filename.compare(0, CHECKPOINT_PREFIX.size(), CHECKPOINT_PREFIX) != 0
+                || entry.path().extension().string() != CHECKPOINT_EXTENSION) continue;
+
+            const auto iterationString = filename.substr(CHECKPOINT_PREFIX.size(), filename.size() - CHECKPOINT_PREFIX.size() - CHECKPOINT_EXTENSION.size());
+            if (iterationString.find_first_not_of("0123456789") != std::string::npos) continue;
+            result.push_back(CheckpointInfo{ entry.path().string(), std::stoull(iterationString) });
+        }
+
+        std::sort(result.begin(), result.end(), [](const CheckpointInfo& lhs, const CheckpointInfo& rhs) { return lhs.iteration_ < rhs.iteration_; });
+        return result;
+    }
+
+    std::string GetCheckpointPath(const std::string& directory, std::uint64_t iteration)
+    {
+        std::array<char, 32> iterationString;
+        std::snprintf(iterationString.data(), iterationString.size(), "%012llu", static_cast<unsigned long long>(iteration));
+        return directory + "/" + CHECKPOINT_PREFIX + iterationString.data() + CHECKPOINT_EXTENSION;
+    }
+
+    MappedCheckpoint::MappedCheckpoint(const std::string& path)
+    {
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            file_ = nullptr;
+            return;
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file_, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(CheckpointHeader))) return;
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_ == nullptr) return;
+        data_ = static_cast<const std::uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        size_ = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+        file_ = open(path.c_str(), O_RDONLY);
+        if (file_ < 0) return;
+        struct stat fileStat;
+        if (fstat(file_, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(sizeof(CheckpointHeader))) return;
+        auto data = mmap(nullptr, static_cast<std::size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file_, 0);
+        if (data == MAP_FAILED) return;
+        data_ = static_cast<const std::uint8_t*>(data);
+        size_ = static_cast<std::size_t>(fileStat.st_size);
+#endif
+        if (data_ == nullptr) return;
+
+        const auto header = reinterpret_cast<const CheckpointHeader*>(data_);
+        if (header->magic_ != CHECKPOINT_MAGIC || header->version_ != CHECKPOINT_VERSION || header->headerSize_ != sizeof(CheckpointHeader)
+            || header->stateFormat_ < 0 || header->stateFormat_ >= static_cast<std::int32_t>(STATE_FORMAT_NAMES.size())) {
+            spdlog::warn("Checkpoint {} has an unknown format (version {}).", path, header->version_);
+            return;
+        }
+        const auto cellSize = GetStateTransferFormat(static_cast<StateFormat>(header->stateFormat_)).cellSize_;
+        if (header->stateSize_ != static_cast<std::uint64_t>(header->width_) * header->height_ * cellSize
+            || GetStateOffset(*header) + header->stateSize_ > size_) {
+            spdlog::warn("Checkpoint {} is truncated.", path);
+            return;
+        }
+        header_ = header;
+    }
+
+    MappedCheckpoint::~MappedCheckpoint()
+    {
+#ifdef _WIN32
+        if (data_ != nullptr) UnmapViewOfFile(data_);
+        if (mapping_ != nullptr) CloseHandle(mapping_);
+        if (file_ != nullptr) CloseHandle(file_);
+#else
+        if (data_ != nullptr) munmap(const_cast<std::uint8_t*>(data_), size_);
+        if (file_ >= 0) close(file_);
+#endif
+    }
+
+    bool MappedCheckpoint::GetSimulationData(SimulationData& simData) const
+    {
+        if (header_->simulationDataSize_ != sizeof(SimulationData)) return false;
+        std::memcpy(&simData, data_ + header_->headerSize_, sizeof(SimulationData));
+        return true;
+    }
+
+    bool MappedCheckpoint::GetParameters(SimulationParameters& parameters) const
+    {
+        if (header_->parametersSize_ != sizeof(SimulationParameters)) return false;
+        std::memcpy(&parameters, data_ + header_->headerSize_ + header_->simulationDataSize_, sizeof(SimulationParameters));
+        return true;
+    }
+
+    const void* MappedCheckpoint::GetState() const
+    {
+        return data_ + GetStateOffset(*header_);
+    }
+
+    void MappedCheckpoint::UploadState(GLuint texture) const
+    {
+        const auto& transferFormat = GetStateTransferFormat(static_cast<StateFormat>(header_->stateFormat_));
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, static_cast<GLsizei>(header_->width_), static_cast<GLsizei>(header_->height_),
+            transferFormat.format_, transferFormat.type_, GetState());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    CheckpointWriter::CheckpointWriter(const std::string& directory, std::size_t maxCheckpoints) :
+        directory_{ directory },
+        maxCheckpoints_{ maxCheckpoints }
+    {
+        std::error_code error;
+        std::filesystem::create_directories(directory_, error);
+        if (error) spdlog::error("Could not create checkpoint directory {}: {}", directory_, error.message());
+
+        glGenBuffers(1, &pixelPackBuffer_);
+        writerThread_ = std::thread{ [this]() { WriterThread(); } };
+    }
+
+    CheckpointWriter::~CheckpointWriter()
+    {
+        {
+            std::lock_guard<std::mutex> lock{ writerMutex_ };
+            quit_ = true;
+        }
+        writerCondition_.notify_one();
+        writerThread_.join();
+
+        if (fence_ != nullptr) glDeleteSync(fence_);
+        if (pixelPackBuffer_ != 0) glDeleteBuffers(1, &pixelPackBuffer_);
+    }
+
+    bool CheckpointWriter::Request(GLuint stateTexture, StateFormat format, const glm::uvec2& size, std::uint64_t localIterationCount,
+        const SimulationData& simData, const SimulationParameters& parameters)
+    {
+        if (IsBusy()) return false;
+
+        const auto& transferFormat = GetStateTransferFormat(format);
+        header_.magic_ = CHECKPOINT_MAGIC;
+        header_.version_ = CHECKPOINT_VERSION;
+        header_.headerSize_ = sizeof(CheckpointHeader);
+        header_.width_ = size.x;
+        header_.height_ = size.y;
+        header_.stateFormat_ = static_cast<std::int32_t>(format);
+        header_.simulationDataSize_ = sizeof(SimulationData);
+        header_.parametersSize_ = sizeof(SimulationParameters);
+        header_.reserved_ = 0;
+        header_.localIterationCount_ = localIterationCount;
+        header_.globalIterationCount_ = simData.currentGlobalIterationCount_;
+        header_.stateSize_ = static_cast<std::uint64_t>(size.x) * size.y * transferFormat.cellSize_;
+        simData_ = simData;
+        parameters_ = parameters;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelPackBuffer_);
+        if (pixelPackBufferSize_ != header_.stateSize_) {
+            pixelPackBufferSize_ = static_cast<std::size_t>(header_.stateSize_);
+            glBufferData(GL_PIXEL_PACK_BUFFER, pixelPackBufferSize_, nullptr, GL_STREAM_READ);
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, stateTexture);
+        glGetTexImage(GL_TEXTURE_2D, 0, transferFormat.format_, transferFormat.type_, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        return true;
+    }
+
+    void CheckpointWriter::Poll()
+    {
+        if (fence_ == nullptr) return;
+        const auto status = glClientWaitSync(fence_, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+        glDeleteSync(fence_);
+        fence_ = nullptr;
+
+        state_.resize(pixelPackBufferSize_);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelPackBuffer_);
+        const auto mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pixelPackBufferSize_, GL_MAP_READ_BIT);
+        if (mapped != nullptr) std::memcpy(state_.data(), mapped, pixelPackBufferSize_);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (mapped == nullptr) {
+            spdlog::error("Could not map the checkpoint read back buffer.");
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{ writerMutex_ };
+            writing_ = true;
+        }
+        writerCondition_.notify_one();
+    }
+
+    void CheckpointWriter::WriterThread()
+    {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock{ writerMutex_ };
+                writerCondition_.wait(lock, [this]() { return quit_ || writing_; });
+                if (quit_) return;
+            }
+
+            // written to a temporary file first, so a crash never leaves a truncated checkpoint behind.
+            const auto path = GetCheckpointPath(directory_, header_.localIterationCount_);
+            const auto tmpPath = path + ".tmp";
+            auto written = false;
+            {
+                std::ofstream ofs(tmpPath, std::ios::binary | std::ios::trunc);
+                ofs.write(reinterpret_cast<const char*>(&header_), sizeof(CheckpointHeader));
+                ofs.write(reinterpret_cast<const char*>(&simData_), sizeof(SimulationData));
+                ofs.write(reinterpret_cast<const char*>(&parameters_), sizeof(SimulationParameters));
+                ofs.write(reinterpret_cast<const char*>(state_.data()), static_cast<std::streamsize>(state_.size()));
+                ofs.close();
+                written = !ofs.fail();
+            }
+
+            std::error_code error;
+            if (!written) {
+                // the older checkpoints stay, the failed one must neither replace nor prune them.
+                spdlog::error("Could not write checkpoint {}.", tmpPath);
+                std::filesystem::remove(tmpPath, error);
+                writing_ = false;
+                continue;
+            }
+
+            std::filesystem::rename(tmpPath, path, error);
+            if (error) spdlog::error("Could not write checkpoint {}: {}", path, error.message());
+            else {
+                RemoveOldCheckpoints();
+                ++numWritten_;
+                spdlog::info("Wrote checkpoint {}.", path);
+            }
+
+            writing_ = false;
+        }
+    }
+
+    void CheckpointWriter::RemoveOldCheckpoints() const
+    {
+        const auto checkpoints = ListCheckpoints(directory_);
+        const auto maxCheckpoints = glm::max(maxCheckpoints_.load(), std::size_t{ 1 });
+        for (std::size_t i = 0; i + maxCheckpoints < checkpoints.size(); ++i) {
+            std::error_code error;
+            std::filesystem::remove(checkpoints[i].path_, error);
+        }
+    }
+}
@@ -0,0 +1,167 @@
+/**
+ * @file   Checkpoint.h
+ *
+ * @brief  Declaration of the binary checkpoints of the simulation state.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "app/SimulationData.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace viscom {
+
+    /** The version of the checkpoint file layout (increase on every change). */
+    constexpr std::uint32_t CHECKPOINT_VERSION = 1;
+
+    /**
+     *  The header at the start of a checkpoint file. It is followed by SimulationData, SimulationParameters (both as
+     *  raw bytes, only restored if their sizes match this build) and the state texture in its state format.
+     */
+    struct CheckpointHeader {
+        /** Always "RDCHKPT". */
+        std::array<char, 8> magic_;
+        std::uint32_t version_;
+        std::uint32_t headerSize_;
+        std::uint32_t width_;
+        std::uint32_t height_;
+        /** The StateFormat of the stored state. */
+        std::int32_t stateFormat_;
+        std::uint32_t simulationDataSize_;
+        std::uint32_t parametersSize_;
+        std::uint32_t reserved_;
+        /** The iteration count of the stored state. */
+        std::uint64_t localIterationCount_;
+        /** The global iteration count when the checkpoint was taken. */
+        std::uint64_t globalIterationCount_;
+        /** The size of the state in bytes. */
+        std::uint64_t stateSize_;
+    };
+    static_assert(sizeof(CheckpointHeader) == 64, "The checkpoint header has a fixed size.");
+
+    /** Pixel transfer format and size of a cell of a state format (the state is transferred in its own format). */
+    struct StateTransferFormat {
+        GLenum format_;
+        GLenum type_;
+        std::size_t cellSize_;
+    };
+
+    /** Returns the pixel transfer format of a state format. */
+    const StateTransferFormat& GetStateTransferFormat(StateFormat format);
+
+    /** A checkpoint file found on disk. */
+    struct CheckpointInfo {
+        std::string path_;
+        std::uint64_t iteration_;
+    };
+
+    /** Returns the checkpoints in the directory sorted by iteration. */
+    std::vector<CheckpointInfo> ListCheckpoints(const std::string& directory);
+    /** Returns the path of the checkpoint of the given iteration. */
+    std::string GetCheckpointPath(const std::string& directory, std::uint64_t iteration);
+
+    /** A checkpoint file mapped into memory for loading. */
+    class MappedCheckpoint
+    {
+    public:
+        explicit MappedCheckpoint(const std::string& path);
+        MappedCheckpoint(const MappedCheckpoint&) = delete;
+        MappedCheckpoint& operator=(const MappedCheckpoint&) = delete;
+        ~MappedCheckpoint();
+
+        /** Returns if the file exists and has a valid header for its size. */
+        bool IsValid() const { return header_ != nullptr; }
+        const CheckpointHeader& GetHeader() const { return *header_; }
+        /** Copies the stored simulation data, returns false if it was written by an incompatible build. */
+        bool GetSimulationData(SimulationData& simData) const;
+        /** Copies the stored simulation parameters, returns false if they were written by an incompatible build. */
+        bool GetParameters(SimulationParameters& parameters) const;
+        /** Returns the stored state (GetHeader().stateSize_ bytes). */
+        const void* GetState() const;
+        /** Uploads the stored state directly from the mapping to a texture of the stored format and size. */
+        void UploadState(GLuint texture) const;
+
+    private:
+        /** The mapped file. */
+        const std::uint8_t* data_ = nullptr;
+        std::size_t size_ = 0;
+        /** The header (nullptr if the file is invalid). */
+        const CheckpointHeader* header_ = nullptr;
+#ifdef _WIN32
+        void* file_ = nullptr;
+        void* mapping_ = nullptr;
+#else
+        int file_ = -1;
+#endif
+    };
+
+    /**
+     *  Writes checkpoints without stalling the frame: the state texture is read back into a pixel pack buffer, the
+     *  buffer is mapped once its fence signaled (a later frame) and the file is written by a background thread. Only
+     *  the newest checkpoints are kept.
+     */
+    class CheckpointWriter
+    {
+    public:
+        CheckpointWriter(const std::string& directory, std::size_t maxCheckpoints);
+        CheckpointWriter(const CheckpointWriter&) = delete;
+        CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+        ~CheckpointWriter();
+
+        /** Starts reading back the state texture, returns false if the previous checkpoint is not written yet. */
+        bool Request(GLuint stateTexture, StateFormat format, const glm::uvec2& size, std::uint64_t localIterationCount,
+            const SimulationData& simData, const SimulationParameters& parameters);
+        /** Hands a finished read back to the writer thread (never waits for the GPU). */
+        void Poll();
+
+        /** Returns if a checkpoint is read back or written. */
+        bool IsBusy() const { return fence_ != nullptr || writing_; }
+        void SetMaxCheckpoints(std::size_t maxCheckpoints) { maxCheckpoints_ = maxCheckpoints; }
+        const std::string& GetDirectory() const { return directory_; }
+        /** Returns the number of checkpoints written so far. */
+        std::uint64_t GetNumWritten() const { return numWritten_; }
+
+    private:
+        /** Writes the pending checkpoint and removes old ones (background thread). */
+        void WriterThread();
+        /** Removes the oldest checkpoints until at most maxCheckpoints_ remain. */
+        void RemoveOldCheckpoints() const;
+
+        /** The directory of the checkpoints. */
+        std::string directory_;
+        /** The number of checkpoints kept on disk. */
+        std::atomic<std::size_t> maxCheckpoints_;
+
+        /** The pixel pack buffer the state is read back into. */
+        GLuint pixelPackBuffer_ = 0;
+        /** The size of the pixel pack buffer. */
+        std::size_t pixelPackBufferSize_ = 0;
+        /** Signals the end of the read back (nullptr if none is pending). */
+        GLsync fence_ = nullptr;
+
+        /** The header and data of the checkpoint being read back or written. */
+        CheckpointHeader header_;
+        SimulationData simData_;
+        SimulationParameters parameters_;
+        /** The state copied from the pixel pack buffer (reused between checkpoints). */
+        std::vector<std::uint8_t> state_;
+
+        /** The writer thread. */
+        std::thread writerThread_;
+        std::mutex writerMutex_;
+        std::condition_variable writerCondition_;
+        /** Set while the writer thread owns the pending checkpoint. */
+        std::atomic<bool> writing_{ false };
+        /** Set to stop the writer thread. */
+        bool quit_ = false;
+        /** The number of checkpoints written. */
+        std::atomic<std::uint64_t> numWritten_{ 0 };
+    };
+}
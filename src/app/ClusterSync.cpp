@@ -0,0 +1,240 @@
+/**
+ * @file   ClusterSync.cpp
+ *
+ * @brief  Implementation of the compact encoding of the data the coordinator synchronizes to the workers every frame.
+ */
+
+#include "ClusterSync.h"
+#include "app/SimulationParameterBlock.h"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+
+namespace viscom {
+
+    /** The weight of a new payload in the moving average of the payload size. */
+    constexpr float PAYLOAD_SIZE_SMOOTHING = 0.05f;
+
+    namespace {
+        /** The parts of a payload (flags in its first byte). */
+        enum SyncPayloadFlags : std::uint8_t {
+            KeyFrame = 1u << 0,
+            SimulationDataChanged = 1u << 1,
+            ParametersChanged = 1u << 2,
+            NewSeedEvents = 1u << 3,
+            StateHashChanged = 1u << 4,
+            DomainTilesChanged = 1u << 5
+        };
+
+        void WriteVarUInt(std::vector<std::uint8_t>& buffer, std::uint64_t value)
+        {
+            while (value >= 0x80) {
+                buffer.push_back(static_cast<std::uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            buffer.push_back(static_cast<std::uint8_t>(value));
+        }
+
+        /** Signed values are zigzag encoded, so small negative deltas stay short. */
+        void WriteVarInt(std::vector<std::uint8_t>& buffer, std::int64_t value)
+        {
+            WriteVarUInt(buffer, (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+        }
+
+        void WriteBytes(std::vector<std::uint8_t>& buffer, const void* data, std::size_t size)
+        {
+            const auto bytes = static_cast<const std::uint8_t*>(data);
+            buffer.insert(buffer.end(), bytes, bytes + size);
+        }
+
+        /** Reads a payload, every read fails after the end was passed. */
+        class PayloadReader
+        {
+        public:
+            explicit PayloadReader(const std::vector<std::uint8_t>& payload) : payload_{ payload } {}
+
+            bool ReadVarUInt(std::uint64_t& value)
+            {
+                value = 0;
+                for (unsigned int shift = 0; shift < 64; shift += 7) {
+                    if (position_ >= payload_.size()) return false;
+                    const auto byte = payload_[position_++];
+                    value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                    if ((byte & 0x80) == 0) return true;
+                }
+                return false;
+            }
+
+            bool ReadVarInt(std::int64_t& value)
+            {
+                std::uint64_t zigzag = 0;
+                if (!ReadVarUInt(zigzag)) return false;
+                value = static_cast<std::int64_t>(zigzag >> 1) ^ -static_cast<std::int64_t>(zigzag & 1);
+                return true;
+            }
+
+            bool ReadBytes(void* data, std::size_t size)
+            {
+                if (size > payload_.size() - position_) return false;
+                std::memcpy(data, payload_.data() + position_, size);
+                position_ += size;
+                return true;
+            }
+
+            bool IsAtEnd() const { return position_ == payload_.size(); }
+
+        private:
+            const std::vector<std::uint8_t>& payload_;
+            std::size_t position_ = 0;
+        };
+
+        /** Returns the bytes of the simulation data without the iteration count (which is sent separately). */
+        void GetSimulationDataBytes(const SimulationData& simData, std::vector<std::uint8_t>& bytes)
+        {
+            bytes.resize(sizeof(SimulationData));
+            std::memcpy(bytes.data(), &simData, sizeof(SimulationData));
+            std::memset(bytes.data() + offsetof(SimulationData, currentGlobalIterationCount_), 0, sizeof(std::uint64_t));
+        }
+
+        void UpdateStatistics(ClusterSyncStatistics& statistics, std::size_t payloadSize, std::size_t seedEvents,
+            const std::chrono::high_resolution_clock::time_point& codingStart)
+        {
+            const std::chrono::duration<float, std::micro> codingTime = std::chrono::high_resolution_clock::now() - codingStart;
+            statistics.payloadSize_ = payloadSize;
+            statistics.averagePayloadSize_ = statistics.numPayloads_ == 0 ? static_cast<float>(payloadSize)
+                : glm::mix(statistics.averagePayloadSize_, static_cast<float>(payloadSize), PAYLOAD_SIZE_SMOOTHING);
+            statistics.maxPayloadSize_ = glm::max(statistics.maxPayloadSize_, payloadSize);
+            statistics.numPayloads_ += 1;
+            statistics.totalBytes_ += payloadSize;
+            statistics.seedEvents_ = seedEvents;
+            statistics.codingTime_ = codingTime.count();
+        }
+    }
+
+    void ClusterSyncEncoder::Encode(const SimulationData& simData, const SimulationParameterBlock& parameters, const SeedEventQueue& seedEvents,
+        const StateHash& stateHash, const std::vector<DomainTile>& domainTiles, std::vector<std::uint8_t>& payload)
+    {
+        const auto codingStart = std::chrono::high_resolution_clock::now();
+        const auto keyFrame = keyFrameRequested_ || framesSinceKeyFrame_ + 1 >= SYNC_KEY_FRAME_INTERVAL;
+        keyFrameRequested_ = false;
+        framesSinceKeyFrame_ = keyFrame ? 0 : framesSinceKeyFrame_ + 1;
+
+        GetSimulationDataBytes(simData, simulationData_);
+        // a key frame repeats the pending seed events for workers that joined, the others skip known sequence numbers.
+        if (keyFrame) seedEvents.GetEvents(seedEvents_);
+        else seedEvents.GetEventsAfter(lastSequence_, seedEvents_);
+
+        std::uint8_t flags = keyFrame ? KeyFrame : 0;
+        if (keyFrame || simulationData_ != lastSimulationData_) flags |= SimulationDataChanged;
+        if (keyFrame || parameters.GetVersion() != lastParameterVersion_) flags |= ParametersChanged;
+        if (!seedEvents_.empty()) flags |= NewSeedEvents;
+        if (keyFrame || stateHash.iteration_ != lastStateHash_.iteration_ || stateHash.hash_ != lastStateHash_.hash_) flags |= StateHashChanged;
+        if (keyFrame || domainTiles != lastDomainTiles_) flags |= DomainTilesChanged;
+
+        payload.clear();
+        payload.push_back(flags);
+        const auto iteration = simData.currentGlobalIterationCount_;
+        if (keyFrame) WriteVarUInt(payload, iteration);
+        else WriteVarInt(payload, static_cast<std::int64_t>(iteration - lastIteration_));
+
+        if (flags & SimulationDataChanged) WriteBytes(payload, simulationData_.data(), simulationData_.size());
+        if (flags & ParametersChanged) {
+            WriteVarUInt(payload, parameters.GetVersion());
+            WriteBytes(payload, &parameters.Get(), sizeof(SimulationParameters));
+        }
+        if (flags & NewSeedEvents) {
+            // the pending sequence numbers are consecutive, seeds are placed shortly after the current iteration.
+            WriteVarUInt(payload, seedEvents_.size());
+            WriteVarUInt(payload, seedEvents_.front().sequence_);
+            for (const auto& seedEvent : seedEvents_) {
+                WriteVarInt(payload, static_cast<std::int64_t>(seedEvent.iteration_ - iteration));
+                const std::array<std::uint16_t, 2> position{ { QuantizeSeedCoordinate(seedEvent.position_.x), QuantizeSeedCoordinate(seedEvent.position_.y) } };
+                WriteBytes(payload, position.data(), sizeof(position));
+            }
+            lastSequence_ = seedEvents_.back().sequence_;
+        }
+        if (flags & StateHashChanged) {
+            WriteVarUInt(payload, stateHash.iteration_);
+            WriteBytes(payload, &stateHash.hash_, sizeof(stateHash.hash_));
+        }
+        if (flags & DomainTilesChanged) {
+            WriteVarUInt(payload, domainTiles.size());
+            if (!domainTiles.empty()) WriteBytes(payload, domainTiles.data(), domainTiles.size() * sizeof(DomainTile));
+        }
+
+        lastIteration_ = iteration;
+        lastSimulationData_.swap(simulationData_);
+        lastParameterVersion_ = parameters.GetVersion();
+        lastStateHash_ = stateHash;
+        if (flags & DomainTilesChanged) lastDomainTiles_ = domainTiles;
+        UpdateStatistics(statistics_, payload.size(), seedEvents_.size(), codingStart);
+    }
+
+    bool ClusterSyncDecoder::Decode(const std::vector<std::uint8_t>& payload, SimulationParameterBlock& parameters, SeedEventQueue& seedEvents)
+    {
+        const auto codingStart = std::chrono::high_resolution_clock::now();
+        PayloadReader reader{ payload };
+        std::uint8_t flags = 0;
+        if (!reader.ReadBytes(&flags, sizeof(flags))) return false;
+        // deltas can only be applied on top of a key frame.
+        const auto keyFrame = (flags & KeyFrame) != 0;
+        if (!keyFrame && !synchronized_) return false;
+
+        // everything is read before anything is applied, so a malformed payload changes nothing.
+        auto iteration = simulationData_.currentGlobalIterationCount_;
+        if (keyFrame) {
+            if (!reader.ReadVarUInt(iteration)) return false;
+        }
+        else {
+            std::int64_t iterationDelta = 0;
+            if (!reader.ReadVarInt(iterationDelta)) return false;
+            iteration += static_cast<std::uint64_t>(iterationDelta);
+        }
+
+        auto simData = simulationData_;
+        if ((flags & SimulationDataChanged) && !reader.ReadBytes(&simData, sizeof(SimulationData))) return false;
+        simData.currentGlobalIterationCount_ = iteration;
+
+        std::uint64_t parameterVersion = 0;
+        SimulationParameters simParameters;
+        if ((flags & ParametersChanged) && (!reader.ReadVarUInt(parameterVersion) || !reader.ReadBytes(&simParameters, sizeof(SimulationParameters)))) return false;
+
+        std::vector<SeedEvent> receivedEvents;
+        if (flags & NewSeedEvents) {
+            std::uint64_t numEvents = 0;
+            std::uint64_t sequence = 0;
+            if (!reader.ReadVarUInt(numEvents) || !reader.ReadVarUInt(sequence) || numEvents > payload.size()) return false;
+            receivedEvents.resize(static_cast<std::size_t>(numEvents));
+            for (auto& seedEvent : receivedEvents) {
+                std::int64_t iterationOffset = 0;
+                std::array<std::uint16_t, 2> position;
+                if (!reader.ReadVarInt(iterationOffset) || !reader.ReadBytes(position.data(), sizeof(position))) return false;
+                seedEvent.sequence_ = sequence++;
+                seedEvent.iteration_ = iteration + static_cast<std::uint64_t>(iterationOffset);
+                seedEvent.position_ = glm::vec2(DequantizeSeedCoordinate(position[0]), DequantizeSeedCoordinate(position[1]));
+            }
+        }
+
+        auto stateHash = stateHash_;
+        if ((flags & StateHashChanged) && (!reader.ReadVarUInt(stateHash.iteration_) || !reader.ReadBytes(&stateHash.hash_, sizeof(stateHash.hash_)))) return false;
+
+        std::vector<DomainTile> domainTiles;
+        if (flags & DomainTilesChanged) {
+            std::uint64_t numTiles = 0;
+            if (!reader.ReadVarUInt(numTiles) || numTiles > payload.size() / sizeof(DomainTile)) return false;
+            domainTiles.resize(static_cast<std::size_t>(numTiles));
+            if (!domainTiles.empty() && !reader.ReadBytes(domainTiles.data(), domainTiles.size() * sizeof(DomainTile))) return false;
+        }
+        if (!reader.IsAtEnd()) return false;
+
+        synchronized_ = true;
+        simulationData_ = simData;
+        if (flags & ParametersChanged) parameters.SetSynchronized(simParameters, parameterVersion);
+        for (const auto& seedEvent : receivedEvents) seedEvents.Insert(seedEvent);
+        stateHash_ = stateHash;
+        if (flags & DomainTilesChanged) domainTiles_.swap(domainTiles);
+        UpdateStatistics(statistics_, payload.size(), receivedEvents.size(), codingStart);
+        return true;
+    }
+}
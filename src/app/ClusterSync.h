@@ -0,0 +1,103 @@
+/**
+ * @file   ClusterSync.h
+ *
+ * @brief  Declaration of the compact encoding of the data the coordinator synchronizes to the workers every frame.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "app/SimulationData.h"
+#include "app/SeedEventQueue.h"
+#include "app/SimulationDomain.h"
+#include "app/StateSync.h"
+#include <vector>
+
+namespace viscom {
+
+    class SimulationParameterBlock;
+
+    /** A key frame (with all data) is sent at least every SYNC_KEY_FRAME_INTERVAL frames, so joining workers can start. */
+    constexpr std::uint64_t SYNC_KEY_FRAME_INTERVAL = 300;
+
+    /** The sizes and coding times of the synchronization payloads. */
+    struct ClusterSyncStatistics {
+        /** The size of the last payload in bytes. */
+        std::size_t payloadSize_ = 0;
+        /** The moving average and the maximum of the payload size in bytes. */
+        float averagePayloadSize_ = 0.0f;
+        std::size_t maxPayloadSize_ = 0;
+        /** The number of payloads and their total size in bytes. */
+        std::uint64_t numPayloads_ = 0;
+        std::uint64_t totalBytes_ = 0;
+        /** The number of seed events in the last payload. */
+        std::size_t seedEvents_ = 0;
+        /** The time encoding or decoding the last payload took in microseconds. */
+        float codingTime_ = 0.0f;
+    };
+
+    /**
+     *  Encodes the synchronized data of a frame into a byte payload. Only the data that changed since the last frame
+     *  is written: the iteration count as a delta, the simulation data and parameters after a change, each seed event
+     *  once (consecutive sequence numbers, iterations relative to the frame, 16 bit positions) and the state hash and
+     *  domain tiles when they change. Key frames hold all data as absolute values (and the pending seed events).
+     */
+    class ClusterSyncEncoder
+    {
+    public:
+        /** Makes the next payload a key frame (a worker joined). */
+        void RequestKeyFrame() { keyFrameRequested_ = true; }
+        /** Encodes the data of this frame into payload. */
+        void Encode(const SimulationData& simData, const SimulationParameterBlock& parameters, const SeedEventQueue& seedEvents,
+            const StateHash& stateHash, const std::vector<DomainTile>& domainTiles, std::vector<std::uint8_t>& payload);
+
+        const ClusterSyncStatistics& GetStatistics() const { return statistics_; }
+
+    private:
+        /** Set if the next payload is a key frame. */
+        bool keyFrameRequested_ = true;
+        /** The frames since the last key frame. */
+        std::uint64_t framesSinceKeyFrame_ = 0;
+        /** The data sent last. */
+        std::uint64_t lastIteration_ = 0;
+        std::vector<std::uint8_t> lastSimulationData_;
+        /** The bytes of the current simulation data (reused to avoid allocations). */
+        std::vector<std::uint8_t> simulationData_;
+        std::uint64_t lastParameterVersion_ = 0;
+        std::uint64_t lastSequence_ = 0;
+        StateHash lastStateHash_;
+        std::vector<DomainTile> lastDomainTiles_;
+        /** The seed events to send (reused to avoid allocations). */
+        std::vector<SeedEvent> seedEvents_;
+        /** The statistics of the payloads. */
+        ClusterSyncStatistics statistics_;
+    };
+
+    /** Decodes the payloads of a ClusterSyncEncoder and keeps the data that is only sent after a change. */
+    class ClusterSyncDecoder
+    {
+    public:
+        /**
+         *  Applies a payload: the parameters and seed events are passed on, the other data is kept. Returns false if
+         *  the payload is malformed or no key frame was received yet (then nothing is applied).
+         */
+        bool Decode(const std::vector<std::uint8_t>& payload, SimulationParameterBlock& parameters, SeedEventQueue& seedEvents);
+
+        /** Returns if a key frame was received. */
+        bool IsSynchronized() const { return synchronized_; }
+        const SimulationData& GetSimulationData() const { return simulationData_; }
+        const StateHash& GetStateHash() const { return stateHash_; }
+        const std::vector<DomainTile>& GetDomainTiles() const { return domainTiles_; }
+        const ClusterSyncStatistics& GetStatistics() const { return statistics_; }
+
+    private:
+        /** Set after the first key frame. */
+        bool synchronized_ = false;
+        /** The data received last. */
+        SimulationData simulationData_;
+        StateHash stateHash_;
+        std::vector<DomainTile> domainTiles_;
+        /** The statistics of the payloads. */
+        ClusterSyncStatistics statistics_;
+    };
+}
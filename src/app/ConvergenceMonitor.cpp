@@ -0,0 +1,117 @@
+/**
+ * @file   ConvergenceMonitor.cpp
+ *
+ * @brief  Implementation of the measurement of the global change of the simulation state between frames.
+ */
+
+#include "core/open_gl.h"
+#include "ConvergenceMonitor.h"
+#include "core/app/ApplicationNodeBase.h"
+#include <algorithm>
+#include <cstring>
+
+namespace viscom {
+
+    /** Has to match LOCAL_SIZE in stateChange.comp. */
+    constexpr GLuint CHANGE_LOCAL_SIZE = 16;
+
+    ConvergenceMonitor::ConvergenceMonitor(ApplicationNodeBase* appNode)
+    {
+        changeProgram_ = appNode->GetGPUProgramManager().GetResource("stateChange", std::vector<std::string>{ "stateChange.comp" });
+        changeFixedProgram_ = appNode->GetGPUProgramManager().GetResource("stateChangeFixed16", std::vector<std::string>{ "stateChange.comp" },
+            std::vector<std::string>{ "STATE_FIXED16" });
+        changeStateLoc_ = changeProgram_->getUniformLocation("state");
+        changeFixedStateLoc_ = changeFixedProgram_->getUniformLocation("state");
+
+        for (auto& pendingChange : pendingChanges_) {
+            glGenBuffers(1, &pendingChange.buffer_);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, pendingChange.buffer_);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    ConvergenceMonitor::~ConvergenceMonitor()
+    {
+        for (auto& pendingChange : pendingChanges_) {
+            if (pendingChange.fence_ != nullptr) glDeleteSync(pendingChange.fence_);
+            glDeleteBuffers(1, &pendingChange.buffer_);
+        }
+        if (referenceTexture_ != 0) glDeleteTextures(1, &referenceTexture_);
+    }
+
+    void ConvergenceMonitor::Measure(GLuint stateTexture, StateFormat format, const glm::uvec2& size, std::uint64_t iteration)
+    {
+        if (size != referenceSize_) {
+            if (referenceTexture_ != 0) glDeleteTextures(1, &referenceTexture_);
+            glGenTextures(1, &referenceTexture_);
+            glBindTexture(GL_TEXTURE_2D, referenceTexture_);
+            glTexStorage2D(GL_TEXTURE_2D, 1, GL_RG32F, static_cast<GLsizei>(size.x), static_cast<GLsizei>(size.y));
+            glBindTexture(GL_TEXTURE_2D, 0);
+            referenceSize_ = size;
+            referenceIteration_ = 0;
+        }
+
+        // with all measurements in flight the copy is kept, so the next measurement spans more iterations.
+        const auto pendingChange = std::find_if(pendingChanges_.begin(), pendingChanges_.end(), [](const PendingChange& change) { return change.fence_ == nullptr; });
+        if (pendingChange == pendingChanges_.end()) return;
+        // the first pass after a clear only copies the state.
+        const auto iterations = referenceIteration_ != 0 && iteration > referenceIteration_ ? iteration - referenceIteration_ : 0;
+
+        const GLuint zero = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, pendingChange->buffer_);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), &zero);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, pendingChange->buffer_);
+
+        const auto fixedPoint = format == StateFormat::Fixed16;
+        glUseProgram(fixedPoint ? changeFixedProgram_->getProgramId() : changeProgram_->getProgramId());
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, stateTexture);
+        glUniform1i(fixedPoint ? changeFixedStateLoc_ : changeStateLoc_, 0);
+        glBindImageTexture(0, referenceTexture_, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RG32F);
+        glDispatchCompute((size.x + CHANGE_LOCAL_SIZE - 1) / CHANGE_LOCAL_SIZE, (size.y + CHANGE_LOCAL_SIZE - 1) / CHANGE_LOCAL_SIZE, 1);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+        referenceIteration_ = iteration;
+        if (iterations == 0) return;
+
+        pendingChange->iteration_ = iteration;
+        pendingChange->iterations_ = iterations;
+        pendingChange->fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    void ConvergenceMonitor::Poll()
+    {
+        for (auto& pendingChange : pendingChanges_) {
+            if (pendingChange.fence_ == nullptr) continue;
+            const auto status = glClientWaitSync(pendingChange.fence_, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) continue;
+            glDeleteSync(pendingChange.fence_);
+            pendingChange.fence_ = nullptr;
+
+            // the shader takes the maximum of the bits, which orders non-negative floats like their values.
+            GLuint maxChangeBits = 0;
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, pendingChange.buffer_);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(maxChangeBits), &maxChangeBits);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            float maxChange = 0.0f;
+            std::memcpy(&maxChange, &maxChangeBits, sizeof(maxChange));
+
+            if (pendingChange.iteration_ < latestChange_.iteration_) continue;
+            latestChange_.iteration_ = pendingChange.iteration_;
+            latestChange_.maxChange_ = maxChange / static_cast<float>(pendingChange.iterations_);
+        }
+    }
+
+    void ConvergenceMonitor::Clear()
+    {
+        for (auto& pendingChange : pendingChanges_) {
+            if (pendingChange.fence_ != nullptr) glDeleteSync(pendingChange.fence_);
+            pendingChange.fence_ = nullptr;
+        }
+        referenceIteration_ = 0;
+        latestChange_ = StateChange{};
+    }
+}
@@ -0,0 +1,79 @@
+/**
+ * @file   ConvergenceMonitor.h
+ *
+ * @brief  Declaration of the measurement of the global change of the simulation state between frames.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "app/SimulationData.h"
+#include <array>
+
+namespace viscom {
+
+    class ApplicationNodeBase;
+    class GPUProgram;
+
+    /** The change of the state over the iterations of a frame. */
+    struct StateChange {
+        /** The iteration the change was measured at (0 if nothing was measured yet). */
+        std::uint64_t iteration_ = 0;
+        /** The maximum change of A or B per iteration since the previous measurement. */
+        float maxChange_ = 0.0f;
+    };
+
+    /**
+     *  Measures how much the state changed since the last measurement: a compute pass reduces max |dA|, |dB| against
+     *  a 32 bit floating point copy of the state it keeps (and updates in the same pass). The results are read back
+     *  asynchronously with fences a few frames later, so the simulation never waits for them.
+     */
+    class ConvergenceMonitor
+    {
+    public:
+        explicit ConvergenceMonitor(ApplicationNodeBase* appNode);
+        ConvergenceMonitor(const ConvergenceMonitor&) = delete;
+        ConvergenceMonitor& operator=(const ConvergenceMonitor&) = delete;
+        ~ConvergenceMonitor();
+
+        /** Measures the change of the state after the given iteration since the last measurement. */
+        void Measure(GLuint stateTexture, StateFormat format, const glm::uvec2& size, std::uint64_t iteration);
+        /** Reads back finished measurements (does not wait for the GPU). */
+        void Poll();
+        /** Drops the copy of the state and pending measurements (after the state was replaced). */
+        void Clear();
+
+        /** Returns the newest measurement read back. */
+        const StateChange& GetLatestChange() const { return latestChange_; }
+
+    private:
+        /** A measurement computed on the GPU but not read back yet. */
+        struct PendingChange {
+            GLuint buffer_ = 0;
+            GLsync fence_ = nullptr;
+            std::uint64_t iteration_ = 0;
+            /** The iterations since the previous measurement. */
+            std::uint64_t iterations_ = 0;
+        };
+
+        /** The number of measurements that can be in flight. */
+        static constexpr std::size_t NUM_PENDING_CHANGES = 4;
+
+        /** The programs for floating point and fixed point states and their uniform locations. */
+        std::shared_ptr<GPUProgram> changeProgram_;
+        std::shared_ptr<GPUProgram> changeFixedProgram_;
+        GLint changeStateLoc_ = -1;
+        GLint changeFixedStateLoc_ = -1;
+
+        /** The copy of the state at the last measurement (RG32F). */
+        GLuint referenceTexture_ = 0;
+        glm::uvec2 referenceSize_ = glm::uvec2{ 0 };
+        /** The iteration of the copy (0 if there is none). */
+        std::uint64_t referenceIteration_ = 0;
+
+        /** The measurements in flight. */
+        std::array<PendingChange, NUM_PENDING_CHANGES> pendingChanges_;
+        /** The newest measurement read back. */
+        StateChange latestChange_;
+    };
+}
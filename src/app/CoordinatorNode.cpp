@@ -11,11 +11,29 @@
 #include <fstream>
 #include <imgui.h>
 #include "renderers/RDRenderer.h"
+#include "app/SimulationParameterBlock.h"
+#include "app/ActiveTiles.h"
+#include "app/Presets.h"
+#include "app/FrameRecorder.h"
+#include "app/FrameProfiler.h"
 #include <fstream>
+#include <cstring>
+#include <cstddef>
+#include <cfloat>
+#include <ctime>
+#include <thread>
+#include <spdlog/spdlog.h>
 #include "core/open_gl.h"
 
 namespace viscom {
 
+    /** The number of iterations run by each backend when comparing them. */
+    constexpr std::uint64_t BACKEND_COMPARISON_ITERATIONS = 100;
+    /** The number of frames in which the slowest node should catch up with the global iteration count. */
+    constexpr std::uint64_t LAG_RECOVERY_FRAMES = 10;
+    /** Continue from the newest checkpoint on startup (e.g., after a crash during an exhibit). */
+    constexpr bool RESUME_FROM_LATEST_CHECKPOINT = true;
+
     CoordinatorNode::CoordinatorNode(ApplicationNodeInternal* appNode) :
         ApplicationNodeImplementation{ appNode }
     {
@@ -35,51 +53,290 @@ namespace viscom {
         for (const auto& rName : rendererNames_) {
             rendererNamesCStr_.push_back(rName.c_str());
         }
+
+        checkpoints_ = ListCheckpoints(GetCheckpointDirectory());
+        if (RESUME_FROM_LATEST_CHECKPOINT && !checkpoints_.empty()) {
+            restoreCheckpointRequested_ = true;
+            checkpointToRestore_ = checkpoints_.back().iteration_;
+        }
     }
 
     void CoordinatorNode::PreSync()
     {
+        RD_PROFILE_BEGIN_FRAME(GetFrameProfiler());
+        // all nodes wait for the coordinator, so this lowers the frame rate of the whole cluster.
+        const auto viewProjection = GetCamera()->GetViewPerspectiveMatrix();
+        if (GetSimulationData().simulationIdle_ && viewProjection == lastViewProjection_) {
+            std::this_thread::sleep_until(lastFrameStart_ + std::chrono::milliseconds(IDLE_FRAME_TIME_MS));
+        }
+        lastFrameStart_ = std::chrono::steady_clock::now();
+        lastViewProjection_ = viewProjection;
+
         ApplicationNodeImplementation::PreSync();
 #ifdef VISCOM_USE_SGCT
-        sharedData_.setVal(GetSimulationData());
-        sharedSeedPoints_.setVal(GetSeedPoints());
+        {
+            std::lock_guard<std::mutex> lock{ workerStatusMutex_ };
+            if (syncKeyFrameRequested_) syncEncoder_.RequestKeyFrame();
+            syncKeyFrameRequested_ = false;
+        }
+        {
+            RD_PROFILE_SCOPE(GetFrameProfiler(), SyncEncode);
+            // only the changes since the last frame are sent, so the payload does not grow with the seed events.
+            syncEncoder_.Encode(GetSimulationData(), GetSimulationParameters(), GetSeedEvents(), GetStateHasher().GetLatestHash(), domainTiles_, syncPayload_);
+            sharedSyncPayload_.setVal(syncPayload_);
+        }
 
         auto syncPoint = syncedTimestamp_.getVal();
 #else
         auto syncPoint = GetCurrentLocalIterationCount();
 #endif
-        // iterate GetSeedPoints, delete all seed points before syncPoint
-        auto lastDel = GetSeedPoints().begin();
-        for (; lastDel != GetSeedPoints().end() && lastDel->first < syncPoint; ++lastDel);
-        if (lastDel != GetSeedPoints().begin()) {
-            GetSeedPoints().erase(GetSeedPoints().begin(), lastDel);
-        }
+        GetSeedEvents().Retire(syncPoint);
     }
 
     void CoordinatorNode::UpdateFrame(double currentTime, double elapsedTime)
     {
+        if (restoreCheckpointRequested_) {
+            RequestCheckpointRestore(checkpointToRestore_);
+            restoreCheckpointRequested_ = false;
+        }
+
         auto seedIterationCount = GetSimulationData().currentGlobalIterationCount_ + 1;
-        GetSimulationData().currentGlobalIterationCount_ += ApplicationNodeImplementation::FRAME_ITERATIONS_INC;
+        UpdateDomainTiles();
+        UpdateIdleState();
+        globalFrameIterations_ = GetSimulationData().simulationIdle_ ? 0 : ComputeGlobalFrameIterations();
+        GetSimulationData().currentGlobalIterationCount_ += globalFrameIterations_;
+        if (GetSimulationData().dynamicResolution_ && !GetSimulationDomain().IsDecomposed()) {
+            const auto gridSize = dynamicResolution_.Update(GetSimulationData(), GetSlowestIterationTime());
+            if (gridSize != GetSimulationData().gridSize_) SetGridSize(gridSize);
+        }
 
-        auto& seed_points = GetSeedPoints();
+        auto& seedEvents = GetSeedEvents();
         if (currentMouseButton_ == GLFW_MOUSE_BUTTON_1 && currentMouseAction_ == GLFW_PRESS) {
-            //seed_points.emplace_back(seedIterationCount, FindIntersectionWithPlane(GetCamera()->GetPickRay(currentMouseCursorPosition_)));
-            seed_points.emplace_back(seedIterationCount, FindIntersectionWithPlane(currentMouseCursorPosition_));
+            //seedEvents.Push(seedIterationCount, FindIntersectionWithPlane(GetCamera()->GetPickRay(currentMouseCursorPosition_)));
+            seedEvents.Push(seedIterationCount, FindIntersectionWithPlane(currentMouseCursorPosition_));
         } else if (currentMouseButton_ == GLFW_MOUSE_BUTTON_2 && currentMouseAction_ == GLFW_PRESS) {
             SimulationData& sim_data = GetSimulationData();
             sim_data.resetFrameIdx_ = seedIterationCount;
+            timestepController_.NotifyReset(sim_data, GetSimulationParameters().Get(), seedIterationCount);
         }
 
         for (const auto& tpos : tuioCursorPositions_) {
-            seed_points.emplace_back(seedIterationCount, FindIntersectionWithPlane(GetCamera()->GetPickRay(tpos.second)));
+            seedEvents.Push(seedIterationCount, FindIntersectionWithPlane(GetCamera()->GetPickRay(tpos.second)));
+        }
+        if (seedEvents.HasSeedPoints(seedIterationCount)) timestepController_.NotifySeed(GetSimulationData(), GetSimulationParameters().Get(), seedIterationCount);
+        UpdateTimestep();
+
+        if (compareBackendsRequested_) {
+            backendDifferences_ = CompareSimulationBackends(BACKEND_COMPARISON_ITERATIONS);
+            compareBackendsRequested_ = false;
+        }
+        if (compareStateFormatsRequested_) {
+            stateFormatErrors_ = CompareStateFormats(BACKEND_COMPARISON_ITERATIONS);
+            compareStateFormatsRequested_ = false;
         }
 
         ApplicationNodeImplementation::UpdateFrame(currentTime, elapsedTime);
+        UpdateCheckpoints();
+#ifdef VISCOM_USE_SGCT
+        SendStateSnapshots();
+#endif
+    }
+
+    void CoordinatorNode::RequestCheckpointRestore(std::uint64_t iteration)
+    {
+        const MappedCheckpoint checkpoint{ GetCheckpointPath(GetCheckpointDirectory(), iteration) };
+        if (!checkpoint.IsValid()) {
+            spdlog::error("Checkpoint of iteration {} not found.", iteration);
+            return;
+        }
+
+        auto& simData = GetSimulationData();
+        SimulationData storedData;
+        if (checkpoint.GetSimulationData(storedData)) {
+            // requests and recordings are not part of the timeline, a restore must not re-trigger or stop them.
+            storedData.checkpointRestoreRequest_ = simData.checkpointRestoreRequest_;
+            storedData.recordingId_ = simData.recordingId_;
+            storedData.recordState_ = simData.recordState_;
+            storedData.traceExportId_ = simData.traceExportId_;
+            simData = storedData;
+        }
+        else spdlog::warn("Checkpoint of iteration {} was written by a different version, only the state is restored.", iteration);
+        SimulationParameters parameters;
+        if (checkpoint.GetParameters(parameters)) GetSimulationParameters().Set(parameters);
+
+        // all nodes restore the state in their next frame (see ApplicationNodeImplementation::UpdateFrame).
+        simData.currentGlobalIterationCount_ = checkpoint.GetHeader().localIterationCount_;
+        simData.stateFormat_ = static_cast<StateFormat>(checkpoint.GetHeader().stateFormat_);
+        simData.checkpointRestoreIteration_ = iteration;
+        ++simData.checkpointRestoreRequest_;
+        lastCheckpointIteration_ = checkpoint.GetHeader().localIterationCount_;
+    }
+
+    void CoordinatorNode::UpdateCheckpoints()
+    {
+        const auto& simData = GetSimulationData();
+        const auto iteration = GetCurrentLocalIterationCount();
+        const auto periodicCheckpointDue = simData.periodicCheckpoints_ && iteration >= lastCheckpointIteration_ + simData.checkpointInterval_;
+        if ((saveCheckpointRequested_ || periodicCheckpointDue) && RequestCheckpoint()) {
+            lastCheckpointIteration_ = iteration;
+            saveCheckpointRequested_ = false;
+        }
+
+        if (GetCheckpointWriter() && GetCheckpointWriter()->GetNumWritten() != listedCheckpointWrites_) {
+            listedCheckpointWrites_ = GetCheckpointWriter()->GetNumWritten();
+            checkpoints_ = ListCheckpoints(GetCheckpointDirectory());
+        }
+    }
+
+#ifdef VISCOM_USE_SGCT
+    void CoordinatorNode::SendStateSnapshots()
+    {
+        std::set<int> clients;
+        {
+            std::lock_guard<std::mutex> lock{ workerStatusMutex_ };
+            clients.swap(snapshotRequests_);
+        }
+        // a decomposed node has only a part of the grid.
+        if (clients.empty() || GetSimulationDomain().IsDecomposed()) return;
+
+        // one snapshot serves all workers asking in this frame, it is sent in parts through the data transfer channel.
+        CreateStateSnapshot(snapshot_);
+        StateSnapshotChunk chunk;
+        chunk.snapshotId_ = ++sentSnapshots_;
+        chunk.snapshotSize_ = static_cast<std::uint32_t>(snapshot_.size());
+        for (const auto client : clients) {
+            for (std::size_t offset = 0; offset < snapshot_.size(); offset += STATE_SNAPSHOT_CHUNK_SIZE) {
+                const auto chunkSize = glm::min(STATE_SNAPSHOT_CHUNK_SIZE, snapshot_.size() - offset);
+                chunk.offset_ = static_cast<std::uint32_t>(offset);
+                snapshotPackage_.resize(sizeof(StateSnapshotChunk) + chunkSize);
+                std::memcpy(snapshotPackage_.data(), &chunk, sizeof(StateSnapshotChunk));
+                std::memcpy(snapshotPackage_.data() + sizeof(StateSnapshotChunk), snapshot_.data() + offset, chunkSize);
+                TransferDataToNode(snapshotPackage_.data(), snapshotPackage_.size(), static_cast<std::uint16_t>(ClusterPackage::SnapshotChunk), client);
+            }
+            spdlog::info("Sent state snapshot of iteration {} to worker {} ({} bytes).", GetCurrentLocalIterationCount(), client, snapshot_.size());
+        }
+    }
+#endif
+
+    void CoordinatorNode::UpdateDomainTiles()
+    {
+        auto& domain = GetSimulationDomain();
+        if (!domain.IsDecomposed()) return;
+
+        domainTiles_.clear();
+        domainTiles_.push_back(DomainTile{ domain.GetNode(), domain.GetTile() });
+#ifdef VISCOM_USE_SGCT
+        {
+            std::lock_guard<std::mutex> lock{ workerStatusMutex_ };
+            for (const auto& status : workerStatus_) {
+                if (!status.second.domainTile_.IsEmpty()) domainTiles_.push_back(DomainTile{ status.first, status.second.domainTile_ });
+            }
+        }
+#endif
+        domain.SetTiles(domainTiles_);
+    }
+
+    void CoordinatorNode::UpdateIdleState()
+    {
+        auto& simData = GetSimulationData();
+        const auto parameterVersion = GetSimulationParameters().GetVersion();
+        // every change of the shared data (resets, checkpoints, grid size, GUI) counts as input, except for the fields
+        // the coordinator writes itself every frame (the adaptive time step rewrites the schedule even without input).
+        simulationDataBytes_.resize(sizeof(SimulationData));
+        std::memcpy(simulationDataBytes_.data(), &simData, sizeof(SimulationData));
+        std::memset(simulationDataBytes_.data() + offsetof(SimulationData, currentGlobalIterationCount_), 0, sizeof(std::uint64_t));
+        std::memset(simulationDataBytes_.data() + offsetof(SimulationData, timestepSchedule_), 0, sizeof(TimestepSchedule));
+        std::memset(simulationDataBytes_.data() + offsetof(SimulationData, simulationIdle_), 0, sizeof(bool));
+        const auto simDataChanged = simulationDataBytes_ != idleSimulationData_;
+        if (simDataChanged) idleSimulationData_.swap(simulationDataBytes_);
+
+        const auto seeding = (currentMouseButton_ == GLFW_MOUSE_BUTTON_1 || currentMouseButton_ == GLFW_MOUSE_BUTTON_2) && currentMouseAction_ == GLFW_PRESS;
+        if (inputReceived_ || seeding || !tuioCursorPositions_.empty() || simDataChanged || parameterVersion != idleParameterVersion_) {
+            idleThrottle_.NotifyActivity(simData);
+        }
+        inputReceived_ = false;
+        idleParameterVersion_ = parameterVersion;
+
+        // the nodes simulate the same state unless the grid is split between them.
+        nodeChanges_.clear();
+        nodeChanges_.push_back(GetConvergenceMonitor().GetLatestChange());
+#ifdef VISCOM_USE_SGCT
+        if (GetSimulationDomain().IsDecomposed()) {
+            std::lock_guard<std::mutex> lock{ workerStatusMutex_ };
+            for (const auto& status : workerStatus_) nodeChanges_.push_back(StateChange{ status.second.stateChangeIteration_, status.second.stateChange_ });
+        }
+#endif
+        idleThrottle_.Update(simData, nodeChanges_);
+    }
+
+    void CoordinatorNode::UpdateTimestep()
+    {
+        // the nodes simulate the same state unless the grid is split between them.
+        nodeErrors_.clear();
+        nodeErrors_.push_back(GetStepErrorEstimator().GetLatestError());
+        auto slowestNodeIteration = GetCurrentLocalIterationCount();
+#ifdef VISCOM_USE_SGCT
+        {
+            std::lock_guard<std::mutex> lock{ workerStatusMutex_ };
+            for (const auto& status : workerStatus_) {
+                slowestNodeIteration = glm::min(slowestNodeIteration, status.second.localIterationCount_);
+                if (GetSimulationDomain().IsDecomposed()) {
+                    nodeErrors_.push_back(StepError{ status.second.stepErrorIteration_, status.second.stepErrorTimestep_, status.second.stepError_ });
+                }
+            }
+        }
+#endif
+        timestepController_.Update(GetSimulationData(), GetSimulationParameters().Get(), nodeErrors_, slowestNodeIteration);
+    }
+
+    std::uint64_t CoordinatorNode::ComputeGlobalFrameIterations()
+    {
+        // with domain decomposition the simulation waits until every node reported its tile.
+        if (!GetSimulationDomain().IsComplete()) return 0;
+
+        const auto& simData = GetSimulationData();
+        if (!simData.adaptiveIterations_) return simData.fixedFrameIterations_;
+
+        auto iterations = GetIterationScheduler().GetAffordableIterations(simData);
+        auto maxLag = simData.currentGlobalIterationCount_ - GetCurrentLocalIterationCount();
+        {
+            std::lock_guard<std::mutex> lock{ workerStatusMutex_ };
+            for (const auto& status : workerStatus_) {
+                iterations = glm::min(iterations, status.second.affordableIterations_);
+                if (status.second.globalIterationCount_ > status.second.localIterationCount_) {
+                    maxLag = glm::max(maxLag, status.second.globalIterationCount_ - status.second.localIterationCount_);
+                }
+            }
+        }
+
+        // slow down so the slowest node catches up within LAG_RECOVERY_FRAMES.
+        const auto recovery = maxLag / LAG_RECOVERY_FRAMES;
+        iterations = iterations > recovery ? iterations - recovery : 0;
+        return glm::max(iterations, simData.minFrameIterations_);
+    }
+
+    void CoordinatorNode::SetGridSize(const glm::uvec2& gridSize)
+    {
+        // no node has simulated beyond the global iteration count yet.
+        auto& simData = GetSimulationData();
+        simData.gridSize_ = gridSize;
+        simData.gridSizeIteration_ = simData.currentGlobalIterationCount_;
+        dynamicResolution_.Reset();
+        spdlog::info("Changing the grid size to {}x{} at iteration {}.", gridSize.x, gridSize.y, simData.gridSizeIteration_);
+    }
+
+    float CoordinatorNode::GetSlowestIterationTime()
+    {
+        auto iterationTime = GetIterationScheduler().GetIterationTime();
+        std::lock_guard<std::mutex> lock{ workerStatusMutex_ };
+        for (const auto& status : workerStatus_) iterationTime = glm::max(iterationTime, status.second.iterationTime_);
+        return iterationTime;
     }
 
     void CoordinatorNode::Draw2D(FrameBuffer& fbo)
     {
         fbo.DrawToFBO([this]() {
+            RD_PROFILE_SCOPE(GetFrameProfiler(), Draw2D);
             ImGui::SetNextWindowSize(ImVec2(480.0f, 200.0f), ImGuiCond_FirstUseEver);
             ImGui::SetNextWindowPos(ImVec2(1920.0f - 480.0f - 10.0f, 1080.0f - 200.0f - 10.0f), ImGuiCond_FirstUseEver);
             ImGui::StyleColorsDark();
@@ -104,18 +361,252 @@ namespace viscom {
                 }
 
                 if (ImGui::TreeNode("Rendering Parameters")) {
+                    ImGui::Checkbox("Reuse Unchanged Frames", &simData.reuseFrames_);
                     GetRenderers()[simData.currentRenderer_]->DrawOptionsGUI(simData);
                     ImGui::TreePop();
                 }
 
+                if (ImGui::TreeNode("Simulation Backend")) {
+                    auto simulationBackend = static_cast<int>(simData.simulationBackend_);
+                    if (ImGui::Combo("Backend", &simulationBackend, SIMULATION_BACKEND_NAMES.data(), static_cast<int>(SIMULATION_BACKEND_NAMES.size()))) {
+                        simData.simulationBackend_ = static_cast<SimulationBackend>(simulationBackend);
+                    }
+                    if (ImGui::Button("Compare Backends")) compareBackendsRequested_ = true;
+                    for (std::size_t i = 0; i < backendDifferences_.size(); ++i) {
+                        if (backendDifferences_[i] >= 0.0f) ImGui::Text("%s: max. difference %g", SIMULATION_BACKEND_NAMES[i], backendDifferences_[i]);
+                    }
+
+                    auto stateFormat = static_cast<int>(simData.stateFormat_);
+                    if (ImGui::Combo("State Format", &stateFormat, STATE_FORMAT_NAMES.data(), static_cast<int>(STATE_FORMAT_NAMES.size()))) {
+                        simData.stateFormat_ = static_cast<StateFormat>(stateFormat);
+                    }
+                    if (ImGui::Button("Compare State Formats")) compareStateFormatsRequested_ = true;
+                    for (std::size_t i = 0; i < stateFormatErrors_.size(); ++i) {
+                        if (stateFormatErrors_[i].maxError_ >= 0.0f) ImGui::Text("%s: max. error %g, RMSE %g", STATE_FORMAT_NAMES[i], stateFormatErrors_[i].maxError_, stateFormatErrors_[i].rmse_);
+                    }
+                    ImGui::TreePop();
+                }
+
+                auto sliderIterations = [](const char* label, std::uint64_t& value, int minValue, int maxValue) {
+                    auto intValue = static_cast<int>(value);
+                    if (ImGui::SliderInt(label, &intValue, minValue, maxValue)) value = static_cast<std::uint64_t>(intValue);
+                };
+
+                if (ImGui::TreeNode("Iteration Scheduler")) {
+                    ImGui::Checkbox("Adaptive Iterations", &simData.adaptiveIterations_);
+                    ImGui::SliderFloat("Simulation Budget (ms)", &simData.simulationTimeBudget_, 0.5f, 33.0f);
+                    sliderIterations("Fixed Iterations", simData.fixedFrameIterations_, 1, 60);
+                    sliderIterations("Min. Iterations", simData.minFrameIterations_, 1, 60);
+                    sliderIterations("Max. Iterations", simData.maxFrameIterations_, 1, 240);
+                    simData.maxFrameIterations_ = glm::max(simData.maxFrameIterations_, simData.minFrameIterations_);
+
+                    ImGui::Text("Iterations per frame: %llu", static_cast<unsigned long long>(globalFrameIterations_));
+                    ImGui::Text("Coordinator: %.3f ms/iteration, affordable %llu, lag %llu", GetIterationScheduler().GetIterationTime(),
+                        static_cast<unsigned long long>(GetIterationScheduler().GetAffordableIterations(simData)),
+                        static_cast<unsigned long long>(simData.currentGlobalIterationCount_ - GetCurrentLocalIterationCount()));
+
+                    std::map<int, WorkerSchedulingStatus> workerStatus;
+                    {
+                        std::lock_guard<std::mutex> lock{ workerStatusMutex_ };
+                        workerStatus = workerStatus_;
+                    }
+                    for (const auto& status : workerStatus) {
+                        const auto lag = status.second.globalIterationCount_ - glm::min(status.second.globalIterationCount_, status.second.localIterationCount_);
+                        ImGui::Text("Worker %d: %.3f ms/iteration, affordable %llu, lag %llu", status.first, status.second.iterationTime_,
+                            static_cast<unsigned long long>(status.second.affordableIterations_), static_cast<unsigned long long>(lag));
+                    }
+
+                    const auto& domain = GetSimulationDomain();
+                    if (domain.IsDecomposed()) {
+                        ImGui::Text("Domain: %ux%u grid, %d of %d tiles known, %d neighbours, halo wait %.3f ms", domain.GetGridSize().x, domain.GetGridSize().y,
+                            static_cast<int>(domain.GetTiles().size()), GetNumClusterNodes(), static_cast<int>(domain.GetReceiveRegions().size()), domain.GetLastWaitTime());
+                    }
+                    ImGui::TreePop();
+                }
+
+                if (ImGui::TreeNode("Resolution")) {
+                    const auto& gridSize = GetSimulationDomain().GetGridSize();
+                    if (GetSimulationDomain().IsDecomposed()) ImGui::Text("Grid: %ux%u (fixed with domain decomposition)", gridSize.x, gridSize.y);
+                    else {
+                        if (requestedGridSize_.x < 0) requestedGridSize_ = glm::ivec2(simData.gridSize_);
+                        ImGui::InputInt2("Grid Size", &requestedGridSize_.x);
+                        if (ImGui::Button("Apply Grid Size")) SetGridSize(glm::uvec2(glm::max(requestedGridSize_, glm::ivec2(1))));
+                        ImGui::Checkbox("Scale Parameters to Grid", &simData.scaleParametersToGrid_);
+                        ImGui::Checkbox("Dynamic Resolution", &simData.dynamicResolution_);
+                        sliderIterations("Target Iterations", simData.dynamicResolutionIterations_, 1, 60);
+
+                        const auto& effective = GetSimulationParameters().GetEffective();
+                        ImGui::Text("Grid: %ux%u (scale %.2f), target %ux%u", gridSize.x, gridSize.y,
+                            static_cast<float>(gridSize.y) / static_cast<float>(SIMULATION_SIZE_Y), simData.gridSize_.x, simData.gridSize_.y);
+                        ImGui::Text("Effective: diffusion %.3f / %.3f, dt %.3f, seed radius %.3f", effective.diffusion_rate_a_,
+                            effective.diffusion_rate_b_, effective.dt_, effective.seed_point_radius_);
+                    }
+                    ImGui::TreePop();
+                }
+
+                if (ImGui::TreeNode("Active Tiles")) {
+                    ImGui::Checkbox("Skip Sleeping Tiles", &simData.activeTiles_);
+                    // logarithmic, the useful thresholds span several orders of magnitude.
+                    ImGui::SliderFloat("Activity Threshold", &simData.activityThreshold_, 0.0f, 1e-3f, "%.2e", 4.0f);
+                    const auto& numTiles = GetActiveTiles().GetNumTiles();
+                    ImGui::Text("Active: %.1f%% of %ux%u tiles", 100.0f * GetActiveTiles().GetActiveFraction(), numTiles.x, numTiles.y);
+                    ImGui::TreePop();
+                }
+
+                if (ImGui::TreeNode("Adaptive Time Step")) {
+                    ImGui::Checkbox("Adaptive Time Step", &simData.adaptiveTimestep_);
+                    // logarithmic, the useful tolerances span several orders of magnitude.
+                    ImGui::SliderFloat("Error Tolerance", &simData.timestepTolerance_, 1e-6f, 1e-1f, "%.2e", 4.0f);
+                    ImGui::SliderFloat("Min. Time Step", &simData.minTimestep_, 0.01f, 1.0f);
+                    ImGui::SliderFloat("Max. Time Step", &simData.maxTimestep_, 0.1f, 5.0f);
+                    simData.maxTimestep_ = glm::max(simData.maxTimestep_, simData.minTimestep_);
+
+                    const auto& parameters = GetSimulationParameters().Get();
+                    const auto iteration = GetCurrentLocalIterationCount();
+                    const auto timestep = simData.timestepSchedule_.GetTimestep(iteration);
+                    ImGui::Text("dt %.3f (proposed %.3f, stable up to %.3f), error %.2e", timestep > 0.0f ? timestep : parameters.dt_,
+                        timestepController_.GetProposedTimestep(), GetMaxStableTimestep(parameters), timestepController_.GetLastError());
+
+                    const auto time = simData.timestepSchedule_.GetTime(iteration, parameters.dt_);
+                    const auto iterations = iteration - glm::min(iteration, static_cast<std::uint64_t>(simData.resetFrameIdx_));
+                    ImGui::Text("Simulated time %.1f in %llu iterations (%llu with dt %.3f)", time, static_cast<unsigned long long>(iterations),
+                        static_cast<unsigned long long>(parameters.dt_ > 0.0f ? time / parameters.dt_ : 0.0), parameters.dt_);
+#ifdef VISCOM_USE_SGCT
+                    std::lock_guard<std::mutex> lock{ workerStatusMutex_ };
+                    for (const auto& status : workerStatus_) {
+                        ImGui::Text("Worker %d: error %.2e with dt %.3f at iteration %llu", status.first, status.second.stepError_,
+                            status.second.stepErrorTimestep_, static_cast<unsigned long long>(status.second.stepErrorIteration_));
+                    }
+#endif
+                    ImGui::TreePop();
+                }
+
+                if (ImGui::TreeNode("Idle Throttling")) {
+                    ImGui::Checkbox("Pause when Stationary", &simData.idleThrottling_);
+                    // logarithmic, the useful thresholds span several orders of magnitude.
+                    ImGui::SliderFloat("Steady State Threshold", &simData.steadyStateThreshold_, 0.0f, 1e-3f, "%.2e", 4.0f);
+                    ImGui::Text("%s, change %.2e per iteration, %llu of %llu steady measurements", simData.simulationIdle_ ? "Paused" : "Running",
+                        idleThrottle_.GetLastChange(), static_cast<unsigned long long>(idleThrottle_.GetSteadyMeasurements()),
+                        static_cast<unsigned long long>(STEADY_STATE_MEASUREMENTS));
+#ifdef VISCOM_USE_SGCT
+                    std::lock_guard<std::mutex> lock{ workerStatusMutex_ };
+                    for (const auto& status : workerStatus_) {
+                        ImGui::Text("Worker %d: change %.2e per iteration at iteration %llu", status.first, status.second.stateChange_,
+                            static_cast<unsigned long long>(status.second.stateChangeIteration_));
+                    }
+#endif
+                    ImGui::TreePop();
+                }
+
+                if (ImGui::TreeNode("State Verification")) {
+                    ImGui::Checkbox("Compare State Hashes", &simData.verifyState_);
+                    sliderIterations("Hash Interval", simData.stateHashInterval_, 100, 10000);
+                    const auto& stateHash = GetStateHasher().GetLatestHash();
+                    ImGui::Text("Coordinator: iteration %llu, hash %016llx", static_cast<unsigned long long>(stateHash.iteration_),
+                        static_cast<unsigned long long>(stateHash.hash_));
+
+#ifdef VISCOM_USE_SGCT
+                    std::lock_guard<std::mutex> lock{ workerStatusMutex_ };
+                    for (const auto& status : workerStatus_) {
+                        ImGui::Text("Worker %d: %llu mismatches, %llu snapshots received", status.first,
+                            static_cast<unsigned long long>(status.second.stateHashMismatches_), static_cast<unsigned long long>(status.second.receivedSnapshots_));
+                    }
+                    if (ImGui::Button("Send Snapshot to Workers")) {
+                        for (const auto& status : workerStatus_) snapshotRequests_.insert(status.first);
+                    }
+#endif
+                    ImGui::TreePop();
+                }
+
+#ifdef VISCOM_USE_SGCT
+                if (ImGui::TreeNode("Cluster Sync")) {
+                    const auto& syncStatistics = syncEncoder_.GetStatistics();
+                    ImGui::Text("Payload: %llu bytes (avg. %.1f, max. %llu), %llu new seed events", static_cast<unsigned long long>(syncStatistics.payloadSize_),
+                        syncStatistics.averagePayloadSize_, static_cast<unsigned long long>(syncStatistics.maxPayloadSize_),
+                        static_cast<unsigned long long>(syncStatistics.seedEvents_));
+                    ImGui::Text("Encoding: %.1f us, %llu bytes in %llu frames", syncStatistics.codingTime_,
+                        static_cast<unsigned long long>(syncStatistics.totalBytes_), static_cast<unsigned long long>(syncStatistics.numPayloads_));
+
+                    std::lock_guard<std::mutex> lock{ workerStatusMutex_ };
+                    for (const auto& status : workerStatus_) ImGui::Text("Worker %d: decoding %.1f us", status.first, status.second.syncDecodeTime_);
+                    ImGui::TreePop();
+                }
+#endif
+
+                if (ImGui::TreeNode("Checkpoints")) {
+                    ImGui::Checkbox("Periodic Checkpoints", &simData.periodicCheckpoints_);
+                    sliderIterations("Checkpoint Interval", simData.checkpointInterval_, 1000, 200000);
+                    sliderIterations("Max. Checkpoints", simData.maxCheckpoints_, 1, 32);
+                    if (ImGui::Button("Save Checkpoint")) saveCheckpointRequested_ = true;
+                    ImGui::SameLine();
+                    if (ImGui::Button("Refresh")) checkpoints_ = ListCheckpoints(GetCheckpointDirectory());
+                    if (GetCheckpointWriter() && GetCheckpointWriter()->IsBusy()) ImGui::Text("Writing checkpoint...");
+
+                    for (const auto& checkpoint : checkpoints_) {
+                        ImGui::PushID(static_cast<int>(checkpoint.iteration_));
+                        if (ImGui::Button("Restore")) {
+                            restoreCheckpointRequested_ = true;
+                            checkpointToRestore_ = checkpoint.iteration_;
+                        }
+                        ImGui::SameLine();
+                        ImGui::Text("Iteration %llu", static_cast<unsigned long long>(checkpoint.iteration_));
+                        ImGui::PopID();
+                    }
+                    ImGui::TreePop();
+                }
+
+                if (ImGui::TreeNode("Recording")) {
+                    auto recording = simData.recordingId_ != 0;
+                    if (ImGui::Checkbox("Record", &recording)) simData.recordingId_ = recording ? static_cast<std::uint64_t>(std::time(nullptr)) : 0;
+                    ImGui::Checkbox("Record State", &simData.recordState_);
+                    sliderIterations("Video Frame Rate", simData.recordingFrameRate_, 1, 120);
+                    if (const auto recorder = GetFrameRecorder()) {
+                        ImGui::Text("%s", recorder->GetDirectory().c_str());
+                        ImGui::Text("%llu frames written, %llu queued, %llu dropped", static_cast<unsigned long long>(recorder->GetNumWritten()),
+                            static_cast<unsigned long long>(recorder->GetNumQueued()), static_cast<unsigned long long>(recorder->GetNumDropped()));
+                    }
+                    ImGui::TreePop();
+                }
+
+                if (ImGui::TreeNode("Profiler")) {
+#ifdef RD_PROFILING
+                    const auto& profiler = GetFrameProfiler();
+                    ImGui::Checkbox("GPU Times", &profilerShowGPU_);
+                    for (std::size_t phase = 0; phase < PROFILE_PHASE_COUNT; ++phase) {
+                        const auto profilePhase = static_cast<ProfilePhase>(phase);
+                        const auto& history = profiler.GetHistory(profilePhase, profilerShowGPU_);
+                        const auto overlay = fmt::format("{:.3f} ms", profiler.GetAverage(profilePhase, profilerShowGPU_));
+                        ImGui::PlotHistogram(PROFILE_PHASE_NAMES[phase], history.data(), static_cast<int>(history.size()),
+                            static_cast<int>(profiler.GetHistoryOffset()), overlay.c_str(), 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+                    }
+
+                    std::lock_guard<std::mutex> lock{ workerStatusMutex_ };
+                    for (const auto& status : workerStatus_) {
+                        const auto& times = profilerShowGPU_ ? status.second.phaseGPUTimes_ : status.second.phaseCPUTimes_;
+                        std::string text;
+                        for (std::size_t phase = 0; phase < PROFILE_PHASE_COUNT; ++phase) {
+                            if (times[phase] > 0.0f) text += fmt::format(" {} {:.2f}", PROFILE_PHASE_NAMES[phase], times[phase]);
+                        }
+                        ImGui::Text("Worker %d (ms):%s", status.first, text.c_str());
+                    }
+                    if (ImGui::Button("Export Trace")) simData.traceExportId_ = static_cast<std::uint64_t>(std::time(nullptr));
+                    if (simData.traceExportId_ != 0) ImGui::Text("%s", GetTraceFile(simData.traceExportId_).c_str());
+#else
+                    ImGui::Text("The profiler is compiled out (RD_PROFILING is off).");
+#endif
+                    ImGui::TreePop();
+                }
+
                 if (ImGui::TreeNode("Reaction Diffusion Parameters")) {
-                    ImGui::SliderFloat("Diffusion Rate A", &simData.diffusion_rate_a_, 0.0f, 2.0f);
-                    ImGui::SliderFloat("Diffusion Rate B", &simData.diffusion_rate_b_, 0.0f, 2.0f);
-                    ImGui::SliderFloat("Feed Rate", &simData.feed_rate_, 0.0f, 0.2f);
-                    ImGui::SliderFloat("Kill Rate", &simData.kill_rate_, 0.0f, 0.2f);
-                    ImGui::SliderFloat("Dt", &simData.dt_, 0.0f, 5.0f);
-                    ImGui::SliderFloat("Seed Point Radius", &simData.seed_point_radius_, 0.01f, 1.0f);
-                    ImGui::Checkbox("Use Manhattan Distance", &simData.use_manhattan_distance_);
+                    auto parameters = GetSimulationParameters().Get();
+                    auto changed = ImGui::SliderFloat("Diffusion Rate A", &parameters.diffusion_rate_a_, 0.0f, 2.0f);
+                    changed |= ImGui::SliderFloat("Diffusion Rate B", &parameters.diffusion_rate_b_, 0.0f, 2.0f);
+                    changed |= ImGui::SliderFloat("Feed Rate", &parameters.feed_rate_, 0.0f, 0.2f);
+                    changed |= ImGui::SliderFloat("Kill Rate", &parameters.kill_rate_, 0.0f, 0.2f);
+                    changed |= ImGui::SliderFloat("Dt", &parameters.dt_, 0.0f, 5.0f);
+                    changed |= ImGui::SliderFloat("Seed Point Radius", &parameters.seed_point_radius_, 0.01f, 1.0f);
+                    changed |= ImGui::Checkbox("Use Manhattan Distance", &parameters.use_manhattan_distance_);
+                    if (changed) GetSimulationParameters().Set(parameters);
                     ImGui::TreePop();
                 }
             }
@@ -126,6 +617,7 @@ namespace viscom {
 
     bool CoordinatorNode::MouseButtonCallback(int button, int action)
     {
+        inputReceived_ = true;
         if (!ApplicationNodeImplementation::MouseButtonCallback(button, action)) {
             currentMouseAction_ = action;
             currentMouseButton_ = button;
@@ -135,6 +627,7 @@ namespace viscom {
 
     bool CoordinatorNode::MousePosCallback(double x, double y)
     {
+        inputReceived_ = true;
         if (!ApplicationNodeImplementation::MousePosCallback(x, y)) {
             currentMouseCursorPosition_ = glm::vec2{x, y};
         }
@@ -193,17 +686,51 @@ namespace viscom {
 #ifdef VISCOM_USE_SGCT
     void CoordinatorNode::EncodeData()
     {
+        RD_PROFILE_SCOPE(GetFrameProfiler(), SyncEncode);
         ApplicationNodeImplementation::EncodeData();
-        sgct::SharedData::instance()->writeObj(&sharedData_);
-        sgct::SharedData::instance()->writeVector(&sharedSeedPoints_);
-        syncedTimestamp_.setVal(sharedData_.getVal().currentGlobalIterationCount_);
+        sgct::SharedData::instance()->writeVector(&sharedSyncPayload_);
+        syncedTimestamp_.setVal(GetSimulationData().currentGlobalIterationCount_);
     }
 
     void CoordinatorNode::DecodeData()
     {
         ApplicationNodeImplementation::DecodeData();
-        sgct::SharedData::instance()->readObj(&sharedData_);
-        sgct::SharedData::instance()->readVector(&sharedSeedPoints_);
+        sgct::SharedData::instance()->readVector(&sharedSyncPayload_);
+    }
+
+    bool CoordinatorNode::DataTransferCallback(void* receivedData, int receivedLength, std::uint16_t packageID, int clientID)
+    {
+        if (packageID == static_cast<std::uint16_t>(ClusterPackage::WorkerStatus) && receivedLength == sizeof(WorkerSchedulingStatus)) {
+            std::lock_guard<std::mutex> lock{ workerStatusMutex_ };
+            std::memcpy(&workerStatus_[clientID], receivedData, sizeof(WorkerSchedulingStatus));
+            return true;
+        }
+        if (packageID == static_cast<std::uint16_t>(ClusterPackage::SnapshotRequest) && receivedLength == sizeof(StateSnapshotRequest)) {
+            StateSnapshotRequest request;
+            std::memcpy(&request, receivedData, sizeof(StateSnapshotRequest));
+            spdlog::warn("Worker {} diverged at iteration {}, sending a state snapshot.", clientID, request.iteration_);
+            std::lock_guard<std::mutex> lock{ workerStatusMutex_ };
+            snapshotRequests_.insert(clientID);
+            return true;
+        }
+        return ApplicationNodeImplementation::DataTransferCallback(receivedData, receivedLength, packageID, clientID);
+    }
+
+    bool CoordinatorNode::DataTransferStatusCallback(bool connected, int clientID)
+    {
+        {
+            std::lock_guard<std::mutex> lock{ workerStatusMutex_ };
+            // a worker that (re)connects has no state yet and starts from a key frame and a snapshot.
+            if (connected) {
+                snapshotRequests_.insert(clientID);
+                syncKeyFrameRequested_ = true;
+            }
+            else {
+                workerStatus_.erase(clientID);
+                snapshotRequests_.erase(clientID);
+            }
+        }
+        return ApplicationNodeImplementation::DataTransferStatusCallback(connected, clientID);
     }
 #endif
 
@@ -214,14 +741,8 @@ namespace viscom {
         std::string presetListFile = GetConfig().resourceSearchPaths_.back() + "/presetList.txt";
         if (!utils::file_exists(presetListFile)) return;
 
-        std::ifstream ifs(presetListFile);
-        std::string str;
-        while (ifs >> str && ifs.good()) {
-            std::string presetName = str;
-            std::string presetFile;
-            ifs >> presetFile;
-            presetNames_.emplace_back(presetName, presetFile);
-        }
+        const auto presets = ReadPresetList(presetListFile);
+        presetNames_.insert(presetNames_.end(), presets.begin(), presets.end());
 
         UpdatePresetNames();
     }
@@ -241,25 +762,10 @@ namespace viscom {
         std::string presetFile = GetConfig().resourceSearchPaths_.back() + "/" + presetNames_[preset].second;
         if (!utils::file_exists(presetFile)) return;
 
-        std::ifstream ifs(presetFile);
-        std::string str;
-
-        while (ifs >> str && ifs.good()) {
-            if (str == "simulationDrawDistance=") ifs >> GetSimulationData().simulationDrawDistance_;
-            else if (str == "simulationHeight=") ifs >> GetSimulationData().simulationHeight_;
-            else if (str == "eta=") ifs >> GetSimulationData().eta_;
-            else if (str == "sigma_a.r=") ifs >> GetSimulationData().sigma_a_.r;
-            else if (str == "sigma_a.g=") ifs >> GetSimulationData().sigma_a_.g;
-            else if (str == "sigma_a.b=") ifs >> GetSimulationData().sigma_a_.b;
-            else if (str == "diffusion_rate_a=") ifs >> GetSimulationData().diffusion_rate_a_;
-            else if (str == "diffusion_rate_b=") ifs >> GetSimulationData().diffusion_rate_b_;
-            else if (str == "feed_rate=") ifs >> GetSimulationData().feed_rate_;
-            else if (str == "kill_rate=") ifs >> GetSimulationData().kill_rate_;
-            else if (str == "dt=") ifs >> GetSimulationData().dt_;
-            else if (str == "seed_point_radius=") ifs >> GetSimulationData().seed_point_radius_;
-            else if (str == "use_manhattan_distance=") ifs >> GetSimulationData().use_manhattan_distance_;
-            else if (str == "currentRenderer=") ifs >> GetSimulationData().currentRenderer_;
-        }
+        // the parameter version only changes (causing an upload and synchronization) if the preset differs.
+        auto parameters = GetSimulationParameters().Get();
+        ReadPreset(presetFile, GetSimulationData(), parameters);
+        GetSimulationParameters().Set(parameters);
     }
 
     void CoordinatorNode::SavePreset(const std::string& presetName)
@@ -273,13 +779,13 @@ namespace viscom {
         ofs << "sigma_a.r= " << GetSimulationData().sigma_a_.r << std::endl;
         ofs << "sigma_a.g= " << GetSimulationData().sigma_a_.g << std::endl;
         ofs << "sigma_a.b= " << GetSimulationData().sigma_a_.b << std::endl;
-        ofs << "diffusion_rate_a= " << GetSimulationData().diffusion_rate_a_ << std::endl;
-        ofs << "diffusion_rate_b= " << GetSimulationData().diffusion_rate_b_ << std::endl;
-        ofs << "feed_rate= " << GetSimulationData().feed_rate_ << std::endl;
-        ofs << "kill_rate= " << GetSimulationData().kill_rate_ << std::endl;
-        ofs << "dt= " << GetSimulationData().dt_ << std::endl;
-        ofs << "seed_point_radius= " << GetSimulationData().seed_point_radius_ << std::endl;
-        ofs << "use_manhattan_distance= " << GetSimulationData().use_manhattan_distance_ << std::endl;
+        ofs << "diffusion_rate_a= " << GetSimulationParameters().Get().diffusion_rate_a_ << std::endl;
+        ofs << "diffusion_rate_b= " << GetSimulationParameters().Get().diffusion_rate_b_ << std::endl;
+        ofs << "feed_rate= " << GetSimulationParameters().Get().feed_rate_ << std::endl;
+        ofs << "kill_rate= " << GetSimulationParameters().Get().kill_rate_ << std::endl;
+        ofs << "dt= " << GetSimulationParameters().Get().dt_ << std::endl;
+        ofs << "seed_point_radius= " << GetSimulationParameters().Get().seed_point_radius_ << std::endl;
+        ofs << "use_manhattan_distance= " << GetSimulationParameters().Get().use_manhattan_distance_ << std::endl;
         ofs << "currentRenderer= " << GetSimulationData().currentRenderer_ << std::endl;
 
         presetNames_.emplace_back(presetName, presetName + ".pst");
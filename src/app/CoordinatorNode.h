@@ -9,6 +9,17 @@
 #pragma once
 
 #include "app/ApplicationNodeImplementation.h"
+#include "app/IterationScheduler.h"
+#include "app/Checkpoint.h"
+#include "app/StateSync.h"
+#include "app/ClusterSync.h"
+#include "app/DynamicResolution.h"
+#include "app/IdleThrottle.h"
+#include "app/TimestepController.h"
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
 
 namespace viscom {
 
@@ -34,17 +45,48 @@ namespace viscom {
 #ifdef VISCOM_USE_SGCT
         virtual void EncodeData() override;
         virtual void DecodeData() override;
+        virtual bool DataTransferCallback(void* receivedData, int receivedLength, std::uint16_t packageID, int clientID) override;
+        virtual bool DataTransferStatusCallback(bool connected, int clientID) override;
 #endif
 
     private:
+        /** Chooses the iterations the global iteration count advances this frame. */
+        std::uint64_t ComputeGlobalFrameIterations();
+        /** Restores the simulation data of a checkpoint and makes all nodes restore its state. */
+        void RequestCheckpointRestore(std::uint64_t iteration);
+        /** Writes periodic and requested checkpoints. */
+        void UpdateCheckpoints();
+        /** Collects the tiles of all nodes with domain decomposition. */
+        void UpdateDomainTiles();
+        /** Resumes the simulation after input or changes of the simulation data and pauses it once the state is stationary. */
+        void UpdateIdleState();
+        /** Schedules the time step of the adaptive integration from the error estimates of the nodes. */
+        void UpdateTimestep();
+#ifdef VISCOM_USE_SGCT
+        /** Sends a snapshot of the current state to the workers that requested one. */
+        void SendStateSnapshots();
+#endif
+
         glm::vec2 FindIntersectionWithPlane(const math::Line3<float>& ray) const;
         glm::vec2 FindIntersectionWithPlane(const glm::vec2& screenCoords);
 
 #ifdef VISCOM_USE_SGCT
-        /** Holds the data the master shares. */
-        sgct::SharedObject<SimulationData> sharedData_;
-        sgct::SharedVector<SeedPoint> sharedSeedPoints_;
+        /** The encoded data the master shares (see ClusterSyncEncoder). */
+        sgct::SharedVector<std::uint8_t> sharedSyncPayload_;
         sgct::SharedUInt64 syncedTimestamp_;
+        /** Encodes the changes of the shared data and the payload of this frame (reused to avoid allocations). */
+        ClusterSyncEncoder syncEncoder_;
+        std::vector<std::uint8_t> syncPayload_;
+        /** Set when a worker connected, so the next payload is a key frame (written by the network thread). */
+        bool syncKeyFrameRequested_ = false;
+
+        /** The workers that joined or diverged and need a snapshot (written by the network thread). */
+        std::set<int> snapshotRequests_;
+        /** The number of snapshots sent (identifies the parts of a snapshot). */
+        std::uint64_t sentSnapshots_ = 0;
+        /** The encoded snapshot and the package of a part of it (reused to avoid allocations). */
+        std::vector<std::uint8_t> snapshot_;
+        std::vector<std::uint8_t> snapshotPackage_;
 #endif
 
         /** store mouse button state */
@@ -55,11 +97,72 @@ namespace viscom {
         /** Store tuio cursor positions. */
         std::vector<std::pair<int, glm::vec2>> tuioCursorPositions_;
 
+        /** The tiles of the coordinator and the workers that reported one. */
+        std::vector<DomainTile> domainTiles_;
+        /** Chooses the grid size with the dynamic resolution. */
+        DynamicResolution dynamicResolution_;
+        /** The grid size entered in the GUI. */
+        glm::ivec2 requestedGridSize_ = glm::ivec2{ -1 };
+        /** Pauses the simulation while the state is stationary. */
+        IdleThrottle idleThrottle_;
+        /** Set by the input callbacks, so the next frame resumes the simulation. */
+        bool inputReceived_ = false;
+        /** The parameter version and simulation data (without the fields written by the coordinator) at the last idle update. */
+        std::uint64_t idleParameterVersion_ = 0;
+        std::vector<std::uint8_t> idleSimulationData_;
+        /** The bytes of the current simulation data (reused to avoid allocations). */
+        std::vector<std::uint8_t> simulationDataBytes_;
+        /** The newest convergence measurement of each node (reused to avoid allocations). */
+        std::vector<StateChange> nodeChanges_;
+        /** Chooses the time step of the adaptive integration. */
+        TimestepController timestepController_;
+        /** The newest step error estimate of each node (reused to avoid allocations). */
+        std::vector<StepError> nodeErrors_;
+        /** The start of the last frame and its view projection (frames are throttled while idle and the view is unchanged). */
+        std::chrono::steady_clock::time_point lastFrameStart_;
+        glm::mat4 lastViewProjection_ = glm::mat4{ 1.0f };
+        /** The iterations the global iteration count advanced in the last frame. */
+        std::uint64_t globalFrameIterations_ = 0;
+        /** The last scheduling status reported by each worker (written by the network thread). */
+        std::map<int, WorkerSchedulingStatus> workerStatus_;
+        /** Protects workerStatus_, snapshotRequests_ and syncKeyFrameRequested_. */
+        std::mutex workerStatusMutex_;
+
+        /** Set by the GUI to compare the simulation backends in the next frame. */
+        bool compareBackendsRequested_ = false;
+        /** The maximum differences of the last backend comparison (negative if none was run yet). */
+        std::array<float, SIMULATION_BACKEND_NAMES.size()> backendDifferences_{ { -1.0f, -1.0f, -1.0f } };
+        /** Set by the GUI to compare the state formats in the next frame. */
+        bool compareStateFormatsRequested_ = false;
+        /** The errors of the state formats from the last comparison (negative if not compared yet). */
+        std::array<StateFormatError, STATE_FORMAT_NAMES.size()> stateFormatErrors_;
+
+        /** Makes all nodes resample the state to the given grid size at the current global iteration. */
+        void SetGridSize(const glm::uvec2& gridSize);
+        /** Returns the measured iteration time of the slowest node in milliseconds. */
+        float GetSlowestIterationTime();
+
         void LoadPresetList();
         void UpdatePresetNames();
         void LoadPreset(int preset);
         void SavePreset(const std::string& presetName);
 
+        /** The iteration of the last checkpoint taken or restored. */
+        std::uint64_t lastCheckpointIteration_ = 0;
+        /** Set by the GUI to write a checkpoint as soon as the writer is idle. */
+        bool saveCheckpointRequested_ = false;
+        /** Set by the GUI (or at startup) to restore the checkpoint of checkpointToRestore_ in the next frame. */
+        bool restoreCheckpointRequested_ = false;
+        std::uint64_t checkpointToRestore_ = 0;
+        /** The checkpoints on disk. */
+        std::vector<CheckpointInfo> checkpoints_;
+        /** The number of checkpoints written when checkpoints_ was listed. */
+        std::uint64_t listedCheckpointWrites_ = 0;
+#ifdef RD_PROFILING
+        /** Set by the GUI to show the GPU instead of the CPU times in the profiler. */
+        bool profilerShowGPU_ = false;
+#endif
+
         /** The list of preset names. */
         std::vector<std::pair<std::string, std::string>> presetNames_;
         /** The list of preset names (as c strings for imgui). */
@@ -0,0 +1,118 @@
+/**
+ * @file   DerivedOutputs.cpp
+ *
+ * @brief  Implementation of the stage computing the renderer inputs from the simulation state.
+ */
+
+#include "core/open_gl.h"
+#include "DerivedOutputs.h"
+#include "core/app/ApplicationNodeBase.h"
+
+namespace viscom {
+
+    /** Has to match the local size of deriveOutputs.comp and minMaxPyramid.comp. */
+    constexpr GLuint DERIVE_LOCAL_SIZE = 16;
+
+    namespace {
+        GLuint CreateOutputTexture(GLenum format, GLsizei levels, const glm::uvec2& size, GLint filter)
+        {
+            GLuint texture = 0;
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexStorage2D(GL_TEXTURE_2D, levels, format, static_cast<GLsizei>(size.x), static_cast<GLsizei>(size.y));
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, levels > 1 ? GL_NEAREST : filter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            return texture;
+        }
+
+        GLuint NumGroups(GLuint size) { return (size + DERIVE_LOCAL_SIZE - 1) / DERIVE_LOCAL_SIZE; }
+
+        /** The version of the last update of any instance (the outputs are recreated on resizes). */
+        std::uint64_t lastStateVersion = 0;
+    }
+
+    DerivedOutputs::DerivedOutputs(ApplicationNodeBase* appNode, const glm::uvec2& size) :
+        size_{ size },
+        gridSize_{ size }
+    {
+        deriveProgram_ = LoadDeriveProgram(appNode, "deriveOutputs", std::vector<std::string>{});
+        deriveFixedProgram_ = LoadDeriveProgram(appNode, "deriveOutputsFixed16", std::vector<std::string>{ "STATE_FIXED16" });
+        minMaxReduceProgram_ = appNode->GetGPUProgramManager().GetResource("minMaxPyramid", std::vector<std::string>{ "minMaxPyramid.comp" });
+
+        while ((glm::max(size_.x, size_.y) >> numPyramidLevels_) > 0) ++numPyramidLevels_;
+        heightTexture_ = CreateOutputTexture(GL_R32F, 1, size_, GL_LINEAR);
+        normalTexture_ = CreateOutputTexture(GL_RG32F, 1, size_, GL_LINEAR);
+        minMaxPyramidTexture_ = CreateOutputTexture(GL_RG32F, numPyramidLevels_, size_, GL_NEAREST_MIPMAP_NEAREST);
+    }
+
+    DerivedOutputs::~DerivedOutputs()
+    {
+        const std::array<GLuint, 3> textures{ { heightTexture_, normalTexture_, minMaxPyramidTexture_ } };
+        glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+    }
+
+    DerivedOutputs::DeriveProgram DerivedOutputs::LoadDeriveProgram(ApplicationNodeBase* appNode, const std::string& name, const std::vector<std::string>& defines)
+    {
+        DeriveProgram result;
+        result.program_ = appNode->GetGPUProgramManager().GetResource(name, std::vector<std::string>{ "deriveOutputs.comp" }, defines);
+        result.stateLoc_ = result.program_->getUniformLocation("state");
+        result.writeNormalsLoc_ = result.program_->getUniformLocation("write_normals");
+        result.writeMinMaxLoc_ = result.program_->getUniformLocation("write_min_max");
+        result.gridSizeLoc_ = result.program_->getUniformLocation("grid_size");
+        return result;
+    }
+
+    void DerivedOutputs::SetGridPlacement(const glm::uvec2& gridSize, const glm::ivec2& origin)
+    {
+        gridSize_ = gridSize;
+        gridOrigin_ = origin;
+    }
+
+    glm::vec4 DerivedOutputs::GetTexCoordTransform() const
+    {
+        const glm::vec2 size{ size_ };
+        return glm::vec4(glm::vec2(gridSize_) / size, -glm::vec2(gridOrigin_) / size);
+    }
+
+    void DerivedOutputs::Update(GLuint stateTexture, StateFormat format, DerivedOutput outputs)
+    {
+        const auto& program = format == StateFormat::Fixed16 ? deriveFixedProgram_ : deriveProgram_;
+        const auto writeNormals = HasDerivedOutput(outputs, DerivedOutput::Normals);
+        const auto writeMinMax = HasDerivedOutput(outputs, DerivedOutput::MinMaxPyramid);
+
+        glUseProgram(program.program_->getProgramId());
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, stateTexture);
+        glUniform1i(program.stateLoc_, 0);
+        glUniform1i(program.writeNormalsLoc_, writeNormals ? 1 : 0);
+        glUniform1i(program.writeMinMaxLoc_, writeMinMax ? 1 : 0);
+        glUniform2f(program.gridSizeLoc_, static_cast<float>(gridSize_.x), static_cast<float>(gridSize_.y));
+
+        glBindImageTexture(0, heightTexture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        if (writeNormals) glBindImageTexture(1, normalTexture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG32F);
+        if (writeMinMax) glBindImageTexture(2, minMaxPyramidTexture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG32F);
+
+        glDispatchCompute(NumGroups(size_.x), NumGroups(size_.y), 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        if (writeMinMax) BuildMinMaxPyramid();
+        validOutputs_ = DerivedOutput::Height | outputs;
+        stateVersion_ = ++lastStateVersion;
+    }
+
+    void DerivedOutputs::BuildMinMaxPyramid()
+    {
+        glUseProgram(minMaxReduceProgram_->getProgramId());
+        for (GLint level = 1; level < numPyramidLevels_; ++level) {
+            const auto levelSize = glm::max(size_ >> glm::uvec2(static_cast<unsigned int>(level)), glm::uvec2(1));
+            glBindImageTexture(0, minMaxPyramidTexture_, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_RG32F);
+            glBindImageTexture(1, minMaxPyramidTexture_, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG32F);
+            glDispatchCompute(NumGroups(levelSize.x), NumGroups(levelSize.y), 1);
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+        }
+    }
+}
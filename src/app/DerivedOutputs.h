@@ -0,0 +1,109 @@
+/**
+ * @file   DerivedOutputs.h
+ *
+ * @brief  Declaration of the stage computing the renderer inputs from the simulation state.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "app/SimulationData.h"
+
+namespace viscom {
+
+    class ApplicationNodeBase;
+    class GPUProgram;
+
+    /** The outputs that can be derived from the simulation state (combinable flags). */
+    enum class DerivedOutput : unsigned int {
+        None = 0,
+        /** The height field 1 - clamp(A - B) (R32F). */
+        Height = 1u << 0,
+        /** The height gradient in texture coordinates (RG32F), the normal is normalize(vec3(-height * gradient, 1)). */
+        Normals = 1u << 1,
+        /** Mip mapped minimum and maximum height (RG32F, level 0 texel p bounds the bilinear height between texel centers p and p + 1). */
+        MinMaxPyramid = 1u << 2
+    };
+
+    constexpr DerivedOutput operator|(DerivedOutput lhs, DerivedOutput rhs)
+    {
+        return static_cast<DerivedOutput>(static_cast<unsigned int>(lhs) | static_cast<unsigned int>(rhs));
+    }
+
+    /** Returns if all outputs in output are contained in flags. */
+    constexpr bool HasDerivedOutput(DerivedOutput flags, DerivedOutput output)
+    {
+        return (static_cast<unsigned int>(flags) & static_cast<unsigned int>(output)) == static_cast<unsigned int>(output);
+    }
+
+    /**
+     *  Computes the outputs requested by the active renderer from the simulation state. This runs once per rendered
+     *  frame after the last iteration, so the simulation passes only write the state.
+     */
+    class DerivedOutputs
+    {
+    public:
+        DerivedOutputs(ApplicationNodeBase* appNode, const glm::uvec2& size);
+        DerivedOutputs(const DerivedOutputs&) = delete;
+        DerivedOutputs& operator=(const DerivedOutputs&) = delete;
+        ~DerivedOutputs();
+
+        /** Sets the size of the whole grid and the grid cell at the origin of the state (with domain decomposition). */
+        void SetGridPlacement(const glm::uvec2& gridSize, const glm::ivec2& origin);
+        /** Computes the given outputs from the state texture (stored in the given format). */
+        void Update(GLuint stateTexture, StateFormat format, DerivedOutput outputs);
+
+        /** Returns the outputs computed by the last update. */
+        DerivedOutput GetValidOutputs() const { return validOutputs_; }
+        /** Returns a number identifying the last update (unique over all instances), renderers compare it to detect a changed state. */
+        std::uint64_t GetStateVersion() const { return stateVersion_; }
+        GLuint GetHeightTexture() const { return heightTexture_; }
+        GLuint GetNormalTexture() const { return normalTexture_; }
+        GLuint GetMinMaxPyramidTexture() const { return minMaxPyramidTexture_; }
+        GLint GetNumPyramidLevels() const { return numPyramidLevels_; }
+        const glm::uvec2& GetSize() const { return size_; }
+        /** Returns the scale (xy) and offset (zw) mapping texture coordinates of the whole grid to the outputs. */
+        glm::vec4 GetTexCoordTransform() const;
+
+    private:
+        /** Builds the coarser levels of the min/max pyramid from level 0. */
+        void BuildMinMaxPyramid();
+
+        /** The size of the simulation. */
+        glm::uvec2 size_;
+        /** The size of the whole grid and the grid cell at the origin of the outputs. */
+        glm::uvec2 gridSize_;
+        glm::ivec2 gridOrigin_ = glm::ivec2{ 0 };
+        /** The outputs computed by the last update. */
+        DerivedOutput validOutputs_ = DerivedOutput::None;
+        /** The version of the last update. */
+        std::uint64_t stateVersion_ = 0;
+
+        /** A program deriving the outputs and its uniform locations. */
+        struct DeriveProgram {
+            std::shared_ptr<GPUProgram> program_;
+            GLint stateLoc_ = -1;
+            GLint writeNormalsLoc_ = -1;
+            GLint writeMinMaxLoc_ = -1;
+            GLint gridSizeLoc_ = -1;
+        };
+
+        /** Loads a variant of the derive program. */
+        static DeriveProgram LoadDeriveProgram(ApplicationNodeBase* appNode, const std::string& name, const std::vector<std::string>& defines);
+
+        /** Programs deriving the outputs from a floating point and a fixed point state. */
+        DeriveProgram deriveProgram_;
+        DeriveProgram deriveFixedProgram_;
+        /** Program reducing a level of the min/max pyramid. */
+        std::shared_ptr<GPUProgram> minMaxReduceProgram_;
+
+        /** The height texture. */
+        GLuint heightTexture_ = 0;
+        /** The height gradient texture. */
+        GLuint normalTexture_ = 0;
+        /** The min/max pyramid texture. */
+        GLuint minMaxPyramidTexture_ = 0;
+        /** The number of levels of the min/max pyramid. */
+        GLint numPyramidLevels_ = 1;
+    };
+}
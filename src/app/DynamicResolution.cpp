@@ -0,0 +1,34 @@
+/**
+ * @file   DynamicResolution.cpp
+ *
+ * @brief  Implementation of the controller choosing the simulation grid size from the measured iteration time.
+ */
+
+#include "DynamicResolution.h"
+#include "app/SimulationData.h"
+
+namespace viscom {
+
+    glm::uvec2 DynamicResolution::Update(const SimulationData& simData, float iterationTime)
+    {
+        if (++framesSinceChange_ < DYNAMIC_RESOLUTION_SETTLE_FRAMES || iterationTime <= 0.0f) return simData.gridSize_;
+
+        const auto load = iterationTime * static_cast<float>(simData.dynamicResolutionIterations_) / simData.simulationTimeBudget_;
+        if (load <= 1.0f && load >= DYNAMIC_RESOLUTION_MIN_LOAD) return simData.gridSize_;
+
+        // aim for the middle of the band, so the next measurement does not cause a change back.
+        const auto targetLoad = 0.5f * (1.0f + DYNAMIC_RESOLUTION_MIN_LOAD);
+        const auto currentScale = static_cast<float>(simData.gridSize_.y) / static_cast<float>(SIMULATION_SIZE_Y);
+        const auto scale = glm::clamp(currentScale * glm::sqrt(targetLoad / load), DYNAMIC_RESOLUTION_MIN_SCALE, DYNAMIC_RESOLUTION_MAX_SCALE);
+
+        const auto gridSize = ScaleGridSize(simData.gridSize_, scale / currentScale);
+        if (gridSize != simData.gridSize_) Reset();
+        return gridSize;
+    }
+
+    glm::uvec2 DynamicResolution::ScaleGridSize(const glm::uvec2& gridSize, float scale)
+    {
+        const auto steps = glm::round(glm::vec2(gridSize) * scale / static_cast<float>(DYNAMIC_RESOLUTION_GRID_STEP));
+        return glm::uvec2(glm::max(steps, glm::vec2(1.0f))) * DYNAMIC_RESOLUTION_GRID_STEP;
+    }
+}
@@ -0,0 +1,46 @@
+/**
+ * @file   DynamicResolution.h
+ *
+ * @brief  Declaration of the controller choosing the simulation grid size from the measured iteration time.
+ */
+
+#pragma once
+
+#include "core/main.h"
+
+namespace viscom {
+
+    struct SimulationData;
+
+    /** The grid scale (relative to SIMULATION_SIZE_X / SIMULATION_SIZE_Y) the dynamic resolution chooses from. */
+    constexpr float DYNAMIC_RESOLUTION_MIN_SCALE = 0.25f;
+    constexpr float DYNAMIC_RESOLUTION_MAX_SCALE = 4.0f;
+    /** The grid size is kept while the frame cost is between this fraction of the budget and the budget. */
+    constexpr float DYNAMIC_RESOLUTION_MIN_LOAD = 0.6f;
+    /** The frames after a change until the iteration times of the new grid size are trusted. */
+    constexpr std::uint64_t DYNAMIC_RESOLUTION_SETTLE_FRAMES = 120;
+    /** Grid sizes are multiples of this, so small changes of the measurements do not cause resizes. */
+    constexpr unsigned int DYNAMIC_RESOLUTION_GRID_STEP = 16;
+
+    /**
+     *  Chooses the grid size so SimulationData::dynamicResolutionIterations_ iterations fit into the simulation time
+     *  budget of the slowest node. The cost of an iteration grows with the number of cells, so the grid is scaled by
+     *  the square root of the ratio of the budget to the cost. Changes wait DYNAMIC_RESOLUTION_SETTLE_FRAMES, so the
+     *  averaged iteration times of all nodes belong to the current size (coordinator side).
+     */
+    class DynamicResolution
+    {
+    public:
+        /** Returns the grid size for the iteration time of the slowest node in milliseconds (the current one if it fits). */
+        glm::uvec2 Update(const SimulationData& simData, float iterationTime);
+        /** Waits DYNAMIC_RESOLUTION_SETTLE_FRAMES before the next change (the grid size was changed elsewhere). */
+        void Reset() { framesSinceChange_ = 0; }
+
+        /** Returns the grid size scaled by the given factor (keeping the aspect ratio, in DYNAMIC_RESOLUTION_GRID_STEP steps). */
+        static glm::uvec2 ScaleGridSize(const glm::uvec2& gridSize, float scale);
+
+    private:
+        /** The frames since the grid size was changed. */
+        std::uint64_t framesSinceChange_ = 0;
+    };
+}
@@ -0,0 +1,171 @@
+/**
+ * @file   FrameProfiler.cpp
+ *
+ * @brief  Implementation of the per-phase CPU and GPU timers of a node.
+ */
+
+#include "core/open_gl.h"
+#include "FrameProfiler.h"
+#include <fstream>
+
+namespace viscom {
+
+    FrameProfiler::FrameProfiler() :
+        start_{ std::chrono::steady_clock::now() }
+    {
+        for (auto& history : cpuHistory_) history.fill(0.0f);
+        for (auto& history : gpuHistory_) history.fill(0.0f);
+    }
+
+    FrameProfiler::~FrameProfiler()
+    {
+        for (auto& slot : slots_) {
+            if (!slot.queries_.empty()) glDeleteQueries(static_cast<GLsizei>(slot.queries_.size()), slot.queries_.data());
+        }
+    }
+
+    double FrameProfiler::GetTime() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+    void FrameProfiler::BeginFrame()
+    {
+        if (inFrame_) return;
+        inFrame_ = true;
+
+        currentSlot_ = (currentSlot_ + 1) % slots_.size();
+        auto& slot = slots_[currentSlot_];
+        if (slot.pending_) ResolveFrame(slot);
+
+        const auto now = GetTime();
+        GLint64 gpuTime = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+        slot.frame_ = ++frame_;
+        slot.events_.clear();
+        slot.usedQueries_ = 0;
+        slot.gpuOffset_ = now - static_cast<double>(gpuTime) * 1e-9;
+        slot.pending_ = true;
+
+        if (lastFrameEnd_ >= 0.0) {
+            Event syncWait;
+            syncWait.phase_ = ProfilePhase::SyncWait;
+            syncWait.frame_ = frame_;
+            syncWait.cpuBegin_ = lastFrameEnd_;
+            syncWait.cpuEnd_ = now;
+            slot.events_.push_back(syncWait);
+        }
+    }
+
+    void FrameProfiler::EndFrame()
+    {
+        inFrame_ = false;
+        lastFrameEnd_ = GetTime();
+    }
+
+    FrameProfiler::Handle FrameProfiler::BeginPhase(ProfilePhase phase, bool gpu)
+    {
+        auto& slot = slots_[currentSlot_];
+        Event event;
+        event.phase_ = phase;
+        event.frame_ = frame_;
+        event.cpuBegin_ = GetTime();
+        if (gpu) event.beginQuery_ = QueryTimestamp();
+        slot.events_.push_back(event);
+        return Handle{ frame_, slot.events_.size() - 1 };
+    }
+
+    void FrameProfiler::EndPhase(const Handle& handle)
+    {
+        // a phase that spans the start of a frame is dropped.
+        if (handle.frame_ != frame_) return;
+        auto& event = slots_[currentSlot_].events_[handle.event_];
+        if (event.beginQuery_ >= 0) event.endQuery_ = QueryTimestamp();
+        event.cpuEnd_ = GetTime();
+    }
+
+    int FrameProfiler::QueryTimestamp()
+    {
+        auto& slot = slots_[currentSlot_];
+        if (slot.usedQueries_ == slot.queries_.size()) {
+            GLuint query = 0;
+            glGenQueries(1, &query);
+            slot.queries_.push_back(query);
+        }
+        glQueryCounter(slot.queries_[slot.usedQueries_], GL_TIMESTAMP);
+        return static_cast<int>(slot.usedQueries_++);
+    }
+
+    void FrameProfiler::ResolveFrame(FrameSlot& slot)
+    {
+        slot.pending_ = false;
+        // the timestamps are written in order, so all are available once the last one is.
+        auto available = true;
+        if (slot.usedQueries_ > 0) {
+            GLint lastAvailable = 0;
+            glGetQueryObjectiv(slot.queries_[slot.usedQueries_ - 1], GL_QUERY_RESULT_AVAILABLE, &lastAvailable);
+            available = lastAvailable != 0;
+        }
+
+        std::array<float, PROFILE_PHASE_COUNT> cpuTotals, gpuTotals;
+        cpuTotals.fill(0.0f);
+        gpuTotals.fill(0.0f);
+        for (auto& event : slot.events_) {
+            if (event.cpuEnd_ < event.cpuBegin_) continue;
+
+            const auto phase = static_cast<std::size_t>(event.phase_);
+            cpuTotals[phase] += static_cast<float>((event.cpuEnd_ - event.cpuBegin_) * 1000.0);
+            if (available && event.beginQuery_ >= 0 && event.endQuery_ >= 0) {
+                GLuint64 begin = 0, end = 0;
+                glGetQueryObjectui64v(slot.queries_[static_cast<std::size_t>(event.beginQuery_)], GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(slot.queries_[static_cast<std::size_t>(event.endQuery_)], GL_QUERY_RESULT, &end);
+                event.gpuBegin_ = static_cast<double>(begin) * 1e-9 + slot.gpuOffset_;
+                event.gpuEnd_ = static_cast<double>(end) * 1e-9 + slot.gpuOffset_;
+                gpuTotals[phase] += static_cast<float>((event.gpuEnd_ - event.gpuBegin_) * 1000.0);
+            }
+            trace_.push_back(event);
+        }
+
+        for (std::size_t phase = 0; phase < PROFILE_PHASE_COUNT; ++phase) {
+            cpuHistory_[phase][historyOffset_] = cpuTotals[phase];
+            gpuHistory_[phase][historyOffset_] = gpuTotals[phase];
+        }
+        historyOffset_ = (historyOffset_ + 1) % PROFILER_HISTORY_FRAMES;
+        while (!trace_.empty() && trace_.front().frame_ + PROFILER_TRACE_FRAMES <= slot.frame_) trace_.pop_front();
+    }
+
+    const std::array<float, PROFILER_HISTORY_FRAMES>& FrameProfiler::GetHistory(ProfilePhase phase, bool gpu) const
+    {
+        return (gpu ? gpuHistory_ : cpuHistory_)[static_cast<std::size_t>(phase)];
+    }
+
+    float FrameProfiler::GetAverage(ProfilePhase phase, bool gpu) const
+    {
+        auto sum = 0.0f;
+        for (auto time : GetHistory(phase, gpu)) sum += time;
+        return sum / static_cast<float>(PROFILER_HISTORY_FRAMES);
+    }
+
+    bool FrameProfiler::WriteTrace(const std::string& file, int processId) const
+    {
+        std::ofstream ofs(file);
+        if (!ofs) return false;
+
+        // the CPU and GPU timings are shown as two threads of the node's process, times are in microseconds.
+        ofs << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        ofs << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << processId << ", \"args\": {\"name\": \"Node " << processId << "\"}},\n";
+        ofs << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << processId << ", \"tid\": 1, \"args\": {\"name\": \"CPU\"}},\n";
+        ofs << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << processId << ", \"tid\": 2, \"args\": {\"name\": \"GPU\"}}";
+        const auto writeEvent = [&ofs, processId](const Event& event, int thread, double begin, double end) {
+            ofs << ",\n{\"name\": \"" << PROFILE_PHASE_NAMES[static_cast<std::size_t>(event.phase_)] << "\", \"cat\": \"" << (thread == 1 ? "cpu" : "gpu")
+                << "\", \"ph\": \"X\", \"pid\": " << processId << ", \"tid\": " << thread << ", \"ts\": " << static_cast<std::uint64_t>(begin * 1e6)
+                << ", \"dur\": " << static_cast<std::uint64_t>((end - begin) * 1e6) << ", \"args\": {\"frame\": " << event.frame_ << "}}";
+        };
+        for (const auto& event : trace_) {
+            writeEvent(event, 1, event.cpuBegin_, event.cpuEnd_);
+            if (event.gpuBegin_ >= 0.0 && event.gpuEnd_ >= event.gpuBegin_) writeEvent(event, 2, event.gpuBegin_, event.gpuEnd_);
+        }
+        ofs << "\n]}\n";
+        return static_cast<bool>(ofs);
+    }
+}
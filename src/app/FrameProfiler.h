@@ -0,0 +1,176 @@
+/**
+ * @file   FrameProfiler.h
+ *
+ * @brief  Declaration of the per-phase CPU and GPU timers of a node.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include <array>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace viscom {
+
+    /** The phases of a frame that are timed. */
+    enum class ProfilePhase : int {
+        /** The simulation iteration loop of UpdateFrame. */
+        Iterations = 0,
+        /** Splatting the seed points into the state. */
+        Seeding = 1,
+        /** ResetSimulation. */
+        Reset = 2,
+        /** The back faces of the simulation volume drawn by the raycaster. */
+        RaycastBack = 3,
+        /** The main raycast (including the upsampling of reduced resolutions). */
+        Raycast = 4,
+        /** Draw2D (the GUI and ImGui). */
+        Draw2D = 5,
+        /** Encoding and sharing the sync payload (coordinator). */
+        SyncEncode = 6,
+        /** Reading and decoding the sync payload (workers). */
+        SyncDecode = 7,
+        /** The time between frames outside the application (SGCT synchronization, swap barrier, vsync). */
+        SyncWait = 8
+    };
+
+    /** The names of the phases (as c strings for imgui). */
+    constexpr std::array<const char*, 9> PROFILE_PHASE_NAMES{ { "Iterations", "Seeding", "Reset", "Raycast Back", "Raycast", "Draw2D",
+        "Sync Encode", "Sync Decode", "Sync Wait" } };
+    constexpr std::size_t PROFILE_PHASE_COUNT = PROFILE_PHASE_NAMES.size();
+
+    /** The frames the histograms show. */
+    constexpr std::size_t PROFILER_HISTORY_FRAMES = 240;
+    /** The frames whose timestamp queries are in flight (results are read this many frames later, never waited for). */
+    constexpr std::size_t PROFILER_QUERY_FRAMES = 3;
+    /** The frames kept for the trace export. */
+    constexpr std::size_t PROFILER_TRACE_FRAMES = 600;
+
+    /**
+     *  Times the phases of each frame on the CPU and, for phases with GPU work, with GL timestamp queries (which can
+     *  be nested, unlike time elapsed queries). The queries of a frame are read PROFILER_QUERY_FRAMES frames later
+     *  and dropped if they are not available yet, so the profiler never stalls. The per-frame totals of each phase
+     *  are kept for the histograms and the single timings of the last frames for a Chrome trace-event export (GPU
+     *  times are moved to the CPU clock).
+     *
+     *  The phases are timed with the RD_PROFILE_* macros, which compile to nothing unless RD_PROFILING is defined
+     *  (the RD_PROFILING CMake option). Without it the nodes do not create a profiler at all.
+     */
+    class FrameProfiler
+    {
+    public:
+        /** A started phase (see BeginPhase). */
+        struct Handle {
+            std::uint64_t frame_ = 0;
+            std::size_t event_ = 0;
+        };
+
+        FrameProfiler();
+        FrameProfiler(const FrameProfiler&) = delete;
+        FrameProfiler& operator=(const FrameProfiler&) = delete;
+        ~FrameProfiler();
+
+        /** Starts the next frame (once per frame, later calls before EndFrame are ignored), the time since the last EndFrame is the sync wait. */
+        void BeginFrame();
+        /** Marks the end of the application work of the frame. */
+        void EndFrame();
+        /** Starts timing a phase, with timestamp queries if gpu is set. */
+        Handle BeginPhase(ProfilePhase phase, bool gpu);
+        void EndPhase(const Handle& handle);
+
+        /** Returns the total time of the phase in each of the last frames in milliseconds (a ring starting at GetHistoryOffset()). */
+        const std::array<float, PROFILER_HISTORY_FRAMES>& GetHistory(ProfilePhase phase, bool gpu) const;
+        std::size_t GetHistoryOffset() const { return historyOffset_; }
+        /** Returns the average time of the phase per frame in milliseconds over the history. */
+        float GetAverage(ProfilePhase phase, bool gpu) const;
+
+        /** Writes the timings of the last PROFILER_TRACE_FRAMES frames as Chrome trace events (processId is the node). */
+        bool WriteTrace(const std::string& file, int processId) const;
+
+    private:
+        /** A timed phase. */
+        struct Event {
+            ProfilePhase phase_ = ProfilePhase::Iterations;
+            std::uint64_t frame_ = 0;
+            /** The CPU times in seconds since the profiler was created. */
+            double cpuBegin_ = 0.0;
+            double cpuEnd_ = 0.0;
+            /** The GPU times on the CPU clock (negative if the phase has no GPU time or it was dropped). */
+            double gpuBegin_ = -1.0;
+            double gpuEnd_ = -1.0;
+            /** The indices of the timestamp queries (of the frame, negative without). */
+            int beginQuery_ = -1;
+            int endQuery_ = -1;
+        };
+
+        /** The events and queries of a frame. */
+        struct FrameSlot {
+            std::uint64_t frame_ = 0;
+            std::vector<Event> events_;
+            /** The timestamp queries (created on demand and reused) and the number used by the frame. */
+            std::vector<GLuint> queries_;
+            std::size_t usedQueries_ = 0;
+            /** The CPU time minus the GPU time in seconds when the frame began. */
+            double gpuOffset_ = 0.0;
+            bool pending_ = false;
+        };
+
+        /** Returns the seconds since the profiler was created. */
+        double GetTime() const;
+        /** Issues a timestamp query of the current frame and returns its index. */
+        int QueryTimestamp();
+        /** Reads the queries of a finished frame (if available) and adds its events to the history and the trace. */
+        void ResolveFrame(FrameSlot& slot);
+
+        /** The time the profiler was created. */
+        std::chrono::steady_clock::time_point start_;
+        /** The frames in flight and the current one. */
+        std::array<FrameSlot, PROFILER_QUERY_FRAMES> slots_;
+        std::size_t currentSlot_ = 0;
+        std::uint64_t frame_ = 0;
+        /** Set between BeginFrame and EndFrame. */
+        bool inFrame_ = false;
+        /** The time of the last EndFrame (negative before the first). */
+        double lastFrameEnd_ = -1.0;
+
+        /** The totals of each phase in the last frames in milliseconds. */
+        std::array<std::array<float, PROFILER_HISTORY_FRAMES>, PROFILE_PHASE_COUNT> cpuHistory_;
+        std::array<std::array<float, PROFILER_HISTORY_FRAMES>, PROFILE_PHASE_COUNT> gpuHistory_;
+        std::size_t historyOffset_ = 0;
+        /** The events of the last frames for the trace. */
+        std::deque<Event> trace_;
+    };
+
+    /** Times the enclosing scope as a phase (use the RD_PROFILE_* macros). */
+    class ProfileScope
+    {
+    public:
+        ProfileScope(FrameProfiler& profiler, ProfilePhase phase, bool gpu) : profiler_{ profiler }, handle_{ profiler.BeginPhase(phase, gpu) } {}
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+        ~ProfileScope() { profiler_.EndPhase(handle_); }
+
+    private:
+        FrameProfiler& profiler_;
+        FrameProfiler::Handle handle_;
+    };
+}
+
+#ifdef RD_PROFILING
+#define RD_PROFILE_CONCAT_IMPL(a, b) a##b
+#define RD_PROFILE_CONCAT(a, b) RD_PROFILE_CONCAT_IMPL(a, b)
+/** Times the CPU work of the enclosing scope as a ProfilePhase. */
+#define RD_PROFILE_SCOPE(profiler, phase) ::viscom::ProfileScope RD_PROFILE_CONCAT(profileScope, __LINE__){ profiler, ::viscom::ProfilePhase::phase, false }
+/** Times the CPU and GPU work of the enclosing scope as a ProfilePhase. */
+#define RD_PROFILE_GPU_SCOPE(profiler, phase) ::viscom::ProfileScope RD_PROFILE_CONCAT(profileScope, __LINE__){ profiler, ::viscom::ProfilePhase::phase, true }
+#define RD_PROFILE_BEGIN_FRAME(profiler) (profiler).BeginFrame()
+#define RD_PROFILE_END_FRAME(profiler) (profiler).EndFrame()
+#else
+#define RD_PROFILE_SCOPE(profiler, phase)
+#define RD_PROFILE_GPU_SCOPE(profiler, phase)
+#define RD_PROFILE_BEGIN_FRAME(profiler)
+#define RD_PROFILE_END_FRAME(profiler)
+#endif
@@ -0,0 +1,293 @@
+/**
+ * @file   FrameRecorder.cpp
+ *
+ * @brief  Implementation of the recorder writing the rendered frames and the simulation state to disk.
+ */
+
+#include "core/open_gl.h"
+#include "FrameRecorder.h"
+#include "app/Checkpoint.h"
+#include <filesystem>
+#include <spdlog/spdlog.h>
+
+namespace viscom {
+
+    /** The time the end of a recording waits for each read back still in flight in nanoseconds. */
+    constexpr GLuint64 RECORDER_FINISH_TIMEOUT = 1000000000;
+
+    FrameRecorder::FrameRecorder(const std::string& directory, std::uint64_t frameRate) :
+        directory_{ directory },
+        frameRate_{ glm::max(frameRate, std::uint64_t{ 1 }) }
+    {
+        std::error_code error;
+        std::filesystem::create_directories(directory_, error);
+        if (error) spdlog::error("Could not create recording directory {}: {}", directory_, error.message());
+        index_.open(directory_ + "/index.txt", std::ios::trunc);
+        index_ << "# file offset size width height format frame iteration" << std::endl;
+
+        stateStream_.filename_ = "state.raw";
+        stateStream_.isState_ = true;
+        writerThread_ = std::thread{ [this]() { WriterThread(); } };
+        spdlog::info("Started recording to {}.", directory_);
+    }
+
+    FrameRecorder::~FrameRecorder()
+    {
+        // the frames still read back are waited for, so the end of the recording is complete.
+        auto finishStream = [this](Stream& stream) {
+            while (!stream.readingSlots_.empty()) {
+                auto& slot = stream.slots_[stream.readingSlots_.front()];
+                stream.readingSlots_.pop_front();
+                const auto status = glClientWaitSync(slot.fence_, GL_SYNC_FLUSH_COMMANDS_BIT, RECORDER_FINISH_TIMEOUT);
+                if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) QueueSlot(stream, slot);
+                else {
+                    glDeleteSync(slot.fence_);
+                    slot.fence_ = nullptr;
+                    slot.state_ = SlotState::Free;
+                    ++numDropped_;
+                }
+            }
+        };
+        for (auto& stream : windowStreams_) finishStream(*stream);
+        finishStream(stateStream_);
+
+        {
+            std::lock_guard<std::mutex> lock{ writerMutex_ };
+            quit_ = true;
+        }
+        writerCondition_.notify_one();
+        writerThread_.join();
+
+        auto releaseStream = [](Stream& stream) {
+            for (auto& slot : stream.slots_) {
+                if (slot.state_ == SlotState::Written) {
+                    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer_);
+                    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                }
+                if (slot.buffer_ != 0) glDeleteBuffers(1, &slot.buffer_);
+            }
+        };
+        for (auto& stream : windowStreams_) releaseStream(*stream);
+        releaseStream(stateStream_);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        spdlog::info("Stopped recording to {} ({} frames written, {} dropped).", directory_, numWritten_.load(), numDropped_);
+    }
+
+    std::uint64_t FrameRecorder::GetNumQueued() const
+    {
+        std::uint64_t result = 0;
+        auto countStream = [&result](const Stream& stream) {
+            for (const auto& slot : stream.slots_) if (slot.state_ == SlotState::Reading || slot.state_ == SlotState::Writing) ++result;
+        };
+        for (const auto& stream : windowStreams_) countStream(*stream);
+        countStream(stateStream_);
+        return result;
+    }
+
+    FrameRecorder::Slot* FrameRecorder::BeginReadBack(Stream& stream, std::size_t size, const glm::uvec2& frameSize, std::uint64_t iteration)
+    {
+        auto& slot = stream.slots_[stream.nextSlot_];
+        if (slot.state_ != SlotState::Free) {
+            ++numDropped_;
+            return nullptr;
+        }
+        stream.nextSlot_ = (stream.nextSlot_ + 1) % stream.slots_.size();
+
+        if (slot.buffer_ == 0) glGenBuffers(1, &slot.buffer_);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer_);
+        if (slot.capacity_ < size) {
+            slot.capacity_ = size;
+            glBufferData(GL_PIXEL_PACK_BUFFER, slot.capacity_, nullptr, GL_STREAM_READ);
+        }
+        slot.size_ = size;
+        slot.frameSize_ = frameSize;
+        slot.frame_ = frame_;
+        slot.iteration_ = iteration;
+        return &slot;
+    }
+
+    void FrameRecorder::EndReadBack(Stream& stream, Slot& slot)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.state_ = SlotState::Reading;
+        stream.readingSlots_.push_back(static_cast<std::size_t>(&slot - stream.slots_.data()));
+    }
+
+    void FrameRecorder::RecordWindow(std::size_t window, std::uint64_t iteration)
+    {
+        while (windowStreams_.size() <= window) {
+            windowStreams_.push_back(std::make_unique<Stream>());
+            windowStreams_.back()->filename_ = "window" + std::to_string(windowStreams_.size() - 1) + ".y4m";
+        }
+        auto& stream = *windowStreams_[window];
+
+        GLint drawFBO = 0;
+        glm::ivec4 viewport{ 0 };
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFBO);
+        glGetIntegerv(GL_VIEWPORT, &viewport.x);
+        // the chroma planes have half the size, so the size has to be even.
+        const glm::uvec2 frameSize{ static_cast<unsigned int>(viewport.z) & ~1u, static_cast<unsigned int>(viewport.w) & ~1u };
+        if (stream.frameSize_ == glm::uvec2{ 0 }) stream.frameSize_ = frameSize;
+        if (frameSize != stream.frameSize_ || frameSize.x == 0 || frameSize.y == 0) {
+            ++numDropped_;
+            return;
+        }
+
+        auto slot = BeginReadBack(stream, static_cast<std::size_t>(frameSize.x) * frameSize.y * 4, frameSize, iteration);
+        if (slot == nullptr) return;
+
+        GLint readFBO = 0;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFBO);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(drawFBO));
+        if (drawFBO != 0) glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(viewport.x, viewport.y, static_cast<GLsizei>(frameSize.x), static_cast<GLsizei>(frameSize.y), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(readFBO));
+        EndReadBack(stream, *slot);
+    }
+
+    void FrameRecorder::RecordState(GLuint stateTexture, StateFormat format, const glm::uvec2& size, std::uint64_t iteration)
+    {
+        const auto& transferFormat = GetStateTransferFormat(format);
+        auto slot = BeginReadBack(stateStream_, static_cast<std::size_t>(size.x) * size.y * transferFormat.cellSize_, size, iteration);
+        if (slot == nullptr) return;
+        slot->format_ = format;
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, stateTexture);
+        glGetTexImage(GL_TEXTURE_2D, 0, transferFormat.format_, transferFormat.type_, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        EndReadBack(stateStream_, *slot);
+    }
+
+    void FrameRecorder::QueueSlot(Stream& stream, Slot& slot)
+    {
+        glDeleteSync(slot.fence_);
+        slot.fence_ = nullptr;
+
+        // the writer thread reads the mapped memory directly, the buffer is not used by GL until it is unmapped.
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer_);
+        slot.data_ = static_cast<const std::uint8_t*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size_, GL_MAP_READ_BIT));
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (slot.data_ == nullptr) {
+            spdlog::error("Could not map a recording read back buffer.");
+            slot.state_ = SlotState::Free;
+            ++numDropped_;
+            return;
+        }
+
+        slot.state_ = SlotState::Writing;
+        {
+            std::lock_guard<std::mutex> lock{ writerMutex_ };
+            writerQueue_.emplace_back(&stream, &slot);
+        }
+        writerCondition_.notify_one();
+    }
+
+    void FrameRecorder::Poll()
+    {
+        ++frame_;
+        auto pollStream = [this](Stream& stream) {
+            for (auto& slot : stream.slots_) {
+                if (slot.state_ != SlotState::Written) continue;
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer_);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                slot.data_ = nullptr;
+                slot.state_ = SlotState::Free;
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            // the fences signal in the order of the read backs.
+            while (!stream.readingSlots_.empty()) {
+                auto& slot = stream.slots_[stream.readingSlots_.front()];
+                const auto status = glClientWaitSync(slot.fence_, 0, 0);
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+                stream.readingSlots_.pop_front();
+                QueueSlot(stream, slot);
+            }
+        };
+        for (auto& stream : windowStreams_) pollStream(*stream);
+        pollStream(stateStream_);
+    }
+
+    void FrameRecorder::WriterThread()
+    {
+        while (true) {
+            std::pair<Stream*, Slot*> queued;
+            {
+                std::unique_lock<std::mutex> lock{ writerMutex_ };
+                writerCondition_.wait(lock, [this]() { return quit_ || !writerQueue_.empty(); });
+                if (writerQueue_.empty()) return;
+                queued = writerQueue_.front();
+                writerQueue_.pop_front();
+            }
+
+            auto& stream = *queued.first;
+            auto& slot = *queued.second;
+            if (!stream.file_.is_open()) {
+                stream.file_.open(directory_ + "/" + stream.filename_, std::ios::binary | std::ios::trunc);
+                if (!stream.isState_) {
+                    const auto header = "YUV4MPEG2 W" + std::to_string(slot.frameSize_.x) + " H" + std::to_string(slot.frameSize_.y)
+                        + " F" + std::to_string(frameRate_) + ":1 Ip A1:1 C420jpeg\n";
+                    stream.file_ << header;
+                    stream.fileSize_ = header.size();
+                }
+            }
+
+            const auto offset = stream.fileSize_;
+            if (stream.isState_) {
+                stream.file_.write(reinterpret_cast<const char*>(slot.data_), static_cast<std::streamsize>(slot.size_));
+                stream.fileSize_ += slot.size_;
+            }
+            else WriteWindowFrame(stream, slot);
+
+            if (!stream.file_.good()) spdlog::error("Could not write recording {}/{}.", directory_, stream.filename_);
+            else {
+                index_ << stream.filename_ << " " << offset << " " << stream.fileSize_ - offset << " " << slot.frameSize_.x << " " << slot.frameSize_.y << " "
+                    << (stream.isState_ ? STATE_FORMAT_NAMES[static_cast<std::size_t>(slot.format_)] : "YUV420") << " "
+                    << slot.frame_ << " " << slot.iteration_ << "\n";
+                ++numWritten_;
+            }
+            slot.state_ = SlotState::Written;
+        }
+    }
+
+    void FrameRecorder::WriteWindowFrame(Stream& stream, const Slot& slot)
+    {
+        const std::size_t width = slot.frameSize_.x;
+        const std::size_t height = slot.frameSize_.y;
+        const auto chromaSize = (width / 2) * (height / 2);
+        planes_.resize(width * height + 2 * chromaSize);
+        auto yPlane = planes_.data();
+        auto uPlane = yPlane + width * height;
+        auto vPlane = uPlane + chromaSize;
+
+        // the read back starts with the bottom row, the video with the top row. Each 2x2 block shares its chroma.
+        for (std::size_t y = 0; y < height; y += 2) {
+            const auto rows = std::array<const std::uint8_t*, 2>{ { slot.data_ + (height - 1 - y) * width * 4, slot.data_ + (height - 2 - y) * width * 4 } };
+            for (std::size_t x = 0; x < width; x += 2) {
+                int sumR = 0, sumG = 0, sumB = 0;
+                for (std::size_t row = 0; row < 2; ++row) {
+                    for (std::size_t column = 0; column < 2; ++column) {
+                        const auto pixel = rows[row] + (x + column) * 4;
+                        const int r = pixel[0], g = pixel[1], b = pixel[2];
+                        yPlane[(y + row) * width + x + column] = static_cast<std::uint8_t>(16 + ((66 * r + 129 * g + 25 * b + 128) >> 8));
+                        sumR += r;
+                        sumG += g;
+                        sumB += b;
+                    }
+                }
+                const auto chroma = (y / 2) * (width / 2) + x / 2;
+                uPlane[chroma] = static_cast<std::uint8_t>(128 + ((-38 * sumR - 74 * sumG + 112 * sumB + 512) >> 10));
+                vPlane[chroma] = static_cast<std::uint8_t>(128 + ((112 * sumR - 94 * sumG - 18 * sumB + 512) >> 10));
+            }
+        }
+
+        constexpr char FRAME_HEADER[] = "FRAME\n";
+        stream.file_.write(FRAME_HEADER, sizeof(FRAME_HEADER) - 1);
+        stream.file_.write(reinterpret_cast<const char*>(planes_.data()), static_cast<std::streamsize>(planes_.size()));
+        stream.fileSize_ += sizeof(FRAME_HEADER) - 1 + planes_.size();
+    }
+}
@@ -0,0 +1,147 @@
+/**
+ * @file   FrameRecorder.h
+ *
+ * @brief  Declaration of the recorder writing the rendered frames and the simulation state to disk.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "app/SimulationData.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace viscom {
+
+    /** The pixel pack buffers of each recorded stream (a frame is dropped if none of them is free). */
+    constexpr std::size_t RECORDER_BUFFERS_PER_STREAM = 4;
+
+    /**
+     *  Records the rendered frames of each window of a node and, optionally, the simulation state without stalling
+     *  the frame. A frame is read back into the next pixel pack buffer of its stream and mapped once its fence
+     *  signaled (a later frame). The writer thread converts and writes straight from the mapped buffer, which is
+     *  unmapped and reused after it was written, so the memory is bounded by the buffers and a frame is dropped if
+     *  the writer falls behind. Windows are written as 4:2:0 Y4M videos (window<i>.y4m), the state as raw cells in
+     *  its state format (state.raw). index.txt has a line for every written frame with its offset, size, frame and
+     *  iteration.
+     */
+    class FrameRecorder
+    {
+    public:
+        /** Starts a recording in the directory, frameRate is written to the headers of the videos. */
+        FrameRecorder(const std::string& directory, std::uint64_t frameRate);
+        FrameRecorder(const FrameRecorder&) = delete;
+        FrameRecorder& operator=(const FrameRecorder&) = delete;
+        /** Writes the frames still read back or queued (waits for them) and ends the recording. */
+        ~FrameRecorder();
+
+        /** Reads back the viewport of the bound draw frame buffer as the next frame of a window. */
+        void RecordWindow(std::size_t window, std::uint64_t iteration);
+        /** Reads back the state texture. */
+        void RecordState(GLuint stateTexture, StateFormat format, const glm::uvec2& size, std::uint64_t iteration);
+        /** Hands finished read backs to the writer thread and reuses written buffers (once per frame, never waits). */
+        void Poll();
+
+        const std::string& GetDirectory() const { return directory_; }
+        /** Returns the number of frames written so far. */
+        std::uint64_t GetNumWritten() const { return numWritten_; }
+        /** Returns the number of frames dropped because no buffer was free (or the window size changed). */
+        std::uint64_t GetNumDropped() const { return numDropped_; }
+        /** Returns the number of frames read back or waiting for the writer thread. */
+        std::uint64_t GetNumQueued() const;
+
+    private:
+        /** The states of a pixel pack buffer. */
+        enum class SlotState : int {
+            /** Can be used for the next frame. */
+            Free,
+            /** Read back by the GPU (the fence is pending). */
+            Reading,
+            /** Mapped and owned by the writer thread. */
+            Writing,
+            /** Written, has to be unmapped. */
+            Written
+        };
+
+        /** A pixel pack buffer of a stream and the frame it holds. */
+        struct Slot {
+            GLuint buffer_ = 0;
+            std::size_t capacity_ = 0;
+            std::size_t size_ = 0;
+            GLsync fence_ = nullptr;
+            std::atomic<SlotState> state_{ SlotState::Free };
+            /** The mapped memory (while Writing). */
+            const std::uint8_t* data_ = nullptr;
+            glm::uvec2 frameSize_ = glm::uvec2{ 0 };
+            /** The state format (state stream only). */
+            StateFormat format_ = StateFormat::Float32;
+            std::uint64_t frame_ = 0;
+            std::uint64_t iteration_ = 0;
+        };
+
+        /** A recorded window or the state. */
+        struct Stream {
+            /** The file name in the recording directory. */
+            std::string filename_;
+            /** Set for the state. */
+            bool isState_ = false;
+            std::array<Slot, RECORDER_BUFFERS_PER_STREAM> slots_;
+            /** The slot used for the next frame. */
+            std::size_t nextSlot_ = 0;
+            /** The slots read back in the order of their frames. */
+            std::deque<std::size_t> readingSlots_;
+            /** The frame size of a window (fixed by its first frame). */
+            glm::uvec2 frameSize_ = glm::uvec2{ 0 };
+
+            /** The file and its size (writer thread only). */
+            std::ofstream file_;
+            std::uint64_t fileSize_ = 0;
+        };
+
+        /** Returns the next slot of the stream and prepares its buffer for size bytes (nullptr if it is still in use). */
+        Slot* BeginReadBack(Stream& stream, std::size_t size, const glm::uvec2& frameSize, std::uint64_t iteration);
+        /** Inserts the fence of the read back. */
+        void EndReadBack(Stream& stream, Slot& slot);
+        /** Maps the slot and hands it to the writer thread. */
+        void QueueSlot(Stream& stream, Slot& slot);
+        /** Writes the queued frames (background thread). */
+        void WriterThread();
+        /** Writes a frame of a window as a Y4M frame (converted to 4:2:0 BT.601 YCbCr). */
+        void WriteWindowFrame(Stream& stream, const Slot& slot);
+
+        /** The directory of the recording. */
+        std::string directory_;
+        /** The frame rate written to the video headers. */
+        std::uint64_t frameRate_;
+        /** The frames since the recording started. */
+        std::uint64_t frame_ = 0;
+
+        /** The streams of the windows (created by their first frame) and of the state. */
+        std::vector<std::unique_ptr<Stream>> windowStreams_;
+        Stream stateStream_;
+
+        /** The writer thread and the queued slots. */
+        std::thread writerThread_;
+        std::mutex writerMutex_;
+        std::condition_variable writerCondition_;
+        std::deque<std::pair<Stream*, Slot*>> writerQueue_;
+        /** Set to stop the writer thread once the queue is empty. */
+        bool quit_ = false;
+        /** The index file (writer thread only). */
+        std::ofstream index_;
+        /** The planes of a converted window frame (writer thread only). */
+        std::vector<std::uint8_t> planes_;
+
+        /** The counters. */
+        std::atomic<std::uint64_t> numWritten_{ 0 };
+        std::uint64_t numDropped_ = 0;
+    };
+}
@@ -0,0 +1,46 @@
+/**
+ * @file   IdleThrottle.cpp
+ *
+ * @brief  Implementation of the controller pausing the simulation once the state is stationary.
+ */
+
+#include "IdleThrottle.h"
+#include "app/SimulationData.h"
+#include <spdlog/spdlog.h>
+
+namespace viscom {
+
+    void IdleThrottle::NotifyActivity(SimulationData& simData)
+    {
+        if (simData.simulationIdle_) spdlog::info("Resuming the simulation at iteration {}.", simData.currentGlobalIterationCount_);
+        simData.simulationIdle_ = false;
+        activityIteration_ = simData.currentGlobalIterationCount_;
+        steadyMeasurements_ = 0;
+    }
+
+    void IdleThrottle::Update(SimulationData& simData, const std::vector<StateChange>& nodeChanges)
+    {
+        if (!simData.idleThrottling_) {
+            if (simData.simulationIdle_) NotifyActivity(simData);
+            return;
+        }
+        if (simData.simulationIdle_ || nodeChanges.empty()) return;
+
+        // measurements from before the last activity do not describe the current state.
+        const auto& coordinatorChange = nodeChanges.front();
+        if (coordinatorChange.iteration_ <= glm::max(activityIteration_, lastMeasuredIteration_)) return;
+        auto maxChange = 0.0f;
+        for (const auto& change : nodeChanges) {
+            if (change.iteration_ <= activityIteration_) return;
+            maxChange = glm::max(maxChange, change.maxChange_);
+        }
+        lastMeasuredIteration_ = coordinatorChange.iteration_;
+        lastChange_ = maxChange;
+
+        steadyMeasurements_ = maxChange <= simData.steadyStateThreshold_ ? steadyMeasurements_ + 1 : 0;
+        if (steadyMeasurements_ >= STEADY_STATE_MEASUREMENTS) {
+            simData.simulationIdle_ = true;
+            spdlog::info("The state is stationary, pausing the simulation at iteration {}.", simData.currentGlobalIterationCount_);
+        }
+    }
+}
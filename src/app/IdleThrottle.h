@@ -0,0 +1,54 @@
+/**
+ * @file   IdleThrottle.h
+ *
+ * @brief  Declaration of the controller pausing the simulation once the state is stationary.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "app/ConvergenceMonitor.h"
+#include <vector>
+
+namespace viscom {
+
+    struct SimulationData;
+
+    /** The consecutive measurements below the threshold after which the simulation pauses. */
+    constexpr std::uint64_t STEADY_STATE_MEASUREMENTS = 60;
+    /** The minimum time between frames while the simulation is paused in milliseconds. */
+    constexpr long long IDLE_FRAME_TIME_MS = 50;
+
+    /**
+     *  Decides when the coordinator pauses the simulation (SimulationData::simulationIdle_, synchronized to all nodes,
+     *  so they stop at the same global iteration): after STEADY_STATE_MEASUREMENTS measurements in a row in which no
+     *  node's state changed by more than SimulationData::steadyStateThreshold_ per iteration. Any input resumes the
+     *  simulation immediately and only measurements taken after it count again.
+     */
+    class IdleThrottle
+    {
+    public:
+        /** Resumes the simulation after input (seed points, resets, parameter changes) at the current global iteration. */
+        void NotifyActivity(SimulationData& simData);
+        /**
+         *  Adds the newest measurement of each node (the coordinator's first) and updates the idle flag. Nodes whose
+         *  measurement is older than the last activity are waited for.
+         */
+        void Update(SimulationData& simData, const std::vector<StateChange>& nodeChanges);
+
+        /** Returns the measurements below the threshold in a row. */
+        std::uint64_t GetSteadyMeasurements() const { return steadyMeasurements_; }
+        /** Returns the largest change per iteration of the last measurements taken into account. */
+        float GetLastChange() const { return lastChange_; }
+
+    private:
+        /** The global iteration of the last activity. */
+        std::uint64_t activityIteration_ = 0;
+        /** The newest coordinator measurement counted (every measurement is counted once). */
+        std::uint64_t lastMeasuredIteration_ = 0;
+        /** The measurements below the threshold in a row. */
+        std::uint64_t steadyMeasurements_ = 0;
+        /** The largest change per iteration of the last measurements taken into account. */
+        float lastChange_ = 0.0f;
+    };
+}
@@ -0,0 +1,85 @@
+/**
+ * @file   IterationScheduler.cpp
+ *
+ * @brief  Implementation of the scheduler choosing the simulation iterations per frame.
+ */
+
+#include "core/open_gl.h"
+#include "IterationScheduler.h"
+#include "app/SimulationData.h"
+
+namespace viscom {
+
+    /** The weight of a new measurement in the moving average. */
+    constexpr double ITERATION_TIME_SMOOTHING = 0.1;
+
+    IterationScheduler::IterationScheduler()
+    {
+        glGenQueries(static_cast<GLsizei>(timerQueries_.size()), timerQueries_.data());
+        queryIterations_.fill(0);
+    }
+
+    IterationScheduler::~IterationScheduler()
+    {
+        glDeleteQueries(static_cast<GLsizei>(timerQueries_.size()), timerQueries_.data());
+    }
+
+    void IterationScheduler::CollectGPUMeasurements()
+    {
+        for (std::size_t i = 0; i < timerQueries_.size(); ++i) {
+            if (queryIterations_[i] == 0) continue;
+
+            GLint available = GL_FALSE;
+            glGetQueryObjectiv(timerQueries_[i], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available == GL_FALSE) continue;
+
+            GLuint64 elapsedNanoseconds = 0;
+            glGetQueryObjectui64v(timerQueries_[i], GL_QUERY_RESULT, &elapsedNanoseconds);
+            AddMeasurement(queryIterations_[i], static_cast<double>(elapsedNanoseconds) * 1e-9);
+            queryIterations_[i] = 0;
+        }
+    }
+
+    void IterationScheduler::BeginGPUMeasurement()
+    {
+        // a query still in flight after NUM_TIMER_QUERIES frames is dropped.
+        queryIterations_[nextQuery_] = 0;
+        glBeginQuery(GL_TIME_ELAPSED, timerQueries_[nextQuery_]);
+    }
+
+    void IterationScheduler::EndGPUMeasurement(std::uint64_t iterations)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        queryIterations_[nextQuery_] = iterations;
+        nextQuery_ = (nextQuery_ + 1) % timerQueries_.size();
+    }
+
+    void IterationScheduler::BeginCPUMeasurement()
+    {
+        cpuMeasurementStart_ = std::chrono::high_resolution_clock::now();
+    }
+
+    void IterationScheduler::EndCPUMeasurement(std::uint64_t iterations)
+    {
+        const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - cpuMeasurementStart_;
+        AddMeasurement(iterations, elapsed.count());
+    }
+
+    std::uint64_t IterationScheduler::GetAffordableIterations(const SimulationData& simData) const
+    {
+        if (!simData.adaptiveIterations_) return simData.fixedFrameIterations_;
+        // nothing measured yet: start with the fixed rate.
+        if (iterationTime_ <= 0.0) return glm::clamp(simData.fixedFrameIterations_, simData.minFrameIterations_, simData.maxFrameIterations_);
+
+        const auto iterations = static_cast<std::uint64_t>(static_cast<double>(simData.simulationTimeBudget_) * 1e-3 / iterationTime_);
+        return glm::clamp(iterations, simData.minFrameIterations_, simData.maxFrameIterations_);
+    }
+
+    void IterationScheduler::AddMeasurement(std::uint64_t iterations, double seconds)
+    {
+        if (iterations == 0) return;
+        const auto time = seconds / static_cast<double>(iterations);
+        if (iterationTime_ <= 0.0) iterationTime_ = time;
+        else iterationTime_ += ITERATION_TIME_SMOOTHING * (time - iterationTime_);
+    }
+}
@@ -0,0 +1,108 @@
+/**
+ * @file   IterationScheduler.h
+ *
+ * @brief  Declaration of the scheduler choosing the simulation iterations per frame.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "app/SimulationDomain.h"
+#include "app/FrameProfiler.h"
+#include <array>
+#include <chrono>
+
+namespace viscom {
+
+    struct SimulationData;
+
+    /** The ids of the packages sent between the nodes. */
+    enum class ClusterPackage : std::uint16_t {
+        /** WorkerSchedulingStatus sent by each worker every frame. */
+        WorkerStatus = 1,
+        /** StateSnapshotRequest sent by a worker whose state diverged from the coordinator. */
+        SnapshotRequest = 2,
+        /** A part of a state snapshot sent by the coordinator (see StateSnapshotChunk). */
+        SnapshotChunk = 3,
+        /** Cells of a tile sent to a neighbouring node with domain decomposition (see DomainHaloHeader). */
+        DomainHalo = 4
+    };
+
+    /** The scheduling and consistency status a worker reports to the coordinator. */
+    struct WorkerSchedulingStatus {
+        /** The iterations the worker has simulated. */
+        std::uint64_t localIterationCount_ = 0;
+        /** The global iteration count the worker has seen. */
+        std::uint64_t globalIterationCount_ = 0;
+        /** The iterations per frame the worker can do within its budget. */
+        std::uint64_t affordableIterations_ = 0;
+        /** The number of state hashes that did not match the coordinator. */
+        std::uint64_t stateHashMismatches_ = 0;
+        /** The number of state snapshots received. */
+        std::uint64_t receivedSnapshots_ = 0;
+        /** The measured time of a single iteration in milliseconds. */
+        float iterationTime_ = 0.0f;
+        /** The time decoding the last synchronization payload took in microseconds. */
+        float syncDecodeTime_ = 0.0f;
+        /** The iteration and the change per iteration of the newest convergence measurement (see ConvergenceMonitor.h). */
+        std::uint64_t stateChangeIteration_ = 0;
+        float stateChange_ = 0.0f;
+        /** The iteration, time step and error of the newest step error estimate (see StepErrorEstimator.h). */
+        std::uint64_t stepErrorIteration_ = 0;
+        float stepErrorTimestep_ = 0.0f;
+        float stepError_ = 0.0f;
+        /** The tile of the grid the worker simulates with domain decomposition. */
+        GridRect domainTile_;
+        /** The average CPU and GPU time of each ProfilePhase per frame in milliseconds (see FrameProfiler.h). */
+        std::array<float, PROFILE_PHASE_COUNT> phaseCPUTimes_{};
+        std::array<float, PROFILE_PHASE_COUNT> phaseGPUTimes_{};
+    };
+
+    /**
+     *  Measures the time of the simulation iterations (GL timer queries for GPU backends, the CPU clock otherwise)
+     *  and derives how many iterations fit into the simulation time budget of a frame.
+     */
+    class IterationScheduler
+    {
+    public:
+        IterationScheduler();
+        IterationScheduler(const IterationScheduler&) = delete;
+        IterationScheduler& operator=(const IterationScheduler&) = delete;
+        ~IterationScheduler();
+
+        /** Reads the results of finished timer queries (does not wait for the GPU). */
+        void CollectGPUMeasurements();
+        /** Starts measuring iterations run on the GPU. */
+        void BeginGPUMeasurement();
+        /** Ends measuring the given number of iterations run on the GPU. */
+        void EndGPUMeasurement(std::uint64_t iterations);
+        /** Starts measuring iterations run on the CPU. */
+        void BeginCPUMeasurement();
+        /** Ends measuring the given number of iterations run on the CPU. */
+        void EndCPUMeasurement(std::uint64_t iterations);
+
+        /** Returns the number of iterations fitting into the budget, clamped to the limits in simData. */
+        std::uint64_t GetAffordableIterations(const SimulationData& simData) const;
+        /** Returns the measured time of a single iteration in milliseconds (0 if nothing was measured yet). */
+        float GetIterationTime() const { return static_cast<float>(iterationTime_ * 1000.0); }
+
+    private:
+        /** Adds a measurement to the running average. */
+        void AddMeasurement(std::uint64_t iterations, double seconds);
+
+        /** The number of timer queries in flight (the results are read a few frames later). */
+        static constexpr std::size_t NUM_TIMER_QUERIES = 4;
+
+        /** The timer queries. */
+        std::array<GLuint, NUM_TIMER_QUERIES> timerQueries_;
+        /** The iterations measured by each query (0 if the query is not in flight). */
+        std::array<std::uint64_t, NUM_TIMER_QUERIES> queryIterations_;
+        /** The query used for the next measurement. */
+        std::size_t nextQuery_ = 0;
+        /** The start of the current CPU measurement. */
+        std::chrono::high_resolution_clock::time_point cpuMeasurementStart_;
+
+        /** Exponential moving average of the time of a single iteration in seconds. */
+        double iterationTime_ = 0.0;
+    };
+}
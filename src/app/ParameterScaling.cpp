@@ -0,0 +1,21 @@
+/**
+ * @file   ParameterScaling.cpp
+ *
+ * @brief  Implementation of the scaling of the simulation parameters to the grid size.
+ */
+
+#include "ParameterScaling.h"
+
+namespace viscom {
+
+    SimulationParameters ScaleParametersToGrid(const SimulationParameters& parameters, float gridScale, unsigned int gridHeight)
+    {
+        auto result = parameters;
+        const auto diffusionScale = gridScale * gridScale;
+        result.diffusion_rate_a_ *= diffusionScale;
+        result.diffusion_rate_b_ *= diffusionScale;
+        result.dt_ /= glm::max(diffusionScale, 1.0f);
+        result.seed_point_radius_ = glm::max(result.seed_point_radius_, MIN_SEED_POINT_RADIUS_CELLS / static_cast<float>(glm::max(gridHeight, 1u)));
+        return result;
+    }
+}
@@ -0,0 +1,24 @@
+/**
+ * @file   ParameterScaling.h
+ *
+ * @brief  Declaration of the scaling of the simulation parameters to the grid size.
+ */
+
+#pragma once
+
+#include "app/SimulationData.h"
+
+namespace viscom {
+
+    /** The minimum seed point radius in grid cells, so seeds still start a pattern on coarse grids. */
+    constexpr float MIN_SEED_POINT_RADIUS_CELLS = 2.0f;
+
+    /**
+     *  Scales parameters tuned for SIMULATION_SIZE_Y rows to a grid gridScale times as fine with gridHeight rows:
+     *  the diffusion rates grow with gridScale^2, so the pattern keeps its size relative to the grid. The explicit
+     *  step is only stable for the diffusion per step of the tuned parameters, so finer grids take smaller time
+     *  steps instead (and need more iterations for the same pattern). The seed radius is already relative to the
+     *  grid height and only kept above MIN_SEED_POINT_RADIUS_CELLS.
+     */
+    SimulationParameters ScaleParametersToGrid(const SimulationParameters& parameters, float gridScale, unsigned int gridHeight);
+}
@@ -0,0 +1,349 @@
+/**
+ * @file   ParameterSweep.cpp
+ *
+ * @brief  Implementation of the feed/kill parameter sweeps on the CPU.
+ */
+
+#include "ParameterSweep.h"
+#include "app/BatchRun.h"
+#include "app/Presets.h"
+#include "app/simulation/LaneSimulator.h"
+#include "app/simulation/ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <spdlog/spdlog.h>
+
+namespace viscom {
+
+    namespace {
+        constexpr double PI = 3.14159265358979323846;
+        /** The radius of the seed points of the initial state in cells. */
+        constexpr float SWEEP_SEED_RADIUS = 3.0f;
+        /** Patterns whose maximum B is below this decayed. */
+        constexpr float DECAYED_MAX_B = 0.02f;
+        /** Patterns with a standard deviation of B below this are uniform. */
+        constexpr float UNIFORM_DEVIATION = 0.02f;
+        /** The range of B below which there are no regions to find (a threshold inside the range would split noise). */
+        constexpr float PATTERN_MIN_RANGE = 1e-3f;
+        /**
+         *  Patterns whose B changed on average by more than this fraction of its standard deviation over the activity
+         *  window are still changing (stationary patterns that slowly straighten stay far below, waves and chaos far above).
+         */
+        constexpr float CHAOTIC_ACTIVITY = 0.2f;
+        /** Regions with a mean isoperimetric quotient above this are spots (a digital disk has about 0.6, a stripe across the grid less than 0.3). */
+        constexpr float SPOTS_COMPACTNESS = 0.4f;
+        /** The pixels per pair of classes.png. */
+        constexpr unsigned int CLASS_MAP_SCALE = 4;
+        /** The colors of the classes in the atlas and the class map. */
+        constexpr std::array<std::array<std::uint8_t, 3>, 5> PATTERN_CLASS_COLORS{ { { { 110, 110, 110 } }, { { 90, 150, 255 } },
+            { { 255, 190, 60 } }, { { 90, 220, 110 } }, { { 240, 80, 80 } } } };
+    }
+
+    PatternStatistics ComputePatternStatistics(const std::vector<float>& b, const std::vector<float>& previousB, const glm::uvec2& size)
+    {
+        PatternStatistics statistics;
+        const auto numCells = b.size();
+        if (numCells == 0) return statistics;
+
+        auto sum = 0.0, sumSqr = 0.0, change = 0.0;
+        auto minB = b[0];
+        for (std::size_t i = 0; i < numCells; ++i) {
+            sum += b[i];
+            sumSqr += static_cast<double>(b[i]) * b[i];
+            change += std::abs(b[i] - previousB[i]);
+            minB = std::min(minB, b[i]);
+            statistics.maxB_ = std::max(statistics.maxB_, b[i]);
+        }
+        const auto mean = sum / static_cast<double>(numCells);
+        statistics.meanB_ = static_cast<float>(mean);
+        statistics.deviationB_ = static_cast<float>(std::sqrt(std::max(sumSqr / static_cast<double>(numCells) - mean * mean, 0.0)));
+        statistics.activity_ = static_cast<float>(change / static_cast<double>(numCells));
+        if (statistics.maxB_ < DECAYED_MAX_B || statistics.deviationB_ < UNIFORM_DEVIATION || statistics.maxB_ - minB < PATTERN_MIN_RANGE) return statistics;
+
+        // the regions are those of the side of the threshold covering less of the grid (spots of B or holes in B).
+        const auto threshold = 0.5f * (minB + statistics.maxB_);
+        std::size_t covered = 0;
+        for (auto value : b) if (value > threshold) ++covered;
+        statistics.coverage_ = static_cast<float>(covered) / static_cast<float>(numCells);
+        const auto regionAbove = statistics.coverage_ <= 0.5f;
+        std::vector<std::uint8_t> mask(numCells);
+        for (std::size_t i = 0; i < numCells; ++i) mask[i] = (b[i] > threshold) == regionAbove ? 1 : 0;
+
+        // flood fill with 4 neighbors, the perimeter counts the edges to cells outside the region (not the grid border).
+        const auto width = static_cast<std::size_t>(size.x);
+        const auto height = static_cast<std::size_t>(size.y);
+        std::vector<std::size_t> stack;
+        auto weightedCompactness = 0.0;
+        std::size_t regionCells = 0;
+        for (std::size_t start = 0; start < numCells; ++start) {
+            if (mask[start] != 1) continue;
+
+            std::size_t area = 0, perimeter = 0;
+            mask[start] = 2;
+            stack.push_back(start);
+            while (!stack.empty()) {
+                const auto cell = stack.back();
+                stack.pop_back();
+                ++area;
+                const auto x = cell % width;
+                const auto y = cell / width;
+                const auto visit = [&mask, &stack, &perimeter](std::size_t neighbor) {
+                    if (mask[neighbor] == 0) ++perimeter;
+                    else if (mask[neighbor] == 1) {
+                        mask[neighbor] = 2;
+                        stack.push_back(neighbor);
+                    }
+                };
+                if (x > 0) visit(cell - 1);
+                if (x + 1 < width) visit(cell + 1);
+                if (y > 0) visit(cell - width);
+                if (y + 1 < height) visit(cell + width);
+            }
+
+            ++statistics.components_;
+            const auto quotient = perimeter == 0 ? 1.0 : 4.0 * PI * static_cast<double>(area) / (static_cast<double>(perimeter) * perimeter);
+            weightedCompactness += std::min(quotient, 1.0) * static_cast<double>(area);
+            regionCells += area;
+        }
+        if (regionCells > 0) statistics.compactness_ = static_cast<float>(weightedCompactness / static_cast<double>(regionCells));
+        return statistics;
+    }
+
+    PatternClass ClassifyPattern(const PatternStatistics& statistics)
+    {
+        if (statistics.maxB_ < DECAYED_MAX_B) return PatternClass::Decayed;
+        if (statistics.activity_ > CHAOTIC_ACTIVITY * std::max(statistics.deviationB_, UNIFORM_DEVIATION)) return PatternClass::Chaotic;
+        if (statistics.deviationB_ < UNIFORM_DEVIATION) return PatternClass::Uniform;
+        return statistics.compactness_ > SPOTS_COMPACTNESS ? PatternClass::Spots : PatternClass::Stripes;
+    }
+
+    ParameterSweep::ParameterSweep(const SweepSettings& settings, const SimulationData& simData, const SimulationParameters& parameters) :
+        settings_{ settings },
+        simData_{ simData },
+        parameters_{ parameters }
+    {
+        settings_.steps_ = glm::max(settings_.steps_, glm::uvec2(1));
+        settings_.gridSize_ = glm::max(settings_.gridSize_, glm::uvec2(1));
+        settings_.tileSize_ = std::max(settings_.tileSize_, 1u);
+        settings_.activityWindow_ = std::min(settings_.activityWindow_, settings_.iterations_);
+    }
+
+    std::vector<glm::vec2> ParameterSweep::CreateInitialState() const
+    {
+        const auto& size = settings_.gridSize_;
+        std::vector<glm::vec2> state(static_cast<std::size_t>(size.x) * size.y, glm::vec2(1.0f, 0.0f));
+
+        // fixed seed, so every sweep starts from the same state.
+        std::mt19937 random{ 42 };
+        std::uniform_real_distribution<float> position{ 0.15f, 0.85f };
+        for (std::size_t i = 0; i < settings_.numSeeds_; ++i) {
+            const glm::vec2 center{ position(random) * static_cast<float>(size.x), position(random) * static_cast<float>(size.y) };
+            for (std::size_t y = 0; y < size.y; ++y) {
+                for (std::size_t x = 0; x < size.x; ++x) {
+                    const auto dx = static_cast<float>(x) + 0.5f - center.x;
+                    const auto dy = static_cast<float>(y) + 0.5f - center.y;
+                    if (dx * dx + dy * dy < SWEEP_SEED_RADIUS * SWEEP_SEED_RADIUS) state[y * size.x + x].y = 1.0f;
+                }
+            }
+        }
+        return state;
+    }
+
+    bool ParameterSweep::Run()
+    {
+        // the outputs are only written after all simulations, so a bad output directory has to fail before them.
+        if (!PrepareOutputDirectory(settings_.outputDirectory_)) return false;
+
+        const auto numPairs = static_cast<std::size_t>(settings_.steps_.x) * settings_.steps_.y;
+        results_.assign(numPairs, SweepResult{});
+        tiles_.assign(numPairs, std::vector<float>{});
+        for (std::size_t f = 0; f < settings_.steps_.y; ++f) {
+            for (std::size_t k = 0; k < settings_.steps_.x; ++k) {
+                auto& result = results_[f * settings_.steps_.x + k];
+                const auto feedStep = settings_.steps_.y > 1 ? static_cast<float>(f) / static_cast<float>(settings_.steps_.y - 1) : 0.0f;
+                const auto killStep = settings_.steps_.x > 1 ? static_cast<float>(k) / static_cast<float>(settings_.steps_.x - 1) : 0.0f;
+                result.feedRate_ = glm::mix(settings_.feedRange_.x, settings_.feedRange_.y, feedStep);
+                result.killRate_ = glm::mix(settings_.killRange_.x, settings_.killRange_.y, killStep);
+            }
+        }
+
+        const auto initialState = CreateInitialState();
+        const auto numBatches = (numPairs + simulation::SWEEP_LANES - 1) / simulation::SWEEP_LANES;
+        simulation::ThreadPool threadPool{ settings_.numThreads_ };
+        spdlog::info("Sweeping {} feed/kill pairs on {}x{} grids for {} iterations: {} batches of {} lanes ({}) on {} threads.", numPairs,
+            settings_.gridSize_.x, settings_.gridSize_.y, settings_.iterations_, numBatches, simulation::SWEEP_LANES,
+            simulation::GetSIMDLevelName(simulation::DetectSIMDLevel()), threadPool.GetNumThreads());
+
+        // the batches are independent, each keeps its grids in the cache of one core for all iterations.
+        const auto start = std::chrono::steady_clock::now();
+        std::atomic<std::size_t> finishedBatches{ 0 };
+        const auto progressStep = std::max<std::size_t>(numBatches / 10, 1);
+        threadPool.ParallelFor(numBatches, [this, &initialState, &finishedBatches, progressStep, numBatches](std::size_t batch) {
+            RunBatch(batch, initialState);
+            const auto finished = ++finishedBatches;
+            if (finished % progressStep == 0) spdlog::info("Batch {} of {}.", finished, numBatches);
+        });
+        simulationTime_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        return WriteAtlas() && WriteResults() && WritePresets();
+    }
+
+    void ParameterSweep::RunBatch(std::size_t batch, const std::vector<glm::vec2>& initialState)
+    {
+        const auto& size = settings_.gridSize_;
+        simulation::LaneSimulator simulator{ size };
+        // the lanes past the last pair repeat it and are discarded.
+        std::array<std::size_t, simulation::SWEEP_LANES> pairs;
+        for (std::size_t lane = 0; lane < simulation::SWEEP_LANES; ++lane) {
+            pairs[lane] = std::min(batch * simulation::SWEEP_LANES + lane, results_.size() - 1);
+            const auto& result = results_[pairs[lane]];
+            simulator.SetParameters(lane, simulation::StencilParameters{ parameters_.diffusion_rate_a_, parameters_.diffusion_rate_b_,
+                result.feedRate_, result.killRate_, parameters_.dt_ });
+        }
+        simulator.SetState(initialState);
+
+        simulator.Step(settings_.iterations_ - settings_.activityWindow_);
+        std::vector<glm::vec2> state;
+        std::array<std::vector<float>, simulation::SWEEP_LANES> previousB;
+        for (std::size_t lane = 0; lane < simulation::SWEEP_LANES; ++lane) {
+            simulator.GetLaneState(lane, state);
+            previousB[lane].resize(state.size());
+            for (std::size_t i = 0; i < state.size(); ++i) previousB[lane][i] = state[i].y;
+        }
+        simulator.Step(settings_.activityWindow_);
+
+        std::vector<float> b;
+        const auto tileSize = static_cast<std::size_t>(settings_.tileSize_);
+        for (std::size_t lane = 0; lane < simulation::SWEEP_LANES; ++lane) {
+            if (batch * simulation::SWEEP_LANES + lane >= results_.size()) break;
+
+            simulator.GetLaneState(lane, state);
+            b.resize(state.size());
+            for (std::size_t i = 0; i < state.size(); ++i) b[i] = state[i].y;
+            auto& result = results_[pairs[lane]];
+            result.statistics_ = ComputePatternStatistics(b, previousB[lane], size);
+            result.class_ = ClassifyPattern(result.statistics_);
+
+            // the tile is the box filtered result (like SimpleGreyScaleRenderer), bottom row first.
+            auto& tile = tiles_[pairs[lane]];
+            tile.resize(tileSize * tileSize);
+            for (std::size_t ty = 0; ty < tileSize; ++ty) {
+                const auto yBegin = ty * size.y / tileSize;
+                const auto yEnd = std::max(yBegin + 1, (ty + 1) * size.y / tileSize);
+                for (std::size_t tx = 0; tx < tileSize; ++tx) {
+                    const auto xBegin = tx * size.x / tileSize;
+                    const auto xEnd = std::max(xBegin + 1, (tx + 1) * size.x / tileSize);
+                    auto sum = 0.0f;
+                    for (auto y = yBegin; y < yEnd; ++y) {
+                        for (auto x = xBegin; x < xEnd; ++x) sum += 1.0f - glm::clamp(state[y * size.x + x].x - state[y * size.x + x].y, 0.0f, 1.0f);
+                    }
+                    tile[ty * tileSize + tx] = sum / static_cast<float>((yEnd - yBegin) * (xEnd - xBegin));
+                }
+            }
+        }
+    }
+
+    bool ParameterSweep::WriteAtlas() const
+    {
+        // kill rates along x, feed rates upwards (images start with the top row).
+        const auto tileSize = static_cast<std::size_t>(settings_.tileSize_);
+        const glm::uvec2 atlasSize{ settings_.steps_.x * settings_.tileSize_, settings_.steps_.y * settings_.tileSize_ };
+        std::vector<std::uint8_t> atlas(static_cast<std::size_t>(atlasSize.x) * atlasSize.y * 3);
+        const glm::uvec2 classMapSize{ settings_.steps_.x * CLASS_MAP_SCALE, settings_.steps_.y * CLASS_MAP_SCALE };
+        std::vector<std::uint8_t> classMap(static_cast<std::size_t>(classMapSize.x) * classMapSize.y * 3);
+        for (std::size_t pair = 0; pair < results_.size(); ++pair) {
+            const auto k = pair % settings_.steps_.x;
+            const auto f = pair / settings_.steps_.x;
+            const auto& color = PATTERN_CLASS_COLORS[static_cast<std::size_t>(results_[pair].class_)];
+            for (std::size_t y = 0; y < tileSize; ++y) {
+                const auto atlasRow = (settings_.steps_.y - 1 - f) * tileSize + (tileSize - 1 - y);
+                for (std::size_t x = 0; x < tileSize; ++x) {
+                    const auto brightness = 0.2f + 0.8f * tiles_[pair][y * tileSize + x];
+                    const auto pixel = (atlasRow * atlasSize.x + k * tileSize + x) * 3;
+                    for (std::size_t c = 0; c < 3; ++c) atlas[pixel + c] = static_cast<std::uint8_t>(static_cast<float>(color[c]) * brightness + 0.5f);
+                }
+            }
+            for (std::size_t y = 0; y < CLASS_MAP_SCALE; ++y) {
+                const auto mapRow = (settings_.steps_.y - 1 - f) * CLASS_MAP_SCALE + y;
+                for (std::size_t x = 0; x < CLASS_MAP_SCALE; ++x) {
+                    const auto pixel = (mapRow * classMapSize.x + k * CLASS_MAP_SCALE + x) * 3;
+                    for (std::size_t c = 0; c < 3; ++c) classMap[pixel + c] = color[c];
+                }
+            }
+        }
+
+        const auto atlasFile = settings_.outputDirectory_ + "/atlas.png";
+        const auto classMapFile = settings_.outputDirectory_ + "/classes.png";
+        if (!WritePNG(atlasFile, atlas, atlasSize, 3) || !WritePNG(classMapFile, classMap, classMapSize, 3)) {
+            spdlog::error("Could not write the atlas {} or {}.", atlasFile, classMapFile);
+            return false;
+        }
+        return true;
+    }
+
+    bool ParameterSweep::WriteResults() const
+    {
+        const auto resultsFile = settings_.outputDirectory_ + "/results.csv";
+        std::ofstream ofs(resultsFile);
+        ofs << "feed_rate,kill_rate,class,mean_b,deviation_b,max_b,activity,coverage,components,compactness\n";
+        for (const auto& result : results_) {
+            const auto& statistics = result.statistics_;
+            ofs << result.feedRate_ << "," << result.killRate_ << "," << PATTERN_CLASS_NAMES[static_cast<std::size_t>(result.class_)] << ","
+                << statistics.meanB_ << "," << statistics.deviationB_ << "," << statistics.maxB_ << "," << statistics.activity_ << ","
+                << statistics.coverage_ << "," << statistics.components_ << "," << statistics.compactness_ << "\n";
+        }
+        if (!ofs.good()) {
+            spdlog::error("Could not write the results {}.", resultsFile);
+            return false;
+        }
+        return true;
+    }
+
+    bool ParameterSweep::WritePresets() const
+    {
+        const auto presetListFile = settings_.outputDirectory_ + "/presetList.txt";
+        std::ofstream presetList(presetListFile);
+        const auto isClass = [this](std::size_t k, std::size_t f, PatternClass patternClass) {
+            return k < settings_.steps_.x && f < settings_.steps_.y && results_[f * settings_.steps_.x + k].class_ == patternClass;
+        };
+
+        for (auto patternClass : { PatternClass::Spots, PatternClass::Stripes, PatternClass::Chaotic }) {
+            // pairs whose neighbors have the same class lie inside a region, so small parameter changes keep the pattern.
+            std::vector<std::size_t> candidates, interior;
+            for (std::size_t pair = 0; pair < results_.size(); ++pair) {
+                if (results_[pair].class_ != patternClass) continue;
+                candidates.push_back(pair);
+                const auto k = pair % settings_.steps_.x;
+                const auto f = pair / settings_.steps_.x;
+                if (isClass(k - 1, f, patternClass) && isClass(k + 1, f, patternClass) && isClass(k, f - 1, patternClass) && isClass(k, f + 1, patternClass)) {
+                    interior.push_back(pair);
+                }
+            }
+            if (!interior.empty()) candidates = interior;
+
+            const auto numPresets = std::min(settings_.presetsPerClass_, candidates.size());
+            for (std::size_t i = 0; i < numPresets; ++i) {
+                const auto& result = results_[candidates[(2 * i + 1) * candidates.size() / (2 * numPresets)]];
+                auto parameters = parameters_;
+                parameters.feed_rate_ = result.feedRate_;
+                parameters.kill_rate_ = result.killRate_;
+
+                const auto name = std::string("Sweep") + PATTERN_CLASS_NAMES[static_cast<std::size_t>(patternClass)] + std::to_string(i + 1);
+                const auto presetFile = settings_.outputDirectory_ + "/" + name + ".txt";
+                if (!WritePreset(presetFile, simData_, parameters)) {
+                    spdlog::error("Could not write the preset {}.", presetFile);
+                    return false;
+                }
+                presetList << name << " " << name << ".txt\n";
+            }
+        }
+        if (!presetList.good()) {
+            spdlog::error("Could not write the preset list {}.", presetListFile);
+            return false;
+        }
+        return true;
+    }
+}
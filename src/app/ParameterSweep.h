@@ -0,0 +1,130 @@
+/**
+ * @file   ParameterSweep.h
+ *
+ * @brief  Declaration of the feed/kill parameter sweeps on the CPU.
+ */
+
+#pragma once
+
+#include "app/SimulationData.h"
+#include <array>
+#include <string>
+#include <vector>
+
+namespace viscom {
+
+    /** The settings of a parameter sweep (filled from the command line of the sweep executable). */
+    struct SweepSettings {
+        /** The directory the atlas, the results and the presets are written to. */
+        std::string outputDirectory_ = ".";
+        /** The range of the feed and kill rates (both ends included). */
+        glm::vec2 feedRange_ = glm::vec2{ 0.01f, 0.1f };
+        glm::vec2 killRange_ = glm::vec2{ 0.045f, 0.07f };
+        /** The number of kill (x) and feed (y) rates. */
+        glm::uvec2 steps_ = glm::uvec2{ 64 };
+        /** The grid size of each simulation. */
+        glm::uvec2 gridSize_ = glm::uvec2{ 64 };
+        /** The number of iterations each simulation runs. */
+        std::uint64_t iterations_ = 10000;
+        /** The state is compared to the one this many iterations before the end to measure the activity. */
+        std::uint64_t activityWindow_ = 500;
+        /** The number of seed points of the initial state (the same for all simulations). */
+        std::size_t numSeeds_ = 6;
+        /** The size of the atlas tile of each simulation in pixels (the grids are downsampled). */
+        unsigned int tileSize_ = 32;
+        /** The number of presets written for each pattern class. */
+        std::size_t presetsPerClass_ = 3;
+        /** The number of threads (0 for all cores). */
+        std::size_t numThreads_ = 0;
+    };
+
+    /** The kinds of patterns a simulation of a sweep ends in. */
+    enum class PatternClass : int {
+        /** B died out everywhere. */
+        Decayed = 0,
+        /** B is (nearly) the same everywhere. */
+        Uniform = 1,
+        /** Stationary compact blobs (of B, or holes in B if it covers most of the grid). */
+        Spots = 2,
+        /** Stationary elongated structures (stripes, labyrinths). */
+        Stripes = 3,
+        /** Still changing at the end of the run (waves, spot replication, chaos). */
+        Chaotic = 4
+    };
+
+    /** The names of the pattern classes. */
+    constexpr std::array<const char*, 5> PATTERN_CLASS_NAMES{ { "Decayed", "Uniform", "Spots", "Stripes", "Chaotic" } };
+
+    /** The statistics of the final B of a simulation the class is chosen from (the region statistics are 0 for decayed and uniform B). */
+    struct PatternStatistics {
+        /** The mean, standard deviation and maximum of B. */
+        float meanB_ = 0.0f;
+        float deviationB_ = 0.0f;
+        float maxB_ = 0.0f;
+        /** The mean absolute change of B over the activity window. */
+        float activity_ = 0.0f;
+        /** The fraction of the cells above the threshold (halfway between the minimum and maximum of B). */
+        float coverage_ = 0.0f;
+        /** The number of connected regions of the minority side of the threshold. */
+        std::size_t components_ = 0;
+        /** The mean isoperimetric quotient (4 pi area / perimeter^2) of those regions, high for compact ones. */
+        float compactness_ = 0.0f;
+    };
+
+    /** Computes the statistics of a final state from B and B activityWindow iterations before (both bottom row first). */
+    PatternStatistics ComputePatternStatistics(const std::vector<float>& b, const std::vector<float>& previousB, const glm::uvec2& size);
+    /** Chooses the class of a pattern from its statistics. */
+    PatternClass ClassifyPattern(const PatternStatistics& statistics);
+
+    /** The result of a single simulation of a sweep. */
+    struct SweepResult {
+        float feedRate_ = 0.0f;
+        float killRate_ = 0.0f;
+        PatternClass class_ = PatternClass::Decayed;
+        PatternStatistics statistics_;
+    };
+
+    /**
+     *  Simulates a grid of feed/kill rate pairs on the CPU and classifies the pattern each one ends in. The pairs
+     *  run as independent small grids in the SIMD lanes of a LaneSimulator (SWEEP_LANES pairs per vector) and the
+     *  batches are spread over all cores. All simulations start from the same seeded state and use the other
+     *  parameters of the base preset without grid scaling (the sizes of the features are in cells).
+     *
+     *  The outputs are atlas.png (the final result of every pair, kill rate along x and feed rate upwards, tinted
+     *  by the class), classes.png (one pixel per pair), results.csv (the statistics of every pair) and for each
+     *  class of patterns presets of pairs inside regions of that class with a preset list to append to the one of
+     *  the resources.
+     */
+    class ParameterSweep
+    {
+    public:
+        ParameterSweep(const SweepSettings& settings, const SimulationData& simData, const SimulationParameters& parameters);
+
+        /** Runs all simulations and writes the outputs, returns false if the output directory or an output could not be written. */
+        bool Run();
+        /** Returns the results ordered by feed rate, then kill rate. */
+        const std::vector<SweepResult>& GetResults() const { return results_; }
+        /** Returns the time spent in the simulations in seconds. */
+        double GetSimulationTime() const { return simulationTime_; }
+
+    private:
+        /** Runs the simulations of a batch and classifies them. */
+        void RunBatch(std::size_t batch, const std::vector<glm::vec2>& initialState);
+        /** Creates the initial state (seed points at fixed random positions). */
+        std::vector<glm::vec2> CreateInitialState() const;
+        bool WriteAtlas() const;
+        bool WriteResults() const;
+        bool WritePresets() const;
+
+        /** The settings of the sweep. */
+        SweepSettings settings_;
+        /** The simulation data and parameters the presets are based on. */
+        SimulationData simData_;
+        SimulationParameters parameters_;
+        /** The results and the final atlas tile of each pair (tileSize_ squared values of the result). */
+        std::vector<SweepResult> results_;
+        std::vector<std::vector<float>> tiles_;
+        /** The time spent in the simulations in seconds. */
+        double simulationTime_ = 0.0;
+    };
+}
@@ -0,0 +1,72 @@
+/**
+ * @file   Presets.cpp
+ *
+ * @brief  Implementation of the functions reading and writing the simulation presets.
+ */
+
+#include "Presets.h"
+#include <fstream>
+
+namespace viscom {
+
+    std::vector<std::pair<std::string, std::string>> ReadPresetList(const std::string& presetListFile)
+    {
+        std::vector<std::pair<std::string, std::string>> result;
+        std::ifstream ifs(presetListFile);
+        std::string str;
+        while (ifs >> str && ifs.good()) {
+            std::string presetName = str;
+            std::string presetFile;
+            ifs >> presetFile;
+            result.emplace_back(presetName, presetFile);
+        }
+        return result;
+    }
+
+    bool ReadPreset(const std::string& presetFile, SimulationData& simData, SimulationParameters& parameters)
+    {
+        std::ifstream ifs(presetFile);
+        if (!ifs.is_open()) return false;
+
+        std::string str;
+        while (ifs >> str && ifs.good()) {
+            if (str == "simulationDrawDistance=") ifs >> simData.simulationDrawDistance_;
+            else if (str == "simulationHeight=") ifs >> simData.simulationHeight_;
+            else if (str == "eta=") ifs >> simData.eta_;
+            else if (str == "sigma_a.r=") ifs >> simData.sigma_a_.r;
+            else if (str == "sigma_a.g=") ifs >> simData.sigma_a_.g;
+            else if (str == "sigma_a.b=") ifs >> simData.sigma_a_.b;
+            else if (str == "diffusion_rate_a=") ifs >> parameters.diffusion_rate_a_;
+            else if (str == "diffusion_rate_b=") ifs >> parameters.diffusion_rate_b_;
+            else if (str == "feed_rate=") ifs >> parameters.feed_rate_;
+            else if (str == "kill_rate=") ifs >> parameters.kill_rate_;
+            else if (str == "dt=") ifs >> parameters.dt_;
+            else if (str == "seed_point_radius=") ifs >> parameters.seed_point_radius_;
+            else if (str == "use_manhattan_distance=") ifs >> parameters.use_manhattan_distance_;
+            else if (str == "currentRenderer=") ifs >> simData.currentRenderer_;
+        }
+        return true;
+    }
+
+    bool WritePreset(const std::string& presetFile, const SimulationData& simData, const SimulationParameters& parameters)
+    {
+        std::ofstream ofs(presetFile);
+        if (!ofs.is_open()) return false;
+
+        ofs << "simulationDrawDistance= " << simData.simulationDrawDistance_ << "\n"
+            << "simulationHeight= " << simData.simulationHeight_ << "\n"
+            << "eta= " << simData.eta_ << "\n"
+            << "sigma_a.r= " << simData.sigma_a_.r << "\n"
+            << "sigma_a.g= " << simData.sigma_a_.g << "\n"
+            << "sigma_a.b= " << simData.sigma_a_.b << "\n"
+            << "diffusion_rate_a= " << parameters.diffusion_rate_a_ << "\n"
+            << "diffusion_rate_b= " << parameters.diffusion_rate_b_ << "\n"
+            << "feed_rate= " << parameters.feed_rate_ << "\n"
+            << "kill_rate= " << parameters.kill_rate_ << "\n"
+            << "dt= " << parameters.dt_ << "\n"
+            << "seed_point_radius= " << parameters.seed_point_radius_ << "\n"
+            << "use_manhattan_distance= " << parameters.use_manhattan_distance_ << "\n"
+            << "currentRenderer= " << simData.currentRenderer_ << "\n";
+        return ofs.good();
+    }
+}
@@ -0,0 +1,22 @@
+/**
+ * @file   Presets.h
+ *
+ * @brief  Declaration of the functions reading and writing the simulation presets.
+ */
+
+#pragma once
+
+#include "app/SimulationData.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace viscom {
+
+    /** Reads the (name, file) pairs of a preset list (the files are relative to the list). */
+    std::vector<std::pair<std::string, std::string>> ReadPresetList(const std::string& presetListFile);
+    /** Reads a preset into the simulation data and parameters, values missing in the file are kept (false if it cannot be opened). */
+    bool ReadPreset(const std::string& presetFile, SimulationData& simData, SimulationParameters& parameters);
+    /** Writes a preset in the format read by ReadPreset (false if it cannot be written). */
+    bool WritePreset(const std::string& presetFile, const SimulationData& simData, const SimulationParameters& parameters);
+}
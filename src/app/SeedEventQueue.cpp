@@ -0,0 +1,167 @@
+/**
+ * @file   SeedEventQueue.cpp
+ *
+ * @brief  Implementation of the queue holding the seed events of upcoming iterations.
+ */
+
+#include "SeedEventQueue.h"
+#include <spdlog/spdlog.h>
+
+namespace viscom {
+
+    namespace {
+        std::size_t NextPowerOfTwo(std::size_t value)
+        {
+            std::size_t result = 1;
+            while (result < value) result <<= 1;
+            return result;
+        }
+    }
+
+    SeedEventQueue::SeedEventQueue(std::size_t eventCapacity, std::size_t iterationCapacity) :
+        events_(NextPowerOfTwo(glm::max(eventCapacity, std::size_t{ 1 }))),
+        iterations_(NextPowerOfTwo(glm::max(iterationCapacity, std::size_t{ 1 })), IterationSlot{ NO_ITERATION, 0, 0 })
+    {
+    }
+
+    const SeedEvent& SeedEventQueue::Push(std::uint64_t iteration, const glm::vec2& position)
+    {
+        SeedEvent event;
+        event.sequence_ = ++lastSequence_;
+        event.iteration_ = iteration;
+        event.position_ = glm::vec2(DequantizeSeedCoordinate(QuantizeSeedCoordinate(position.x)), DequantizeSeedCoordinate(QuantizeSeedCoordinate(position.y)));
+        Append(event);
+        return events_[(head_ + size_ - 1) & (events_.size() - 1)];
+    }
+
+    bool SeedEventQueue::Insert(const SeedEvent& event)
+    {
+        if (event.sequence_ <= lastSequence_) return false;
+        lastSequence_ = event.sequence_;
+        Append(event);
+        return true;
+    }
+
+    void SeedEventQueue::Append(const SeedEvent& event)
+    {
+        if (size_ == events_.size()) GrowEvents();
+
+        const auto index = head_ + size_;
+        auto& storedEvent = events_[index & (events_.size() - 1)];
+        storedEvent = event;
+        // keeps the events of an iteration contiguous (the coordinator only adds seeds for future iterations).
+        storedEvent.iteration_ = glm::max(event.iteration_, lastIteration_);
+        lastIteration_ = storedEvent.iteration_;
+        ++size_;
+
+        const auto iteration = storedEvent.iteration_;
+        auto* slot = &iterations_[iteration & (iterations_.size() - 1)];
+        if (slot->iteration_ == iteration) {
+            ++slot->numEvents_;
+            return;
+        }
+        if (slot->iteration_ != NO_ITERATION) {
+            GrowIterations();
+            slot = &iterations_[iteration & (iterations_.size() - 1)];
+        }
+        *slot = IterationSlot{ iteration, index, 1 };
+    }
+
+    void SeedEventQueue::Retire(std::uint64_t iteration)
+    {
+        while (size_ > 0) {
+            const auto frontIteration = GetEvent(head_).iteration_;
+            if (frontIteration >= iteration) break;
+
+            auto& slot = iterations_[frontIteration & (iterations_.size() - 1)];
+            head_ += slot.numEvents_;
+            size_ -= slot.numEvents_;
+            slot.iteration_ = NO_ITERATION;
+        }
+    }
+
+    void SeedEventQueue::Clear()
+    {
+        head_ += size_;
+        size_ = 0;
+        for (auto& slot : iterations_) slot.iteration_ = NO_ITERATION;
+        lastIteration_ = 0;
+    }
+
+    void SeedEventQueue::Rewind(std::uint64_t iteration)
+    {
+        // pending events keep their order, so new ones still go behind the last of them.
+        lastIteration_ = size_ > 0 ? GetEvent(head_ + size_ - 1).iteration_ : iteration;
+    }
+
+    const SeedEventQueue::IterationSlot* SeedEventQueue::FindSlot(std::uint64_t iteration) const
+    {
+        const auto& slot = iterations_[iteration & (iterations_.size() - 1)];
+        return slot.iteration_ == iteration ? &slot : nullptr;
+    }
+
+    bool SeedEventQueue::HasSeedPoints(std::uint64_t iteration) const
+    {
+        return FindSlot(iteration) != nullptr;
+    }
+
+    void SeedEventQueue::GetSeedPoints(std::uint64_t iteration, std::vector<glm::vec2>& seedPoints) const
+    {
+        seedPoints.clear();
+        const auto slot = FindSlot(iteration);
+        if (slot == nullptr) return;
+        for (std::size_t i = 0; i < slot->numEvents_; ++i) seedPoints.push_back(GetEvent(slot->firstEvent_ + i).position_);
+    }
+
+    void SeedEventQueue::GetEvents(std::vector<SeedEvent>& events) const
+    {
+        events.resize(size_);
+        for (std::size_t i = 0; i < size_; ++i) events[i] = GetEvent(head_ + i);
+    }
+
+    void SeedEventQueue::GetEventsAfter(std::uint64_t sequence, std::vector<SeedEvent>& events) const
+    {
+        // the sequence numbers increase along the queue, so the new events are found from the back.
+        std::size_t numEvents = 0;
+        while (numEvents < size_ && GetEvent(head_ + size_ - numEvents - 1).sequence_ > sequence) ++numEvents;
+        events.resize(numEvents);
+        for (std::size_t i = 0; i < numEvents; ++i) events[i] = GetEvent(head_ + size_ - numEvents + i);
+    }
+
+    void SeedEventQueue::GrowEvents()
+    {
+        std::vector<SeedEvent> events(2 * events_.size());
+        for (std::size_t i = 0; i < size_; ++i) events[i] = GetEvent(head_ + i);
+        for (auto& slot : iterations_) {
+            if (slot.iteration_ != NO_ITERATION) slot.firstEvent_ -= head_;
+        }
+        events_.swap(events);
+        head_ = 0;
+        spdlog::warn("Seed event queue grown to {} events.", events_.size());
+    }
+
+    void SeedEventQueue::GrowIterations()
+    {
+        for (auto capacity = 2 * iterations_.size();; capacity *= 2) {
+            std::vector<IterationSlot> slots(capacity, IterationSlot{ NO_ITERATION, 0, 0 });
+            auto collision = false;
+            for (std::size_t i = 0; i < size_ && !collision;) {
+                const auto index = head_ + i;
+                const auto iteration = GetEvent(index).iteration_;
+                auto& slot = slots[iteration & (capacity - 1)];
+                if (slot.iteration_ != NO_ITERATION) collision = true;
+                else {
+                    std::size_t numEvents = 1;
+                    while (i + numEvents < size_ && GetEvent(index + numEvents).iteration_ == iteration) ++numEvents;
+                    slot = IterationSlot{ iteration, index, numEvents };
+                    i += numEvents;
+                }
+            }
+            if (collision) continue;
+
+            iterations_.swap(slots);
+            spdlog::warn("Seed event queue grown to {} iterations.", iterations_.size());
+            return;
+        }
+    }
+}
@@ -0,0 +1,118 @@
+/**
+ * @file   SeedEventQueue.h
+ *
+ * @brief  Declaration of the queue holding the seed events of upcoming iterations.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace viscom {
+
+    /** Seed positions are quantized to 16 bit per axis in [SEED_POSITION_MIN, SEED_POSITION_MIN + SEED_POSITION_RANGE]. */
+    constexpr float SEED_POSITION_MIN = -0.5f;
+    constexpr float SEED_POSITION_RANGE = 2.0f;
+
+    /** Quantizes a seed coordinate (texture coordinates, clamped to the quantization range). */
+    inline std::uint16_t QuantizeSeedCoordinate(float coordinate)
+    {
+        const auto normalized = glm::clamp((coordinate - SEED_POSITION_MIN) / SEED_POSITION_RANGE, 0.0f, 1.0f);
+        return static_cast<std::uint16_t>(std::lround(normalized * 65535.0f));
+    }
+
+    inline float DequantizeSeedCoordinate(std::uint16_t quantized)
+    {
+        return SEED_POSITION_MIN + SEED_POSITION_RANGE * (static_cast<float>(quantized) / 65535.0f);
+    }
+
+    /** A seed point placed at a given iteration (synchronized to the workers, has to stay trivially copyable). */
+    struct SeedEvent {
+        /** The sequence number assigned by the coordinator (starts at 1, increases with every event). */
+        std::uint64_t sequence_ = 0;
+        /** The iteration before which the seed point is applied. */
+        std::uint64_t iteration_ = 0;
+        /** The position of the seed point in texture coordinates (quantized, see QuantizeSeedCoordinate). */
+        glm::vec2 position_ = glm::vec2{ 0.0f };
+    };
+
+    /**
+     *  Holds the pending seed events ordered by iteration in a preallocated ring buffer. Events of one iteration are
+     *  stored contiguously and found through a second ring indexed by the iteration number, so appending, looking up
+     *  the seeds of an iteration and retiring old events do not scan the queue. Events are deduplicated by their
+     *  sequence number, so the same events can be received several times.
+     */
+    class SeedEventQueue
+    {
+    public:
+        /** Creates a queue with room for the given number of events and distinct pending iterations (powers of two). */
+        explicit SeedEventQueue(std::size_t eventCapacity = 4096, std::size_t iterationCapacity = 1024);
+
+        /**
+         *  Adds a new seed point, assigns the next sequence number and returns the event (coordinator side). The
+         *  position is quantized as for sending it, so the coordinator simulates the same seed as the workers.
+         */
+        const SeedEvent& Push(std::uint64_t iteration, const glm::vec2& position);
+        /** Adds an event received from the coordinator, returns false if it is already known. */
+        bool Insert(const SeedEvent& event);
+        /** Removes all events of iterations before the given one. */
+        void Retire(std::uint64_t iteration);
+        /** Removes all events (the sequence numbers stay known). */
+        void Clear();
+        /** Lets new events be placed from the given iteration on again after the iteration count was rewound. */
+        void Rewind(std::uint64_t iteration);
+
+        /** Returns if there are seed points for the given iteration. */
+        bool HasSeedPoints(std::uint64_t iteration) const;
+        /** Replaces seedPoints with the seed points of the given iteration. */
+        void GetSeedPoints(std::uint64_t iteration, std::vector<glm::vec2>& seedPoints) const;
+        /** Replaces events with all pending events in order. */
+        void GetEvents(std::vector<SeedEvent>& events) const;
+        /** Replaces events with the pending events with a sequence number after the given one (in order). */
+        void GetEventsAfter(std::uint64_t sequence, std::vector<SeedEvent>& events) const;
+
+        std::size_t GetSize() const { return size_; }
+        bool IsEmpty() const { return size_ == 0; }
+        /** Returns the last sequence number added to the queue. */
+        std::uint64_t GetLastSequence() const { return lastSequence_; }
+
+    private:
+        /** The events of one iteration. */
+        struct IterationSlot {
+            /** The iteration (NO_ITERATION if the slot is unused). */
+            std::uint64_t iteration_;
+            /** The index of the first event in the event ring (not wrapped). */
+            std::size_t firstEvent_;
+            /** The number of events. */
+            std::size_t numEvents_;
+        };
+
+        static constexpr std::uint64_t NO_ITERATION = std::numeric_limits<std::uint64_t>::max();
+
+        /** Stores an event with a known sequence number behind the last one. */
+        void Append(const SeedEvent& event);
+        /** Returns the slot of a pending iteration or nullptr. */
+        const IterationSlot* FindSlot(std::uint64_t iteration) const;
+        const SeedEvent& GetEvent(std::size_t index) const { return events_[index & (events_.size() - 1)]; }
+        /** Doubles the event ring (only if the preallocated capacity is exceeded). */
+        void GrowEvents();
+        /** Doubles the iteration ring until all pending iterations map to distinct slots. */
+        void GrowIterations();
+
+        /** The ring buffer of events. */
+        std::vector<SeedEvent> events_;
+        /** The index of the oldest event (not wrapped). */
+        std::size_t head_ = 0;
+        /** The number of pending events. */
+        std::size_t size_ = 0;
+        /** The ring of iteration slots indexed by the iteration number. */
+        std::vector<IterationSlot> iterations_;
+        /** The last sequence number added. */
+        std::uint64_t lastSequence_ = 0;
+        /** The iteration of the last event added (later events are never placed before it). */
+        std::uint64_t lastIteration_ = 0;
+    };
+}
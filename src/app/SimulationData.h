@@ -0,0 +1,161 @@
+/**
+ * @file   SimulationData.h
+ *
+ * @brief  Declaration of the simulation data shared between all nodes and simulation backends.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "app/TimestepSchedule.h"
+
+namespace viscom {
+
+    /** The backends that can advance the reaction diffusion simulation. */
+    enum class SimulationBackend : int {
+        /** Fullscreen quad drawn with reactionDiffusionSimulation.frag. */
+        FragmentShader = 0,
+        /** Compute shader advancing several iterations per dispatch in shared memory tiles. */
+        ComputeShader = 1,
+        /** Multithreaded SIMD implementation on the CPU. */
+        CPU = 2
+    };
+
+    /** The names of the simulation backends (as c strings for imgui). */
+    constexpr std::array<const char*, 3> SIMULATION_BACKEND_NAMES{ { "Fragment Shader", "Compute Shader", "CPU" } };
+
+    /** The storage formats of the simulation state (A and B) on the GPU. */
+    enum class StateFormat : int {
+        /** 32 bit floating point (RG32F). */
+        Float32 = 0,
+        /** 16 bit floating point (RG16F), the results depend on the rounding of the driver. */
+        Float16 = 1,
+        /** 16 bit fixed point with 15 fractional bits (RG16UI), bit-identical on all drivers. */
+        Fixed16 = 2
+    };
+
+    /** The names of the state formats (as c strings for imgui). */
+    constexpr std::array<const char*, 3> STATE_FORMAT_NAMES{ { "FP32", "FP16", "Fixed16" } };
+
+    /** The default simulation grid size (x), also the size the parameters and presets are tuned for. */
+    constexpr unsigned int SIMULATION_SIZE_X = 1920 / 4;
+    /** The default simulation grid size (y), also the size the parameters and presets are tuned for. */
+    constexpr unsigned int SIMULATION_SIZE_Y = 1080 / 4;
+
+    /**
+     *  The reaction diffusion parameters. They are kept in a SimulationParameterBlock that versions them, so they are
+     *  uploaded and synchronized only after a change (has to stay trivially copyable).
+     */
+    struct SimulationParameters {
+        float diffusion_rate_a_ = 1.0f;
+        float diffusion_rate_b_ = 0.5f;
+        float feed_rate_ = 0.055f;
+        float kill_rate_ = 0.062f;
+        float dt_ = 1.0f;
+        float seed_point_radius_ = 0.1f;
+        bool use_manhattan_distance_ = true;
+    };
+
+    struct SimulationData {
+        /** The distance the simulation will be drawn at. */
+        float simulationDrawDistance_ = 15.0f;
+        /** The simulation height field height. */
+        float simulationHeight_ = 0.1f;
+        /** The relative index of refraction used for raycasting. */
+        float eta_ = 1.5f;
+        /** The absorption coefficient. */
+        glm::vec3 sigma_a_ = glm::vec3(2.0f);
+        /** The fraction of the window resolution the height field is raycast at (upsampled to the window resolution). */
+        float renderResolution_ = 1.0f;
+        /** Choose the fraction on each node so raycasting stays within renderTimeBudget_ (see RenderResolution.h). */
+        bool adaptiveRenderResolution_ = false;
+        /** The time raycasting all windows may take per frame on each node in milliseconds. */
+        float renderTimeBudget_ = 8.0f;
+        /** Accumulate jittered frames at a reduced resolution while the view does not change. */
+        bool temporalAccumulation_ = true;
+        /** Blit the last frame of a window while the state, the view and the renderer parameters are unchanged (see RenderCache.h). */
+        bool reuseFrames_ = true;
+        /** The current global iteration count. */
+        std::uint64_t currentGlobalIterationCount_ = 0;
+        /** frame at which the simulation should be reset */
+        size_t resetFrameIdx_ = 0;
+
+        int currentRenderer_ = 0;
+        /** The backend used to advance the simulation. */
+        SimulationBackend simulationBackend_ = SimulationBackend::FragmentShader;
+        /** The storage format of the simulation state on the GPU. */
+        StateFormat stateFormat_ = StateFormat::Float32;
+
+        /** The size of the simulation grid (read from simulation.txt, multiplied by DOMAIN_GRID_SCALE with domain decomposition). */
+        glm::uvec2 gridSize_ = glm::uvec2{ SIMULATION_SIZE_X, SIMULATION_SIZE_Y };
+        /** The iteration before which all nodes resample their state to gridSize_. */
+        std::uint64_t gridSizeIteration_ = 0;
+        /** Scale the diffusion, time step and seed radius with the grid size, so the pattern keeps its size on the plane. */
+        bool scaleParametersToGrid_ = true;
+        /** Choose the grid size so dynamicResolutionIterations_ fit into the simulation time budget (see DynamicResolution.h). */
+        bool dynamicResolution_ = false;
+        /** The iterations per frame the dynamic resolution keeps within the budget. */
+        std::uint64_t dynamicResolutionIterations_ = 8;
+
+        /** Only compute the tiles of the grid that changed recently or have an active neighbour (see ActiveTiles.h, GPU backends). */
+        bool activeTiles_ = true;
+        /** The change of A or B per iteration below which a tile goes to sleep. */
+        float activityThreshold_ = 1e-5f;
+
+        /** Choose the time step from an estimate of the local error (see TimestepController.h), otherwise the dt of the parameters is used. */
+        bool adaptiveTimestep_ = false;
+        /** The error of A or B per step the adaptive time step keeps. */
+        float timestepTolerance_ = 1e-3f;
+        /** The range of the adaptive time step in the units of the parameters' dt. */
+        float minTimestep_ = 0.05f;
+        float maxTimestep_ = 5.0f;
+        /** The time step of every iteration and the simulated time (written by the coordinator). */
+        TimestepSchedule timestepSchedule_;
+
+        /** Choose the iterations per frame from the measured iteration time (otherwise fixedFrameIterations_ are used). */
+        bool adaptiveIterations_ = true;
+        /** The time the simulation may take per frame on each node in milliseconds. */
+        float simulationTimeBudget_ = 8.0f;
+        /** The iterations per frame if adaptiveIterations_ is off. */
+        std::uint64_t fixedFrameIterations_ = 5;
+        /** The minimum iterations per frame. */
+        std::uint64_t minFrameIterations_ = 1;
+        /** The maximum iterations per frame (also limits how fast a node catches up). */
+        std::uint64_t maxFrameIterations_ = 60;
+
+        /** Pause the simulation while the state is stationary and there is no input (see IdleThrottle.h). */
+        bool idleThrottling_ = true;
+        /** The change of A or B per iteration below which the state counts as stationary. */
+        float steadyStateThreshold_ = 1e-6f;
+        /** Set by the coordinator while the simulation is paused. */
+        bool simulationIdle_ = false;
+
+        /** Compare hashes of the state of all nodes and send a snapshot to workers that diverged. */
+        bool verifyState_ = true;
+        /** The iterations between state hashes. */
+        std::uint64_t stateHashInterval_ = 1000;
+
+        /** Write checkpoints every checkpointInterval_ iterations. */
+        bool periodicCheckpoints_ = true;
+        /** The iterations between periodic checkpoints. */
+        std::uint64_t checkpointInterval_ = 20000;
+        /** The number of checkpoints kept on disk. */
+        std::uint64_t maxCheckpoints_ = 8;
+        /** Increased by the coordinator to make all nodes restore the checkpoint of checkpointRestoreIteration_. */
+        std::uint64_t checkpointRestoreRequest_ = 0;
+        /** The iteration of the checkpoint to restore. */
+        std::uint64_t checkpointRestoreIteration_ = 0;
+
+        /** Set by the coordinator to a new id (its start time) to make all nodes record their windows, 0 while not recording (see FrameRecorder.h). */
+        std::uint64_t recordingId_ = 0;
+        /** Also record the simulation state after every frame that iterated. */
+        bool recordState_ = false;
+        /** The frame rate written to the headers of the recorded videos. */
+        std::uint64_t recordingFrameRate_ = 60;
+        /** Set by the coordinator to a new id (its time) to make all nodes export the trace of their last frames (see FrameProfiler.h). */
+        std::uint64_t traceExportId_ = 0;
+    };
+}
@@ -0,0 +1,99 @@
+/**
+ * @file   SimulationDomain.cpp
+ *
+ * @brief  Implementation of the decomposition of the simulation grid between the nodes.
+ */
+
+#include "SimulationDomain.h"
+#include <algorithm>
+#include <cstring>
+
+namespace viscom {
+
+    int GetClusterNodeIndex()
+    {
+#ifdef VISCOM_USE_SGCT
+        return static_cast<int>(sgct_core::ClusterManager::instance()->getThisNodeId());
+#else
+        return 0;
+#endif
+    }
+
+    int GetNumClusterNodes()
+    {
+#ifdef VISCOM_USE_SGCT
+        return static_cast<int>(sgct_core::ClusterManager::instance()->getNumberOfNodes());
+#else
+        return 1;
+#endif
+    }
+
+    SimulationDomain::SimulationDomain(const glm::uvec2& gridSize, int node, const GridRect& tile) :
+        gridSize_{ gridSize },
+        node_{ node },
+        tile_{ tile }
+    {
+        stateRect_ = GetStateRect(tile_);
+        tiles_.push_back(DomainTile{ node_, tile_ });
+    }
+
+    GridRect SimulationDomain::GetStateRect(const GridRect& tile) const
+    {
+        if (!IsDecomposed()) return tile;
+        const auto halo = glm::ivec2(static_cast<int>(DOMAIN_HALO_SIZE));
+        return GridRect{ tile.min_ - halo, tile.max_ + halo }.Intersect(GridRect{ glm::ivec2(0), glm::ivec2(gridSize_) });
+    }
+
+    void SimulationDomain::SetTiles(const std::vector<DomainTile>& tiles)
+    {
+        if (tiles == tiles_) return;
+        tiles_ = tiles;
+
+        // the halo of a node is taken from the tiles overlapping it; cells no tile covers are simulated locally.
+        sendRegions_.clear();
+        receiveRegions_.clear();
+        for (const auto& tile : tiles_) {
+            if (tile.node_ == node_) continue;
+
+            const auto receiveRect = stateRect_.Intersect(tile.rect_);
+            if (!receiveRect.IsEmpty() && !tile_.Contains(receiveRect)) receiveRegions_.push_back(HaloRegion{ tile.node_, receiveRect });
+            const auto sendRect = GetStateRect(tile.rect_).Intersect(tile_);
+            if (!sendRect.IsEmpty() && !tile.rect_.Contains(sendRect)) sendRegions_.push_back(HaloRegion{ tile.node_, sendRect });
+        }
+    }
+
+    void SimulationDomain::AddHalo(const void* package, std::size_t packageSize)
+    {
+        if (packageSize < sizeof(DomainHaloHeader)) return;
+        DomainHaloHeader header;
+        std::memcpy(&header, package, sizeof(DomainHaloHeader));
+
+        const auto data = static_cast<const std::uint8_t*>(package);
+        {
+            std::lock_guard<std::mutex> lock{ haloMutex_ };
+            receivedHalos_[std::make_pair(header.iteration_, static_cast<int>(header.sourceNode_))].assign(data, data + packageSize);
+        }
+        haloCondition_.notify_one();
+    }
+
+    bool SimulationDomain::TakeHalos(std::uint64_t iteration, std::vector<std::vector<std::uint8_t>>& halos, std::chrono::milliseconds timeout)
+    {
+        const auto waitStart = std::chrono::high_resolution_clock::now();
+        std::unique_lock<std::mutex> lock{ haloMutex_ };
+        const auto complete = haloCondition_.wait_for(lock, timeout, [this, iteration]() {
+            return std::all_of(receiveRegions_.begin(), receiveRegions_.end(), [this, iteration](const HaloRegion& region) {
+                return receivedHalos_.count(std::make_pair(iteration, region.node_)) > 0;
+            });
+        });
+
+        halos.clear();
+        for (auto it = receivedHalos_.begin(); it != receivedHalos_.end() && it->first.first <= iteration;) {
+            if (it->first.first == iteration) halos.push_back(std::move(it->second));
+            it = receivedHalos_.erase(it);
+        }
+
+        const std::chrono::duration<float, std::milli> waitTime = std::chrono::high_resolution_clock::now() - waitStart;
+        lastWaitTime_ = waitTime.count();
+        return complete;
+    }
+}
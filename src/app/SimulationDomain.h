@@ -0,0 +1,132 @@
+/**
+ * @file   SimulationDomain.h
+ *
+ * @brief  Declaration of the decomposition of the simulation grid between the nodes.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace viscom {
+
+    /** Split the simulation grid between the nodes according to their viewports (otherwise every node simulates all of it). */
+    constexpr bool USE_DOMAIN_DECOMPOSITION = false;
+    /** The size of the grid relative to SimulationData::gridSize_ with domain decomposition. */
+    constexpr unsigned int DOMAIN_GRID_SCALE = 4;
+    /** The cells simulated around the tile of a node, which is also the number of iterations between halo exchanges. */
+    constexpr unsigned int DOMAIN_HALO_SIZE = 16;
+    /** How long a node waits for the halos of its neighbours before it continues without them. */
+    constexpr long long DOMAIN_HALO_TIMEOUT_MS = 1000;
+
+    /** A rectangle of grid cells (max_ is exclusive). */
+    struct GridRect {
+        glm::ivec2 min_ = glm::ivec2{ 0 };
+        glm::ivec2 max_ = glm::ivec2{ 0 };
+
+        glm::ivec2 GetSize() const { return glm::max(max_ - min_, glm::ivec2{ 0 }); }
+        bool IsEmpty() const { return max_.x <= min_.x || max_.y <= min_.y; }
+        GridRect Intersect(const GridRect& other) const { return GridRect{ glm::max(min_, other.min_), glm::min(max_, other.max_) }; }
+        bool Contains(const GridRect& other) const { return min_.x <= other.min_.x && min_.y <= other.min_.y && max_.x >= other.max_.x && max_.y >= other.max_.y; }
+        bool operator==(const GridRect& other) const { return min_ == other.min_ && max_ == other.max_; }
+    };
+
+    /** The part of the grid a node is responsible for (synchronized to the workers, has to stay trivially copyable). */
+    struct DomainTile {
+        std::int32_t node_ = -1;
+        GridRect rect_;
+
+        bool operator==(const DomainTile& other) const { return node_ == other.node_ && rect_ == other.rect_; }
+    };
+
+    /** The header of a halo package, followed by the cells of rect_ in the state format. */
+    struct DomainHaloHeader {
+        /** The iteration the cells belong to. */
+        std::uint64_t iteration_;
+        std::int32_t sourceNode_;
+        /** The StateFormat of the cells. */
+        std::int32_t stateFormat_;
+        /** The cells in grid coordinates. */
+        GridRect rect_;
+    };
+
+    /** Returns the index of this node in the cluster (0 for the coordinator). */
+    int GetClusterNodeIndex();
+    /** Returns the number of nodes in the cluster. */
+    int GetNumClusterNodes();
+
+    /**
+     *  Describes which part of the grid this node simulates. Each node steps its tile plus a halo of DOMAIN_HALO_SIZE
+     *  cells, so the cells of the tile stay exact for DOMAIN_HALO_SIZE iterations. After that the halo is replaced
+     *  with the cells of the neighbouring tiles, which are sent directly between the nodes. Without domain
+     *  decomposition the tile is the whole grid and there are no neighbours.
+     */
+    class SimulationDomain
+    {
+    public:
+        /** A region of cells exchanged with another node. */
+        struct HaloRegion {
+            int node_;
+            GridRect rect_;
+        };
+
+        SimulationDomain(const glm::uvec2& gridSize, int node, const GridRect& tile);
+
+        /** Replaces the tiles of all nodes and recomputes the halo regions (only if they changed). */
+        void SetTiles(const std::vector<DomainTile>& tiles);
+
+        const glm::uvec2& GetGridSize() const { return gridSize_; }
+        int GetNode() const { return node_; }
+        const GridRect& GetTile() const { return tile_; }
+        /** Returns the cells simulated by this node (the tile and its halo within the grid). */
+        const GridRect& GetStateRect() const { return stateRect_; }
+        glm::uvec2 GetStateSize() const { return glm::uvec2(stateRect_.GetSize()); }
+        const std::vector<DomainTile>& GetTiles() const { return tiles_; }
+        /** Returns if the grid is split between several nodes. */
+        bool IsDecomposed() const { return USE_DOMAIN_DECOMPOSITION; }
+        /** Returns if the tiles of all nodes are known. */
+        bool IsComplete() const { return !IsDecomposed() || static_cast<int>(tiles_.size()) == GetNumClusterNodes(); }
+        /** The cells this node sends to its neighbours. */
+        const std::vector<HaloRegion>& GetSendRegions() const { return sendRegions_; }
+        /** The cells this node receives from its neighbours. */
+        const std::vector<HaloRegion>& GetReceiveRegions() const { return receiveRegions_; }
+
+        /** Stores a received halo package (network thread). */
+        void AddHalo(const void* package, std::size_t packageSize);
+        /**
+         *  Waits until the halos of all receive regions for the given iteration arrived and moves them to halos.
+         *  Returns false if some did not arrive within the timeout (halos then holds the ones that did).
+         */
+        bool TakeHalos(std::uint64_t iteration, std::vector<std::vector<std::uint8_t>>& halos, std::chrono::milliseconds timeout);
+        /** Returns the time the last TakeHalos waited in milliseconds. */
+        float GetLastWaitTime() const { return lastWaitTime_; }
+
+    private:
+        /** Returns the cells a node with the given tile simulates. */
+        GridRect GetStateRect(const GridRect& tile) const;
+
+        /** The size of the whole grid. */
+        glm::uvec2 gridSize_;
+        /** The index of this node. */
+        int node_;
+        /** The tile of this node and the cells it simulates. */
+        GridRect tile_;
+        GridRect stateRect_;
+        /** The tiles of all nodes. */
+        std::vector<DomainTile> tiles_;
+        std::vector<HaloRegion> sendRegions_;
+        std::vector<HaloRegion> receiveRegions_;
+
+        /** The received halo packages by iteration and source node. */
+        std::map<std::pair<std::uint64_t, int>, std::vector<std::uint8_t>> receivedHalos_;
+        std::mutex haloMutex_;
+        std::condition_variable haloCondition_;
+        /** The time the last TakeHalos waited in milliseconds. */
+        float lastWaitTime_ = 0.0f;
+    };
+}
@@ -0,0 +1,108 @@
+/**
+ * @file   SimulationParameterBlock.cpp
+ *
+ * @brief  Implementation of the versioned simulation parameters and their uniform buffer.
+ */
+
+#include "core/open_gl.h"
+#include "SimulationParameterBlock.h"
+#include "app/simulation/FixedPoint.h"
+
+namespace viscom {
+
+    namespace {
+        bool operator==(const SimulationParameters& lhs, const SimulationParameters& rhs)
+        {
+            return lhs.diffusion_rate_a_ == rhs.diffusion_rate_a_ && lhs.diffusion_rate_b_ == rhs.diffusion_rate_b_
+                && lhs.feed_rate_ == rhs.feed_rate_ && lhs.kill_rate_ == rhs.kill_rate_ && lhs.dt_ == rhs.dt_
+                && lhs.seed_point_radius_ == rhs.seed_point_radius_ && lhs.use_manhattan_distance_ == rhs.use_manhattan_distance_;
+        }
+
+        SimulationParameterUniforms ToUniforms(const SimulationParameters& parameters)
+        {
+            SimulationParameterUniforms result;
+            result.diffusionRateA_ = parameters.diffusion_rate_a_;
+            result.diffusionRateB_ = parameters.diffusion_rate_b_;
+            result.feedRate_ = parameters.feed_rate_;
+            result.killRate_ = parameters.kill_rate_;
+            result.dt_ = parameters.dt_;
+            result.seedPointRadius_ = parameters.seed_point_radius_;
+            result.useManhattanDistance_ = parameters.use_manhattan_distance_ ? 1 : 0;
+
+            const auto fixedCoefficients = simulation::ComputeFixedPointCoefficients(parameters);
+            result.fixedDiffusionA_ = fixedCoefficients.diffusionA_;
+            result.fixedDiffusionB_ = fixedCoefficients.diffusionB_;
+            result.fixedDt_ = fixedCoefficients.dt_;
+            result.fixedFeed_ = fixedCoefficients.feed_;
+            result.fixedKillFeed_ = fixedCoefficients.killFeed_;
+            return result;
+        }
+    }
+
+    SimulationParameterBlock::SimulationParameterBlock() :
+        effectiveParameters_{ ScaleParametersToGrid(parameters_, gridScale_, gridHeight_) }
+    {
+        glGenBuffers(1, &uniformBuffer_);
+        glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer_);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(SimulationParameterUniforms), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    SimulationParameterBlock::~SimulationParameterBlock()
+    {
+        if (uniformBuffer_ != 0) glDeleteBuffers(1, &uniformBuffer_);
+        uniformBuffer_ = 0;
+    }
+
+    void SimulationParameterBlock::Set(const SimulationParameters& parameters)
+    {
+        if (parameters == parameters_) return;
+        parameters_ = parameters;
+        ++version_;
+        UpdateEffectiveParameters();
+    }
+
+    void SimulationParameterBlock::SetSynchronized(const SimulationParameters& parameters, std::uint64_t version)
+    {
+        parameters_ = parameters;
+        version_ = version;
+        UpdateEffectiveParameters();
+    }
+
+    void SimulationParameterBlock::SetGridScale(float gridScale, unsigned int gridHeight)
+    {
+        if (gridScale == gridScale_ && gridHeight == gridHeight_) return;
+        gridScale_ = gridScale;
+        gridHeight_ = gridHeight;
+        UpdateEffectiveParameters();
+    }
+
+    void SimulationParameterBlock::SetTimestep(float timestep)
+    {
+        if (timestep == timestep_) return;
+        timestep_ = timestep;
+        UpdateEffectiveParameters();
+    }
+
+    void SimulationParameterBlock::UpdateEffectiveParameters()
+    {
+        auto parameters = parameters_;
+        if (timestep_ > 0.0f) parameters.dt_ = timestep_;
+        effectiveParameters_ = ScaleParametersToGrid(parameters, gridScale_, gridHeight_);
+        // the buffer holds the effective parameters, so it is also written when only the grid or time step changed.
+        uploaded_ = false;
+    }
+
+    void SimulationParameterBlock::Bind()
+    {
+        if (!uploaded_ || uploadedVersion_ != version_) {
+            const auto uniforms = ToUniforms(effectiveParameters_);
+            glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer_);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SimulationParameterUniforms), &uniforms);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            uploadedVersion_ = version_;
+            uploaded_ = true;
+        }
+        glBindBufferBase(GL_UNIFORM_BUFFER, SIMULATION_PARAMETERS_BINDING, uniformBuffer_);
+    }
+}
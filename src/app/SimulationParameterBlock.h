@@ -0,0 +1,86 @@
+/**
+ * @file   SimulationParameterBlock.h
+ *
+ * @brief  Declaration of the versioned simulation parameters and their uniform buffer.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "app/ParameterScaling.h"
+
+namespace viscom {
+
+    /** The binding point of the SimulationParameters uniform block in the simulation shaders. */
+    constexpr GLuint SIMULATION_PARAMETERS_BINDING = 0;
+
+    /** The std140 layout of the SimulationParameters uniform block (has to match the shaders). */
+    struct SimulationParameterUniforms {
+        float diffusionRateA_;
+        float diffusionRateB_;
+        float feedRate_;
+        float killRate_;
+        float dt_;
+        float seedPointRadius_;
+        std::int32_t useManhattanDistance_;
+        /** The fixed point coefficients (see simulation/FixedPoint.h). */
+        std::int32_t fixedDiffusionA_;
+        std::int32_t fixedDiffusionB_;
+        std::int32_t fixedDt_;
+        std::int32_t fixedFeed_;
+        std::int32_t fixedKillFeed_;
+    };
+    static_assert(sizeof(SimulationParameterUniforms) == 48, "SimulationParameterUniforms has to match the std140 layout.");
+
+    /**
+     *  Holds the simulation parameters with a version that is increased on every change. The uniform buffer is only
+     *  written, the parameters only sent to the workers and preset loads only cause work if the version changed.
+     */
+    class SimulationParameterBlock
+    {
+    public:
+        SimulationParameterBlock();
+        SimulationParameterBlock(const SimulationParameterBlock&) = delete;
+        SimulationParameterBlock& operator=(const SimulationParameterBlock&) = delete;
+        ~SimulationParameterBlock();
+
+        const SimulationParameters& Get() const { return parameters_; }
+        /** Returns the parameters scaled to the grid, which the simulation uses (see ScaleParametersToGrid). */
+        const SimulationParameters& GetEffective() const { return effectiveParameters_; }
+        /** Replaces the parameters, the version only changes if they differ. */
+        void Set(const SimulationParameters& parameters);
+        /** Replaces the parameters with the ones received from the coordinator together with their version. */
+        void SetSynchronized(const SimulationParameters& parameters, std::uint64_t version);
+        /** Returns the version of the parameters. */
+        std::uint64_t GetVersion() const { return version_; }
+        /** Sets the scale and height of the grid the effective parameters are computed for (local to each node, not versioned). */
+        void SetGridScale(float gridScale, unsigned int gridHeight);
+        /** Replaces dt with the time step of the adaptive integration before the grid scaling (0 keeps dt, local to each node, not versioned). */
+        void SetTimestep(float timestep);
+
+        /** Uploads the parameters if they changed since the last upload and binds the uniform buffer. */
+        void Bind();
+
+    private:
+        /** Recomputes the effective parameters and marks the uniform buffer as outdated. */
+        void UpdateEffectiveParameters();
+
+        /** The parameters. */
+        SimulationParameters parameters_;
+        /** The parameters scaled to the grid. */
+        SimulationParameters effectiveParameters_;
+        /** The scale and height of the grid. */
+        float gridScale_ = 1.0f;
+        unsigned int gridHeight_ = SIMULATION_SIZE_Y;
+        /** The time step replacing dt (0 if none). */
+        float timestep_ = 0.0f;
+        /** The version of the parameters. */
+        std::uint64_t version_ = 0;
+        /** The uniform buffer. */
+        GLuint uniformBuffer_ = 0;
+        /** The version in the uniform buffer. */
+        std::uint64_t uploadedVersion_ = 0;
+        /** Whether the uniform buffer holds any version yet. */
+        bool uploaded_ = false;
+    };
+}
@@ -0,0 +1,243 @@
+/**
+ * @file   StateSync.cpp
+ *
+ * @brief  Implementation of the state hashes and snapshots keeping the simulation state of all nodes consistent.
+ */
+
+#include "core/open_gl.h"
+#include "StateSync.h"
+#include "core/app/ApplicationNodeBase.h"
+#include "app/Checkpoint.h"
+#include <algorithm>
+#include <cstring>
+
+namespace viscom {
+
+    /** Has to match the local size of stateHash.comp. */
+    constexpr GLuint HASH_LOCAL_SIZE = 16;
+    /** The longest literal sequence and repetition of the run length encoding. */
+    constexpr std::size_t MAX_RUN_LENGTH = 128;
+
+    namespace {
+        /** Returns the number of equal bytes starting at begin (at most MAX_RUN_LENGTH). */
+        std::size_t GetRunLength(const std::vector<std::uint8_t>& data, std::size_t begin)
+        {
+            std::size_t length = 1;
+            while (length < MAX_RUN_LENGTH && begin + length < data.size() && data[begin + length] == data[begin]) ++length;
+            return length;
+        }
+
+        /** Appends the run length encoding of data: c < 128 copies c + 1 literal bytes, otherwise repeats the next byte c - 126 times. */
+        void RunLengthEncode(const std::vector<std::uint8_t>& data, std::vector<std::uint8_t>& encoded)
+        {
+            std::size_t i = 0;
+            while (i < data.size()) {
+                const auto runLength = GetRunLength(data, i);
+                if (runLength > 1) {
+                    encoded.push_back(static_cast<std::uint8_t>(runLength + 126));
+                    encoded.push_back(data[i]);
+                    i += runLength;
+                    continue;
+                }
+
+                // literal bytes up to the next repetition.
+                const auto literalBegin = i;
+                while (i < data.size() && i - literalBegin < MAX_RUN_LENGTH && GetRunLength(data, i) == 1) ++i;
+                encoded.push_back(static_cast<std::uint8_t>(i - literalBegin - 1));
+                encoded.insert(encoded.end(), data.begin() + literalBegin, data.begin() + i);
+            }
+        }
+
+        bool RunLengthDecode(const std::uint8_t* encoded, std::size_t encodedSize, std::vector<std::uint8_t>& data)
+        {
+            std::size_t i = 0;
+            std::size_t size = 0;
+            while (i < encodedSize) {
+                const auto control = encoded[i++];
+                if (control < MAX_RUN_LENGTH) {
+                    const std::size_t length = control + 1u;
+                    if (i + length > encodedSize || size + length > data.size()) return false;
+                    std::memcpy(data.data() + size, encoded + i, length);
+                    i += length;
+                    size += length;
+                }
+                else {
+                    const std::size_t length = control - 126u;
+                    if (i >= encodedSize || size + length > data.size()) return false;
+                    std::memset(data.data() + size, encoded[i++], length);
+                    size += length;
+                }
+            }
+            return size == data.size();
+        }
+    }
+
+    void EncodeStateSnapshot(const StateSnapshotHeader& header, const std::uint8_t* state, std::vector<std::uint8_t>& snapshot)
+    {
+        const auto cellSize = GetStateTransferFormat(static_cast<StateFormat>(header.stateFormat_)).cellSize_;
+        const auto numCells = static_cast<std::size_t>(header.stateSize_) / cellSize;
+
+        std::vector<std::uint8_t> planes(header.stateSize_);
+        for (std::size_t b = 0; b < cellSize; ++b) {
+            std::uint8_t previous = 0;
+            for (std::size_t i = 0; i < numCells; ++i) {
+                const auto value = state[i * cellSize + b];
+                planes[b * numCells + i] = static_cast<std::uint8_t>(value - previous);
+                previous = value;
+            }
+        }
+
+        snapshot.resize(sizeof(StateSnapshotHeader));
+        RunLengthEncode(planes, snapshot);
+        auto snapshotHeader = header;
+        snapshotHeader.encodedSize_ = static_cast<std::uint32_t>(snapshot.size() - sizeof(StateSnapshotHeader));
+        snapshotHeader.reserved_ = 0;
+        std::memcpy(snapshot.data(), &snapshotHeader, sizeof(StateSnapshotHeader));
+    }
+
+    bool DecodeStateSnapshot(const std::vector<std::uint8_t>& snapshot, StateSnapshotHeader& header, std::vector<std::uint8_t>& state)
+    {
+        if (snapshot.size() < sizeof(StateSnapshotHeader)) return false;
+        std::memcpy(&header, snapshot.data(), sizeof(StateSnapshotHeader));
+        if (header.stateFormat_ < 0 || header.stateFormat_ >= static_cast<std::int32_t>(STATE_FORMAT_NAMES.size())
+            || header.encodedSize_ != snapshot.size() - sizeof(StateSnapshotHeader)) return false;
+
+        const auto cellSize = GetStateTransferFormat(static_cast<StateFormat>(header.stateFormat_)).cellSize_;
+        const auto numCells = static_cast<std::size_t>(header.width_) * header.height_;
+        if (header.stateSize_ != numCells * cellSize) return false;
+
+        std::vector<std::uint8_t> planes(header.stateSize_);
+        if (!RunLengthDecode(snapshot.data() + sizeof(StateSnapshotHeader), header.encodedSize_, planes)) return false;
+
+        state.resize(header.stateSize_);
+        for (std::size_t b = 0; b < cellSize; ++b) {
+            std::uint8_t value = 0;
+            for (std::size_t i = 0; i < numCells; ++i) {
+                value = static_cast<std::uint8_t>(value + planes[b * numCells + i]);
+                state[i * cellSize + b] = value;
+            }
+        }
+        return true;
+    }
+
+    bool StateSnapshotAssembler::AddChunk(const void* package, std::size_t packageSize)
+    {
+        if (packageSize < sizeof(StateSnapshotChunk)) return false;
+        StateSnapshotChunk chunk;
+        std::memcpy(&chunk, package, sizeof(StateSnapshotChunk));
+        const auto chunkSize = packageSize - sizeof(StateSnapshotChunk);
+        if (static_cast<std::size_t>(chunk.offset_) + chunkSize > chunk.snapshotSize_) return false;
+
+        // the parts of a snapshot arrive in order, a new snapshot replaces an incomplete one.
+        if (chunk.snapshotId_ != snapshotId_ || chunk.offset_ == 0) {
+            snapshotId_ = chunk.snapshotId_;
+            snapshot_.resize(chunk.snapshotSize_);
+            receivedSize_ = 0;
+        }
+        if (chunk.offset_ != receivedSize_ || chunk.snapshotSize_ != snapshot_.size()) return false;
+
+        std::memcpy(snapshot_.data() + chunk.offset_, static_cast<const std::uint8_t*>(package) + sizeof(StateSnapshotChunk), chunkSize);
+        receivedSize_ += chunkSize;
+        return receivedSize_ == snapshot_.size();
+    }
+
+    void StateSnapshotAssembler::TakeSnapshot(std::vector<std::uint8_t>& snapshot)
+    {
+        snapshot.swap(snapshot_);
+        snapshot_.clear();
+        receivedSize_ = 0;
+    }
+
+    StateHasher::StateHasher(ApplicationNodeBase* appNode)
+    {
+        hashProgram_ = appNode->GetGPUProgramManager().GetResource("stateHash", std::vector<std::string>{ "stateHash.comp" });
+        hashFixedProgram_ = appNode->GetGPUProgramManager().GetResource("stateHashFixed16", std::vector<std::string>{ "stateHash.comp" },
+            std::vector<std::string>{ "STATE_FIXED16" });
+        hashStateLoc_ = hashProgram_->getUniformLocation("state");
+        hashFixedStateLoc_ = hashFixedProgram_->getUniformLocation("state");
+
+        for (auto& pendingHash : pendingHashes_) {
+            glGenBuffers(1, &pendingHash.buffer_);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, pendingHash.buffer_);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    StateHasher::~StateHasher()
+    {
+        for (auto& pendingHash : pendingHashes_) {
+            if (pendingHash.fence_ != nullptr) glDeleteSync(pendingHash.fence_);
+            glDeleteBuffers(1, &pendingHash.buffer_);
+        }
+    }
+
+    void StateHasher::Hash(GLuint stateTexture, StateFormat format, const glm::uvec2& size, std::uint64_t iteration)
+    {
+        auto pendingHash = std::find_if(pendingHashes_.begin(), pendingHashes_.end(), [](const PendingHash& hash) { return hash.fence_ == nullptr; });
+        if (pendingHash == pendingHashes_.end()) return;
+
+        const std::array<GLuint, 2> zero{ { 0, 0 } };
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, pendingHash->buffer_);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), zero.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, pendingHash->buffer_);
+
+        const auto fixedPoint = format == StateFormat::Fixed16;
+        glUseProgram(fixedPoint ? hashFixedProgram_->getProgramId() : hashProgram_->getProgramId());
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, stateTexture);
+        glUniform1i(fixedPoint ? hashFixedStateLoc_ : hashStateLoc_, 0);
+        glDispatchCompute((size.x + HASH_LOCAL_SIZE - 1) / HASH_LOCAL_SIZE, (size.y + HASH_LOCAL_SIZE - 1) / HASH_LOCAL_SIZE, 1);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+
+        pendingHash->iteration_ = iteration;
+        pendingHash->fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    void StateHasher::Poll()
+    {
+        for (auto& pendingHash : pendingHashes_) {
+            if (pendingHash.fence_ == nullptr) continue;
+            const auto status = glClientWaitSync(pendingHash.fence_, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) continue;
+            glDeleteSync(pendingHash.fence_);
+            pendingHash.fence_ = nullptr;
+
+            std::array<GLuint, 2> result;
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, pendingHash.buffer_);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(result), result.data());
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+            StateHash hash;
+            hash.iteration_ = pendingHash.iteration_;
+            hash.hash_ = (static_cast<std::uint64_t>(result[1]) << 32) | result[0];
+            hashHistory_[nextHistoryEntry_] = hash;
+            nextHistoryEntry_ = (nextHistoryEntry_ + 1) % hashHistory_.size();
+            if (hash.iteration_ > latestHash_.iteration_) latestHash_ = hash;
+        }
+    }
+
+    bool StateHasher::FindHash(std::uint64_t iteration, std::uint64_t& hash) const
+    {
+        for (const auto& entry : hashHistory_) {
+            if (entry.iteration_ == iteration && iteration != 0) {
+                hash = entry.hash_;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void StateHasher::Clear()
+    {
+        for (auto& pendingHash : pendingHashes_) {
+            if (pendingHash.fence_ != nullptr) glDeleteSync(pendingHash.fence_);
+            pendingHash.fence_ = nullptr;
+        }
+        hashHistory_.fill(StateHash{});
+        latestHash_ = StateHash{};
+    }
+}
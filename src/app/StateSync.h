@@ -0,0 +1,137 @@
+/**
+ * @file   StateSync.h
+ *
+ * @brief  Declaration of the state hashes and snapshots keeping the simulation state of all nodes consistent.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "app/SimulationData.h"
+#include <array>
+#include <vector>
+
+namespace viscom {
+
+    class ApplicationNodeBase;
+    class GPUProgram;
+
+    /** The hash of the simulation state after an iteration (synchronized to the workers, has to stay trivially copyable). */
+    struct StateHash {
+        /** The iteration the state was hashed after (0 if there is no hash). */
+        std::uint64_t iteration_ = 0;
+        std::uint64_t hash_ = 0;
+    };
+
+    /** Sent by a worker to request a snapshot of the coordinator state. */
+    struct StateSnapshotRequest {
+        /** The iteration at which the state diverged (0 if the worker has no state yet). */
+        std::uint64_t iteration_ = 0;
+    };
+
+    /** The header of an encoded state snapshot, followed by the encoded state. */
+    struct StateSnapshotHeader {
+        /** The iteration of the state. */
+        std::uint64_t iteration_;
+        std::uint32_t width_;
+        std::uint32_t height_;
+        /** The StateFormat of the state. */
+        std::int32_t stateFormat_;
+        /** The size of the decoded state in bytes. */
+        std::uint32_t stateSize_;
+        /** The size of the encoded state in bytes. */
+        std::uint32_t encodedSize_;
+        std::uint32_t reserved_;
+    };
+    static_assert(sizeof(StateSnapshotHeader) == 32, "The snapshot header has a fixed size.");
+
+    /** The header of a part of a snapshot sent through the data transfer channel, followed by the part. */
+    struct StateSnapshotChunk {
+        /** Identifies the snapshot the part belongs to. */
+        std::uint64_t snapshotId_;
+        /** The offset of the part in the snapshot. */
+        std::uint32_t offset_;
+        /** The size of the whole snapshot (header and encoded state). */
+        std::uint32_t snapshotSize_;
+    };
+
+    /** The size of the snapshot parts sent through the data transfer channel. */
+    constexpr std::size_t STATE_SNAPSHOT_CHUNK_SIZE = 64 * 1024;
+
+    /**
+     *  Encodes a state snapshot: the bytes of all cells are split into planes (the exponent and sign bytes of A and B
+     *  are nearly constant over large areas), each plane is delta coded and the result is run length encoded.
+     */
+    void EncodeStateSnapshot(const StateSnapshotHeader& header, const std::uint8_t* state, std::vector<std::uint8_t>& snapshot);
+    /** Decodes a snapshot, returns false if it is malformed. */
+    bool DecodeStateSnapshot(const std::vector<std::uint8_t>& snapshot, StateSnapshotHeader& header, std::vector<std::uint8_t>& state);
+
+    /** Reassembles a snapshot from the parts received through the data transfer channel. */
+    class StateSnapshotAssembler
+    {
+    public:
+        /** Adds a received package, returns true if a snapshot is complete (then it can be taken with TakeSnapshot). */
+        bool AddChunk(const void* package, std::size_t packageSize);
+        /** Moves the completed snapshot to snapshot. */
+        void TakeSnapshot(std::vector<std::uint8_t>& snapshot);
+
+    private:
+        /** The snapshot being received. */
+        std::uint64_t snapshotId_ = 0;
+        std::vector<std::uint8_t> snapshot_;
+        /** The number of bytes received. */
+        std::size_t receivedSize_ = 0;
+    };
+
+    /**
+     *  Computes 64 bit hashes of the simulation state on the GPU. The hashes are read back a few frames later without
+     *  waiting for the GPU and the most recent ones are kept for comparing them to the hashes of the coordinator.
+     *  Only bit-identical states have the same hash, so floating point states only match on identical GPUs and drivers.
+     */
+    class StateHasher
+    {
+    public:
+        explicit StateHasher(ApplicationNodeBase* appNode);
+        StateHasher(const StateHasher&) = delete;
+        StateHasher& operator=(const StateHasher&) = delete;
+        ~StateHasher();
+
+        /** Starts hashing the state after the given iteration (dropped if too many hashes are still in flight). */
+        void Hash(GLuint stateTexture, StateFormat format, const glm::uvec2& size, std::uint64_t iteration);
+        /** Reads back finished hashes (does not wait for the GPU). */
+        void Poll();
+        /** Looks up the hash of a recent iteration, returns false if it is not known (yet). */
+        bool FindHash(std::uint64_t iteration, std::uint64_t& hash) const;
+        /** Returns the newest hash read back. */
+        const StateHash& GetLatestHash() const { return latestHash_; }
+        /** Drops all pending and known hashes (after the state was replaced). */
+        void Clear();
+
+    private:
+        /** A hash computed on the GPU but not read back yet. */
+        struct PendingHash {
+            GLuint buffer_ = 0;
+            GLsync fence_ = nullptr;
+            std::uint64_t iteration_ = 0;
+        };
+
+        /** The number of hashes that can be in flight. */
+        static constexpr std::size_t NUM_PENDING_HASHES = 4;
+        /** The number of hashes kept for comparisons. */
+        static constexpr std::size_t HASH_HISTORY_SIZE = 16;
+
+        /** The hash programs for floating point and fixed point states. */
+        std::shared_ptr<GPUProgram> hashProgram_;
+        std::shared_ptr<GPUProgram> hashFixedProgram_;
+        GLint hashStateLoc_ = -1;
+        GLint hashFixedStateLoc_ = -1;
+
+        /** The hashes in flight. */
+        std::array<PendingHash, NUM_PENDING_HASHES> pendingHashes_;
+        /** The hashes read back (ring buffer). */
+        std::array<StateHash, HASH_HISTORY_SIZE> hashHistory_;
+        std::size_t nextHistoryEntry_ = 0;
+        /** The newest hash read back. */
+        StateHash latestHash_;
+    };
+}
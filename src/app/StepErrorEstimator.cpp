@@ -0,0 +1,102 @@
+/**
+ * @file   StepErrorEstimator.cpp
+ *
+ * @brief  Implementation of the estimation of the local error of a simulation time step.
+ */
+
+#include "core/open_gl.h"
+#include "StepErrorEstimator.h"
+#include "core/app/ApplicationNodeBase.h"
+#include <algorithm>
+#include <cstring>
+
+namespace viscom {
+
+    /** Has to match LOCAL_SIZE in stepError.comp. */
+    constexpr GLuint STEP_ERROR_LOCAL_SIZE = 16;
+
+    StepErrorEstimator::StepErrorEstimator(ApplicationNodeBase* appNode)
+    {
+        errorProgram_ = appNode->GetGPUProgramManager().GetResource("stepError", std::vector<std::string>{ "stepError.comp" });
+        errorFixedProgram_ = appNode->GetGPUProgramManager().GetResource("stepErrorFixed16", std::vector<std::string>{ "stepError.comp" },
+            std::vector<std::string>{ "STATE_FIXED16" });
+        errorStateLoc_ = errorProgram_->getUniformLocation("state");
+        errorStepDtLoc_ = errorProgram_->getUniformLocation("step_dt");
+        errorFixedStateLoc_ = errorFixedProgram_->getUniformLocation("state");
+        errorFixedStepDtLoc_ = errorFixedProgram_->getUniformLocation("step_dt");
+
+        for (auto& pendingError : pendingErrors_) {
+            glGenBuffers(1, &pendingError.buffer_);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, pendingError.buffer_);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    StepErrorEstimator::~StepErrorEstimator()
+    {
+        for (auto& pendingError : pendingErrors_) {
+            if (pendingError.fence_ != nullptr) glDeleteSync(pendingError.fence_);
+            glDeleteBuffers(1, &pendingError.buffer_);
+        }
+    }
+
+    void StepErrorEstimator::Estimate(GLuint stateTexture, StateFormat format, const glm::uvec2& size, std::uint64_t iteration, float dt, float effectiveDt)
+    {
+        // with all estimates in flight this one is skipped, the controller only needs a recent one.
+        const auto pendingError = std::find_if(pendingErrors_.begin(), pendingErrors_.end(), [](const PendingError& error) { return error.fence_ == nullptr; });
+        if (pendingError == pendingErrors_.end()) return;
+
+        const GLuint zero = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, pendingError->buffer_);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), &zero);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, pendingError->buffer_);
+
+        const auto fixedPoint = format == StateFormat::Fixed16;
+        glUseProgram(fixedPoint ? errorFixedProgram_->getProgramId() : errorProgram_->getProgramId());
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, stateTexture);
+        glUniform1i(fixedPoint ? errorFixedStateLoc_ : errorStateLoc_, 0);
+        glUniform1f(fixedPoint ? errorFixedStepDtLoc_ : errorStepDtLoc_, effectiveDt);
+        glDispatchCompute((size.x + STEP_ERROR_LOCAL_SIZE - 1) / STEP_ERROR_LOCAL_SIZE, (size.y + STEP_ERROR_LOCAL_SIZE - 1) / STEP_ERROR_LOCAL_SIZE, 1);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+
+        pendingError->iteration_ = iteration;
+        pendingError->dt_ = dt;
+        pendingError->fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    void StepErrorEstimator::Poll()
+    {
+        for (auto& pendingError : pendingErrors_) {
+            if (pendingError.fence_ == nullptr) continue;
+            const auto status = glClientWaitSync(pendingError.fence_, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) continue;
+            glDeleteSync(pendingError.fence_);
+            pendingError.fence_ = nullptr;
+
+            // the shader takes the maximum of the bits, which orders non-negative floats like their values.
+            GLuint maxErrorBits = 0;
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, pendingError.buffer_);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(maxErrorBits), &maxErrorBits);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+            if (pendingError.iteration_ < latestError_.iteration_) continue;
+            latestError_.iteration_ = pendingError.iteration_;
+            latestError_.dt_ = pendingError.dt_;
+            std::memcpy(&latestError_.error_, &maxErrorBits, sizeof(latestError_.error_));
+        }
+    }
+
+    void StepErrorEstimator::Clear()
+    {
+        for (auto& pendingError : pendingErrors_) {
+            if (pendingError.fence_ != nullptr) glDeleteSync(pendingError.fence_);
+            pendingError.fence_ = nullptr;
+        }
+        latestError_ = StepError{};
+    }
+}
@@ -0,0 +1,79 @@
+/**
+ * @file   StepErrorEstimator.h
+ *
+ * @brief  Declaration of the estimation of the local error of a simulation time step.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "app/SimulationData.h"
+#include <array>
+
+namespace viscom {
+
+    class ApplicationNodeBase;
+    class GPUProgram;
+
+    /** The estimated error of a time step. */
+    struct StepError {
+        /** The iteration the error was estimated at (0 if nothing was estimated yet). */
+        std::uint64_t iteration_ = 0;
+        /** The time step in the units of the parameters' dt. */
+        float dt_ = 0.0f;
+        /** The maximum error of A or B after a single step. */
+        float error_ = 0.0f;
+    };
+
+    /**
+     *  Estimates the local error of the next time step by step doubling: a compute pass advances a copy of every cell
+     *  by one full and by two half steps and reduces the largest difference (stepError.comp). The state is not
+     *  changed and the results are read back asynchronously with fences like the ConvergenceMonitor's.
+     */
+    class StepErrorEstimator
+    {
+    public:
+        explicit StepErrorEstimator(ApplicationNodeBase* appNode);
+        StepErrorEstimator(const StepErrorEstimator&) = delete;
+        StepErrorEstimator& operator=(const StepErrorEstimator&) = delete;
+        ~StepErrorEstimator();
+
+        /**
+         *  Estimates the error of a step of dt (in the units of the parameters' dt, effectiveDt after the grid scaling)
+         *  from the state before the given iteration. The simulation parameters have to be bound.
+         */
+        void Estimate(GLuint stateTexture, StateFormat format, const glm::uvec2& size, std::uint64_t iteration, float dt, float effectiveDt);
+        /** Reads back finished estimates (does not wait for the GPU). */
+        void Poll();
+        /** Drops pending estimates (after the state was replaced). */
+        void Clear();
+
+        /** Returns the newest estimate read back. */
+        const StepError& GetLatestError() const { return latestError_; }
+
+    private:
+        /** An estimate computed on the GPU but not read back yet. */
+        struct PendingError {
+            GLuint buffer_ = 0;
+            GLsync fence_ = nullptr;
+            std::uint64_t iteration_ = 0;
+            float dt_ = 0.0f;
+        };
+
+        /** The number of estimates that can be in flight. */
+        static constexpr std::size_t NUM_PENDING_ERRORS = 4;
+
+        /** The programs for floating point and fixed point states and their uniform locations. */
+        std::shared_ptr<GPUProgram> errorProgram_;
+        std::shared_ptr<GPUProgram> errorFixedProgram_;
+        GLint errorStateLoc_ = -1;
+        GLint errorStepDtLoc_ = -1;
+        GLint errorFixedStateLoc_ = -1;
+        GLint errorFixedStepDtLoc_ = -1;
+
+        /** The estimates in flight. */
+        std::array<PendingError, NUM_PENDING_ERRORS> pendingErrors_;
+        /** The newest estimate read back. */
+        StepError latestError_;
+    };
+}
@@ -0,0 +1,99 @@
+/**
+ * @file   TimestepController.cpp
+ *
+ * @brief  Implementation of the controller choosing the simulation time step from the estimated error.
+ */
+
+#include "TimestepController.h"
+#include "app/SimulationData.h"
+#include <limits>
+#include <spdlog/spdlog.h>
+
+namespace viscom {
+
+    namespace {
+        /** Returns the time step of the dt of the parameters within the bounds of the adaptive time step. */
+        float GetInitialTimestep(const SimulationData& simData, const SimulationParameters& parameters)
+        {
+            return glm::clamp(parameters.dt_, simData.minTimestep_, glm::max(simData.minTimestep_, glm::min(simData.maxTimestep_, GetMaxStableTimestep(parameters))));
+        }
+    }
+
+    float GetMaxStableTimestep(const SimulationParameters& parameters)
+    {
+        // the grid scaling keeps dt * diffusion rate, so the limit holds for the effective parameters as well.
+        const auto maxDiffusion = glm::max(parameters.diffusion_rate_a_, parameters.diffusion_rate_b_);
+        return maxDiffusion > 0.0f ? TIMESTEP_STABILITY_LIMIT / maxDiffusion : std::numeric_limits<float>::max();
+    }
+
+    void TimestepController::FallBackToParameters(SimulationData& simData, const SimulationParameters& parameters, std::uint64_t iteration, TimestepChangeReason reason)
+    {
+        auto& schedule = simData.timestepSchedule_;
+        const auto initialTimestep = GetInitialTimestep(simData, parameters);
+        const auto timestep = schedule.GetTimestep(iteration);
+        if (timestep > initialTimestep) schedule.Add(iteration, initialTimestep, reason, parameters.dt_);
+    }
+
+    void TimestepController::NotifySeed(SimulationData& simData, const SimulationParameters& parameters, std::uint64_t iteration)
+    {
+        if (simData.adaptiveTimestep_) FallBackToParameters(simData, parameters, iteration, TimestepChangeReason::Seed);
+    }
+
+    void TimestepController::NotifyReset(SimulationData& simData, const SimulationParameters& parameters, std::uint64_t iteration)
+    {
+        // the change is added even if the time step stays, it starts the simulated time again.
+        auto& schedule = simData.timestepSchedule_;
+        const auto timestep = schedule.GetTimestep(iteration);
+        const auto initialTimestep = simData.adaptiveTimestep_ ? GetInitialTimestep(simData, parameters) : 0.0f;
+        schedule.Add(iteration, timestep > 0.0f ? glm::min(timestep, initialTimestep) : initialTimestep, TimestepChangeReason::Reset, parameters.dt_);
+    }
+
+    void TimestepController::Update(SimulationData& simData, const SimulationParameters& parameters, const std::vector<StepError>& nodeErrors,
+        std::uint64_t slowestNodeIteration)
+    {
+        auto& schedule = simData.timestepSchedule_;
+        const auto latestChange = schedule.GetLatestChange();
+        const auto timestep = latestChange == nullptr ? 0.0f : latestChange->dt_;
+        // seeds of a paused simulation are scheduled after the global iteration count and have to stay.
+        const auto iteration = glm::max(simData.currentGlobalIterationCount_, latestChange == nullptr ? std::uint64_t{ 0 } : latestChange->iteration_);
+
+        // switching the mode is scheduled like every other change, so the nodes switch at the same iteration.
+        if (!simData.adaptiveTimestep_) {
+            if (timestep > 0.0f) schedule.Add(iteration, 0.0f, TimestepChangeReason::Mode, parameters.dt_);
+            return;
+        }
+        if (timestep == 0.0f) {
+            const auto initialTimestep = GetInitialTimestep(simData, parameters);
+            schedule.Add(iteration, initialTimestep, TimestepChangeReason::Mode, parameters.dt_);
+            spdlog::info("Adaptive time step starting with dt = {} at iteration {}.", initialTimestep, iteration);
+            return;
+        }
+        if (nodeErrors.empty()) return;
+
+        // estimates from before the last change describe a different time step or state.
+        const auto& coordinatorError = nodeErrors.front();
+        if (coordinatorError.iteration_ < latestChange->iteration_ || coordinatorError.iteration_ == lastEstimateIteration_) return;
+        auto maxError = 0.0f;
+        auto allowedTimestep = std::numeric_limits<float>::max();
+        for (const auto& error : nodeErrors) {
+            if (error.iteration_ < latestChange->iteration_ || error.dt_ <= 0.0f) return;
+            const auto factor = error.error_ > 0.0f ? TIMESTEP_SAFETY * glm::sqrt(simData.timestepTolerance_ / error.error_) : TIMESTEP_MAX_FACTOR;
+            allowedTimestep = glm::min(allowedTimestep, error.dt_ * glm::clamp(factor, TIMESTEP_MIN_FACTOR, TIMESTEP_MAX_FACTOR));
+            maxError = glm::max(maxError, error.error_);
+        }
+        lastEstimateIteration_ = coordinatorError.iteration_;
+        lastError_ = maxError;
+        const auto maxTimestep = glm::max(simData.minTimestep_, glm::min(simData.maxTimestep_, GetMaxStableTimestep(parameters)));
+        proposedTimestep_ = glm::clamp(allowedTimestep, simData.minTimestep_, maxTimestep);
+
+        // a node that has not reached the last change yet still needs the changes before it.
+        if (slowestNodeIteration < latestChange->iteration_) return;
+        // larger steps wait a few iterations, so a front that just started is measured again first.
+        const auto growing = proposedTimestep_ > timestep;
+        if (growing && iteration < latestChange->iteration_ + TIMESTEP_CONTROL_INTERVAL) return;
+        // the bounds are always applied, otherwise small changes are not worth the synchronization.
+        const auto outOfBounds = timestep < simData.minTimestep_ || timestep > maxTimestep;
+        if (!outOfBounds && glm::abs(proposedTimestep_ - timestep) < TIMESTEP_MIN_CHANGE * timestep) return;
+        schedule.Add(iteration, proposedTimestep_, TimestepChangeReason::ErrorEstimate, parameters.dt_);
+    }
+}
@@ -0,0 +1,69 @@
+/**
+ * @file   TimestepController.h
+ *
+ * @brief  Declaration of the controller choosing the simulation time step from the estimated error.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include "app/StepErrorEstimator.h"
+#include <vector>
+
+namespace viscom {
+
+    struct SimulationData;
+    struct SimulationParameters;
+
+    /** The fraction of the time step allowed by the error estimate that is used. */
+    constexpr float TIMESTEP_SAFETY = 0.9f;
+    /** The factors the time step may change by at once. */
+    constexpr float TIMESTEP_MIN_FACTOR = 0.25f;
+    constexpr float TIMESTEP_MAX_FACTOR = 2.0f;
+    /** Relative changes below this are not scheduled (every change is synchronized and stops a compute batch). */
+    constexpr float TIMESTEP_MIN_CHANGE = 0.1f;
+    /** The minimum iterations between two changes from the error estimate. */
+    constexpr std::uint64_t TIMESTEP_CONTROL_INTERVAL = 16;
+    /** The largest dt * diffusion rate used: the explicit step of the 9 point Laplacian is unstable above 1.25. */
+    constexpr float TIMESTEP_STABILITY_LIMIT = 1.0f;
+
+    /** Returns the largest time step the explicit scheme is stable for with the given parameters (in the units of their dt). */
+    float GetMaxStableTimestep(const SimulationParameters& parameters);
+
+    /**
+     *  Chooses the time step of the adaptive integration (coordinator side) and adds it to the schedule in the
+     *  SimulationData, so all nodes use it from the same iteration on. Forward Euler has a local error of O(dt^2),
+     *  so the time step is scaled by TIMESTEP_SAFETY * sqrt(tolerance / error) of the newest estimate of each node.
+     *  Seed points and resets fall back to the dt of the parameters right away, the estimates then grow it again.
+     */
+    class TimestepController
+    {
+    public:
+        /** Schedules the time step for seed points added before the given iteration. */
+        void NotifySeed(SimulationData& simData, const SimulationParameters& parameters, std::uint64_t iteration);
+        /** Schedules the time step for a reset before the given iteration (the simulated time starts again). */
+        void NotifyReset(SimulationData& simData, const SimulationParameters& parameters, std::uint64_t iteration);
+        /**
+         *  Adds the newest estimate of each node (the coordinator's first) and schedules a new time step at the global
+         *  iteration count if it differs enough. Changes wait until the slowest node reached the previous one.
+         */
+        void Update(SimulationData& simData, const SimulationParameters& parameters, const std::vector<StepError>& nodeErrors,
+            std::uint64_t slowestNodeIteration);
+
+        /** Returns the largest error of the last estimates taken into account. */
+        float GetLastError() const { return lastError_; }
+        /** Returns the time step the last estimates allowed. */
+        float GetProposedTimestep() const { return proposedTimestep_; }
+
+    private:
+        /** Schedules the dt of the parameters (within the bounds) if the current time step is larger. */
+        void FallBackToParameters(SimulationData& simData, const SimulationParameters& parameters, std::uint64_t iteration, TimestepChangeReason reason);
+
+        /** The newest coordinator estimate taken into account. */
+        std::uint64_t lastEstimateIteration_ = 0;
+        /** The largest error of the last estimates taken into account. */
+        float lastError_ = 0.0f;
+        /** The time step the last estimates allowed. */
+        float proposedTimestep_ = 0.0f;
+    };
+}
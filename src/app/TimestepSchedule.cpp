@@ -0,0 +1,63 @@
+/**
+ * @file   TimestepSchedule.cpp
+ *
+ * @brief  Implementation of the time steps of the iterations shared by all nodes.
+ */
+
+#include "TimestepSchedule.h"
+#include <algorithm>
+
+namespace viscom {
+
+    const TimestepChange* TimestepSchedule::Find(std::uint64_t iteration) const
+    {
+        const auto end = changes_.begin() + numChanges_;
+        const auto next = std::upper_bound(changes_.begin(), end, iteration, [](std::uint64_t value, const TimestepChange& change) { return value < change.iteration_; });
+        return next == changes_.begin() ? nullptr : &*(next - 1);
+    }
+
+    float TimestepSchedule::GetTimestep(std::uint64_t iteration) const
+    {
+        const auto change = Find(iteration);
+        return change == nullptr ? 0.0f : change->dt_;
+    }
+
+    double TimestepSchedule::GetTime(std::uint64_t iteration, float parametersDt) const
+    {
+        // iterations before the oldest change use the dt of the parameters.
+        const auto change = Find(iteration);
+        if (change == nullptr) return static_cast<double>(iteration) * parametersDt;
+        const auto dt = change->dt_ > 0.0f ? change->dt_ : parametersDt;
+        return change->time_ + static_cast<double>(iteration - change->iteration_) * dt;
+    }
+
+    bool TimestepSchedule::IsChangeIteration(std::uint64_t iteration) const
+    {
+        const auto end = changes_.begin() + numChanges_;
+        return std::any_of(changes_.begin(), end, [iteration](const TimestepChange& change) { return change.iteration_ == iteration; });
+    }
+
+    const TimestepChange* TimestepSchedule::GetLatestChange() const
+    {
+        return numChanges_ == 0 ? nullptr : &changes_[numChanges_ - 1];
+    }
+
+    void TimestepSchedule::Add(std::uint64_t iteration, float dt, TimestepChangeReason reason, float parametersDt)
+    {
+        TimestepChange change;
+        change.iteration_ = iteration;
+        change.time_ = reason == TimestepChangeReason::Reset ? 0.0 : GetTime(iteration, parametersDt);
+        change.dt_ = dt;
+        change.reason_ = reason;
+
+        // changes after the new one were never simulated (they are after the global iteration count as well).
+        while (numChanges_ > 0 && changes_[numChanges_ - 1].iteration_ >= iteration) --numChanges_;
+        if (numChanges_ == changes_.size()) {
+            std::move(changes_.begin() + 1, changes_.end(), changes_.begin());
+            --numChanges_;
+        }
+        changes_[numChanges_++] = change;
+        // unused entries are zero, so equal schedules have equal bytes.
+        std::fill(changes_.begin() + numChanges_, changes_.end(), TimestepChange{});
+    }
+}
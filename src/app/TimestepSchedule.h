@@ -0,0 +1,66 @@
+/**
+ * @file   TimestepSchedule.h
+ *
+ * @brief  Declaration of the time steps of the iterations shared by all nodes.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace viscom {
+
+    /** The number of time step changes kept (a node lagging behind more changes diverges until the state check resyncs it). */
+    constexpr std::size_t TIMESTEP_SCHEDULE_SIZE = 16;
+
+    /** Why the time step changed. */
+    enum class TimestepChangeReason : std::uint32_t {
+        /** The adaptive time step was switched on or off. */
+        Mode = 0,
+        /** The error estimate allowed a larger or required a smaller time step. */
+        ErrorEstimate = 1,
+        /** Seed points were added (the fronts around them need small steps). */
+        Seed = 2,
+        /** The simulation was reset (the simulated time starts at 0 again). */
+        Reset = 3
+    };
+
+    /** A change of the time step before an iteration (no padding, the schedule is compared bytewise). */
+    struct TimestepChange {
+        /** The first iteration using the time step. */
+        std::uint64_t iteration_ = 0;
+        /** The simulated time before the iteration. */
+        double time_ = 0.0;
+        /** The time step in the units of the parameters' dt (0 uses the dt of the parameters). */
+        float dt_ = 0.0f;
+        TimestepChangeReason reason_ = TimestepChangeReason::Mode;
+    };
+    static_assert(sizeof(TimestepChange) == 24, "TimestepChange has to be free of padding.");
+
+    /**
+     *  The time step of every iteration as a list of changes. The coordinator only adds changes after the global
+     *  iteration count synchronized last, which no node has simulated yet, so every node uses the same time step in
+     *  every iteration and the simulated time is a function of the iteration (has to stay trivially copyable).
+     */
+    struct TimestepSchedule {
+        /** Returns the time step of an iteration (0 if it uses the dt of the parameters). */
+        float GetTimestep(std::uint64_t iteration) const;
+        /** Returns the simulated time before an iteration, parametersDt is used for iterations without a time step. */
+        double GetTime(std::uint64_t iteration, float parametersDt) const;
+        /** Returns if the time step changes before the given iteration. */
+        bool IsChangeIteration(std::uint64_t iteration) const;
+        /** Returns the newest change (nullptr if there is none). */
+        const TimestepChange* GetLatestChange() const;
+        /** Adds a change before the given iteration (replaces later ones), the simulated time continues unless it is a reset. */
+        void Add(std::uint64_t iteration, float dt, TimestepChangeReason reason, float parametersDt);
+
+        /** The changes ordered by iteration, the oldest ones are dropped. */
+        std::array<TimestepChange, TIMESTEP_SCHEDULE_SIZE> changes_{};
+        std::uint64_t numChanges_ = 0;
+
+    private:
+        /** Returns the newest change at or before the iteration (nullptr if there is none). */
+        const TimestepChange* Find(std::uint64_t iteration) const;
+    };
+}
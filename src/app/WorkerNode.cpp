@@ -7,11 +7,20 @@
  */
 
 #include "WorkerNode.h"
+#include "app/IterationScheduler.h"
+#include "app/SimulationParameterBlock.h"
+#include "app/ConvergenceMonitor.h"
+#include "app/StepErrorEstimator.h"
+#include "app/FrameProfiler.h"
 #include <imgui.h>
+#include <spdlog/spdlog.h>
 #include "core/open_gl.h"
 
 namespace viscom {
 
+    /** The time in seconds after which an unanswered snapshot request is repeated. */
+    constexpr double SNAPSHOT_REQUEST_TIMEOUT = 5.0;
+
     WorkerNode::WorkerNode(ApplicationNodeInternal* appNode) :
         ApplicationNodeImplementation{ appNode }
     {
@@ -21,34 +30,123 @@ namespace viscom {
 
     void WorkerNode::UpdateSyncedInfo()
     {
+        RD_PROFILE_BEGIN_FRAME(GetFrameProfiler());
         ApplicationNodeImplementation::UpdateSyncedInfo();
 #ifdef VISCOM_USE_SGCT
-        GetSimulationData() = sharedData_.getVal();
-        auto tmpSeedPoints = sharedSeedPoints_.getVal();
-        for (const auto& tsp : tmpSeedPoints) GetSeedPoints().push_back(tsp);
+        RD_PROFILE_SCOPE(GetFrameProfiler(), SyncDecode);
+        // a worker that just joined waits for the next key frame.
+        if (syncDecoder_.Decode(sharedSyncPayload_.getVal(), GetSimulationParameters(), GetSeedEvents())) {
+            GetSimulationData() = syncDecoder_.GetSimulationData();
+            if (GetSimulationDomain().IsDecomposed()) GetSimulationDomain().SetTiles(syncDecoder_.GetDomainTiles());
+        }
 #endif
 
-        // iterate GetSeedPoints, delete all seed points before current time
-        auto lastDel = GetSeedPoints().begin();
-        for (; lastDel != GetSeedPoints().end() && lastDel->first < GetCurrentLocalIterationCount(); ++lastDel);
-        if (lastDel != GetSeedPoints().begin()) {
-            GetSeedPoints().erase(GetSeedPoints().begin(), lastDel);
+        GetSeedEvents().Retire(GetCurrentLocalIterationCount());
+    }
+
+    void WorkerNode::UpdateFrame(double currentTime, double elapsedTime)
+    {
+#ifdef VISCOM_USE_SGCT
+        // a snapshot replaces the state before this frame's iterations, so the node catches up from it right away.
+        auto applySnapshot = false;
+        {
+            std::lock_guard<std::mutex> lock{ snapshotMutex_ };
+            if (snapshotReceived_) {
+                snapshot_.swap(receivedSnapshot_);
+                snapshotReceived_ = false;
+                applySnapshot = true;
+            }
         }
+        if (applySnapshot && ApplyStateSnapshot(snapshot_)) {
+            ++receivedSnapshots_;
+            snapshotRequested_ = false;
+            checkedHashIteration_ = GetCurrentLocalIterationCount();
+        }
+#endif
+
+        ApplicationNodeImplementation::UpdateFrame(currentTime, elapsedTime);
+
+#ifdef VISCOM_USE_SGCT
+        CheckStateHash(currentTime);
+
+        // report the progress to the coordinator (node 0), which throttles the global rate to the slowest node.
+        WorkerSchedulingStatus status;
+        status.localIterationCount_ = GetCurrentLocalIterationCount();
+        status.globalIterationCount_ = GetSimulationData().currentGlobalIterationCount_;
+        status.affordableIterations_ = GetIterationScheduler().GetAffordableIterations(GetSimulationData());
+        status.stateHashMismatches_ = stateHashMismatches_;
+        status.receivedSnapshots_ = receivedSnapshots_;
+        status.iterationTime_ = GetIterationScheduler().GetIterationTime();
+        status.syncDecodeTime_ = syncDecoder_.GetStatistics().codingTime_;
+        status.domainTile_ = GetSimulationDomain().GetTile();
+        status.stateChangeIteration_ = GetConvergenceMonitor().GetLatestChange().iteration_;
+        status.stateChange_ = GetConvergenceMonitor().GetLatestChange().maxChange_;
+        status.stepErrorIteration_ = GetStepErrorEstimator().GetLatestError().iteration_;
+        status.stepErrorTimestep_ = GetStepErrorEstimator().GetLatestError().dt_;
+        status.stepError_ = GetStepErrorEstimator().GetLatestError().error_;
+#ifdef RD_PROFILING
+        for (std::size_t phase = 0; phase < PROFILE_PHASE_COUNT; ++phase) {
+            status.phaseCPUTimes_[phase] = GetFrameProfiler().GetAverage(static_cast<ProfilePhase>(phase), false);
+            status.phaseGPUTimes_[phase] = GetFrameProfiler().GetAverage(static_cast<ProfilePhase>(phase), true);
+        }
+#endif
+        TransferDataToNode(&status, sizeof(status), static_cast<std::uint16_t>(ClusterPackage::WorkerStatus), 0);
+#endif
     }
 
 #ifdef VISCOM_USE_SGCT
+    void WorkerNode::CheckStateHash(double currentTime)
+    {
+        // the coordinator hash is compared as soon as the local state of the same iteration was hashed.
+        const auto& reference = syncDecoder_.GetStateHash();
+        std::uint64_t localHash = 0;
+        if (reference.iteration_ == 0 || reference.iteration_ == checkedHashIteration_ || !GetStateHasher().FindHash(reference.iteration_, localHash)) return;
+
+        checkedHashIteration_ = reference.iteration_;
+        if (localHash == reference.hash_) return;
+
+        ++stateHashMismatches_;
+        spdlog::warn("State of iteration {} differs from the coordinator (hash {:016x}, expected {:016x}).", reference.iteration_, localHash, reference.hash_);
+        RequestStateSnapshot(reference.iteration_, currentTime);
+    }
+
+    void WorkerNode::RequestStateSnapshot(std::uint64_t iteration, double currentTime)
+    {
+        if (snapshotRequested_ && currentTime - snapshotRequestTime_ < SNAPSHOT_REQUEST_TIMEOUT) return;
+
+        StateSnapshotRequest request;
+        request.iteration_ = iteration;
+        TransferDataToNode(&request, sizeof(request), static_cast<std::uint16_t>(ClusterPackage::SnapshotRequest), 0);
+        snapshotRequested_ = true;
+        snapshotRequestTime_ = currentTime;
+    }
+
     void WorkerNode::EncodeData()
     {
         ApplicationNodeImplementation::EncodeData();
-        sgct::SharedData::instance()->writeObj(&sharedData_);
-        sgct::SharedData::instance()->writeVector(&sharedSeedPoints_);
+        sgct::SharedData::instance()->writeVector(&sharedSyncPayload_);
     }
 
     void WorkerNode::DecodeData()
     {
+        RD_PROFILE_BEGIN_FRAME(GetFrameProfiler());
+        RD_PROFILE_SCOPE(GetFrameProfiler(), SyncDecode);
         ApplicationNodeImplementation::DecodeData();
-        sgct::SharedData::instance()->readObj(&sharedData_);
-        sgct::SharedData::instance()->readVector(&sharedSeedPoints_);
+        sgct::SharedData::instance()->readVector(&sharedSyncPayload_);
+    }
+
+    bool WorkerNode::DataTransferCallback(void* receivedData, int receivedLength, std::uint16_t packageID, int clientID)
+    {
+        if (packageID != static_cast<std::uint16_t>(ClusterPackage::SnapshotChunk)) {
+            return ApplicationNodeImplementation::DataTransferCallback(receivedData, receivedLength, packageID, clientID);
+        }
+
+        std::lock_guard<std::mutex> lock{ snapshotMutex_ };
+        if (snapshotAssembler_.AddChunk(receivedData, static_cast<std::size_t>(receivedLength))) {
+            snapshotAssembler_.TakeSnapshot(receivedSnapshot_);
+            snapshotReceived_ = true;
+        }
+        return true;
     }
 #endif
 
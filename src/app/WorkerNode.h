@@ -9,6 +9,10 @@
 #pragma once
 
 #include "app/ApplicationNodeImplementation.h"
+#include "app/StateSync.h"
+#include "app/SimulationDomain.h"
+#include "app/ClusterSync.h"
+#include <mutex>
 
 namespace viscom {
 
@@ -19,15 +23,44 @@ namespace viscom {
         virtual ~WorkerNode() override;
 
         virtual void UpdateSyncedInfo() override;
+        virtual void UpdateFrame(double currentTime, double elapsedTime) override;
 
 #ifdef VISCOM_USE_SGCT
         virtual void EncodeData() override;
         virtual void DecodeData() override;
+        virtual bool DataTransferCallback(void* receivedData, int receivedLength, std::uint16_t packageID, int clientID) override;
 
     private:
-        /** Holds the data shared by the master. */
-        sgct::SharedObject<SimulationData> sharedData_;
-        sgct::SharedVector<SeedPoint> sharedSeedPoints_;
+        /** Compares the local state hash to the one of the coordinator and requests a snapshot on a mismatch. */
+        void CheckStateHash(double currentTime);
+        /** Asks the coordinator for a snapshot of its state (repeated only after a timeout). */
+        void RequestStateSnapshot(std::uint64_t iteration, double currentTime);
+
+        /** Holds the encoded data shared by the master. */
+        sgct::SharedVector<std::uint8_t> sharedSyncPayload_;
+        /** Decodes the payloads and keeps the data that is only sent after a change. */
+        ClusterSyncDecoder syncDecoder_;
+
+        /** The iteration of the last coordinator hash compared to the local one. */
+        std::uint64_t checkedHashIteration_ = 0;
+        /** The number of local hashes that did not match the coordinator. */
+        std::uint64_t stateHashMismatches_ = 0;
+        /** The number of snapshots applied. */
+        std::uint64_t receivedSnapshots_ = 0;
+        /** Set while a requested snapshot has not arrived. */
+        bool snapshotRequested_ = false;
+        /** The time of the last snapshot request. */
+        double snapshotRequestTime_ = 0.0;
+
+        /** Reassembles the snapshot parts (network thread). */
+        StateSnapshotAssembler snapshotAssembler_;
+        /** The last snapshot received completely, swapped into snapshot_ on the main thread. */
+        std::vector<std::uint8_t> receivedSnapshot_;
+        bool snapshotReceived_ = false;
+        /** Protects snapshotAssembler_, receivedSnapshot_ and snapshotReceived_. */
+        std::mutex snapshotMutex_;
+        /** The snapshot being applied. */
+        std::vector<std::uint8_t> snapshot_;
 #endif
     };
 
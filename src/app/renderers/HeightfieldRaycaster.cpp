@@ -8,14 +8,29 @@
 
 #include "HeightfieldRaycaster.h"
 #include "app/ApplicationNodeImplementation.h"
+#include "app/FrameProfiler.h"
 #include <imgui.h>
 #include <glm/gtc/type_ptr.hpp>
 #include "core/open_gl.h"
 
 namespace viscom::renderers {
 
+    namespace {
+        /** Returns the element of the Halton sequence with the given index and base (in [0, 1)). */
+        float Halton(std::uint64_t index, std::uint64_t base)
+        {
+            auto result = 0.0f;
+            auto fraction = 1.0f;
+            for (; index > 0; index /= base) {
+                fraction /= static_cast<float>(base);
+                result += fraction * static_cast<float>(index % base);
+            }
+            return result;
+        }
+    }
+
     HeightfieldRaycaster::HeightfieldRaycaster(ApplicationNodeImplementation* appNode) :
-        RDRenderer{ "HeightfieldRaycaster", appNode }
+        RDRenderer{ "HeightfieldRaycaster", DerivedOutput::Height | DerivedOutput::Normals | DerivedOutput::MinMaxPyramid, appNode }
     {
         FrameBufferDescriptor simulationBackFBDesc;
         simulationBackFBDesc.texDesc_.emplace_back(GL_RG32F, GL_TEXTURE_2D);
@@ -26,24 +41,44 @@ namespace viscom::renderers {
         raycastBackVPLoc_ = raycastBackProgram_->getUniformLocation("viewProjectionMatrix");
         raycastBackQuadSizeLoc_ = raycastBackProgram_->getUniformLocation("quadSize");
         raycastBackDistanceLoc_ = raycastBackProgram_->getUniformLocation("distance");
-        raycastProgram_ = appNode_->GetGPUProgramManager().GetResource("raycastHeightfield", std::vector<std::string>{ "raycastHeightfield.vert", "raycastHeightfield.frag" });
-        raycastVPLoc_ = raycastProgram_->getUniformLocation("viewProjectionMatrix");
-        raycastQuadSizeLoc_ = raycastProgram_->getUniformLocation("quadSize");
-        raycastDistanceLoc_ = raycastProgram_->getUniformLocation("distance");
-        raycastSimHeightLoc_ = raycastProgram_->getUniformLocation("simulationHeight");
-        raycastCamPosLoc_ = raycastProgram_->getUniformLocation("cameraPosition");
-        raycastEtaLoc_ = raycastProgram_->getUniformLocation("eta");
-        raycastSigmaALoc_ = raycastProgram_->getUniformLocation("sigma_a");
-        raycastEnvMapLoc_ = raycastProgram_->getUniformLocation("environment");
-        raycastBGTexLoc_ = raycastProgram_->getUniformLocation("backgroundTexture");
-        raycastHeightTextureLoc_ = raycastProgram_->getUniformLocation("heightTexture");
-        raycastPositionBackTexLoc_ = raycastProgram_->getUniformLocation("backPositionTexture");
+        raycastProgram_ = LoadRaycastProgram("raycastHeightfield", std::vector<std::string>{});
+        raycastReducedProgram_ = LoadRaycastProgram("raycastHeightfieldReduced", std::vector<std::string>{ "REDUCED_RESOLUTION" });
+        upsampleProgram_ = LoadRaycastProgram("raycastHeightfieldUpsample", std::vector<std::string>{ "UPSAMPLE" });
+        accumulation_.resize(simulationBackFBOs_.size());
 
         glGenVertexArrays(1, &simDummyVAO_);
         backgroundTexture_ = appNode_->GetTextureManager().GetResource("models/teapot/default.png");
         environmentMap_ = appNode_->GetTextureManager().GetResource("textures/grace_probe.hdr");
     }
 
+    HeightfieldRaycaster::RaycastProgram HeightfieldRaycaster::LoadRaycastProgram(const std::string& name, const std::vector<std::string>& defines) const
+    {
+        RaycastProgram result;
+        result.program_ = appNode_->GetGPUProgramManager().GetResource(name, std::vector<std::string>{ "raycastHeightfield.vert", "raycastHeightfield.frag" }, defines);
+        result.vpLoc_ = result.program_->getUniformLocation("viewProjectionMatrix");
+        result.quadSizeLoc_ = result.program_->getUniformLocation("quadSize");
+        result.distanceLoc_ = result.program_->getUniformLocation("distance");
+        result.simHeightLoc_ = result.program_->getUniformLocation("simulationHeight");
+        result.camPosLoc_ = result.program_->getUniformLocation("cameraPosition");
+        result.etaLoc_ = result.program_->getUniformLocation("eta");
+        result.sigmaALoc_ = result.program_->getUniformLocation("sigma_a");
+        result.envMapLoc_ = result.program_->getUniformLocation("environment");
+        result.bgTexLoc_ = result.program_->getUniformLocation("backgroundTexture");
+        result.heightTextureLoc_ = result.program_->getUniformLocation("heightTexture");
+        result.normalTextureLoc_ = result.program_->getUniformLocation("normalTexture");
+        result.minMaxPyramidLoc_ = result.program_->getUniformLocation("minMaxPyramid");
+        result.texCoordTransformLoc_ = result.program_->getUniformLocation("stateTexCoordTransform");
+        result.positionBackTexLoc_ = result.program_->getUniformLocation("backPositionTexture");
+        result.backPositionTransformLoc_ = result.program_->getUniformLocation("backPositionTransform");
+        result.reducedColorLoc_ = result.program_->getUniformLocation("reducedColor");
+        result.reducedHitLoc_ = result.program_->getUniformLocation("reducedHit");
+        result.reducedSizeLoc_ = result.program_->getUniformLocation("reducedSize");
+        result.reducedTransformLoc_ = result.program_->getUniformLocation("reducedTransform");
+        result.historyLoc_ = result.program_->getUniformLocation("history");
+        result.historyDecayLoc_ = result.program_->getUniformLocation("historyDecay");
+        return result;
+    }
+
     HeightfieldRaycaster::~HeightfieldRaycaster()
     {
         if (simDummyVAO_ != 0) glDeleteVertexArrays(1, &simDummyVAO_);
@@ -65,47 +100,193 @@ namespace viscom::renderers {
 
     void HeightfieldRaycaster::UpdateFrame(double, double, const SimulationData& simData, const glm::vec2& nearPlaneSize)
     {
+        renderResolution_.Update(simData);
+    }
+
+    void HeightfieldRaycaster::RenderRDResults(FrameBuffer& fbo, const SimulationData& simData, const glm::mat4& perspectiveMatrix, const DerivedOutputs& derivedOutputs)
+    {
+        const auto window = static_cast<std::size_t>(appNode_->SelectOffscreenBuffer(simulationBackFBOs_) - simulationBackFBOs_.data());
+        const auto resolution = renderResolution_.GetResolution();
+        const auto camPos = appNode_->GetCamera()->GetPosition();
+        const auto& quadSize = appNode_->GetSimulationOutputSize();
+        std::vector<float> parameters{ simData.simulationDrawDistance_, simData.simulationHeight_, simData.eta_,
+            simData.sigma_a_.r, simData.sigma_a_.g, simData.sigma_a_.b, camPos.x, camPos.y, camPos.z, quadSize.x, quadSize.y, resolution };
+
+        // frames are accumulated while the view of the window stays the same, a changing state only limits their weight.
+        auto& accumulation = accumulation_[window];
+        const auto accumulate = simData.temporalAccumulation_ && resolution < RENDER_RESOLUTION_MAX
+            && accumulation.viewProjection_ == perspectiveMatrix && accumulation.parameters_ == parameters;
+        const auto accumulatedFrames = accumulate ? glm::min(accumulation.frames_ + 1, TEMPORAL_ACCUMULATION_FRAMES) : std::uint64_t{ 0 };
+        const auto stateChanged = accumulation.stateVersion_ != derivedOutputs.GetStateVersion();
+
+        RenderCacheKey key{ derivedOutputs.GetStateVersion(), perspectiveMatrix, parameters };
+        key.parameters_.push_back(static_cast<float>(accumulatedFrames));
+        renderCache_.SetEnabled(simData.reuseFrames_);
+        renderCache_.Draw(fbo, key, [&]() {
+            renderResolution_.BeginMeasurement();
+            RenderRaycast(fbo, simData, perspectiveMatrix, derivedOutputs, resolution, window, accumulatedFrames, stateChanged);
+            renderResolution_.EndMeasurement();
+            accumulation.viewProjection_ = perspectiveMatrix;
+            accumulation.parameters_ = std::move(parameters);
+            accumulation.stateVersion_ = derivedOutputs.GetStateVersion();
+            accumulation.frames_ = accumulatedFrames;
+        });
+    }
+
+    void HeightfieldRaycaster::RenderRaycast(FrameBuffer& fbo, const SimulationData& simData, const glm::mat4& perspectiveMatrix, const DerivedOutputs& derivedOutputs,
+        float resolution, std::size_t window, std::uint64_t accumulatedFrames, bool stateChanged)
+    {
+        {
+            RD_PROFILE_GPU_SCOPE(appNode_->GetFrameProfiler(), RaycastBack);
+            appNode_->SelectOffscreenBuffer(simulationBackFBOs_)->DrawToFBO([this, &perspectiveMatrix, &simData]() {
+                glBindVertexArray(simDummyVAO_);
+                glUseProgram(raycastBackProgram_->getProgramId());
+                glUniformMatrix4fv(raycastBackVPLoc_, 1, GL_FALSE, glm::value_ptr(perspectiveMatrix));
+                glUniform2fv(raycastBackQuadSizeLoc_, 1, glm::value_ptr(appNode_->GetSimulationOutputSize()));
+                glUniform1f(raycastBackDistanceLoc_, simData.simulationDrawDistance_);
+                glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            });
+        }
+
+        RD_PROFILE_GPU_SCOPE(appNode_->GetFrameProfiler(), Raycast);
+        if (resolution < RENDER_RESOLUTION_MAX) {
+            RenderReducedResolution(fbo, simData, perspectiveMatrix, derivedOutputs, resolution, window, accumulatedFrames, stateChanged);
+            return;
+        }
+
+        fbo.DrawToFBO([this, &perspectiveMatrix, &simData, &derivedOutputs]() {
+            SetRaycastUniforms(raycastProgram_, simData, perspectiveMatrix, derivedOutputs);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        });
+    }
+
+    void HeightfieldRaycaster::SetRaycastUniforms(const RaycastProgram& program, const SimulationData& simData, const glm::mat4& perspectiveMatrix, const DerivedOutputs& derivedOutputs) const
+    {
+        glm::vec3 camPos = appNode_->GetCamera()->GetPosition();
+        glBindVertexArray(simDummyVAO_);
+        glUseProgram(program.program_->getProgramId());
+        glUniformMatrix4fv(program.vpLoc_, 1, GL_FALSE, glm::value_ptr(perspectiveMatrix));
+        glUniform2fv(program.quadSizeLoc_, 1, glm::value_ptr(appNode_->GetSimulationOutputSize()));
+        glUniform1f(program.distanceLoc_, simData.simulationDrawDistance_ - simData.simulationHeight_);
+        glUniform1f(program.simHeightLoc_, simData.simulationHeight_);
+        glUniform3fv(program.camPosLoc_, 1, glm::value_ptr(camPos));
+        glUniform1f(program.etaLoc_, simData.eta_);
+        glUniform3fv(program.sigmaALoc_, 1, glm::value_ptr(simData.sigma_a_));
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, environmentMap_->getTextureId());
+        glUniform1i(program.envMapLoc_, 0);
+
+        glActiveTexture(GL_TEXTURE0 + 1);
+        glBindTexture(GL_TEXTURE_2D, backgroundTexture_->getTextureId());
+        glUniform1i(program.bgTexLoc_, 1);
+
+        glActiveTexture(GL_TEXTURE0 + 2);
+        glBindTexture(GL_TEXTURE_2D, derivedOutputs.GetHeightTexture());
+        glUniform1i(program.heightTextureLoc_, 2);
+
+        glActiveTexture(GL_TEXTURE0 + 3);
+        glBindTexture(GL_TEXTURE_2D, derivedOutputs.GetNormalTexture());
+        glUniform1i(program.normalTextureLoc_, 3);
+
+        glActiveTexture(GL_TEXTURE0 + 4);
+        glBindTexture(GL_TEXTURE_2D, derivedOutputs.GetMinMaxPyramidTexture());
+        glUniform1i(program.minMaxPyramidLoc_, 4);
+        glUniform4fv(program.texCoordTransformLoc_, 1, glm::value_ptr(derivedOutputs.GetTexCoordTransform()));
+
+        glBindImageTexture(0, appNode_->SelectOffscreenBuffer(simulationBackFBOs_)->GetTextures()[0], 0, GL_FALSE, 0, GL_READ_ONLY, GL_RG32F);
+        glUniform1i(program.positionBackTexLoc_, 0);
+        glUniform4f(program.backPositionTransformLoc_, 1.0f, 1.0f, 0.0f, 0.0f);
     }
 
-    void HeightfieldRaycaster::RenderRDResults(FrameBuffer& fbo, const SimulationData& simData, const glm::mat4& perspectiveMatrix, GLuint rdTexture)
+    void HeightfieldRaycaster::RenderReducedResolution(FrameBuffer& fbo, const SimulationData& simData, const glm::mat4& perspectiveMatrix,
+        const DerivedOutputs& derivedOutputs, float resolution, std::size_t window, std::uint64_t accumulatedFrames, bool stateChanged)
     {
-        appNode_->SelectOffscreenBuffer(simulationBackFBOs_)->DrawToFBO([this, &perspectiveMatrix, &simData]() {
-            glBindVertexArray(simDummyVAO_);
-            glUseProgram(raycastBackProgram_->getProgramId());
-            glUniformMatrix4fv(raycastBackVPLoc_, 1, GL_FALSE, glm::value_ptr(perspectiveMatrix));
-            glUniform2fv(raycastBackQuadSizeLoc_, 1, glm::value_ptr(appNode_->GetSimulationOutputSize()));
-            glUniform1f(raycastBackDistanceLoc_, simData.simulationDrawDistance_);
+        // created on first use, the buffers have the size of the window but only the reduced size is drawn to.
+        if (reducedResolutionFBOs_.empty()) {
+            FrameBufferDescriptor reducedFBDesc;
+            reducedFBDesc.texDesc_.emplace_back(GL_RGBA16F, GL_TEXTURE_2D);
+            reducedFBDesc.texDesc_.emplace_back(GL_RGBA32F, GL_TEXTURE_2D);
+            reducedResolutionFBOs_ = appNode_->CreateOffscreenBuffers(reducedFBDesc);
+            FrameBufferDescriptor historyFBDesc;
+            historyFBDesc.texDesc_.emplace_back(GL_RGBA16F, GL_TEXTURE_2D);
+            historyFBDesc.texDesc_.emplace_back(GL_RGBA16F, GL_TEXTURE_2D);
+            historyFBDesc.texDesc_.emplace_back(GL_RGBA16F, GL_TEXTURE_2D);
+            historyFBOs_ = appNode_->CreateOffscreenBuffers(historyFBDesc);
+        }
+        auto& reducedFBO = reducedResolutionFBOs_[window];
+        auto& historyFBO = historyFBOs_[window];
+        auto& accumulation = accumulation_[window];
+
+        const glm::vec2 windowSize{ static_cast<float>(reducedFBO.GetWidth()), static_cast<float>(reducedFBO.GetHeight()) };
+        const auto reducedSize = glm::max(glm::ivec2(glm::round(windowSize * resolution)), glm::ivec2(1));
+        const auto scale = glm::vec2(reducedSize) / windowSize;
+        // accumulated frames are shifted by up to half a reduced pixel, so they sample different points of the window pixels.
+        const auto jitter = accumulatedFrames == 0 ? glm::vec2(0.0f)
+            : glm::vec2(Halton(accumulatedFrames, 2), Halton(accumulatedFrames, 3)) - 0.5f;
+        glm::mat4 jitterMatrix{ 1.0f };
+        jitterMatrix[3] = glm::vec4(2.0f * jitter / glm::vec2(reducedSize), 0.0f, 1.0f);
+
+        reducedFBO.DrawToFBO([this, &simData, &perspectiveMatrix, &derivedOutputs, &reducedSize, &scale, &jitter, &jitterMatrix]() {
+            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            glViewport(0, 0, reducedSize.x, reducedSize.y);
+            SetRaycastUniforms(raycastReducedProgram_, simData, jitterMatrix * perspectiveMatrix, derivedOutputs);
+            glUniform4f(raycastReducedProgram_.backPositionTransformLoc_, 1.0f / scale.x, 1.0f / scale.y, -jitter.x / scale.x, -jitter.y / scale.y);
             glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
         });
 
-        fbo.DrawToFBO([this, &perspectiveMatrix, &simData, rdTexture]() {
-            glm::vec3 camPos = appNode_->GetCamera()->GetPosition();
-            glBindVertexArray(simDummyVAO_);
-            glUseProgram(raycastProgram_->getProgramId());
-            glUniformMatrix4fv(raycastVPLoc_, 1, GL_FALSE, glm::value_ptr(perspectiveMatrix));
-            glUniform2fv(raycastQuadSizeLoc_, 1, glm::value_ptr(appNode_->GetSimulationOutputSize()));
-            glUniform1f(raycastDistanceLoc_, simData.simulationDrawDistance_ - simData.simulationHeight_);
-            glUniform1f(raycastSimHeightLoc_, simData.simulationHeight_);
-            glUniform3fv(raycastCamPosLoc_, 1, glm::value_ptr(camPos));
-            glUniform1f(raycastEtaLoc_, simData.eta_);
-            glUniform3fv(raycastSigmaALoc_, 1, glm::value_ptr(simData.sigma_a_));
-
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, environmentMap_->getTextureId());
-            glUniform1i(raycastEnvMapLoc_, 0);
-
-            glActiveTexture(GL_TEXTURE0 + 1);
-            glBindTexture(GL_TEXTURE_2D, backgroundTexture_->getTextureId());
-            glUniform1i(raycastBGTexLoc_, 1);
-
-            glActiveTexture(GL_TEXTURE0 + 2);
-            glBindTexture(GL_TEXTURE_2D, rdTexture);
-            glUniform1i(raycastHeightTextureLoc_, 2);
-
-            glBindImageTexture(0, appNode_->SelectOffscreenBuffer(simulationBackFBOs_)->GetTextures()[0], 0, GL_FALSE, 0, GL_READ_ONLY, GL_RG32F);
-            glUniform1i(raycastPositionBackTexLoc_, 0);
+        // the first frame after a change starts a new history, while the state changes older frames fade out.
+        auto historyDecay = stateChanged ? TEMPORAL_ACCUMULATION_DECAY : 1.0f;
+        if (accumulatedFrames == 0) historyDecay = 0.0f;
+        const auto drawUpsampled = [&]() {
+            SetRaycastUniforms(upsampleProgram_, simData, perspectiveMatrix, derivedOutputs);
+
+            glActiveTexture(GL_TEXTURE0 + 5);
+            glBindTexture(GL_TEXTURE_2D, reducedFBO.GetTextures()[0]);
+            glUniform1i(upsampleProgram_.reducedColorLoc_, 5);
+
+            glActiveTexture(GL_TEXTURE0 + 6);
+            glBindTexture(GL_TEXTURE_2D, reducedFBO.GetTextures()[1]);
+            glUniform1i(upsampleProgram_.reducedHitLoc_, 6);
+            glUniform2i(upsampleProgram_.reducedSizeLoc_, reducedSize.x, reducedSize.y);
+            glUniform4f(upsampleProgram_.reducedTransformLoc_, scale.x, scale.y, jitter.x, jitter.y);
+
+            glActiveTexture(GL_TEXTURE0 + 7);
+            glBindTexture(GL_TEXTURE_2D, historyFBO.GetTextures()[accumulation.history_]);
+            glUniform1i(upsampleProgram_.historyLoc_, 7);
+            glUniform1f(upsampleProgram_.historyDecayLoc_, historyDecay);
 
             glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        };
+
+        if (!simData.temporalAccumulation_) {
+            historyDecay = 0.0f;
+            fbo.DrawToFBO(drawUpsampled);
+            return;
+        }
+
+        // the history is read and written in the same pass, so it is drawn to the other attachment and then to the window.
+        const auto writeHistory = 1 - accumulation.history_;
+        GLint historyFBOId = 0;
+        historyFBO.DrawToFBO(std::vector<std::size_t>{ 2, writeHistory }, [&drawUpsampled, &historyFBOId]() {
+            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            drawUpsampled();
+            glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &historyFBOId);
+        });
+        accumulation.history_ = writeHistory;
+
+        fbo.DrawToFBO([&historyFBO, &historyFBOId]() {
+            glm::ivec4 viewport{ 0 };
+            glGetIntegerv(GL_VIEWPORT, &viewport.x);
+            GLint readFBO = 0;
+            glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFBO);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(historyFBOId));
+            glReadBuffer(GL_COLOR_ATTACHMENT2);
+            glBlitFramebuffer(0, 0, static_cast<GLint>(historyFBO.GetWidth()), static_cast<GLint>(historyFBO.GetHeight()),
+                viewport.x, viewport.y, viewport.x + viewport.z, viewport.y + viewport.w, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(readFBO));
         });
     }
 
@@ -116,5 +297,10 @@ namespace viscom::renderers {
         ImGui::SliderFloat("Absorption Red", &simData.sigma_a_.r, 0.0f, 100.0f);
         ImGui::SliderFloat("Absorption Green", &simData.sigma_a_.g, 0.0f, 100.0f);
         ImGui::SliderFloat("Absorption Blue", &simData.sigma_a_.b, 0.0f, 100.0f);
+        ImGui::SliderFloat("Resolution", &simData.renderResolution_, RENDER_RESOLUTION_MIN, RENDER_RESOLUTION_MAX);
+        ImGui::Checkbox("Adaptive Resolution", &simData.adaptiveRenderResolution_);
+        ImGui::SliderFloat("Render Budget (ms)", &simData.renderTimeBudget_, 1.0f, 33.0f);
+        ImGui::Checkbox("Temporal Accumulation", &simData.temporalAccumulation_);
+        ImGui::Text("Resolution: %.2f, render time: %.2f ms", renderResolution_.GetResolution(), renderResolution_.GetFrameTime());
     }
 }
@@ -11,6 +11,7 @@
 #include "core/main.h"
 #include "core/gfx/FrameBuffer.h"
 #include "RDRenderer.h"
+#include "RenderResolution.h"
 
 namespace viscom {
     class ApplicationNodeImplementation;
@@ -21,6 +22,11 @@ namespace viscom {
 
 namespace viscom::renderers {
 
+    /** The number of jittered frames accumulated at a reduced resolution while the view does not change. */
+    constexpr std::uint64_t TEMPORAL_ACCUMULATION_FRAMES = 16;
+    /** The fraction of the accumulated weight kept per frame while the state changes (limits the lag behind the simulation). */
+    constexpr float TEMPORAL_ACCUMULATION_DECAY = 0.75f;
+
     class HeightfieldRaycaster : public RDRenderer
     {
     public:
@@ -29,10 +35,14 @@ namespace viscom::renderers {
 
         virtual void ClearBuffers(FrameBuffer& fbo) override;
         virtual void UpdateFrame(double currentTime, double elapsedTime, const SimulationData& simData, const glm::vec2& nearPlaneSize) override;
-        virtual void RenderRDResults(FrameBuffer& fbo, const SimulationData& simData, const glm::mat4& perspectiveMatrix, GLuint rdTexture) override;
+        virtual void RenderRDResults(FrameBuffer& fbo, const SimulationData& simData, const glm::mat4& perspectiveMatrix, const DerivedOutputs& derivedOutputs) override;
         virtual void DrawOptionsGUI(SimulationData& simData) const override;
 
     private:
+        /** Renders the back positions and raycasts the height field (at the given fraction of the window resolution). */
+        void RenderRaycast(FrameBuffer& fbo, const SimulationData& simData, const glm::mat4& perspectiveMatrix, const DerivedOutputs& derivedOutputs,
+            float resolution, std::size_t window, std::uint64_t accumulatedFrames, bool stateChanged);
+
         /** The frame buffer objects for the simulation height field back. */
         std::vector<FrameBuffer> simulationBackFBOs_;
 
@@ -45,30 +55,84 @@ namespace viscom::renderers {
         /** Holds the location of the simulation quad distance. */
         GLint raycastBackDistanceLoc_ = -1;
 
+        /** A variant of the raycasting program and its uniform locations. */
+        struct RaycastProgram {
+            /** Holds the shader program for raycasting the height field. */
+            std::shared_ptr<GPUProgram> program_;
+            /** Holds the location of the VP matrix. */
+            GLint vpLoc_ = -1;
+            /** Holds the location of the simulation quad size. */
+            GLint quadSizeLoc_ = -1;
+            /** Holds the location of the simulation quad distance. */
+            GLint distanceLoc_ = -1;
+            /** Holds the location of the simulation height. */
+            GLint simHeightLoc_ = -1;
+            /** Holds the location of the camera position. */
+            GLint camPosLoc_ = -1;
+            /** Holds the location of index of refraction. */
+            GLint etaLoc_ = -1;
+            /** Holds the location of the absorption coefficient. */
+            GLint sigmaALoc_ = -1;
+            /** Holds the location of the environment map. */
+            GLint envMapLoc_ = -1;
+            /** Holds the location of the background texture. */
+            GLint bgTexLoc_ = -1;
+            /** Holds the location of the height texture. */
+            GLint heightTextureLoc_ = -1;
+            /** Holds the location of the height gradient texture. */
+            GLint normalTextureLoc_ = -1;
+            /** Holds the location of the min/max height pyramid used to skip empty space. */
+            GLint minMaxPyramidLoc_ = -1;
+            /** Holds the location of the back position texture. */
+            GLint positionBackTexLoc_ = -1;
+            /** Holds the location of the mapping of fragment coordinates to the back position texture. */
+            GLint backPositionTransformLoc_ = -1;
+            /** Holds the location of the texture coordinate transform of the height and gradient textures. */
+            GLint texCoordTransformLoc_ = -1;
+            /** Holds the locations of the reduced resolution color and hit textures, their size and coordinate mapping (upsampling). */
+            GLint reducedColorLoc_ = -1;
+            GLint reducedHitLoc_ = -1;
+            GLint reducedSizeLoc_ = -1;
+            GLint reducedTransformLoc_ = -1;
+            /** Holds the locations of the accumulated frames and the fraction of their weight kept (upsampling). */
+            GLint historyLoc_ = -1;
+            GLint historyDecayLoc_ = -1;
+        };
+
+        /** The view of a window the accumulated frames belong to. */
+        struct AccumulationState {
+            glm::mat4 viewProjection_ = glm::mat4{ 0.0f };
+            std::vector<float> parameters_;
+            std::uint64_t stateVersion_ = 0;
+            /** The number of frames accumulated (0 after the view changed). */
+            std::uint64_t frames_ = 0;
+            /** The history attachment holding the accumulated frames (the other one is written). */
+            std::size_t history_ = 0;
+        };
+
+        /** Loads a variant of the raycasting program. */
+        RaycastProgram LoadRaycastProgram(const std::string& name, const std::vector<std::string>& defines) const;
+        /** Sets the uniforms and textures all raycasting programs share. */
+        void SetRaycastUniforms(const RaycastProgram& program, const SimulationData& simData, const glm::mat4& perspectiveMatrix, const DerivedOutputs& derivedOutputs) const;
+        /** Raycasts at the given fraction of the window resolution and upsamples the result, blended with the accumulated frames. */
+        void RenderReducedResolution(FrameBuffer& fbo, const SimulationData& simData, const glm::mat4& perspectiveMatrix,
+            const DerivedOutputs& derivedOutputs, float resolution, std::size_t window, std::uint64_t accumulatedFrames, bool stateChanged);
+
         /** Holds the shader program for raycasting the height field. */
-        std::shared_ptr<GPUProgram> raycastProgram_;
-        /** Holds the location of the VP matrix. */
-        GLint raycastVPLoc_ = -1;
-        /** Holds the location of the simulation quad size. */
-        GLint raycastQuadSizeLoc_ = -1;
-        /** Holds the location of the simulation quad distance. */
-        GLint raycastDistanceLoc_ = -1;
-        /** Holds the location of the simulation height. */
-        GLint raycastSimHeightLoc_ = -1;
-        /** Holds the location of the camera position. */
-        GLint raycastCamPosLoc_ = -1;
-        /** Holds the location of index of refraction. */
-        GLint raycastEtaLoc_ = -1;
-        /** Holds the location of the absorption coefficient. */
-        GLint raycastSigmaALoc_ = -1;
-        /** Holds the location of the environment map. */
-        GLint raycastEnvMapLoc_ = -1;
-        /** Holds the location of the background texture. */
-        GLint raycastBGTexLoc_ = -1;
-        /** Holds the location of the height texture. */
-        GLint raycastHeightTextureLoc_ = -1;
-        /** Holds the location of the back position texture. */
-        GLint raycastPositionBackTexLoc_ = -1;
+        RaycastProgram raycastProgram_;
+        /** Holds the shader program for raycasting at a reduced resolution (writes the hit positions). */
+        RaycastProgram raycastReducedProgram_;
+        /** Holds the shader program upsampling the reduced resolution to the window resolution. */
+        RaycastProgram upsampleProgram_;
+
+        /** The frame buffer objects for raycasting at a reduced resolution (color and hit position, window sized). */
+        std::vector<FrameBuffer> reducedResolutionFBOs_;
+        /** The frame buffer objects with the accumulated frames of each window (two history attachments and the upsampled frame). */
+        std::vector<FrameBuffer> historyFBOs_;
+        /** The view each window accumulated frames for. */
+        std::vector<AccumulationState> accumulation_;
+        /** Chooses the reduced resolution. */
+        RenderResolution renderResolution_;
 
         /** Holds the dummy VAO for the simulation quad. */
         GLuint simDummyVAO_ = 0;
@@ -10,9 +10,10 @@
 
 namespace viscom::renderers {
 
-    RDRenderer::RDRenderer(const std::string& name, ApplicationNodeImplementation* appNode) :
+    RDRenderer::RDRenderer(const std::string& name, DerivedOutput requiredOutputs, ApplicationNodeImplementation* appNode) :
+        appNode_{ appNode },
         name_{ name },
-        appNode_{ appNode }
+        requiredOutputs_{ requiredOutputs }
     {
     }
 
@@ -10,6 +10,8 @@
 
 #include "core/main.h"
 #include "core/gfx/FrameBuffer.h"
+#include "app/DerivedOutputs.h"
+#include "RenderCache.h"
 
 namespace viscom {
     class ApplicationNodeImplementation;
@@ -21,22 +23,28 @@ namespace viscom::renderers {
     class RDRenderer
     {
     public:
-        RDRenderer(const std::string& name, ApplicationNodeImplementation* appNode);
+        RDRenderer(const std::string& name, DerivedOutput requiredOutputs, ApplicationNodeImplementation* appNode);
         virtual ~RDRenderer();
 
         std::string GetName() const { return name_; }
+        /** Returns the outputs derived from the simulation state this renderer reads. */
+        DerivedOutput GetRequiredDerivedOutputs() const { return requiredOutputs_; }
         virtual void ClearBuffers(FrameBuffer& fbo) = 0;
         virtual void UpdateFrame(double currentTime, double elapsedTime, const SimulationData& simData, const glm::vec2& nearPlaneSize) = 0;
-        virtual void RenderRDResults(FrameBuffer& fbo, const SimulationData& simData, const glm::mat4& perspectiveMatrix, GLuint rdTexture) = 0;
+        virtual void RenderRDResults(FrameBuffer& fbo, const SimulationData& simData, const glm::mat4& perspectiveMatrix, const DerivedOutputs& derivedOutputs) = 0;
         virtual void DrawOptionsGUI(SimulationData& simData) const = 0;
 
     protected:
         /** Holds the application node. */
         ApplicationNodeImplementation* appNode_;
+        /** Holds the frames rendered last, redrawn while neither the state nor the view changes. */
+        RenderCache renderCache_;
 
     private:
         /** Holds the implementations name. */
         std::string name_;
+        /** Holds the derived outputs needed for rendering. */
+        DerivedOutput requiredOutputs_;
     };
 
 }
@@ -0,0 +1,117 @@
+/**
+ * @file   RenderCache.cpp
+ *
+ * @brief  Implementation of the cache of rendered frames for unchanged states and views.
+ */
+
+#include "core/open_gl.h"
+#include "RenderCache.h"
+#include "core/gfx/FrameBuffer.h"
+#include <algorithm>
+
+namespace viscom::renderers {
+
+    namespace {
+        /** Blits the color of a rectangle (x, y, width, height) between the bound read and draw frame buffers. */
+        void BlitColor(const glm::ivec4& src, const glm::ivec4& dst)
+        {
+            glBlitFramebuffer(src.x, src.y, src.x + src.z, src.y + src.w, dst.x, dst.y, dst.x + dst.z, dst.y + dst.w,
+                GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        }
+    }
+
+    bool RenderCacheKey::operator==(const RenderCacheKey& other) const
+    {
+        return stateVersion_ == other.stateVersion_ && viewProjection_ == other.viewProjection_ && parameters_ == other.parameters_;
+    }
+
+    RenderCache::~RenderCache()
+    {
+        Clear();
+    }
+
+    void RenderCache::Clear()
+    {
+        for (auto& frame : frames_) {
+            glDeleteFramebuffers(1, &frame.fbo_);
+            glDeleteTextures(1, &frame.texture_);
+        }
+        frames_.clear();
+    }
+
+    void RenderCache::SetEnabled(bool enabled)
+    {
+        if (enabled_ && !enabled) Clear();
+        enabled_ = enabled;
+    }
+
+    RenderCache::CachedFrame& RenderCache::GetCurrentFrame()
+    {
+        GLint targetFBO = 0;
+        glm::ivec4 viewport{ 0 };
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFBO);
+        glGetIntegerv(GL_VIEWPORT, &viewport.x);
+
+        auto frame = std::find_if(frames_.begin(), frames_.end(), [targetFBO, &viewport](const CachedFrame& f) {
+            return f.targetFBO_ == targetFBO && f.viewport_.x == viewport.x && f.viewport_.y == viewport.y;
+        });
+        if (frame != frames_.end() && frame->viewport_ == viewport) return *frame;
+        if (frame == frames_.end()) frame = frames_.emplace(frames_.end());
+        else {
+            // the window was resized.
+            glDeleteFramebuffers(1, &frame->fbo_);
+            glDeleteTextures(1, &frame->texture_);
+            *frame = CachedFrame{};
+        }
+        frame->targetFBO_ = targetFBO;
+        frame->viewport_ = viewport;
+
+        // 16 bit float round trips 8 bit targets and does not clamp HDR targets.
+        glGenTextures(1, &frame->texture_);
+        glBindTexture(GL_TEXTURE_2D, frame->texture_);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, viewport.z, viewport.w);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glGenFramebuffers(1, &frame->fbo_);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frame->fbo_);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frame->texture_, 0);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(targetFBO));
+        return *frame;
+    }
+
+    void RenderCache::Draw(FrameBuffer& fbo, const RenderCacheKey& key, const std::function<void()>& render)
+    {
+        if (!enabled_) {
+            render();
+            return;
+        }
+
+        auto hit = false;
+        fbo.DrawToFBO([this, &key, &hit]() {
+            auto& frame = GetCurrentFrame();
+            if (!frame.valid_ || !(frame.key_ == key)) return;
+
+            GLint readFBO = 0;
+            glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFBO);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, frame.fbo_);
+            BlitColor(glm::ivec4(0, 0, frame.viewport_.z, frame.viewport_.w), frame.viewport_);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(readFBO));
+            hit = true;
+        });
+        if (hit) return;
+
+        render();
+
+        fbo.DrawToFBO([this, &key]() {
+            auto& frame = GetCurrentFrame();
+            GLint readFBO = 0;
+            glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFBO);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(frame.targetFBO_));
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frame.fbo_);
+            BlitColor(frame.viewport_, glm::ivec4(0, 0, frame.viewport_.z, frame.viewport_.w));
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(frame.targetFBO_));
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(readFBO));
+            frame.key_ = key;
+            frame.valid_ = true;
+        });
+    }
+}
@@ -0,0 +1,73 @@
+/**
+ * @file   RenderCache.h
+ *
+ * @brief  Declaration of the cache of rendered frames for unchanged states and views.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace viscom {
+    class FrameBuffer;
+}
+
+namespace viscom::renderers {
+
+    /** Everything a cached frame depends on. */
+    struct RenderCacheKey {
+        /** The state version of the derived outputs (changes with every frame that ran iterations, a reset or a replaced state). */
+        std::uint64_t stateVersion_ = 0;
+        /** The view projection matrix of the frame. */
+        glm::mat4 viewProjection_ = glm::mat4{ 1.0f };
+        /** The renderer parameters (uniforms not derived from the state or the view). */
+        std::vector<float> parameters_;
+
+        bool operator==(const RenderCacheKey& other) const;
+    };
+
+    /**
+     *  Keeps a copy of the color the renderer drew to every target (frame buffer and viewport, so one per window).
+     *  As long as the key of a target does not change the copy is blitted instead of rendering the frame again.
+     */
+    class RenderCache
+    {
+    public:
+        RenderCache() = default;
+        RenderCache(const RenderCache&) = delete;
+        RenderCache& operator=(const RenderCache&) = delete;
+        ~RenderCache();
+
+        /** Blits the cached frame of fbo if it was rendered with the same key, otherwise calls render and caches the result. */
+        void Draw(FrameBuffer& fbo, const RenderCacheKey& key, const std::function<void()>& render);
+        /** Drops all cached frames. */
+        void Clear();
+        /** Switches the cache on or off, while it is off Draw always renders (and nothing is kept). */
+        void SetEnabled(bool enabled);
+
+    private:
+        /** A cached frame of a target. */
+        struct CachedFrame {
+            /** The frame buffer and viewport (x, y, width, height) the frame was drawn to. */
+            GLint targetFBO_ = 0;
+            glm::ivec4 viewport_ = glm::ivec4{ 0 };
+            /** The copy of the frame. */
+            GLuint fbo_ = 0;
+            GLuint texture_ = 0;
+            /** The key the frame was rendered with. */
+            RenderCacheKey key_;
+            bool valid_ = false;
+        };
+
+        /** Returns the cached frame of the bound draw frame buffer and viewport (created if needed). */
+        CachedFrame& GetCurrentFrame();
+
+        /** The cached frames of all targets. */
+        std::vector<CachedFrame> frames_;
+        /** Whether frames are cached. */
+        bool enabled_ = true;
+    };
+}
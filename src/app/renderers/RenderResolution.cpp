@@ -0,0 +1,82 @@
+/**
+ * @file   RenderResolution.cpp
+ *
+ * @brief  Implementation of the controller choosing the resolution the height field is raycast at.
+ */
+
+#include "core/open_gl.h"
+#include "RenderResolution.h"
+#include "app/SimulationData.h"
+
+namespace viscom::renderers {
+
+    /** The weight of a new measurement in the moving average. */
+    constexpr double RENDER_TIME_SMOOTHING = 0.1;
+
+    RenderResolution::RenderResolution()
+    {
+        glGenQueries(static_cast<GLsizei>(timerQueries_.size()), timerQueries_.data());
+        queryPending_.fill(false);
+    }
+
+    RenderResolution::~RenderResolution()
+    {
+        glDeleteQueries(static_cast<GLsizei>(timerQueries_.size()), timerQueries_.data());
+    }
+
+    void RenderResolution::Update(const SimulationData& simData)
+    {
+        for (std::size_t i = 0; i < timerQueries_.size(); ++i) {
+            if (!queryPending_[i]) continue;
+
+            GLint available = GL_FALSE;
+            glGetQueryObjectiv(timerQueries_[i], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available == GL_FALSE) continue;
+
+            GLuint64 elapsedNanoseconds = 0;
+            glGetQueryObjectui64v(timerQueries_[i], GL_QUERY_RESULT, &elapsedNanoseconds);
+            const auto time = static_cast<double>(elapsedNanoseconds) * 1e-9;
+            if (windowTime_ <= 0.0) windowTime_ = time;
+            else windowTime_ += RENDER_TIME_SMOOTHING * (time - windowTime_);
+            queryPending_[i] = false;
+        }
+        // frames taken from the render cache do not count.
+        if (windowsThisFrame_ > 0) windowsPerFrame_ = windowsThisFrame_;
+        windowsThisFrame_ = 0;
+
+        if (!simData.adaptiveRenderResolution_) {
+            resolution_ = glm::clamp(simData.renderResolution_, RENDER_RESOLUTION_MIN, RENDER_RESOLUTION_MAX);
+            framesSinceChange_ = 0;
+            return;
+        }
+        if (++framesSinceChange_ < RENDER_RESOLUTION_SETTLE_FRAMES || windowTime_ <= 0.0) return;
+
+        const auto load = GetFrameTime() / simData.renderTimeBudget_;
+        if (load <= 1.0f && (load >= RENDER_RESOLUTION_MIN_LOAD || resolution_ >= RENDER_RESOLUTION_MAX)) return;
+
+        // aim for the middle of the band, so the next measurement does not cause a change back.
+        const auto targetLoad = 0.5f * (1.0f + RENDER_RESOLUTION_MIN_LOAD);
+        const auto resolution = glm::clamp(glm::round(resolution_ * glm::sqrt(targetLoad / load) / RENDER_RESOLUTION_STEP) * RENDER_RESOLUTION_STEP,
+            RENDER_RESOLUTION_MIN, RENDER_RESOLUTION_MAX);
+        if (resolution == resolution_) return;
+        resolution_ = resolution;
+        framesSinceChange_ = 0;
+        // the average starts again with the new fraction.
+        windowTime_ = 0.0;
+    }
+
+    void RenderResolution::BeginMeasurement()
+    {
+        // a query still in flight after NUM_TIMER_QUERIES windows is dropped.
+        queryPending_[nextQuery_] = false;
+        glBeginQuery(GL_TIME_ELAPSED, timerQueries_[nextQuery_]);
+    }
+
+    void RenderResolution::EndMeasurement()
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        queryPending_[nextQuery_] = true;
+        nextQuery_ = (nextQuery_ + 1) % timerQueries_.size();
+        ++windowsThisFrame_;
+    }
+}
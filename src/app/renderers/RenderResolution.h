@@ -0,0 +1,75 @@
+/**
+ * @file   RenderResolution.h
+ *
+ * @brief  Declaration of the controller choosing the resolution the height field is raycast at.
+ */
+
+#pragma once
+
+#include "core/main.h"
+#include <array>
+
+namespace viscom {
+    struct SimulationData;
+}
+
+namespace viscom::renderers {
+
+    /** The range of the fraction of the window resolution the height field is raycast at. */
+    constexpr float RENDER_RESOLUTION_MIN = 0.25f;
+    constexpr float RENDER_RESOLUTION_MAX = 1.0f;
+    /** The fraction is kept while the render time is between this fraction of the budget and the budget. */
+    constexpr float RENDER_RESOLUTION_MIN_LOAD = 0.7f;
+    /** The frames after a change until the render times of the new fraction are trusted. */
+    constexpr std::uint64_t RENDER_RESOLUTION_SETTLE_FRAMES = 30;
+    /** The fraction is a multiple of this, so small changes of the measurements do not reallocate anything. */
+    constexpr float RENDER_RESOLUTION_STEP = 0.05f;
+
+    /**
+     *  Measures the GPU time of the raycasting passes of all windows of a node (GL timer queries) and, in the adaptive
+     *  mode, chooses the fraction of the window resolution so the sum stays within SimulationData::renderTimeBudget_.
+     *  The cost is dominated by the raycast pass, which scales with the number of pixels, so the fraction is scaled by
+     *  the square root of the ratio of the budget to the cost. Every node chooses its own fraction.
+     */
+    class RenderResolution
+    {
+    public:
+        RenderResolution();
+        RenderResolution(const RenderResolution&) = delete;
+        RenderResolution& operator=(const RenderResolution&) = delete;
+        ~RenderResolution();
+
+        /** Reads the finished timer queries and updates the fraction (once per frame, does not wait for the GPU). */
+        void Update(const SimulationData& simData);
+        /** Starts measuring the rendering of a window. */
+        void BeginMeasurement();
+        /** Ends measuring the rendering of a window. */
+        void EndMeasurement();
+
+        /** Returns the fraction of the window resolution to raycast at. */
+        float GetResolution() const { return resolution_; }
+        /** Returns the measured render time of a frame (all windows) in milliseconds (0 if nothing was measured yet). */
+        float GetFrameTime() const { return static_cast<float>(windowTime_ * 1000.0) * static_cast<float>(windowsPerFrame_); }
+
+    private:
+        /** The number of timer queries in flight (the results are read a few frames later). */
+        static constexpr std::size_t NUM_TIMER_QUERIES = 8;
+
+        /** The timer queries. */
+        std::array<GLuint, NUM_TIMER_QUERIES> timerQueries_;
+        /** If a query is in flight. */
+        std::array<bool, NUM_TIMER_QUERIES> queryPending_;
+        /** The query used for the next measurement. */
+        std::size_t nextQuery_ = 0;
+
+        /** Exponential moving average of the render time of a window in seconds. */
+        double windowTime_ = 0.0;
+        /** The windows rendered in the current and in the last frame. */
+        std::uint64_t windowsThisFrame_ = 0;
+        std::uint64_t windowsPerFrame_ = 1;
+        /** The current fraction. */
+        float resolution_ = RENDER_RESOLUTION_MAX;
+        /** The frames since the fraction was changed. */
+        std::uint64_t framesSinceChange_ = 0;
+    };
+}
@@ -14,13 +14,14 @@
 namespace viscom::renderers {
 
     SimpleGreyScaleRenderer::SimpleGreyScaleRenderer(ApplicationNodeImplementation* appNode) :
-        RDRenderer{ "SimpleGreyScaleRenderer", appNode }
+        RDRenderer{ "SimpleGreyScaleRenderer", DerivedOutput::Height, appNode }
     {
         drawGSProgram_ = appNode_->GetGPUProgramManager().GetResource("simpleGreyscaleRD", std::vector<std::string>{ "raycastHeightfield.vert", "drawGreyscale.frag" });
         drawGSVPLoc_ = drawGSProgram_->getUniformLocation("viewProjectionMatrix");
         drawGSQuadSizeLoc_ = drawGSProgram_->getUniformLocation("quadSize");
         drawGSDistanceLoc_ = drawGSProgram_->getUniformLocation("distance");
         drawGSHeightTextureLoc_ = drawGSProgram_->getUniformLocation("heightTexture");
+        drawGSTexCoordTransformLoc_ = drawGSProgram_->getUniformLocation("stateTexCoordTransform");
 
         glGenVertexArrays(1, &simDummyVAO_);
     }
@@ -43,20 +44,26 @@ namespace viscom::renderers {
     {
     }
 
-    void SimpleGreyScaleRenderer::RenderRDResults(FrameBuffer& fbo, const SimulationData& simData, const glm::mat4& perspectiveMatrix, GLuint rdTexture)
+    void SimpleGreyScaleRenderer::RenderRDResults(FrameBuffer& fbo, const SimulationData& simData, const glm::mat4& perspectiveMatrix, const DerivedOutputs& derivedOutputs)
     {
-        fbo.DrawToFBO([this, &perspectiveMatrix, &simData, rdTexture]() {
-            glBindVertexArray(simDummyVAO_);
-            glUseProgram(drawGSProgram_->getProgramId());
-            glUniformMatrix4fv(drawGSVPLoc_, 1, GL_FALSE, glm::value_ptr(perspectiveMatrix));
-            glUniform2fv(drawGSQuadSizeLoc_, 1, glm::value_ptr(appNode_->GetSimulationOutputSize()));
-            glUniform1f(drawGSDistanceLoc_, 10.0f);
+        const auto& quadSize = appNode_->GetSimulationOutputSize();
+        RenderCacheKey key{ derivedOutputs.GetStateVersion(), perspectiveMatrix, std::vector<float>{ quadSize.x, quadSize.y } };
+        renderCache_.SetEnabled(simData.reuseFrames_);
+        renderCache_.Draw(fbo, key, [this, &fbo, &perspectiveMatrix, &derivedOutputs]() {
+            fbo.DrawToFBO([this, &perspectiveMatrix, &derivedOutputs]() {
+                glBindVertexArray(simDummyVAO_);
+                glUseProgram(drawGSProgram_->getProgramId());
+                glUniformMatrix4fv(drawGSVPLoc_, 1, GL_FALSE, glm::value_ptr(perspectiveMatrix));
+                glUniform2fv(drawGSQuadSizeLoc_, 1, glm::value_ptr(appNode_->GetSimulationOutputSize()));
+                glUniform1f(drawGSDistanceLoc_, 10.0f);
 
-            glActiveTexture(GL_TEXTURE0 + 2);
-            glBindTexture(GL_TEXTURE_2D, rdTexture);
-            glUniform1i(drawGSHeightTextureLoc_, 2);
+                glActiveTexture(GL_TEXTURE0 + 2);
+                glBindTexture(GL_TEXTURE_2D, derivedOutputs.GetHeightTexture());
+                glUniform1i(drawGSHeightTextureLoc_, 2);
+                glUniform4fv(drawGSTexCoordTransformLoc_, 1, glm::value_ptr(derivedOutputs.GetTexCoordTransform()));
 
-            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+                glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            });
         });
     }
 
@@ -28,7 +28,7 @@ namespace viscom::renderers {
 
         virtual void ClearBuffers(FrameBuffer& fbo) override;
         virtual void UpdateFrame(double currentTime, double elapsedTime, const SimulationData& simData, const glm::vec2& nearPlaneSize) override;
-        virtual void RenderRDResults(FrameBuffer& fbo, const SimulationData& simData, const glm::mat4& perspectiveMatrix, GLuint rdTexture) override;
+        virtual void RenderRDResults(FrameBuffer& fbo, const SimulationData& simData, const glm::mat4& perspectiveMatrix, const DerivedOutputs& derivedOutputs) override;
         virtual void DrawOptionsGUI(SimulationData& simData) const override;
 
     private:
@@ -42,6 +42,8 @@ namespace viscom::renderers {
         GLint drawGSDistanceLoc_ = -1;
         /** Holds the location of the height texture. */
         GLint drawGSHeightTextureLoc_ = -1;
+        /** Holds the location of the texture coordinate transform of the height texture. */
+        GLint drawGSTexCoordTransformLoc_ = -1;
 
         /** Holds the dummy VAO for the simulation quad. */
         GLuint simDummyVAO_ = 0;
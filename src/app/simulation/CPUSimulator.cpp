@@ -0,0 +1,173 @@
+/**
+ * @file   CPUSimulator.cpp
+ *
+ * @brief  Implementation of the multithreaded SIMD reaction diffusion simulation on the CPU.
+ */
+
+#include "CPUSimulator.h"
+#include "app/SimulationData.h"
+#include <cstring>
+#include <new>
+
+namespace viscom::simulation {
+
+    namespace {
+        /** Alignment of the plane memory (one AVX register / half a cache line). */
+        constexpr std::size_t PLANE_ALIGNMENT = 32;
+        /** The number of bands per thread (more bands balance the load better). */
+        constexpr std::size_t BANDS_PER_THREAD = 4;
+    }
+
+    void CPUSimulator::AlignedDeleter::operator()(float* ptr) const
+    {
+        ::operator delete[](ptr, std::align_val_t{ PLANE_ALIGNMENT });
+    }
+
+    CPUSimulator::CPUSimulator(const glm::uvec2& size, std::size_t numThreads, SIMDLevel simdLevel) :
+        Simulator{ "CPU", size },
+        simdLevel_{ simdLevel },
+        rowKernel_{ GetRowKernel(simdLevel) },
+        stride_{ HALO_COLUMNS + ((static_cast<std::size_t>(size.x) + 1 + HALO_COLUMNS - 1) / HALO_COLUMNS) * HALO_COLUMNS },
+        threadPool_{ numThreads }
+    {
+        const auto planeSize = stride_ * (static_cast<std::size_t>(size.y) + 2);
+        for (auto& plane : planesA_) {
+            plane = PlaneMemory{ new (std::align_val_t{ PLANE_ALIGNMENT }) float[planeSize] };
+            std::fill_n(plane.get(), planeSize, 0.0f);
+        }
+        for (auto& plane : planesB_) {
+            plane = PlaneMemory{ new (std::align_val_t{ PLANE_ALIGNMENT }) float[planeSize] };
+            std::fill_n(plane.get(), planeSize, 0.0f);
+        }
+
+        numBands_ = std::max<std::size_t>(1, std::min<std::size_t>(size.y, threadPool_.GetNumThreads() * BANDS_PER_THREAD));
+        bandHeight_ = (size.y + numBands_ - 1) / numBands_;
+        numBands_ = (size.y + bandHeight_ - 1) / bandHeight_;
+
+        Reset();
+    }
+
+    CPUSimulator::~CPUSimulator() = default;
+
+    void CPUSimulator::Reset()
+    {
+        const auto planeSize = stride_ * (static_cast<std::size_t>(GetSize().y) + 2);
+        for (std::size_t i = 0; i < 2; ++i) {
+            std::fill_n(planesA_[i].get(), planeSize, 1.0f);
+            std::fill_n(planesB_[i].get(), planeSize, 0.0f);
+        }
+        currentBuffer_ = 0;
+    }
+
+    void CPUSimulator::Step(const SimulationParameters& parameters, const std::vector<glm::vec2>& seedPoints)
+    {
+        StencilParameters params;
+        params.diffusionRateA_ = parameters.diffusion_rate_a_;
+        params.diffusionRateB_ = parameters.diffusion_rate_b_;
+        params.feedRate_ = parameters.feed_rate_;
+        params.killRate_ = parameters.kill_rate_;
+        params.dt_ = parameters.dt_;
+
+        if (!seedPoints.empty()) ApplySeedPoints(seedPoints, parameters);
+        threadPool_.ParallelFor(numBands_, [this, &params](std::size_t band) {
+            ComputeBand(band, params);
+        });
+        currentBuffer_ = 1 - currentBuffer_;
+    }
+
+    void CPUSimulator::ComputeBand(std::size_t band, const StencilParameters& params)
+    {
+        ScopedDenormalFlush denormalFlush;
+        const auto src = currentBuffer_;
+        const auto dst = 1 - currentBuffer_;
+        const auto yBegin = band * bandHeight_;
+        const auto yEnd = std::min<std::size_t>(yBegin + bandHeight_, GetSize().y);
+
+        for (auto y = yBegin; y < yEnd; ++y) {
+            // rows y - 1 and y + 1 always exist as halo rows.
+            StencilRow row;
+            row.aUp_ = RowA(src, y) + stride_;
+            row.a_ = RowA(src, y);
+            row.aDown_ = RowA(src, y) - stride_;
+            row.bUp_ = RowB(src, y) + stride_;
+            row.b_ = RowB(src, y);
+            row.bDown_ = RowB(src, y) - stride_;
+            row.aOut_ = RowA(dst, y);
+            row.bOut_ = RowB(dst, y);
+            rowKernel_(row, params, 0, GetSize().x);
+            UpdateHalo(dst, y);
+        }
+    }
+
+    void CPUSimulator::ApplySeedPoints(const std::vector<glm::vec2>& seedPoints, const SimulationParameters& parameters)
+    {
+        // B is set to 1 in the current state before the iteration.
+        ForEachSeedCell(seedPoints, parameters, [this](std::size_t x, std::size_t y) { RowB(currentBuffer_, y)[x] = 1.0f; });
+        UpdateAllHalos(currentBuffer_);
+    }
+
+    void CPUSimulator::UpdateHalo(std::size_t buffer, std::size_t y) const
+    {
+        const auto width = static_cast<std::size_t>(GetSize().x);
+        auto rowA = RowA(buffer, y);
+        auto rowB = RowB(buffer, y);
+        rowA[-1] = rowA[0];
+        rowA[width] = rowA[width - 1];
+        rowB[-1] = rowB[0];
+        rowB[width] = rowB[width - 1];
+
+        // the halo rows include the halo columns, so they are copied after those were set.
+        const auto rowLength = (width + 2) * sizeof(float);
+        if (y == 0) {
+            std::memcpy(rowA - stride_ - 1, rowA - 1, rowLength);
+            std::memcpy(rowB - stride_ - 1, rowB - 1, rowLength);
+        }
+        if (y + 1 == GetSize().y) {
+            std::memcpy(rowA + stride_ - 1, rowA - 1, rowLength);
+            std::memcpy(rowB + stride_ - 1, rowB - 1, rowLength);
+        }
+    }
+
+    void CPUSimulator::UpdateAllHalos(std::size_t buffer) const
+    {
+        for (std::size_t y = 0; y < GetSize().y; ++y) UpdateHalo(buffer, y);
+    }
+
+    void CPUSimulator::GetState(std::vector<glm::vec2>& state) const
+    {
+        const auto width = static_cast<std::size_t>(GetSize().x);
+        state.resize(width * GetSize().y);
+        for (std::size_t y = 0; y < GetSize().y; ++y) {
+            const auto rowA = RowA(currentBuffer_, y);
+            const auto rowB = RowB(currentBuffer_, y);
+            for (std::size_t x = 0; x < width; ++x) state[y * width + x] = glm::vec2(rowA[x], rowB[x]);
+        }
+    }
+
+    void CPUSimulator::SetState(const std::vector<glm::vec2>& state)
+    {
+        const auto width = static_cast<std::size_t>(GetSize().x);
+        if (state.size() != width * GetSize().y) return;
+
+        for (std::size_t y = 0; y < GetSize().y; ++y) {
+            auto rowA = RowA(currentBuffer_, y);
+            auto rowB = RowB(currentBuffer_, y);
+            for (std::size_t x = 0; x < width; ++x) {
+                rowA[x] = state[y * width + x].x;
+                rowB[x] = state[y * width + x].y;
+            }
+        }
+        UpdateAllHalos(currentBuffer_);
+    }
+
+    void CPUSimulator::GetResult(std::vector<float>& result) const
+    {
+        const auto width = static_cast<std::size_t>(GetSize().x);
+        result.resize(width * GetSize().y);
+        for (std::size_t y = 0; y < GetSize().y; ++y) {
+            const auto rowA = RowA(currentBuffer_, y);
+            const auto rowB = RowB(currentBuffer_, y);
+            for (std::size_t x = 0; x < width; ++x) result[y * width + x] = 1.0f - glm::clamp(rowA[x] - rowB[x], 0.0f, 1.0f);
+        }
+    }
+}
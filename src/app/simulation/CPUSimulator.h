@@ -0,0 +1,74 @@
+/**
+ * @file   CPUSimulator.h
+ *
+ * @brief  Declaration of the multithreaded SIMD reaction diffusion simulation on the CPU.
+ */
+
+#pragma once
+
+#include "Simulator.h"
+#include "StencilKernels.h"
+#include "ThreadPool.h"
+#include <memory>
+
+namespace viscom::simulation {
+
+    /**
+     *  Gray-Scott simulation on the CPU doing the same as reactionDiffusionSimulation.frag.
+     *  A and B are stored in separate (planar) ping-pong planes. Each plane has one halo row above and below the grid
+     *  and halo columns left and right that replicate the border cells (like GL_CLAMP_TO_EDGE), so the row kernels
+     *  never need to test for borders. Rows are split into bands that are processed by a thread pool.
+     */
+    class CPUSimulator : public Simulator
+    {
+    public:
+        /** Creates a simulator for the given grid size using numThreads threads (0 for all cores). */
+        CPUSimulator(const glm::uvec2& size, std::size_t numThreads = 0, SIMDLevel simdLevel = DetectSIMDLevel());
+        virtual ~CPUSimulator() override;
+
+        virtual void Reset() override;
+        virtual void Step(const SimulationParameters& parameters, const std::vector<glm::vec2>& seedPoints) override;
+        virtual void GetState(std::vector<glm::vec2>& state) const override;
+        virtual void SetState(const std::vector<glm::vec2>& state) override;
+        virtual void GetResult(std::vector<float>& result) const override;
+
+        SIMDLevel GetSIMDLevel() const { return simdLevel_; }
+        std::size_t GetNumThreads() const { return threadPool_.GetNumThreads(); }
+
+    private:
+        /** Deleter for the aligned plane memory. */
+        struct AlignedDeleter { void operator()(float* ptr) const; };
+        using PlaneMemory = std::unique_ptr<float[], AlignedDeleter>;
+
+        /** Column of the first grid cell inside a padded row (keeps the grid rows aligned). */
+        static constexpr std::size_t HALO_COLUMNS = 8;
+
+        float* RowA(std::size_t buffer, std::size_t y) const { return planesA_[buffer].get() + (y + 1) * stride_ + HALO_COLUMNS; }
+        float* RowB(std::size_t buffer, std::size_t y) const { return planesB_[buffer].get() + (y + 1) * stride_ + HALO_COLUMNS; }
+
+        void ComputeBand(std::size_t band, const StencilParameters& params);
+        void ApplySeedPoints(const std::vector<glm::vec2>& seedPoints, const SimulationParameters& parameters);
+        void UpdateHalo(std::size_t buffer, std::size_t y) const;
+        void UpdateAllHalos(std::size_t buffer) const;
+
+        /** The instruction set used by the row kernel. */
+        SIMDLevel simdLevel_;
+        /** The row kernel. */
+        RowKernelFunction rowKernel_;
+        /** Floats per padded row. */
+        std::size_t stride_;
+        /** The A planes (front and back). */
+        PlaneMemory planesA_[2];
+        /** The B planes (front and back). */
+        PlaneMemory planesB_[2];
+        /** The index of the planes holding the current state. */
+        std::size_t currentBuffer_ = 0;
+        /** The number of rows per band. */
+        std::size_t bandHeight_;
+        /** The number of bands. */
+        std::size_t numBands_;
+        /** The thread pool processing the bands. */
+        ThreadPool threadPool_;
+    };
+
+}
@@ -0,0 +1,329 @@
+/**
+ * @file   FFT.cpp
+ *
+ * @brief  Implementation of the fast Fourier transforms of the spectral simulation.
+ *
+ * The butterflies are written once for a lane type holding one value of each of the FFT_LANES interleaved
+ * sequences. The SSE lanes evaluate the same operations in the same order as the scalar ones, so the result does not
+ * depend on the instruction set. SSE is part of every x86-64 CPU, so no runtime dispatch beyond the scalar fallback
+ * is needed (the AVX2 level uses the SSE butterflies as well).
+ */
+
+#include "FFT.h"
+#include <cmath>
+#include <map>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define RD_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace viscom::simulation {
+
+    namespace {
+        constexpr double PI = 3.14159265358979323846;
+
+        /** Lanes computed one after another. */
+        struct ScalarLanes {
+            struct Vector { float v[FFT_LANES]; };
+
+            static Vector Load(const float* ptr) { Vector r; for (std::size_t l = 0; l < FFT_LANES; ++l) r.v[l] = ptr[l]; return r; }
+            static void Store(float* ptr, const Vector& a) { for (std::size_t l = 0; l < FFT_LANES; ++l) ptr[l] = a.v[l]; }
+            static Vector Set1(float s) { Vector r; for (auto& v : r.v) v = s; return r; }
+            static Vector Add(const Vector& a, const Vector& b) { Vector r; for (std::size_t l = 0; l < FFT_LANES; ++l) r.v[l] = a.v[l] + b.v[l]; return r; }
+            static Vector Sub(const Vector& a, const Vector& b) { Vector r; for (std::size_t l = 0; l < FFT_LANES; ++l) r.v[l] = a.v[l] - b.v[l]; return r; }
+            static Vector Mul(const Vector& a, const Vector& b) { Vector r; for (std::size_t l = 0; l < FFT_LANES; ++l) r.v[l] = a.v[l] * b.v[l]; return r; }
+        };
+
+#ifdef RD_X86_SIMD
+        /** All lanes in one SSE register. */
+        struct SSELanes {
+            using Vector = __m128;
+
+            static Vector Load(const float* ptr) { return _mm_loadu_ps(ptr); }
+            static void Store(float* ptr, Vector a) { _mm_storeu_ps(ptr, a); }
+            static Vector Set1(float s) { return _mm_set1_ps(s); }
+            static Vector Add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+            static Vector Sub(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+            static Vector Mul(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+        };
+        static_assert(FFT_LANES == 4, "The SSE lanes hold four sequences.");
+#endif
+
+        /** Multiplies (re, im) by the scalar complex number (wRe, wIm). */
+        template<class Lanes, class V = typename Lanes::Vector>
+        inline void Rotate(V& re, V& im, float wRe, float wIm)
+        {
+            const auto r = Lanes::Sub(Lanes::Mul(re, Lanes::Set1(wRe)), Lanes::Mul(im, Lanes::Set1(wIm)));
+            im = Lanes::Add(Lanes::Mul(re, Lanes::Set1(wIm)), Lanes::Mul(im, Lanes::Set1(wRe)));
+            re = r;
+        }
+
+        /** Forward DFT of size Radix in place. */
+        template<class Lanes, std::size_t Radix, class V = typename Lanes::Vector>
+        inline void Butterfly(V* re, V* im)
+        {
+            if constexpr (Radix == 2) {
+                const auto r = Lanes::Sub(re[0], re[1]);
+                const auto i = Lanes::Sub(im[0], im[1]);
+                re[0] = Lanes::Add(re[0], re[1]);
+                im[0] = Lanes::Add(im[0], im[1]);
+                re[1] = r;
+                im[1] = i;
+            }
+            else if constexpr (Radix == 3) {
+                // y1,2 = x0 - (x1 + x2) / 2 -/+ i sin(2 pi / 3) (x1 - x2)
+                const auto sumRe = Lanes::Add(re[1], re[2]);
+                const auto sumIm = Lanes::Add(im[1], im[2]);
+                const auto diffRe = Lanes::Mul(Lanes::Set1(0.866025403784438647f), Lanes::Sub(re[1], re[2]));
+                const auto diffIm = Lanes::Mul(Lanes::Set1(0.866025403784438647f), Lanes::Sub(im[1], im[2]));
+                const auto midRe = Lanes::Sub(re[0], Lanes::Mul(Lanes::Set1(0.5f), sumRe));
+                const auto midIm = Lanes::Sub(im[0], Lanes::Mul(Lanes::Set1(0.5f), sumIm));
+                re[0] = Lanes::Add(re[0], sumRe);
+                im[0] = Lanes::Add(im[0], sumIm);
+                re[1] = Lanes::Add(midRe, diffIm);
+                im[1] = Lanes::Sub(midIm, diffRe);
+                re[2] = Lanes::Sub(midRe, diffIm);
+                im[2] = Lanes::Add(midIm, diffRe);
+            }
+            else if constexpr (Radix == 4) {
+                // y1,3 = (x0 - x2) -/+ i (x1 - x3)
+                const auto t0Re = Lanes::Add(re[0], re[2]);
+                const auto t0Im = Lanes::Add(im[0], im[2]);
+                const auto t1Re = Lanes::Sub(re[0], re[2]);
+                const auto t1Im = Lanes::Sub(im[0], im[2]);
+                const auto t2Re = Lanes::Add(re[1], re[3]);
+                const auto t2Im = Lanes::Add(im[1], im[3]);
+                const auto t3Re = Lanes::Sub(re[1], re[3]);
+                const auto t3Im = Lanes::Sub(im[1], im[3]);
+                re[0] = Lanes::Add(t0Re, t2Re);
+                im[0] = Lanes::Add(t0Im, t2Im);
+                re[1] = Lanes::Add(t1Re, t3Im);
+                im[1] = Lanes::Sub(t1Im, t3Re);
+                re[2] = Lanes::Sub(t0Re, t2Re);
+                im[2] = Lanes::Sub(t0Im, t2Im);
+                re[3] = Lanes::Sub(t1Re, t3Im);
+                im[3] = Lanes::Add(t1Im, t3Re);
+            }
+        }
+
+        /**
+         *  A Stockham stage: the j-th butterfly takes the elements j + r * n / radix, rotates them by the twiddle factors
+         *  of its position k = j % span in the transforms of the previous stages and writes the transform of length
+         *  span * radix to (j / span) * span * radix + k + r * span.
+         */
+        template<class Lanes, std::size_t Radix>
+        void StageFixed(std::size_t size, std::size_t span, const float* twiddleRe, const float* twiddleIm,
+            const float* inRe, const float* inIm, float* outRe, float* outIm)
+        {
+            using V = typename Lanes::Vector;
+            const auto m = size / Radix;
+            for (std::size_t block = 0; block < m / span; ++block) {
+                for (std::size_t k = 0; k < span; ++k) {
+                    const auto j = block * span + k;
+                    V re[Radix], im[Radix];
+                    for (std::size_t r = 0; r < Radix; ++r) {
+                        re[r] = Lanes::Load(inRe + (j + r * m) * FFT_LANES);
+                        im[r] = Lanes::Load(inIm + (j + r * m) * FFT_LANES);
+                    }
+                    if (k != 0) for (std::size_t r = 1; r < Radix; ++r) Rotate<Lanes>(re[r], im[r], twiddleRe[k * Radix + r], twiddleIm[k * Radix + r]);
+                    Butterfly<Lanes, Radix>(re, im);
+
+                    const auto out = block * span * Radix + k;
+                    for (std::size_t r = 0; r < Radix; ++r) {
+                        Lanes::Store(outRe + (out + r * span) * FFT_LANES, re[r]);
+                        Lanes::Store(outIm + (out + r * span) * FFT_LANES, im[r]);
+                    }
+                }
+            }
+        }
+
+        /** A Stockham stage with a direct DFT for any radix (O(radix^2) per butterfly). */
+        template<class Lanes>
+        void StageGeneric(std::size_t size, std::size_t radix, std::size_t span, const float* twiddleRe, const float* twiddleIm,
+            const float* rootRe, const float* rootIm, const float* inRe, const float* inIm, float* outRe, float* outIm)
+        {
+            // the radix can be any prime factor, so the rotated inputs go to a float buffer (no vector of intrinsic types).
+            std::vector<float> re(radix * FFT_LANES), im(radix * FFT_LANES);
+            const auto m = size / radix;
+            for (std::size_t block = 0; block < m / span; ++block) {
+                for (std::size_t k = 0; k < span; ++k) {
+                    const auto j = block * span + k;
+                    for (std::size_t r = 0; r < radix; ++r) {
+                        auto inputRe = Lanes::Load(inRe + (j + r * m) * FFT_LANES);
+                        auto inputIm = Lanes::Load(inIm + (j + r * m) * FFT_LANES);
+                        if (k != 0 && r != 0) Rotate<Lanes>(inputRe, inputIm, twiddleRe[k * radix + r], twiddleIm[k * radix + r]);
+                        Lanes::Store(re.data() + r * FFT_LANES, inputRe);
+                        Lanes::Store(im.data() + r * FFT_LANES, inputIm);
+                    }
+
+                    const auto out = block * span * radix + k;
+                    for (std::size_t q = 0; q < radix; ++q) {
+                        auto sumRe = Lanes::Load(re.data());
+                        auto sumIm = Lanes::Load(im.data());
+                        for (std::size_t r = 1; r < radix; ++r) {
+                            auto termRe = Lanes::Load(re.data() + r * FFT_LANES);
+                            auto termIm = Lanes::Load(im.data() + r * FFT_LANES);
+                            Rotate<Lanes>(termRe, termIm, rootRe[(q * r) % radix], rootIm[(q * r) % radix]);
+                            sumRe = Lanes::Add(sumRe, termRe);
+                            sumIm = Lanes::Add(sumIm, termIm);
+                        }
+                        Lanes::Store(outRe + (out + q * span) * FFT_LANES, sumRe);
+                        Lanes::Store(outIm + (out + q * span) * FFT_LANES, sumIm);
+                    }
+                }
+            }
+        }
+
+        /** Returns the radices of a size: fours first, then the remaining prime factors in increasing order. */
+        std::vector<std::size_t> Factorize(std::size_t size)
+        {
+            std::vector<std::size_t> radices;
+            while (size % 4 == 0) { radices.push_back(4); size /= 4; }
+            for (std::size_t p = 2; p * p <= size; ++p) {
+                while (size % p == 0) { radices.push_back(p); size /= p; }
+            }
+            if (size > 1) radices.push_back(size);
+            return radices;
+        }
+
+        /** Returns per thread buffers for the interleaved sequences of a batch (never shrinks). */
+        float* GetBatchBuffer(std::size_t size)
+        {
+            thread_local std::vector<float> buffer;
+            if (buffer.size() < size) buffer.resize(size);
+            return buffer.data();
+        }
+    }
+
+    FFTPlan::FFTPlan(std::size_t size) :
+        size_{ size }
+    {
+        std::size_t span = 1;
+        for (auto radix : Factorize(size)) {
+            Stage stage{ radix, span, twiddleRe_.size(), rootRe_.size() };
+            for (std::size_t k = 0; k < span; ++k) {
+                for (std::size_t r = 0; r < radix; ++r) {
+                    const auto angle = -2.0 * PI * static_cast<double>(r * k) / static_cast<double>(span * radix);
+                    twiddleRe_.push_back(static_cast<float>(std::cos(angle)));
+                    twiddleIm_.push_back(static_cast<float>(std::sin(angle)));
+                }
+            }
+            if (radix != 2 && radix != 3 && radix != 4) {
+                for (std::size_t r = 0; r < radix; ++r) {
+                    const auto angle = -2.0 * PI * static_cast<double>(r) / static_cast<double>(radix);
+                    rootRe_.push_back(static_cast<float>(std::cos(angle)));
+                    rootIm_.push_back(static_cast<float>(std::sin(angle)));
+                }
+            }
+            stages_.push_back(stage);
+            span *= radix;
+        }
+    }
+
+    std::size_t FFTPlan::Forward(float* re[2], float* im[2], SIMDLevel simdLevel) const
+    {
+#ifdef RD_X86_SIMD
+        if (simdLevel != SIMDLevel::Scalar) return ForwardLanes<SSELanes>(re, im);
+#endif
+        return ForwardLanes<ScalarLanes>(re, im);
+    }
+
+    template<class Lanes>
+    std::size_t FFTPlan::ForwardLanes(float* re[2], float* im[2]) const
+    {
+        std::size_t current = 0;
+        for (const auto& stage : stages_) {
+            const auto twRe = twiddleRe_.data() + stage.twiddleOffset_;
+            const auto twIm = twiddleIm_.data() + stage.twiddleOffset_;
+            const auto next = 1 - current;
+            switch (stage.radix_) {
+            case 2: StageFixed<Lanes, 2>(size_, stage.span_, twRe, twIm, re[current], im[current], re[next], im[next]); break;
+            case 3: StageFixed<Lanes, 3>(size_, stage.span_, twRe, twIm, re[current], im[current], re[next], im[next]); break;
+            case 4: StageFixed<Lanes, 4>(size_, stage.span_, twRe, twIm, re[current], im[current], re[next], im[next]); break;
+            default:
+                StageGeneric<Lanes>(size_, stage.radix_, stage.span_, twRe, twIm, rootRe_.data() + stage.rootOffset_, rootIm_.data() + stage.rootOffset_,
+                    re[current], im[current], re[next], im[next]);
+                break;
+            }
+            current = next;
+        }
+        return current;
+    }
+
+    std::shared_ptr<const FFTPlan> GetFFTPlan(std::size_t size)
+    {
+        static std::mutex plansMutex;
+        static std::map<std::size_t, std::shared_ptr<const FFTPlan>> plans;
+
+        std::lock_guard<std::mutex> lock{ plansMutex };
+        auto& plan = plans[size];
+        if (!plan) plan = std::make_shared<const FFTPlan>(size);
+        return plan;
+    }
+
+    FFT2D::FFT2D(const glm::uvec2& size, SIMDLevel simdLevel) :
+        size_{ size },
+        simdLevel_{ simdLevel },
+        rowPlan_{ GetFFTPlan(size.x) },
+        columnPlan_{ GetFFTPlan(size.y) }
+    {
+    }
+
+    void FFT2D::Forward(float* re, float* im, ThreadPool& threadPool) const
+    {
+        Transform(re, im, false, threadPool);
+    }
+
+    void FFT2D::Inverse(float* re, float* im, ThreadPool& threadPool) const
+    {
+        Transform(re, im, true, threadPool);
+    }
+
+    void FFT2D::Transform(float* re, float* im, bool inverse, ThreadPool& threadPool) const
+    {
+        const auto width = static_cast<std::size_t>(size_.x);
+        const auto height = static_cast<std::size_t>(size_.y);
+        threadPool.ParallelFor((height + FFT_LANES - 1) / FFT_LANES, [this, re, im, inverse, width, height](std::size_t batch) {
+            const auto y = batch * FFT_LANES;
+            TransformBatch(*rowPlan_, re + y * width, im + y * width, 1, width, std::min(FFT_LANES, height - y), inverse);
+        });
+        threadPool.ParallelFor((width + FFT_LANES - 1) / FFT_LANES, [this, re, im, inverse, width](std::size_t batch) {
+            const auto x = batch * FFT_LANES;
+            TransformBatch(*columnPlan_, re + x, im + x, width, 1, std::min(FFT_LANES, width - x), inverse);
+        });
+    }
+
+    void FFT2D::TransformBatch(const FFTPlan& plan, float* re, float* im, std::size_t elementStride, std::size_t laneStride,
+        std::size_t numLanes, bool inverse) const
+    {
+        ScopedDenormalFlush denormalFlush;
+        // the sequences are copied into interleaved buffers (unused lanes are zero). The inverse transform is the
+        // conjugate of the forward transform of the conjugate, divided by the size.
+        const auto size = plan.GetSize();
+        const auto batchSize = size * FFT_LANES;
+        const auto buffer = GetBatchBuffer(4 * batchSize);
+        float* batchRe[2] = { buffer, buffer + batchSize };
+        float* batchIm[2] = { buffer + 2 * batchSize, buffer + 3 * batchSize };
+        const auto imSign = inverse ? -1.0f : 1.0f;
+
+        for (std::size_t k = 0; k < size; ++k) {
+            for (std::size_t l = 0; l < FFT_LANES; ++l) {
+                const auto inside = l < numLanes;
+                batchRe[0][k * FFT_LANES + l] = inside ? re[k * elementStride + l * laneStride] : 0.0f;
+                batchIm[0][k * FFT_LANES + l] = inside ? imSign * im[k * elementStride + l * laneStride] : 0.0f;
+            }
+        }
+
+        const auto result = plan.Forward(batchRe, batchIm, simdLevel_);
+
+        const auto scale = inverse ? 1.0f / static_cast<float>(size) : 1.0f;
+        for (std::size_t k = 0; k < size; ++k) {
+            for (std::size_t l = 0; l < numLanes; ++l) {
+                re[k * elementStride + l * laneStride] = scale * batchRe[result][k * FFT_LANES + l];
+                im[k * elementStride + l * laneStride] = imSign * scale * batchIm[result][k * FFT_LANES + l];
+            }
+        }
+    }
+}
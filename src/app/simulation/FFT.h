@@ -0,0 +1,99 @@
+/**
+ * @file   FFT.h
+ *
+ * @brief  Declaration of the fast Fourier transforms of the spectral simulation.
+ */
+
+#pragma once
+
+#include "StencilKernels.h"
+#include "ThreadPool.h"
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace viscom::simulation {
+
+    /** The number of transforms an FFTPlan computes at once (one SSE register per butterfly value). */
+    constexpr std::size_t FFT_LANES = 4;
+
+    /**
+     *  Plan of a complex forward FFT of a single size (mixed radix Stockham algorithm with radix 4, 2 and 3 butterflies
+     *  and a generic one for other prime factors, so sizes with large prime factors are slow). The twiddle factors are
+     *  computed once per plan. Each call transforms FFT_LANES sequences whose values are interleaved (element k of
+     *  sequence l at k * FFT_LANES + l) with each butterfly working on all of them at once.
+     */
+    class FFTPlan
+    {
+    public:
+        explicit FFTPlan(std::size_t size);
+
+        std::size_t GetSize() const { return size_; }
+
+        /**
+         *  Transforms the interleaved sequences in re[0] and im[0] (unnormalized, exp(-2 pi i jk / n)). The stages write
+         *  alternately into the two buffers, the index of the one holding the result is returned.
+         */
+        std::size_t Forward(float* re[2], float* im[2], SIMDLevel simdLevel) const;
+
+    private:
+        /** A pass of butterflies of a single radix. */
+        struct Stage {
+            std::size_t radix_;
+            /** The length of the transforms finished by the previous stages. */
+            std::size_t span_;
+            /** The first twiddle factor of the stage (span_ * radix_ values). */
+            std::size_t twiddleOffset_;
+            /** The first root of unity of the radix (only used by the generic butterfly). */
+            std::size_t rootOffset_;
+        };
+
+        template<class Lanes> std::size_t ForwardLanes(float* re[2], float* im[2]) const;
+
+        /** The transform size. */
+        std::size_t size_;
+        /** The stages in the order they are applied. */
+        std::vector<Stage> stages_;
+        /** The twiddle factors of all stages. */
+        std::vector<float> twiddleRe_;
+        std::vector<float> twiddleIm_;
+        /** The roots of unity of the generic radices. */
+        std::vector<float> rootRe_;
+        std::vector<float> rootIm_;
+    };
+
+    /** Returns the plan for the given size (plans are created once and shared). */
+    std::shared_ptr<const FFTPlan> GetFFTPlan(std::size_t size);
+
+    /**
+     *  Two-dimensional FFT of a periodic grid stored row by row in separate real and imaginary planes. Rows and then
+     *  columns are transformed by FFTPlans, FFT_LANES rows or columns per task of the thread pool. Two real fields
+     *  are transformed at once by storing one as the real and one as the imaginary part (see SpectralSimulator).
+     */
+    class FFT2D
+    {
+    public:
+        FFT2D(const glm::uvec2& size, SIMDLevel simdLevel);
+
+        const glm::uvec2& GetSize() const { return size_; }
+
+        /** Transforms the planes in place (unnormalized). */
+        void Forward(float* re, float* im, ThreadPool& threadPool) const;
+        /** Transforms the planes back in place (including the normalization by 1 / (width * height)). */
+        void Inverse(float* re, float* im, ThreadPool& threadPool) const;
+
+    private:
+        void Transform(float* re, float* im, bool inverse, ThreadPool& threadPool) const;
+        void TransformBatch(const FFTPlan& plan, float* re, float* im, std::size_t elementStride, std::size_t laneStride,
+            std::size_t numLanes, bool inverse) const;
+
+        /** The grid size. */
+        glm::uvec2 size_;
+        /** The instruction set of the butterflies. */
+        SIMDLevel simdLevel_;
+        /** The plans for the rows and columns. */
+        std::shared_ptr<const FFTPlan> rowPlan_;
+        std::shared_ptr<const FFTPlan> columnPlan_;
+    };
+
+}
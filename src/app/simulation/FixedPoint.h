@@ -0,0 +1,60 @@
+/**
+ * @file   FixedPoint.h
+ *
+ * @brief  Fixed point representation of the simulation state and parameters.
+ */
+
+#pragma once
+
+#include "app/SimulationData.h"
+#include <cmath>
+#include <cstdint>
+
+namespace viscom::simulation {
+
+    /**
+     *  The fixed point state stores A and B as unsigned 16 bit integers with 15 fractional bits (1.0 == 32768).
+     *  All arithmetic on it is done in integers with explicit round half up, so every GPU and driver computes
+     *  bit-identical states. See reactionDiffusionSimulation.frag/.comp for the kernel.
+     */
+    constexpr std::int32_t FIXED_POINT_ONE = 1 << 15;
+
+    /** The simulation parameters with 16 fractional bits as used by the fixed point kernel. */
+    struct FixedPointCoefficients {
+        /** dt * diffusion_rate_a / 20 (the Laplacian is evaluated with integer weights 1, 4, -20). */
+        std::int32_t diffusionA_;
+        /** dt * diffusion_rate_b / 20. */
+        std::int32_t diffusionB_;
+        /** dt. */
+        std::int32_t dt_;
+        /** feed_rate. */
+        std::int32_t feed_;
+        /** kill_rate + feed_rate. */
+        std::int32_t killFeed_;
+    };
+
+    inline std::int32_t ToFixedPointCoefficient(double value)
+    {
+        return static_cast<std::int32_t>(std::floor(value * 65536.0 + 0.5));
+    }
+
+    inline FixedPointCoefficients ComputeFixedPointCoefficients(const SimulationParameters& parameters)
+    {
+        FixedPointCoefficients result;
+        result.diffusionA_ = ToFixedPointCoefficient(static_cast<double>(parameters.dt_) * parameters.diffusion_rate_a_ / 20.0);
+        result.diffusionB_ = ToFixedPointCoefficient(static_cast<double>(parameters.dt_) * parameters.diffusion_rate_b_ / 20.0);
+        result.dt_ = ToFixedPointCoefficient(parameters.dt_);
+        result.feed_ = ToFixedPointCoefficient(parameters.feed_rate_);
+        result.killFeed_ = ToFixedPointCoefficient(static_cast<double>(parameters.kill_rate_) + parameters.feed_rate_);
+        return result;
+    }
+
+    inline float FromFixedPoint(std::uint16_t value) { return static_cast<float>(value) / static_cast<float>(FIXED_POINT_ONE); }
+
+    inline std::uint16_t ToFixedPoint(float value)
+    {
+        const auto clamped = std::fmin(std::fmax(value, 0.0f), 1.0f);
+        return static_cast<std::uint16_t>(std::floor(clamped * static_cast<float>(FIXED_POINT_ONE) + 0.5f));
+    }
+
+}
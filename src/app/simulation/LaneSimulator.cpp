@@ -0,0 +1,115 @@
+/**
+ * @file   LaneSimulator.cpp
+ *
+ * @brief  Implementation of the simulation of several small independent grids in the SIMD lanes of the CPU.
+ */
+
+#include "LaneSimulator.h"
+#include <cstring>
+#include <new>
+
+namespace viscom::simulation {
+
+    namespace {
+        /** Alignment of the plane memory (one cell of all lanes is one AVX register). */
+        constexpr std::size_t PLANE_ALIGNMENT = 32;
+    }
+
+    void LaneSimulator::AlignedDeleter::operator()(float* ptr) const
+    {
+        ::operator delete[](ptr, std::align_val_t{ PLANE_ALIGNMENT });
+    }
+
+    LaneSimulator::LaneSimulator(const glm::uvec2& size, SIMDLevel simdLevel) :
+        size_{ size },
+        simdLevel_{ simdLevel },
+        rowKernel_{ GetLaneRowKernel(simdLevel) },
+        stride_{ (static_cast<std::size_t>(size.x) + 2) * SWEEP_LANES }
+    {
+        const auto planeSize = stride_ * (static_cast<std::size_t>(size.y) + 2);
+        for (std::size_t i = 0; i < 2; ++i) {
+            planesA_[i] = PlaneMemory{ new (std::align_val_t{ PLANE_ALIGNMENT }) float[planeSize] };
+            planesB_[i] = PlaneMemory{ new (std::align_val_t{ PLANE_ALIGNMENT }) float[planeSize] };
+            std::fill_n(planesA_[i].get(), planeSize, 1.0f);
+            std::fill_n(planesB_[i].get(), planeSize, 0.0f);
+        }
+        for (std::size_t lane = 0; lane < SWEEP_LANES; ++lane) SetParameters(lane, StencilParameters{});
+    }
+
+    LaneSimulator::~LaneSimulator() = default;
+
+    void LaneSimulator::SetParameters(std::size_t lane, const StencilParameters& params)
+    {
+        params_.diffusionRateA_[lane] = params.diffusionRateA_;
+        params_.diffusionRateB_[lane] = params.diffusionRateB_;
+        params_.feedRate_[lane] = params.feedRate_;
+        params_.killRate_[lane] = params.killRate_;
+        params_.dt_[lane] = params.dt_;
+    }
+
+    void LaneSimulator::SetState(const std::vector<glm::vec2>& state)
+    {
+        const auto width = static_cast<std::size_t>(size_.x);
+        if (state.size() != width * size_.y) return;
+
+        for (std::size_t y = 0; y < size_.y; ++y) {
+            auto rowA = RowA(currentBuffer_, y);
+            auto rowB = RowB(currentBuffer_, y);
+            for (std::size_t x = 0; x < width; ++x) {
+                std::fill_n(rowA + x * SWEEP_LANES, SWEEP_LANES, state[y * width + x].x);
+                std::fill_n(rowB + x * SWEEP_LANES, SWEEP_LANES, state[y * width + x].y);
+            }
+        }
+        for (std::size_t y = 0; y < size_.y; ++y) UpdateHalo(currentBuffer_, y);
+    }
+
+    void LaneSimulator::Step(std::uint64_t iterations)
+    {
+        ScopedDenormalFlush denormalFlush;
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            const auto src = currentBuffer_;
+            const auto dst = 1 - currentBuffer_;
+            for (std::size_t y = 0; y < size_.y; ++y) {
+                // rows y - 1 and y + 1 always exist as halo rows.
+                StencilRow row;
+                row.aUp_ = RowA(src, y) + stride_;
+                row.a_ = RowA(src, y);
+                row.aDown_ = RowA(src, y) - stride_;
+                row.bUp_ = RowB(src, y) + stride_;
+                row.b_ = RowB(src, y);
+                row.bDown_ = RowB(src, y) - stride_;
+                row.aOut_ = RowA(dst, y);
+                row.bOut_ = RowB(dst, y);
+                rowKernel_(row, params_, size_.x);
+                UpdateHalo(dst, y);
+            }
+            currentBuffer_ = dst;
+        }
+    }
+
+    void LaneSimulator::UpdateHalo(std::size_t buffer, std::size_t y) const
+    {
+        const auto width = static_cast<std::size_t>(size_.x);
+        const auto cellSize = SWEEP_LANES * sizeof(float);
+        for (auto row : { RowA(buffer, y), RowB(buffer, y) }) {
+            std::memcpy(row - SWEEP_LANES, row, cellSize);
+            std::memcpy(row + width * SWEEP_LANES, row + (width - 1) * SWEEP_LANES, cellSize);
+
+            // the halo rows include the halo columns, so they are copied after those were set.
+            const auto rowLength = (width + 2) * cellSize;
+            if (y == 0) std::memcpy(row - stride_ - SWEEP_LANES, row - SWEEP_LANES, rowLength);
+            if (y + 1 == size_.y) std::memcpy(row + stride_ - SWEEP_LANES, row - SWEEP_LANES, rowLength);
+        }
+    }
+
+    void LaneSimulator::GetLaneState(std::size_t lane, std::vector<glm::vec2>& state) const
+    {
+        const auto width = static_cast<std::size_t>(size_.x);
+        state.resize(width * size_.y);
+        for (std::size_t y = 0; y < size_.y; ++y) {
+            const auto rowA = RowA(currentBuffer_, y);
+            const auto rowB = RowB(currentBuffer_, y);
+            for (std::size_t x = 0; x < width; ++x) state[y * width + x] = glm::vec2(rowA[x * SWEEP_LANES + lane], rowB[x * SWEEP_LANES + lane]);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+/**
+ * @file   LaneSimulator.h
+ *
+ * @brief  Declaration of the simulation of several small independent grids in the SIMD lanes of the CPU.
+ */
+
+#pragma once
+
+#include "StencilKernels.h"
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace viscom::simulation {
+
+    /**
+     *  Gray-Scott simulation of SWEEP_LANES independent grids of the same size with different parameters, doing the
+     *  same as CPUSimulator for each of them. The grids are interleaved (the lanes of a cell are next to each other),
+     *  so one vector instruction advances all of them and each lane gives the same result as a CPUSimulator with its
+     *  parameters. The simulator is single threaded: parameter sweeps run one simulator per task, and a batch of small
+     *  grids stays in the cache of its core for all iterations. The borders replicate the border cells like
+     *  CPUSimulator.
+     */
+    class LaneSimulator
+    {
+    public:
+        /** Creates a simulator for SWEEP_LANES grids of the given size (all A = 1, B = 0). */
+        explicit LaneSimulator(const glm::uvec2& size, SIMDLevel simdLevel = DetectSIMDLevel());
+        LaneSimulator(const LaneSimulator&) = delete;
+        LaneSimulator& operator=(const LaneSimulator&) = delete;
+        ~LaneSimulator();
+
+        const glm::uvec2& GetSize() const { return size_; }
+        SIMDLevel GetSIMDLevel() const { return simdLevel_; }
+
+        /** Sets the parameters of a lane (as used by the kernels, i.e., already scaled to the grid). */
+        void SetParameters(std::size_t lane, const StencilParameters& params);
+        /** Sets the (A, B) state of all lanes (bottom row first, the size has to match GetSize()). */
+        void SetState(const std::vector<glm::vec2>& state);
+        /** Advances all lanes by the given number of iterations. */
+        void Step(std::uint64_t iterations);
+        /** Copies the current (A, B) state of a lane into the given vector (bottom row first). */
+        void GetLaneState(std::size_t lane, std::vector<glm::vec2>& state) const;
+
+    private:
+        /** Deleter for the aligned plane memory. */
+        struct AlignedDeleter { void operator()(float* ptr) const; };
+        using PlaneMemory = std::unique_ptr<float[], AlignedDeleter>;
+
+        float* RowA(std::size_t buffer, std::size_t y) const { return planesA_[buffer].get() + (y + 1) * stride_ + SWEEP_LANES; }
+        float* RowB(std::size_t buffer, std::size_t y) const { return planesB_[buffer].get() + (y + 1) * stride_ + SWEEP_LANES; }
+        void UpdateHalo(std::size_t buffer, std::size_t y) const;
+
+        /** The size of each grid. */
+        glm::uvec2 size_;
+        /** The instruction set used by the row kernel. */
+        SIMDLevel simdLevel_;
+        /** The row kernel. */
+        LaneRowKernelFunction rowKernel_;
+        /** Floats per padded row (the grid row, one halo cell left and right, SWEEP_LANES floats per cell). */
+        std::size_t stride_;
+        /** The parameters of the lanes. */
+        LaneParameters params_;
+        /** The A and B planes (front and back). */
+        PlaneMemory planesA_[2];
+        PlaneMemory planesB_[2];
+        /** The index of the planes holding the current state. */
+        std::size_t currentBuffer_ = 0;
+    };
+
+}
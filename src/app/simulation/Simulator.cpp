@@ -0,0 +1,49 @@
+/**
+ * @file   Simulator.cpp
+ *
+ * @brief  Implementation of the base class for simulation engines that run without an OpenGL context.
+ */
+
+#include "Simulator.h"
+#include "app/SimulationData.h"
+#include <cmath>
+
+namespace viscom::simulation {
+
+    Simulator::Simulator(const std::string& name, const glm::uvec2& size) :
+        name_{ name },
+        size_{ size },
+        gridSize_{ size }
+    {
+    }
+
+    Simulator::~Simulator() = default;
+
+    void Simulator::ForEachSeedCell(const std::vector<glm::vec2>& seedPoints, const SimulationParameters& parameters,
+        const std::function<void(std::size_t, std::size_t)>& cell) const
+    {
+        const glm::vec2 texDim{ size_ };
+        const glm::vec2 gridDim{ gridSize_ };
+        const glm::vec2 origin{ gridOrigin_ };
+        const auto aspect = gridDim.x / gridDim.y;
+        const auto radius = parameters.seed_point_radius_;
+        const auto radiusSqr = radius * radius;
+        const auto halfWidth = radius / aspect;
+
+        for (const auto& seedPoint : seedPoints) {
+            const auto yBegin = static_cast<std::size_t>(glm::clamp(std::floor((seedPoint.y - radius) * gridDim.y - 0.5f) - origin.y, 0.0f, texDim.y));
+            const auto yEnd = static_cast<std::size_t>(glm::clamp(std::ceil((seedPoint.y + radius) * gridDim.y + 0.5f) - origin.y, 0.0f, texDim.y));
+            const auto xBegin = static_cast<std::size_t>(glm::clamp(std::floor((seedPoint.x - halfWidth) * gridDim.x - 0.5f) - origin.x, 0.0f, texDim.x));
+            const auto xEnd = static_cast<std::size_t>(glm::clamp(std::ceil((seedPoint.x + halfWidth) * gridDim.x + 0.5f) - origin.x, 0.0f, texDim.x));
+
+            for (auto y = yBegin; y < yEnd; ++y) {
+                const auto dy = std::abs((static_cast<float>(y) + origin.y + 0.5f) / gridDim.y - seedPoint.y);
+                for (auto x = xBegin; x < xEnd; ++x) {
+                    const auto dx = std::abs((static_cast<float>(x) + origin.x + 0.5f) / gridDim.x - seedPoint.x) * aspect;
+                    const auto inside = parameters.use_manhattan_distance_ ? (dx + dy < radius) : (dx * dx + dy * dy < radiusSqr);
+                    if (inside) cell(x, y);
+                }
+            }
+        }
+    }
+}
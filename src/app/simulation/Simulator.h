@@ -0,0 +1,64 @@
+/**
+ * @file   Simulator.h
+ *
+ * @brief  Declaration of the base class for simulation engines that run without an OpenGL context.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace viscom {
+    struct SimulationParameters;
+}
+
+namespace viscom::simulation {
+
+    /**
+     *  Interface of a headless reaction diffusion simulation.
+     *  The state is a grid of (A, B) pairs stored row by row starting at the bottom row, i.e., in the same order as the
+     *  simulation texture on the GPU. Seed points are given in texture coordinates.
+     */
+    class Simulator
+    {
+    public:
+        Simulator(const std::string& name, const glm::uvec2& size);
+        virtual ~Simulator();
+
+        const std::string& GetName() const { return name_; }
+        const glm::uvec2& GetSize() const { return size_; }
+
+        /** Resets the whole grid to A = 1, B = 0. */
+        virtual void Reset() = 0;
+        /** Sets B = 1 inside the given seed points and advances the simulation by a single iteration. */
+        virtual void Step(const SimulationParameters& parameters, const std::vector<glm::vec2>& seedPoints) = 0;
+        /** Copies the current (A, B) state into the given vector. */
+        virtual void GetState(std::vector<glm::vec2>& state) const = 0;
+        /** Replaces the current state by the given (A, B) values (size has to match GetSize()). */
+        virtual void SetState(const std::vector<glm::vec2>& state) = 0;
+        /** Computes the displayed result (1 - clamp(A - B, 0, 1)) for each cell. */
+        virtual void GetResult(std::vector<float>& result) const = 0;
+
+        /** Sets the size of the whole grid and the grid cell at the origin of the state (seed points are in grid coordinates). */
+        void SetGridPlacement(const glm::uvec2& gridSize, const glm::ivec2& origin) { gridSize_ = gridSize; gridOrigin_ = origin; }
+
+    protected:
+        /** Calls cell(x, y) for each cell of the state inside one of the seed points (same stamp as seedSplat.frag). */
+        void ForEachSeedCell(const std::vector<glm::vec2>& seedPoints, const SimulationParameters& parameters,
+            const std::function<void(std::size_t, std::size_t)>& cell) const;
+
+    private:
+        /** Holds the implementations name. */
+        std::string name_;
+        /** Holds the grid size. */
+        glm::uvec2 size_;
+        /** The size of the whole grid and the grid cell at the origin of the state. */
+        glm::uvec2 gridSize_;
+        glm::ivec2 gridOrigin_ = glm::ivec2{ 0 };
+    };
+
+}
@@ -0,0 +1,194 @@
+/**
+ * @file   SpectralSimulator.cpp
+ *
+ * @brief  Implementation of the spectral exponential time differencing simulation on the CPU.
+ */
+
+#include "SpectralSimulator.h"
+#include "app/SimulationData.h"
+#include <cmath>
+
+namespace viscom::simulation {
+
+    namespace {
+        constexpr double PI = 3.14159265358979323846;
+
+        /** phi1(z) = (exp(z) - 1) / z and phi2(z) = (exp(z) - 1 - z) / z^2, as Taylor series close to 0 (cancellation). */
+        double Phi1(double z) { return std::abs(z) < 1e-3 ? 1.0 + z / 2.0 + z * z / 6.0 + z * z * z / 24.0 : std::expm1(z) / z; }
+        double Phi2(double z) { return std::abs(z) < 1e-3 ? 0.5 + z / 6.0 + z * z / 24.0 + z * z * z / 120.0 : (std::expm1(z) - z) / (z * z); }
+
+        /** Applies the factors of a packed field to the values at a wave number (z) and at its negative (mirrored). */
+        inline glm::vec2 ApplyFactor(float p, float q, const glm::vec2& z, const glm::vec2& mirrored)
+        {
+            return glm::vec2(p * z.x + q * mirrored.x, p * z.y - q * mirrored.y);
+        }
+    }
+
+    bool SpectralSimulator::CoefficientParameters::operator==(const CoefficientParameters& other) const
+    {
+        return diffusionRateA_ == other.diffusionRateA_ && diffusionRateB_ == other.diffusionRateB_ && feedRate_ == other.feedRate_
+            && killRate_ == other.killRate_ && dt_ == other.dt_;
+    }
+
+    SpectralSimulator::SpectralSimulator(const glm::uvec2& size, std::size_t numThreads, SIMDLevel simdLevel) :
+        Simulator{ "CPU Spectral", size },
+        threadPool_{ numThreads },
+        fft_{ size, simdLevel },
+        coefficients_((static_cast<std::size_t>(size.x) / 2 + 1) * (static_cast<std::size_t>(size.y) / 2 + 1))
+    {
+        const auto numCells = static_cast<std::size_t>(size.x) * size.y;
+        for (auto field : { &state_, &reaction_, &stage_ }) {
+            field->re_.resize(numCells, 0.0f);
+            field->im_.resize(numCells, 0.0f);
+        }
+        Reset();
+    }
+
+    SpectralSimulator::~SpectralSimulator() = default;
+
+    void SpectralSimulator::Reset()
+    {
+        std::fill(state_.re_.begin(), state_.re_.end(), 1.0f);
+        std::fill(state_.im_.begin(), state_.im_.end(), 0.0f);
+    }
+
+    template<class Fn>
+    void SpectralSimulator::ForEachWaveNumberPair(const Fn& fn)
+    {
+        const auto width = static_cast<std::size_t>(GetSize().x);
+        const auto height = static_cast<std::size_t>(GetSize().y);
+        threadPool_.ParallelFor(height / 2 + 1, [this, &fn, width, height](std::size_t ky) {
+            ScopedDenormalFlush denormalFlush;
+            const auto kyMirrored = (height - ky) % height;
+            for (std::size_t kx = 0; kx < width; ++kx) {
+                const auto kxMirrored = (width - kx) % width;
+                if (ky == kyMirrored && kx > kxMirrored) continue;
+                fn(ky * width + kx, kyMirrored * width + kxMirrored, GetCoefficients(kx, ky));
+            }
+        });
+    }
+
+    void SpectralSimulator::Step(const SimulationParameters& parameters, const std::vector<glm::vec2>& seedPoints)
+    {
+        const auto width = static_cast<std::size_t>(GetSize().x);
+        if (!seedPoints.empty()) ForEachSeedCell(seedPoints, parameters, [this, width](std::size_t x, std::size_t y) { state_.im_[y * width + x] = 1.0f; });
+        UpdateCoefficients(CoefficientParameters{ parameters.diffusion_rate_a_, parameters.diffusion_rate_b_, parameters.feed_rate_, parameters.kill_rate_, parameters.dt_ });
+
+        ComputeReaction(state_, reaction_, parameters.feed_rate_);
+        fft_.Forward(state_.re_.data(), state_.im_.data(), threadPool_);
+        fft_.Forward(reaction_.re_.data(), reaction_.im_.data(), threadPool_);
+
+        // a = exp(dt L) u + dt phi1(dt L) N(u) is kept in the state and transformed back in the stage.
+        ForEachWaveNumberPair([this](std::size_t i, std::size_t j, const SpectralCoefficients& c) {
+            const glm::vec2 u{ state_.re_[i], state_.im_[i] };
+            const glm::vec2 uMirrored{ state_.re_[j], state_.im_[j] };
+            const glm::vec2 n{ reaction_.re_[i], reaction_.im_[i] };
+            const glm::vec2 nMirrored{ reaction_.re_[j], reaction_.im_[j] };
+            const auto a = ApplyFactor(c.pExp_, c.qExp_, u, uMirrored) + ApplyFactor(c.pPhi1_, c.qPhi1_, n, nMirrored);
+            const auto aMirrored = ApplyFactor(c.pExp_, c.qExp_, uMirrored, u) + ApplyFactor(c.pPhi1_, c.qPhi1_, nMirrored, n);
+            state_.re_[i] = stage_.re_[i] = a.x;
+            state_.im_[i] = stage_.im_[i] = a.y;
+            state_.re_[j] = stage_.re_[j] = aMirrored.x;
+            state_.im_[j] = stage_.im_[j] = aMirrored.y;
+        });
+        fft_.Inverse(stage_.re_.data(), stage_.im_.data(), threadPool_);
+        ComputeReaction(stage_, stage_, parameters.feed_rate_);
+        fft_.Forward(stage_.re_.data(), stage_.im_.data(), threadPool_);
+
+        // u' = a + dt phi2(dt L) (N(a) - N(u))
+        ForEachWaveNumberPair([this](std::size_t i, std::size_t j, const SpectralCoefficients& c) {
+            const glm::vec2 a{ state_.re_[i], state_.im_[i] };
+            const glm::vec2 aMirrored{ state_.re_[j], state_.im_[j] };
+            const glm::vec2 dn{ stage_.re_[i] - reaction_.re_[i], stage_.im_[i] - reaction_.im_[i] };
+            const glm::vec2 dnMirrored{ stage_.re_[j] - reaction_.re_[j], stage_.im_[j] - reaction_.im_[j] };
+            const auto u = a + ApplyFactor(c.pPhi2_, c.qPhi2_, dn, dnMirrored);
+            const auto uMirrored = aMirrored + ApplyFactor(c.pPhi2_, c.qPhi2_, dnMirrored, dn);
+            state_.re_[i] = u.x;
+            state_.im_[i] = u.y;
+            state_.re_[j] = uMirrored.x;
+            state_.im_[j] = uMirrored.y;
+        });
+        fft_.Inverse(state_.re_.data(), state_.im_.data(), threadPool_);
+
+        // clamped like the explicit step of the other backends.
+        threadPool_.ParallelFor(GetSize().y, [this, width](std::size_t y) {
+            for (auto x = y * width; x < (y + 1) * width; ++x) {
+                state_.re_[x] = glm::clamp(state_.re_[x], 0.0f, 1.0f);
+                state_.im_[x] = glm::clamp(state_.im_[x], 0.0f, 1.0f);
+            }
+        });
+    }
+
+    void SpectralSimulator::ComputeReaction(const Field& in, Field& out, float feedRate)
+    {
+        // the linear feed and kill terms are part of L, so A gets -A * B * B + F and B gets A * B * B.
+        const auto width = static_cast<std::size_t>(GetSize().x);
+        threadPool_.ParallelFor(GetSize().y, [&in, &out, feedRate, width](std::size_t y) {
+            ScopedDenormalFlush denormalFlush;
+            for (auto x = y * width; x < (y + 1) * width; ++x) {
+                const auto abb = in.re_[x] * in.im_[x] * in.im_[x];
+                out.re_[x] = feedRate - abb;
+                out.im_[x] = abb;
+            }
+        });
+    }
+
+    void SpectralSimulator::UpdateCoefficients(const CoefficientParameters& parameters)
+    {
+        if (parameters == coefficientParameters_) return;
+        coefficientParameters_ = parameters;
+
+        const auto width = static_cast<std::size_t>(GetSize().x);
+        const auto height = static_cast<std::size_t>(GetSize().y);
+        const auto dt = static_cast<double>(parameters.dt_);
+        for (std::size_t ky = 0; ky <= height / 2; ++ky) {
+            const auto cosY = std::cos(2.0 * PI * static_cast<double>(ky) / static_cast<double>(height));
+            for (std::size_t kx = 0; kx <= width / 2; ++kx) {
+                const auto cosX = std::cos(2.0 * PI * static_cast<double>(kx) / static_cast<double>(width));
+                // the Fourier symbol of the 9-point Laplacian (weights 0.05, 0.2, -1), so the same discrete problem is solved.
+                const auto laplace = -1.0 + 0.4 * (cosX + cosY) + 0.2 * cosX * cosY;
+                const auto zA = dt * (parameters.diffusionRateA_ * laplace - parameters.feedRate_);
+                const auto zB = dt * (parameters.diffusionRateB_ * laplace - (parameters.killRate_ + parameters.feedRate_));
+
+                const auto expA = std::exp(zA), expB = std::exp(zB);
+                const auto phi1A = dt * Phi1(zA), phi1B = dt * Phi1(zB);
+                const auto phi2A = dt * Phi2(zA), phi2B = dt * Phi2(zB);
+                auto& c = coefficients_[ky * (width / 2 + 1) + kx];
+                c.pExp_ = static_cast<float>(0.5 * (expA + expB));
+                c.qExp_ = static_cast<float>(0.5 * (expA - expB));
+                c.pPhi1_ = static_cast<float>(0.5 * (phi1A + phi1B));
+                c.qPhi1_ = static_cast<float>(0.5 * (phi1A - phi1B));
+                c.pPhi2_ = static_cast<float>(0.5 * (phi2A + phi2B));
+                c.qPhi2_ = static_cast<float>(0.5 * (phi2A - phi2B));
+            }
+        }
+    }
+
+    const SpectralSimulator::SpectralCoefficients& SpectralSimulator::GetCoefficients(std::size_t kx, std::size_t ky) const
+    {
+        const auto width = static_cast<std::size_t>(GetSize().x);
+        const auto height = static_cast<std::size_t>(GetSize().y);
+        return coefficients_[std::min(ky, height - ky) * (width / 2 + 1) + std::min(kx, width - kx)];
+    }
+
+    void SpectralSimulator::GetState(std::vector<glm::vec2>& state) const
+    {
+        state.resize(state_.re_.size());
+        for (std::size_t i = 0; i < state.size(); ++i) state[i] = glm::vec2(state_.re_[i], state_.im_[i]);
+    }
+
+    void SpectralSimulator::SetState(const std::vector<glm::vec2>& state)
+    {
+        if (state.size() != state_.re_.size()) return;
+        for (std::size_t i = 0; i < state.size(); ++i) {
+            state_.re_[i] = state[i].x;
+            state_.im_[i] = state[i].y;
+        }
+    }
+
+    void SpectralSimulator::GetResult(std::vector<float>& result) const
+    {
+        result.resize(state_.re_.size());
+        for (std::size_t i = 0; i < result.size(); ++i) result[i] = 1.0f - glm::clamp(state_.re_[i] - state_.im_[i], 0.0f, 1.0f);
+    }
+}
@@ -0,0 +1,90 @@
+/**
+ * @file   SpectralSimulator.h
+ *
+ * @brief  Declaration of the spectral exponential time differencing simulation on the CPU.
+ */
+
+#pragma once
+
+#include "Simulator.h"
+#include "FFT.h"
+#include "ThreadPool.h"
+
+namespace viscom::simulation {
+
+    /**
+     *  Gray-Scott simulation for large offline runs on a periodic domain. The linear terms (diffusion with the Fourier
+     *  symbol of the 9-point Laplacian of the other backends, the feed and the kill rate) are integrated exactly in
+     *  Fourier space, only the reaction A * B * B and the constant feed are evaluated in real space and integrated
+     *  by the exponential Runge-Kutta scheme ETDRK2 (Cox and Matthews). Without the diffusion limit of the explicit
+     *  step the time step is only limited by the reaction, so dt can be about ten times larger.
+     *  A and B are transformed together as the real and imaginary part of one complex field, the spectral operators
+     *  separate them again using the symmetry of the transforms of real fields.
+     */
+    class SpectralSimulator : public Simulator
+    {
+    public:
+        /** Creates a simulator for the given grid size using numThreads threads (0 for all cores). */
+        SpectralSimulator(const glm::uvec2& size, std::size_t numThreads = 0, SIMDLevel simdLevel = DetectSIMDLevel());
+        virtual ~SpectralSimulator() override;
+
+        virtual void Reset() override;
+        virtual void Step(const SimulationParameters& parameters, const std::vector<glm::vec2>& seedPoints) override;
+        virtual void GetState(std::vector<glm::vec2>& state) const override;
+        virtual void SetState(const std::vector<glm::vec2>& state) override;
+        virtual void GetResult(std::vector<float>& result) const override;
+
+        std::size_t GetNumThreads() const { return threadPool_.GetNumThreads(); }
+
+    private:
+        /** The parameters the coefficients were computed for. */
+        struct CoefficientParameters {
+            float diffusionRateA_ = -1.0f;
+            float diffusionRateB_ = -1.0f;
+            float feedRate_ = -1.0f;
+            float killRate_ = -1.0f;
+            float dt_ = -1.0f;
+
+            bool operator==(const CoefficientParameters& other) const;
+        };
+
+        /**
+         *  The ETDRK2 factors exp(dt L), dt phi1(dt L) and dt phi2(dt L) of a wave number for the packed field A + iB:
+         *  a factor cA of A and cB of B is applied as p * Z(k) + q * conj(Z(-k)) with p = (cA + cB) / 2, q = (cA - cB) / 2.
+         */
+        struct SpectralCoefficients {
+            float pExp_, qExp_;
+            float pPhi1_, qPhi1_;
+            float pPhi2_, qPhi2_;
+        };
+
+        /** A complex field as real (A) and imaginary (B) plane. */
+        struct Field {
+            std::vector<float> re_;
+            std::vector<float> im_;
+        };
+
+        void UpdateCoefficients(const CoefficientParameters& parameters);
+        const SpectralCoefficients& GetCoefficients(std::size_t kx, std::size_t ky) const;
+        /** Calls fn(i, iMirrored) for all pairs of a wave number and its negative (each pair once), rows in parallel. */
+        template<class Fn> void ForEachWaveNumberPair(const Fn& fn);
+        /** Writes the nonlinear terms of the real space field in to out (may be the same). */
+        void ComputeReaction(const Field& in, Field& out, float feedRate);
+
+        /** The thread pool processing the rows and columns. */
+        ThreadPool threadPool_;
+        /** The transforms of the grid. */
+        FFT2D fft_;
+        /** The state (in real space between steps). */
+        Field state_;
+        /** The transformed reaction terms of the state. */
+        Field reaction_;
+        /** The intermediate ETDRK2 stage. */
+        Field stage_;
+        /** The parameters of the coefficients. */
+        CoefficientParameters coefficientParameters_;
+        /** The coefficients for wave numbers (min(kx, width - kx), min(ky, height - ky)). */
+        std::vector<SpectralCoefficients> coefficients_;
+    };
+
+}
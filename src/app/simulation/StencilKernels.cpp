@@ -0,0 +1,291 @@
+/**
+ * @file   StencilKernels.cpp
+ *
+ * @brief  Implementation of the row kernels for the Gray-Scott step on the CPU.
+ *
+ * The SIMD kernels evaluate exactly the same operations in the same order as the scalar kernel (no FMA contraction),
+ * so all instruction sets produce identical results. The AVX2 kernel is compiled with a function level target
+ * attribute and only selected after a runtime check, so the application does not require AVX2 capable CPUs.
+ */
+
+#include "StencilKernels.h"
+#include <array>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define RD_X86_SIMD 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define RD_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define RD_TARGET_AVX2
+#endif
+
+namespace viscom::simulation {
+
+    namespace {
+
+        void RowKernelScalar(const StencilRow& row, const StencilParameters& params, std::size_t begin, std::size_t end)
+        {
+            for (auto x = begin; x < end; ++x) {
+                const auto laplaceA = Laplace(row.aUp_, row.a_, row.aDown_, x);
+                const auto laplaceB = Laplace(row.bUp_, row.b_, row.bDown_, x);
+                GrayScottCell(row.a_[x], row.b_[x], laplaceA, laplaceB, params, row.aOut_[x], row.bOut_[x]);
+            }
+        }
+
+        void LaneRowKernelScalar(const StencilRow& row, const LaneParameters& params, std::size_t width)
+        {
+            std::array<StencilParameters, SWEEP_LANES> laneParams;
+            for (std::size_t lane = 0; lane < SWEEP_LANES; ++lane) {
+                laneParams[lane] = StencilParameters{ params.diffusionRateA_[lane], params.diffusionRateB_[lane],
+                    params.feedRate_[lane], params.killRate_[lane], params.dt_[lane] };
+            }
+
+            // the neighbors of a cell are SWEEP_LANES floats apart, so Laplace works on the lane offset rows.
+            for (std::size_t x = 0; x < width; ++x) {
+                for (std::size_t lane = 0; lane < SWEEP_LANES; ++lane) {
+                    const auto i = x * SWEEP_LANES + lane;
+                    const auto corners = (row.aUp_[i - SWEEP_LANES] + row.aUp_[i + SWEEP_LANES]) + (row.aDown_[i - SWEEP_LANES] + row.aDown_[i + SWEEP_LANES]);
+                    const auto edges = (row.aUp_[i] + row.aDown_[i]) + (row.a_[i - SWEEP_LANES] + row.a_[i + SWEEP_LANES]);
+                    const auto laplaceA = 0.05f * corners + 0.2f * edges - row.a_[i];
+                    const auto cornersB = (row.bUp_[i - SWEEP_LANES] + row.bUp_[i + SWEEP_LANES]) + (row.bDown_[i - SWEEP_LANES] + row.bDown_[i + SWEEP_LANES]);
+                    const auto edgesB = (row.bUp_[i] + row.bDown_[i]) + (row.b_[i - SWEEP_LANES] + row.b_[i + SWEEP_LANES]);
+                    const auto laplaceB = 0.05f * cornersB + 0.2f * edgesB - row.b_[i];
+                    GrayScottCell(row.a_[i], row.b_[i], laplaceA, laplaceB, laneParams[lane], row.aOut_[i], row.bOut_[i]);
+                }
+            }
+        }
+
+#ifdef RD_X86_SIMD
+        inline __m128 LaplaceSSE(const float* up, const float* center, const float* down, std::size_t x)
+        {
+            const auto corners = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(up + x - 1), _mm_loadu_ps(up + x + 1)),
+                _mm_add_ps(_mm_loadu_ps(down + x - 1), _mm_loadu_ps(down + x + 1)));
+            const auto edges = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(up + x), _mm_loadu_ps(down + x)),
+                _mm_add_ps(_mm_loadu_ps(center + x - 1), _mm_loadu_ps(center + x + 1)));
+            return _mm_sub_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.05f), corners), _mm_mul_ps(_mm_set1_ps(0.2f), edges)), _mm_loadu_ps(center + x));
+        }
+
+        void RowKernelSSE(const StencilRow& row, const StencilParameters& params, std::size_t begin, std::size_t end)
+        {
+            const auto da = _mm_set1_ps(params.diffusionRateA_);
+            const auto db = _mm_set1_ps(params.diffusionRateB_);
+            const auto feed = _mm_set1_ps(params.feedRate_);
+            const auto killFeed = _mm_set1_ps(params.killRate_ + params.feedRate_);
+            const auto dt = _mm_set1_ps(params.dt_);
+            const auto zero = _mm_setzero_ps();
+            const auto one = _mm_set1_ps(1.0f);
+
+            auto x = begin;
+            for (; x + 4 <= end; x += 4) {
+                const auto laplaceA = LaplaceSSE(row.aUp_, row.a_, row.aDown_, x);
+                const auto laplaceB = LaplaceSSE(row.bUp_, row.b_, row.bDown_, x);
+                const auto a = _mm_loadu_ps(row.a_ + x);
+                const auto b = _mm_loadu_ps(row.b_ + x);
+                const auto abb = _mm_mul_ps(_mm_mul_ps(a, b), b);
+
+                const auto dA = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(da, laplaceA), abb), _mm_mul_ps(feed, _mm_sub_ps(one, a)));
+                const auto dB = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(db, laplaceB), abb), _mm_mul_ps(killFeed, b));
+                const auto aNext = _mm_add_ps(a, _mm_mul_ps(dA, dt));
+                const auto bNext = _mm_add_ps(b, _mm_mul_ps(dB, dt));
+                _mm_storeu_ps(row.aOut_ + x, _mm_min_ps(_mm_max_ps(aNext, zero), one));
+                _mm_storeu_ps(row.bOut_ + x, _mm_min_ps(_mm_max_ps(bNext, zero), one));
+            }
+            RowKernelScalar(row, params, x, end);
+        }
+
+        /** Laplacian of four lanes of a cell (the neighbors are SWEEP_LANES floats apart). */
+        inline __m128 LaneLaplaceSSE(const float* up, const float* center, const float* down, std::size_t i)
+        {
+            const auto corners = _mm_add_ps(_mm_add_ps(_mm_load_ps(up + i - SWEEP_LANES), _mm_load_ps(up + i + SWEEP_LANES)),
+                _mm_add_ps(_mm_load_ps(down + i - SWEEP_LANES), _mm_load_ps(down + i + SWEEP_LANES)));
+            const auto edges = _mm_add_ps(_mm_add_ps(_mm_load_ps(up + i), _mm_load_ps(down + i)),
+                _mm_add_ps(_mm_load_ps(center + i - SWEEP_LANES), _mm_load_ps(center + i + SWEEP_LANES)));
+            return _mm_sub_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.05f), corners), _mm_mul_ps(_mm_set1_ps(0.2f), edges)), _mm_load_ps(center + i));
+        }
+
+        void LaneRowKernelSSE(const StencilRow& row, const LaneParameters& params, std::size_t width)
+        {
+            const auto zero = _mm_setzero_ps();
+            const auto one = _mm_set1_ps(1.0f);
+            // the eight lanes are two halves of four.
+            for (std::size_t half = 0; half < SWEEP_LANES; half += 4) {
+                const auto da = _mm_load_ps(params.diffusionRateA_ + half);
+                const auto db = _mm_load_ps(params.diffusionRateB_ + half);
+                const auto feed = _mm_load_ps(params.feedRate_ + half);
+                const auto killFeed = _mm_add_ps(_mm_load_ps(params.killRate_ + half), feed);
+                const auto dt = _mm_load_ps(params.dt_ + half);
+
+                for (std::size_t x = 0; x < width; ++x) {
+                    const auto i = x * SWEEP_LANES + half;
+                    const auto laplaceA = LaneLaplaceSSE(row.aUp_, row.a_, row.aDown_, i);
+                    const auto laplaceB = LaneLaplaceSSE(row.bUp_, row.b_, row.bDown_, i);
+                    const auto a = _mm_load_ps(row.a_ + i);
+                    const auto b = _mm_load_ps(row.b_ + i);
+                    const auto abb = _mm_mul_ps(_mm_mul_ps(a, b), b);
+
+                    const auto dA = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(da, laplaceA), abb), _mm_mul_ps(feed, _mm_sub_ps(one, a)));
+                    const auto dB = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(db, laplaceB), abb), _mm_mul_ps(killFeed, b));
+                    const auto aNext = _mm_add_ps(a, _mm_mul_ps(dA, dt));
+                    const auto bNext = _mm_add_ps(b, _mm_mul_ps(dB, dt));
+                    _mm_store_ps(row.aOut_ + i, _mm_min_ps(_mm_max_ps(aNext, zero), one));
+                    _mm_store_ps(row.bOut_ + i, _mm_min_ps(_mm_max_ps(bNext, zero), one));
+                }
+            }
+        }
+
+        RD_TARGET_AVX2 inline __m256 LaplaceAVX2(const float* up, const float* center, const float* down, std::size_t x)
+        {
+            const auto corners = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(up + x - 1), _mm256_loadu_ps(up + x + 1)),
+                _mm256_add_ps(_mm256_loadu_ps(down + x - 1), _mm256_loadu_ps(down + x + 1)));
+            const auto edges = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(up + x), _mm256_loadu_ps(down + x)),
+                _mm256_add_ps(_mm256_loadu_ps(center + x - 1), _mm256_loadu_ps(center + x + 1)));
+            return _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(0.05f), corners), _mm256_mul_ps(_mm256_set1_ps(0.2f), edges)), _mm256_loadu_ps(center + x));
+        }
+
+        RD_TARGET_AVX2 void RowKernelAVX2(const StencilRow& row, const StencilParameters& params, std::size_t begin, std::size_t end)
+        {
+            const auto da = _mm256_set1_ps(params.diffusionRateA_);
+            const auto db = _mm256_set1_ps(params.diffusionRateB_);
+            const auto feed = _mm256_set1_ps(params.feedRate_);
+            const auto killFeed = _mm256_set1_ps(params.killRate_ + params.feedRate_);
+            const auto dt = _mm256_set1_ps(params.dt_);
+            const auto zero = _mm256_setzero_ps();
+            const auto one = _mm256_set1_ps(1.0f);
+
+            auto x = begin;
+            for (; x + 8 <= end; x += 8) {
+                const auto laplaceA = LaplaceAVX2(row.aUp_, row.a_, row.aDown_, x);
+                const auto laplaceB = LaplaceAVX2(row.bUp_, row.b_, row.bDown_, x);
+                const auto a = _mm256_loadu_ps(row.a_ + x);
+                const auto b = _mm256_loadu_ps(row.b_ + x);
+                const auto abb = _mm256_mul_ps(_mm256_mul_ps(a, b), b);
+
+                const auto dA = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(da, laplaceA), abb), _mm256_mul_ps(feed, _mm256_sub_ps(one, a)));
+                const auto dB = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(db, laplaceB), abb), _mm256_mul_ps(killFeed, b));
+                const auto aNext = _mm256_add_ps(a, _mm256_mul_ps(dA, dt));
+                const auto bNext = _mm256_add_ps(b, _mm256_mul_ps(dB, dt));
+                _mm256_storeu_ps(row.aOut_ + x, _mm256_min_ps(_mm256_max_ps(aNext, zero), one));
+                _mm256_storeu_ps(row.bOut_ + x, _mm256_min_ps(_mm256_max_ps(bNext, zero), one));
+            }
+            RowKernelSSE(row, params, x, end);
+        }
+
+        /** Laplacian of all lanes of a cell (the neighbors are SWEEP_LANES floats apart). */
+        RD_TARGET_AVX2 inline __m256 LaneLaplaceAVX2(const float* up, const float* center, const float* down, std::size_t i)
+        {
+            const auto corners = _mm256_add_ps(_mm256_add_ps(_mm256_load_ps(up + i - SWEEP_LANES), _mm256_load_ps(up + i + SWEEP_LANES)),
+                _mm256_add_ps(_mm256_load_ps(down + i - SWEEP_LANES), _mm256_load_ps(down + i + SWEEP_LANES)));
+            const auto edges = _mm256_add_ps(_mm256_add_ps(_mm256_load_ps(up + i), _mm256_load_ps(down + i)),
+                _mm256_add_ps(_mm256_load_ps(center + i - SWEEP_LANES), _mm256_load_ps(center + i + SWEEP_LANES)));
+            return _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(0.05f), corners), _mm256_mul_ps(_mm256_set1_ps(0.2f), edges)), _mm256_load_ps(center + i));
+        }
+
+        RD_TARGET_AVX2 void LaneRowKernelAVX2(const StencilRow& row, const LaneParameters& params, std::size_t width)
+        {
+            const auto da = _mm256_load_ps(params.diffusionRateA_);
+            const auto db = _mm256_load_ps(params.diffusionRateB_);
+            const auto feed = _mm256_load_ps(params.feedRate_);
+            const auto killFeed = _mm256_add_ps(_mm256_load_ps(params.killRate_), feed);
+            const auto dt = _mm256_load_ps(params.dt_);
+            const auto zero = _mm256_setzero_ps();
+            const auto one = _mm256_set1_ps(1.0f);
+
+            for (std::size_t x = 0; x < width; ++x) {
+                const auto i = x * SWEEP_LANES;
+                const auto laplaceA = LaneLaplaceAVX2(row.aUp_, row.a_, row.aDown_, i);
+                const auto laplaceB = LaneLaplaceAVX2(row.bUp_, row.b_, row.bDown_, i);
+                const auto a = _mm256_load_ps(row.a_ + i);
+                const auto b = _mm256_load_ps(row.b_ + i);
+                const auto abb = _mm256_mul_ps(_mm256_mul_ps(a, b), b);
+
+                const auto dA = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(da, laplaceA), abb), _mm256_mul_ps(feed, _mm256_sub_ps(one, a)));
+                const auto dB = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(db, laplaceB), abb), _mm256_mul_ps(killFeed, b));
+                const auto aNext = _mm256_add_ps(a, _mm256_mul_ps(dA, dt));
+                const auto bNext = _mm256_add_ps(b, _mm256_mul_ps(dB, dt));
+                _mm256_store_ps(row.aOut_ + i, _mm256_min_ps(_mm256_max_ps(aNext, zero), one));
+                _mm256_store_ps(row.bOut_ + i, _mm256_min_ps(_mm256_max_ps(bNext, zero), one));
+            }
+        }
+#endif
+    }
+
+    ScopedDenormalFlush::ScopedDenormalFlush()
+    {
+#ifdef RD_X86_SIMD
+        previousState_ = _mm_getcsr();
+        // bit 15: flush to zero, bit 6: denormals are zero.
+        _mm_setcsr(previousState_ | 0x8040u);
+#endif
+    }
+
+    ScopedDenormalFlush::~ScopedDenormalFlush()
+    {
+#ifdef RD_X86_SIMD
+        _mm_setcsr(previousState_);
+#endif
+    }
+
+    SIMDLevel DetectSIMDLevel()
+    {
+#ifdef RD_X86_SIMD
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return SIMDLevel::AVX2;
+        if (__builtin_cpu_supports("sse2")) return SIMDLevel::SSE;
+#elif defined(_MSC_VER)
+        int cpuInfo[4];
+        __cpuid(cpuInfo, 0);
+        if (cpuInfo[0] >= 7) {
+            __cpuidex(cpuInfo, 1, 0);
+            const auto osUsesXSave = (cpuInfo[2] & (1 << 27)) != 0;
+            const auto avxSupported = (cpuInfo[2] & (1 << 28)) != 0;
+            if (osUsesXSave && avxSupported && (_xgetbv(0) & 0x6) == 0x6) {
+                __cpuidex(cpuInfo, 7, 0);
+                if ((cpuInfo[1] & (1 << 5)) != 0) return SIMDLevel::AVX2;
+            }
+        }
+        return SIMDLevel::SSE;
+#endif
+#endif
+        return SIMDLevel::Scalar;
+    }
+
+    RowKernelFunction GetRowKernel(SIMDLevel level)
+    {
+#ifdef RD_X86_SIMD
+        switch (level) {
+        case SIMDLevel::AVX2: return &RowKernelAVX2;
+        case SIMDLevel::SSE: return &RowKernelSSE;
+        default: break;
+        }
+#endif
+        return &RowKernelScalar;
+    }
+
+    LaneRowKernelFunction GetLaneRowKernel(SIMDLevel level)
+    {
+#ifdef RD_X86_SIMD
+        switch (level) {
+        case SIMDLevel::AVX2: return &LaneRowKernelAVX2;
+        case SIMDLevel::SSE: return &LaneRowKernelSSE;
+        default: break;
+        }
+#endif
+        return &LaneRowKernelScalar;
+    }
+
+    const char* GetSIMDLevelName(SIMDLevel level)
+    {
+        switch (level) {
+        case SIMDLevel::AVX2: return "AVX2";
+        case SIMDLevel::SSE: return "SSE";
+        default: return "Scalar";
+        }
+    }
+}
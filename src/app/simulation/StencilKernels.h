@@ -0,0 +1,111 @@
+/**
+ * @file   StencilKernels.h
+ *
+ * @brief  Declaration of the row kernels for the Gray-Scott step on the CPU.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+namespace viscom::simulation {
+
+    /** The instruction set used by the CPU row kernels. */
+    enum class SIMDLevel {
+        Scalar,
+        SSE,
+        AVX2
+    };
+
+    /** The reaction diffusion parameters as used by the row kernels. */
+    struct StencilParameters {
+        float diffusionRateA_ = 1.0f;
+        float diffusionRateB_ = 0.5f;
+        float feedRate_ = 0.055f;
+        float killRate_ = 0.062f;
+        float dt_ = 1.0f;
+    };
+
+    /** Pointers to the three input rows of A and B and the output row of both (all pointing to column 0). */
+    struct StencilRow {
+        const float* aUp_;
+        const float* a_;
+        const float* aDown_;
+        const float* bUp_;
+        const float* b_;
+        const float* bDown_;
+        float* aOut_;
+        float* bOut_;
+    };
+
+    /** Updates the columns [begin, end) of a row. Columns -1 and end have to be readable (halo). */
+    using RowKernelFunction = void(*)(const StencilRow& row, const StencilParameters& params, std::size_t begin, std::size_t end);
+
+    /** The number of independent simulations the lane kernels advance at once (one AVX2 register of floats). */
+    constexpr std::size_t SWEEP_LANES = 8;
+
+    /** The reaction diffusion parameters of each lane (structure of arrays, so a lane vector is a single load). */
+    struct alignas(32) LaneParameters {
+        float diffusionRateA_[SWEEP_LANES];
+        float diffusionRateB_[SWEEP_LANES];
+        float feedRate_[SWEEP_LANES];
+        float killRate_[SWEEP_LANES];
+        float dt_[SWEEP_LANES];
+    };
+
+    /**
+     *  Updates the columns [0, width) of a row of SWEEP_LANES interleaved simulations: the rows hold the lanes of a
+     *  cell next to each other (cell x, lane l at x * SWEEP_LANES + l) and have to be 32 byte aligned. Columns -1 and
+     *  width have to be readable (halo).
+     */
+    using LaneRowKernelFunction = void(*)(const StencilRow& row, const LaneParameters& params, std::size_t width);
+
+    /** Returns the best instruction set supported by the CPU the application runs on. */
+    SIMDLevel DetectSIMDLevel();
+    /** Returns the row kernel for the given instruction set (falls back to lower levels if not compiled in). */
+    RowKernelFunction GetRowKernel(SIMDLevel level);
+    /** Returns the lane row kernel for the given instruction set (falls back to lower levels if not compiled in). */
+    LaneRowKernelFunction GetLaneRowKernel(SIMDLevel level);
+    /** Returns a human readable name of the instruction set. */
+    const char* GetSIMDLevelName(SIMDLevel level);
+
+    /**
+     *  Enables flush-to-zero and denormals-are-zero for the current thread while in scope. GPUs flush denormals too and
+     *  the B channel decays into the denormal range on large empty areas, which would slow down the kernels a lot.
+     */
+    class ScopedDenormalFlush
+    {
+    public:
+        ScopedDenormalFlush();
+        ScopedDenormalFlush(const ScopedDenormalFlush&) = delete;
+        ScopedDenormalFlush& operator=(const ScopedDenormalFlush&) = delete;
+        ~ScopedDenormalFlush();
+
+    private:
+        /** The floating point control state before entering the scope. */
+        unsigned int previousState_ = 0;
+    };
+
+    /** 9-point Laplacian with the same weights as reactionDiffusionSimulation.frag. */
+    inline float Laplace(const float* up, const float* center, const float* down, std::size_t x)
+    {
+        // 0.0500    0.2000    0.0500
+        // 0.2000   -1.0000    0.2000
+        // 0.0500    0.2000    0.0500
+        const auto corners = (up[x - 1] + up[x + 1]) + (down[x - 1] + down[x + 1]);
+        const auto edges = (up[x] + down[x]) + (center[x - 1] + center[x + 1]);
+        return 0.05f * corners + 0.2f * edges - center[x];
+    }
+
+    /** Gray-Scott update of a single cell from its Laplacians. */
+    inline void GrayScottCell(float a, float b, float laplaceA, float laplaceB, const StencilParameters& params, float& aOut, float& bOut)
+    {
+        const auto abb = a * b * b;
+        const auto aNext = a + (params.diffusionRateA_ * laplaceA - abb + params.feedRate_ * (1.0f - a)) * params.dt_;
+        const auto bNext = b + (params.diffusionRateB_ * laplaceB + abb - (params.killRate_ + params.feedRate_) * b) * params.dt_;
+        aOut = std::min(std::max(aNext, 0.0f), 1.0f);
+        bOut = std::min(std::max(bNext, 0.0f), 1.0f);
+    }
+
+}
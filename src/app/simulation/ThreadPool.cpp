@@ -0,0 +1,80 @@
+/**
+ * @file   ThreadPool.cpp
+ *
+ * @brief  Implementation of a simple fork-join thread pool for the CPU simulation.
+ */
+
+#include "ThreadPool.h"
+
+namespace viscom::simulation {
+
+    ThreadPool::ThreadPool(std::size_t numThreads)
+    {
+        if (numThreads == 0) numThreads = std::thread::hardware_concurrency();
+        if (numThreads == 0) numThreads = 1;
+
+        workers_.reserve(numThreads - 1);
+        for (std::size_t i = 1; i < numThreads; ++i) workers_.emplace_back([this]() { WorkerLoop(); });
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock{ mutex_ };
+            shutdown_ = true;
+        }
+        jobCondition_.notify_all();
+        for (auto& worker : workers_) worker.join();
+    }
+
+    void ThreadPool::ParallelFor(std::size_t numTasks, const std::function<void(std::size_t)>& fn)
+    {
+        if (numTasks == 0) return;
+        if (workers_.empty() || numTasks == 1) {
+            for (std::size_t i = 0; i < numTasks; ++i) fn(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{ mutex_ };
+            job_ = &fn;
+            numTasks_ = numTasks;
+            nextTask_.store(0, std::memory_order_relaxed);
+            activeWorkers_ = workers_.size();
+            ++generation_;
+        }
+        jobCondition_.notify_all();
+
+        RunTasks();
+
+        std::unique_lock<std::mutex> lock{ mutex_ };
+        doneCondition_.wait(lock, [this]() { return activeWorkers_ == 0; });
+        job_ = nullptr;
+    }
+
+    void ThreadPool::WorkerLoop()
+    {
+        std::size_t lastGeneration = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock{ mutex_ };
+                jobCondition_.wait(lock, [this, lastGeneration]() { return shutdown_ || generation_ != lastGeneration; });
+                if (shutdown_) return;
+                lastGeneration = generation_;
+            }
+
+            RunTasks();
+
+            {
+                std::lock_guard<std::mutex> lock{ mutex_ };
+                --activeWorkers_;
+            }
+            doneCondition_.notify_one();
+        }
+    }
+
+    void ThreadPool::RunTasks()
+    {
+        for (auto i = nextTask_.fetch_add(1); i < numTasks_; i = nextTask_.fetch_add(1)) (*job_)(i);
+    }
+}
@@ -0,0 +1,65 @@
+/**
+ * @file   ThreadPool.h
+ *
+ * @brief  Declaration of a simple fork-join thread pool for the CPU simulation.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace viscom::simulation {
+
+    /**
+     *  A pool of worker threads that process one parallel loop at a time.
+     *  The calling thread takes part in the loop, so a pool with a single thread does not spawn any workers.
+     */
+    class ThreadPool
+    {
+    public:
+        /** Creates a pool with the given number of threads (0 uses the hardware concurrency). */
+        explicit ThreadPool(std::size_t numThreads = 0);
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ~ThreadPool();
+
+        /** Returns the number of threads working on a loop (including the calling thread). */
+        std::size_t GetNumThreads() const { return workers_.size() + 1; }
+
+        /** Calls fn(i) for all i in [0, numTasks) in parallel and returns when all calls finished. */
+        void ParallelFor(std::size_t numTasks, const std::function<void(std::size_t)>& fn);
+
+    private:
+        void WorkerLoop();
+        void RunTasks();
+
+        /** Holds the worker threads. */
+        std::vector<std::thread> workers_;
+        /** Protects the job state. */
+        std::mutex mutex_;
+        /** Signals workers a new job (or shutdown). */
+        std::condition_variable jobCondition_;
+        /** Signals the caller that all workers left the current job. */
+        std::condition_variable doneCondition_;
+
+        /** The function of the current job. */
+        const std::function<void(std::size_t)>* job_ = nullptr;
+        /** The number of tasks of the current job. */
+        std::size_t numTasks_ = 0;
+        /** The next task index to process. */
+        std::atomic<std::size_t> nextTask_{ 0 };
+        /** Incremented for each job so workers can detect new work. */
+        std::size_t generation_ = 0;
+        /** The number of workers still busy with the current job. */
+        std::size_t activeWorkers_ = 0;
+        /** Set to stop the workers. */
+        bool shutdown_ = false;
+    };
+
+}
@@ -0,0 +1,140 @@
+/**
+ * @file   batch.cpp
+ *
+ * @brief  Entry point of the headless batch runs (no window, no OpenGL context).
+ */
+
+#include "app/BatchRun.h"
+#include "app/Presets.h"
+
+#include <spdlog/spdlog.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+    constexpr const char* USAGE =
+        "Usage: ReactionDiffusionBatch [options]\n"
+        "  --resources <dir>      resource directory with presetList.txt and simulation.txt (default ../resources)\n"
+        "  --preset <name|file>   preset from presetList.txt or a preset file\n"
+        "  --seeds <file>         seed script, lines of \"iteration x y\" (default: one seed in the center)\n"
+        "  --iterations <n>       iterations to run (default 10000)\n"
+        "  --size <w>x<h>         grid size (default from simulation.txt)\n"
+        "  --no-scale             do not scale the parameters to the grid size\n"
+        "  --spectral             use the spectral ETDRK2 solver (periodic domain)\n"
+        "  --threads <n>          number of threads (default all cores)\n"
+        "  --dump <i,j,...>       iterations to dump the state at\n"
+        "  --dump-every <n>       dump the state every n iterations\n"
+        "  --render <i,j,...>     iterations to render the result at\n"
+        "  --render-every <n>     render the result every n iterations\n"
+        "  --output <dir>         output directory (default .)\n";
+
+    std::vector<std::uint64_t> ParseIterationList(const std::string& list)
+    {
+        std::vector<std::uint64_t> result;
+        std::istringstream iss(list);
+        std::string item;
+        while (std::getline(iss, item, ',')) result.push_back(std::stoull(item));
+        return result;
+    }
+
+    /** Reads the grid settings of simulation.txt (like ApplicationNodeImplementation::LoadSimulationConfig). */
+    void ReadSimulationConfig(const std::string& configFile, viscom::BatchSettings& settings)
+    {
+        std::ifstream ifs(configFile);
+        std::string str;
+        while (ifs >> str && ifs.good()) {
+            if (str == "gridSize.x=") ifs >> settings.gridSize_.x;
+            else if (str == "gridSize.y=") ifs >> settings.gridSize_.y;
+            else if (str == "scaleParametersToGrid=") ifs >> settings.scaleParametersToGrid_;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string resourceDirectory = "../resources";
+    std::string preset;
+    viscom::BatchSettings settings;
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    // the resource directory is needed first, the grid settings of simulation.txt can be overridden.
+    for (std::size_t i = 0; i + 1 < args.size(); ++i) if (args[i] == "--resources") resourceDirectory = args[i + 1];
+    ReadSimulationConfig(resourceDirectory + "/simulation.txt", settings);
+
+    try {
+        for (std::size_t i = 0; i < args.size(); ++i) {
+            const auto& arg = args[i];
+            const auto hasValue = i + 1 < args.size();
+            if (arg == "--no-scale") settings.scaleParametersToGrid_ = false;
+            else if (arg == "--spectral") settings.spectral_ = true;
+            else if (!hasValue) {
+                std::cerr << USAGE;
+                return EXIT_FAILURE;
+            }
+            else if (arg == "--resources") ++i;
+            else if (arg == "--preset") preset = args[++i];
+            else if (arg == "--seeds") settings.seedScriptFile_ = args[++i];
+            else if (arg == "--iterations") settings.iterations_ = std::stoull(args[++i]);
+            else if (arg == "--threads") settings.numThreads_ = std::stoul(args[++i]);
+            else if (arg == "--dump") settings.dumpIterations_ = ParseIterationList(args[++i]);
+            else if (arg == "--dump-every") settings.dumpInterval_ = std::stoull(args[++i]);
+            else if (arg == "--render") settings.renderIterations_ = ParseIterationList(args[++i]);
+            else if (arg == "--render-every") settings.renderInterval_ = std::stoull(args[++i]);
+            else if (arg == "--output") settings.outputDirectory_ = args[++i];
+            else if (arg == "--size") {
+                const auto& size = args[++i];
+                const auto separator = size.find('x');
+                settings.gridSize_ = glm::uvec2(std::stoul(size.substr(0, separator)), std::stoul(size.substr(separator + 1)));
+            }
+            else {
+                std::cerr << USAGE;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    catch (const std::exception&) {
+        std::cerr << USAGE;
+        return EXIT_FAILURE;
+    }
+    settings.gridSize_ = glm::max(settings.gridSize_, glm::uvec2(1));
+
+    viscom::SimulationData simData;
+    viscom::SimulationParameters parameters;
+    if (!preset.empty()) {
+        auto presetFile = preset;
+        for (const auto& entry : viscom::ReadPresetList(resourceDirectory + "/presetList.txt")) {
+            if (entry.first == preset) presetFile = resourceDirectory + "/" + entry.second;
+        }
+        if (!viscom::ReadPreset(presetFile, simData, parameters)) {
+            spdlog::error("Could not read the preset {}.", presetFile);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<viscom::BatchSeed> seeds;
+    if (settings.seedScriptFile_.empty()) seeds.push_back(viscom::BatchSeed{ 0, glm::vec2(0.5f) });
+    else if (!viscom::ReadSeedScript(settings.seedScriptFile_, seeds)) {
+        spdlog::error("Could not read the seed script {}.", settings.seedScriptFile_);
+        return EXIT_FAILURE;
+    }
+
+    viscom::BatchRun run{ settings, parameters, std::move(seeds) };
+    spdlog::info("Running {} iterations on a {}x{} grid ({} solver).", settings.iterations_, settings.gridSize_.x, settings.gridSize_.y,
+        settings.spectral_ ? "spectral" : "explicit");
+    if (!run.Run()) return EXIT_FAILURE;
+
+    const auto& summary = run.GetSummary();
+    const auto iterationsPerSecond = summary.simulationTime_ > 0.0 ? static_cast<double>(summary.iterations_) / summary.simulationTime_ : 0.0;
+    const auto cells = static_cast<double>(settings.gridSize_.x) * static_cast<double>(settings.gridSize_.y);
+    std::cout << "iterations: " << summary.iterations_ << "\n"
+        << "simulation time: " << summary.simulationTime_ << " s\n"
+        << "output time: " << summary.outputTime_ << " s\n"
+        << "iterations per second: " << iterationsPerSecond << "\n"
+        << "cell updates per second: " << iterationsPerSecond * cells << std::endl;
+    return EXIT_SUCCESS;
+}
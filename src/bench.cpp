@@ -0,0 +1,84 @@
+/**
+ * @file   bench.cpp
+ *
+ * @brief  Entry point of the benchmark suite (rd_bench).
+ */
+
+#include "app/BenchmarkNode.h"
+
+#include <core/main.h>
+
+#include <core/FrameworkInternal.h>
+#include <core/app_internal/ApplicationNodeInternal.h>
+#include <core/initialize.h>
+
+#include <spdlog/spdlog.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+    constexpr const char* USAGE =
+        "Usage: rd_bench [options] [framework.cfg]\n"
+        "  --output <file>        JSON report (default rd_bench.json)\n"
+        "  --baseline <file>      report to compare the results to, exits with 1 if a result regressed\n"
+        "  --threshold <percent>  change a result may get worse by before it is a regression (default 10)\n"
+        "  --min-time <seconds>   minimum time each case is measured for (default 1)\n"
+        "  --min-frames <n>       minimum frames each case is measured for (default 10)\n"
+        "  --quick                fewer and smaller cases (e.g. for llvmpipe)\n";
+}
+
+int main(int argc, char** argv)
+{
+    viscom::BenchmarkSettings settings;
+    std::string configFile = "framework.cfg";
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    try {
+        for (std::size_t i = 0; i < args.size(); ++i) {
+            const auto& arg = args[i];
+            const auto hasValue = i + 1 < args.size();
+            if (arg == "--quick") {
+                settings.quick_ = true;
+                settings.minCaseTime_ = 0.25;
+            }
+            else if (arg.compare(0, 2, "--") != 0) configFile = arg;
+            else if (!hasValue) {
+                std::cerr << USAGE;
+                return EXIT_FAILURE;
+            }
+            else if (arg == "--output") settings.outputFile_ = args[++i];
+            else if (arg == "--baseline") settings.baselineFile_ = args[++i];
+            else if (arg == "--threshold") settings.threshold_ = std::stod(args[++i]) / 100.0;
+            else if (arg == "--min-time") settings.minCaseTime_ = std::stod(args[++i]);
+            else if (arg == "--min-frames") settings.minCaseFrames_ = std::stoul(args[++i]);
+            else {
+                std::cerr << USAGE;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    catch (const std::exception&) {
+        std::cerr << USAGE;
+        return EXIT_FAILURE;
+    }
+
+    // the results go to the console, the log only shows problems.
+    spdlog::set_level(spdlog::level::warn);
+
+    auto config = viscom::LoadConfiguration(configFile);
+    // every node measures itself, the benchmark is meant for the single node configuration.
+    auto appNode = Application_Init(config, [&settings](viscom::ApplicationNodeInternal* node) { return std::make_unique<viscom::BenchmarkNode>(node, settings); },
+        [&settings](viscom::ApplicationNodeInternal* node) { return std::make_unique<viscom::BenchmarkNode>(node, settings); });
+
+    if (!appNode->IsInitialized()) {
+        spdlog::error("Could not start the benchmark.");
+        return EXIT_FAILURE;
+    }
+    // the benchmark node ends the process once all cases ran (see BenchmarkNode::Finish).
+    appNode->Render();
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file   sweep.cpp
+ *
+ * @brief  Entry point of the feed/kill parameter sweeps (no window, no OpenGL context).
+ */
+
+#include "app/ParameterSweep.h"
+#include "app/Presets.h"
+
+#include <spdlog/spdlog.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace {
+
+    constexpr const char* USAGE =
+        "Usage: ReactionDiffusionSweep [options]\n"
+        "  --resources <dir>      resource directory with presetList.txt (default ../resources)\n"
+        "  --preset <name|file>   preset the diffusion rates, time step and rendering settings are taken from\n"
+        "  --feed <min>:<max>     range of the feed rates (default 0.01:0.1)\n"
+        "  --kill <min>:<max>     range of the kill rates (default 0.045:0.07)\n"
+        "  --steps <k>x<f>        number of kill and feed rates (default 64x64)\n"
+        "  --size <w>x<h>         grid size of each simulation (default 64x64)\n"
+        "  --iterations <n>       iterations of each simulation (default 10000)\n"
+        "  --tile <n>             atlas tile size in pixels (default 32)\n"
+        "  --presets <n>          presets written per pattern class (default 3)\n"
+        "  --threads <n>          number of threads (default all cores)\n"
+        "  --output <dir>         output directory (default .)\n";
+
+    glm::vec2 ParseRange(const std::string& range)
+    {
+        const auto separator = range.find(':');
+        return glm::vec2(std::stof(range.substr(0, separator)), std::stof(range.substr(separator + 1)));
+    }
+
+    glm::uvec2 ParseSize(const std::string& size)
+    {
+        const auto separator = size.find('x');
+        return glm::uvec2(std::stoul(size.substr(0, separator)), std::stoul(size.substr(separator + 1)));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string resourceDirectory = "../resources";
+    std::string preset;
+    viscom::SweepSettings settings;
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    try {
+        for (std::size_t i = 0; i < args.size(); ++i) {
+            const auto& arg = args[i];
+            if (i + 1 >= args.size()) {
+                std::cerr << USAGE;
+                return EXIT_FAILURE;
+            }
+            else if (arg == "--resources") resourceDirectory = args[++i];
+            else if (arg == "--preset") preset = args[++i];
+            else if (arg == "--feed") settings.feedRange_ = ParseRange(args[++i]);
+            else if (arg == "--kill") settings.killRange_ = ParseRange(args[++i]);
+            else if (arg == "--steps") settings.steps_ = ParseSize(args[++i]);
+            else if (arg == "--size") settings.gridSize_ = ParseSize(args[++i]);
+            else if (arg == "--iterations") settings.iterations_ = std::stoull(args[++i]);
+            else if (arg == "--tile") settings.tileSize_ = static_cast<unsigned int>(std::stoul(args[++i]));
+            else if (arg == "--presets") settings.presetsPerClass_ = std::stoul(args[++i]);
+            else if (arg == "--threads") settings.numThreads_ = std::stoul(args[++i]);
+            else if (arg == "--output") settings.outputDirectory_ = args[++i];
+            else {
+                std::cerr << USAGE;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    catch (const std::exception&) {
+        std::cerr << USAGE;
+        return EXIT_FAILURE;
+    }
+
+    viscom::SimulationData simData;
+    viscom::SimulationParameters parameters;
+    if (!preset.empty()) {
+        auto presetFile = preset;
+        for (const auto& entry : viscom::ReadPresetList(resourceDirectory + "/presetList.txt")) {
+            if (entry.first == preset) presetFile = resourceDirectory + "/" + entry.second;
+        }
+        if (!viscom::ReadPreset(presetFile, simData, parameters)) {
+            spdlog::error("Could not read the preset {}.", presetFile);
+            return EXIT_FAILURE;
+        }
+    }
+
+    viscom::ParameterSweep sweep{ settings, simData, parameters };
+    if (!sweep.Run()) return EXIT_FAILURE;
+
+    std::array<std::size_t, viscom::PATTERN_CLASS_NAMES.size()> classCounts{};
+    for (const auto& result : sweep.GetResults()) ++classCounts[static_cast<std::size_t>(result.class_)];
+    const auto cellUpdates = static_cast<double>(sweep.GetResults().size()) * settings.gridSize_.x * settings.gridSize_.y * static_cast<double>(settings.iterations_);
+    std::cout << "pairs: " << sweep.GetResults().size() << "\n"
+        << "simulation time: " << sweep.GetSimulationTime() << " s\n"
+        << "cell updates per second: " << (sweep.GetSimulationTime() > 0.0 ? cellUpdates / sweep.GetSimulationTime() : 0.0) << "\n";
+    for (std::size_t i = 0; i < classCounts.size(); ++i) std::cout << viscom::PATTERN_CLASS_NAMES[i] << ": " << classCounts[i] << "\n";
+    std::cout << std::flush;
+    return EXIT_SUCCESS;
+}